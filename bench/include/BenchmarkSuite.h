@@ -0,0 +1,99 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef BENCHMARKSUITE_H_INCLUDED
+#define BENCHMARKSUITE_H_INCLUDED
+
+// Includes:
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define BENCH_DEFAULT_MIN_TIME   0.5
+#define BENCH_REPETITIONS        5
+
+/// The body of a benchmark. It is called with the number of operations to do,
+/// and is timed as a whole
+typedef function<void(size_t operations)> bench_function_t;
+
+/// The result of running a benchmark
+typedef struct bench_result_t
+{
+	/// The name of the benchmark
+	string name;
+
+	/// What one operation is, e.g. "post"
+	string unit;
+
+	/// The number of operations in each timed repetition
+	size_t operations;
+
+	/// The median, fastest and slowest time per operation, in nanoseconds
+	double medianNs, minNs, maxNs;
+} bench_result_t;
+
+/// The BenchmarkSuite class holds a set of named microbenchmarks and times
+/// them. Each benchmark is first run with more and more operations until a run
+/// takes a measurable time, then that many operations are repeated several
+/// times and the median time per operation reported, so that a stray context
+/// switch doesn't skew the result. Results are written as one JSON object per
+/// line so that runs from different commits can be compared by a script.
+/// @author Clayton Peters
+class BenchmarkSuite
+{
+	public:
+		/// Constructs a new BenchmarkSuite object
+		/// @param _minTime The least time, in seconds, each repetition of a
+		/// benchmark should take
+		BenchmarkSuite(double _minTime = BENCH_DEFAULT_MIN_TIME);
+
+		/// Adds a benchmark
+		/// @param name The name of the benchmark, with groups separated by
+		/// slashes, e.g. "filter/check"
+		/// @param unit What one operation is, e.g. "post"
+		/// @param function The body of the benchmark
+		void add(const string& name, const string& unit, bench_function_t function);
+
+		/// Gets the names of the benchmarks, in the order they were added
+		vector<string> getNames() const;
+
+		/// Runs the benchmarks whose names start with any of the given
+		/// prefixes, or all of them if there are none, writing each result
+		/// as it finishes
+		/// @param prefixes The prefixes to select benchmarks with
+		/// @param out Where to write the results
+		/// @returns The number of benchmarks run
+		size_t run(const vector<string>& prefixes, FILE* out);
+
+		/// Stops the compiler from optimising away a value that a benchmark
+		/// computes but doesn't otherwise use
+		static void keep(size_t value);
+
+	private:
+		/// A benchmark
+		typedef struct benchmark_t
+		{
+			string name, unit;
+			bench_function_t function;
+		} benchmark_t;
+
+		/// Times a benchmark
+		bench_result_t measure(const benchmark_t& benchmark);
+
+		/// Writes a result as a line of JSON
+		static void write(const bench_result_t& result, FILE* out);
+
+		/// The least time each repetition should take, in seconds
+		double minTime;
+
+		/// The benchmarks
+		vector<benchmark_t> benchmarks;
+};
+
+#endif
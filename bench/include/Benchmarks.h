@@ -0,0 +1,27 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef BENCHMARKS_H_INCLUDED
+#define BENCHMARKS_H_INCLUDED
+
+// Includes:
+#include "BenchmarkSuite.h"
+
+/// Adds the moderation filter benchmarks
+void addFilterBenchmarks(BenchmarkSuite& suite);
+
+/// Adds the UTF-8 string benchmarks
+void addUtf8Benchmarks(BenchmarkSuite& suite);
+
+/// Adds the property list benchmarks
+void addPropertyBenchmarks(BenchmarkSuite& suite);
+
+/// Adds the plugin lookup benchmarks, if there are plugins to look up
+/// @param pluginsPath The path to search for plugins in
+void addPluginBenchmarks(BenchmarkSuite& suite, const string& pluginsPath);
+
+/// Adds the download benchmarks, against a server on the loopback address
+void addDownloadBenchmarks(BenchmarkSuite& suite);
+
+#endif
@@ -0,0 +1,72 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef LOOPBACKSERVER_H_INCLUDED
+#define LOOPBACKSERVER_H_INCLUDED
+
+// Includes:
+#include <string>
+#include <thread>
+#include <atomic>
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define LOOPBACK_MAX_BODY          (1024 * 1024)
+#define LOOPBACK_POLL_MS           100
+#define LOOPBACK_REQUEST_SIZE      4096
+
+/// The LoopbackServer class is a minimal HTTP server on 127.0.0.1, so that
+/// downloads can be benchmarked without the network getting in the way. A GET
+/// of "/<n>" is answered with n bytes (at most LOOPBACK_MAX_BODY), and every
+/// connection is closed after one response, as libaura makes a new connection
+/// for each download.
+/// @author Clayton Peters
+class LoopbackServer
+{
+	public:
+		/// Constructs a new LoopbackServer object, listening on a port of the
+		/// system's choosing, and starts serving
+		/// @throws AuraException if the server couldn't be started
+		LoopbackServer();
+
+		/// Destroys a LoopbackServer object, stopping the server
+		~LoopbackServer();
+
+		/// Gets the URL of a response of the given size
+		/// @param size The number of bytes in the body
+		string getUrl(size_t size) const;
+
+		/// Gets the number of requests answered
+		unsigned long long getRequestCount() const;
+
+	private:
+		LoopbackServer(const LoopbackServer&);
+		LoopbackServer& operator=(const LoopbackServer&);
+
+		/// Entry point for the thread that answers requests
+		void serverMain();
+
+		/// Reads a request from a connection and answers it
+		void handleConnection(int fd);
+
+		/// The listening socket, and the port it's on
+		int listenFd;
+		unsigned short port;
+
+		/// The body that responses are cut from
+		string body;
+
+		/// The number of requests answered
+		atomic<unsigned long long> requestCount;
+
+		/// Set when the server is to stop
+		atomic<bool> stopping;
+
+		/// The thread that answers requests
+		thread serverThread;
+};
+
+#endif
@@ -0,0 +1,49 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef POSTCORPUS_H_INCLUDED
+#define POSTCORPUS_H_INCLUDED
+
+// Includes:
+#include <string>
+#include <vector>
+#include <random>
+
+// Namespaces:
+using namespace std;
+
+/// The PostCorpus class makes text that looks like social media posts to feed
+/// benchmarks: mostly English words with some accented, Greek, Cyrillic, CJK
+/// and emoji text, hashtags, mentions and links, up to a tweet's length. The
+/// same seed always gives the same posts, so runs are comparable.
+/// @author Clayton Peters
+class PostCorpus
+{
+	public:
+		/// Constructs a new PostCorpus object
+		/// @param count The number of posts to make
+		/// @param seed The seed for the random number generator
+		PostCorpus(size_t count, unsigned int seed = 1);
+
+		/// Gets the posts
+		const vector<string>& getPosts() const;
+
+		/// Gets the total length of the posts in bytes
+		size_t getByteCount() const;
+
+		/// Makes a random word of lower case ASCII letters
+		/// @param random The random number generator to use
+		/// @param minLength The shortest the word can be
+		/// @param maxLength The longest the word can be
+		static string makeWord(mt19937& random, size_t minLength, size_t maxLength);
+
+	private:
+		/// The posts
+		vector<string> posts;
+
+		/// The total length of the posts in bytes
+		size_t byteCount;
+};
+
+#endif
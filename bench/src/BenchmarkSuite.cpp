@@ -0,0 +1,132 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <algorithm>
+#include <chrono>
+#include "BenchmarkSuite.h"
+
+/// Somewhere for keep() to write to that the compiler can't see through
+static volatile size_t g_kept;
+
+/// Constructs a new BenchmarkSuite object
+/// @param _minTime The least time, in seconds, each repetition of a benchmark
+/// should take
+BenchmarkSuite::BenchmarkSuite(double _minTime) :
+	minTime(_minTime)
+{
+}
+
+/// Adds a benchmark
+/// @param name The name of the benchmark, with groups separated by slashes,
+/// e.g. "filter/check"
+/// @param unit What one operation is, e.g. "post"
+/// @param function The body of the benchmark
+void BenchmarkSuite::add(const string& name, const string& unit, bench_function_t function)
+{
+	benchmark_t benchmark;
+	benchmark.name = name;
+	benchmark.unit = unit;
+	benchmark.function = function;
+	benchmarks.push_back(benchmark);
+}
+
+/// Gets the names of the benchmarks, in the order they were added
+vector<string> BenchmarkSuite::getNames() const
+{
+	vector<string> names;
+	for (auto& benchmark : benchmarks)
+	{
+		names.push_back(benchmark.name);
+	}
+
+	return names;
+}
+
+/// Runs the benchmarks whose names start with any of the given prefixes, or
+/// all of them if there are none, writing each result as it finishes
+/// @param prefixes The prefixes to select benchmarks with
+/// @param out Where to write the results
+/// @returns The number of benchmarks run
+size_t BenchmarkSuite::run(const vector<string>& prefixes, FILE* out)
+{
+	size_t count = 0;
+	for (auto& benchmark : benchmarks)
+	{
+		bool selected = prefixes.empty();
+		for (auto& prefix : prefixes)
+		{
+			if (benchmark.name.compare(0, prefix.length(), prefix) == 0)
+			{
+				selected = true;
+				break;
+			}
+		}
+		if (!selected)
+		{
+			continue;
+		}
+
+		write(measure(benchmark), out);
+		fflush(out);
+		count++;
+	}
+
+	return count;
+}
+
+/// Stops the compiler from optimising away a value that a benchmark computes
+/// but doesn't otherwise use
+void BenchmarkSuite::keep(size_t value)
+{
+	g_kept = value;
+}
+
+/// Times a benchmark
+bench_result_t BenchmarkSuite::measure(const benchmark_t& benchmark)
+{
+	auto time = [&benchmark](size_t operations)
+	{
+		auto start = chrono::steady_clock::now();
+		benchmark.function(operations);
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	};
+
+	// Find how many operations take a measurable time, then scale that up
+	// to the minimum (this also warms the caches)
+	size_t operations = 1;
+	double elapsed;
+	while ((elapsed = time(operations)) < minTime / 10.0 && operations < ((size_t)1 << 40))
+	{
+		operations *= 2;
+	}
+	if (elapsed < minTime)
+	{
+		operations = (size_t)(operations * minTime / (elapsed > 0.0 ? elapsed : 1e-9)) + 1;
+	}
+
+	vector<double> perOperation;
+	for (int i = 0; i < BENCH_REPETITIONS; i++)
+	{
+		perOperation.push_back(time(operations) * 1e9 / operations);
+	}
+	sort(perOperation.begin(), perOperation.end());
+
+	bench_result_t result;
+	result.name = benchmark.name;
+	result.unit = benchmark.unit;
+	result.operations = operations;
+	result.medianNs = perOperation[BENCH_REPETITIONS / 2];
+	result.minNs = perOperation.front();
+	result.maxNs = perOperation.back();
+	return result;
+}
+
+/// Writes a result as a line of JSON
+void BenchmarkSuite::write(const bench_result_t& result, FILE* out)
+{
+	// Names and units are ours, so they never need escaping
+	fprintf(out, "{\"name\":\"%s\",\"unit\":\"%s\",\"operations\":%zu,\"ns_per_op\":%.3f,\"min_ns_per_op\":%.3f,\"max_ns_per_op\":%.3f,\"ops_per_second\":%.1f}\n",
+		result.name.c_str(), result.unit.c_str(), result.operations, result.medianNs, result.minNs, result.maxNs, result.medianNs > 0.0 ? 1e9 / result.medianNs : 0.0);
+}
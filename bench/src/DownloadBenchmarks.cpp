@@ -0,0 +1,52 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <stdio.h>
+#include <memory>
+#include "AuraException.h"
+#include "Benchmarks.h"
+#include "LoopbackServer.h"
+
+/// Adds a benchmark of downloading a response of the given size
+static void add_sync_benchmark(BenchmarkSuite& suite, shared_ptr<LoopbackServer> server, const string& name, size_t size)
+{
+	string url = server->getUrl(size);
+	suite.add(name, "download", [server, url, size](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			aura_download_data_t* data = aura_download_sync(url.c_str());
+			if (data != NULL)
+			{
+				total += data->responseCode == 200 && data->dataLength == size;
+				aura_free_download_data(data);
+			}
+		}
+		BenchmarkSuite::keep(total);
+	});
+}
+
+/// Adds the download benchmarks, which download from a server on the loopback
+/// address so that what's measured is libaura's (and curl's) overhead rather
+/// than the network's
+void addDownloadBenchmarks(BenchmarkSuite& suite)
+{
+	shared_ptr<LoopbackServer> server;
+	try
+	{
+		server.reset(new LoopbackServer());
+	}
+	catch (AuraException& e)
+	{
+		fprintf(stderr, "Skipping download benchmarks: %s\n", e.what());
+		return;
+	}
+
+	// About the size of an API response, and of a photo
+	add_sync_benchmark(suite, server, "download/sync/1k", 1024);
+	add_sync_benchmark(suite, server, "download/sync/256k", 256 * 1024);
+}
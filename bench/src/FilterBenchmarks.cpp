@@ -0,0 +1,156 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <ctype.h>
+#include <memory>
+#include <thread>
+#include "Benchmarks.h"
+#include "PostCorpus.h"
+
+// Definitions:
+#define FILTER_BENCH_TERMS           10000
+#define FILTER_BENCH_ALLOWED         200
+#define FILTER_BENCH_POSTS           10000
+#define FILTER_BENCH_BLOCKED_RATE    50
+#define FILTER_BENCH_MALFORMED_RATE  100
+#define FILTER_BENCH_OVERLONG_NUL    "\xC0\x80"
+
+/// The blocklist, allowlist and posts the filter benchmarks share
+typedef struct filter_bench_data_t
+{
+	vector<string> blocked, allowed;
+	vector<const char*> blockedPointers, allowedPointers;
+	vector<string> posts;
+	aura_filter_t filter;
+
+	~filter_bench_data_t()
+	{
+		aura_filter_delete(filter);
+	}
+} filter_bench_data_t;
+
+/// Makes the blocklist, allowlist and posts
+static shared_ptr<filter_bench_data_t> make_data()
+{
+	shared_ptr<filter_bench_data_t> data(new filter_bench_data_t);
+	mt19937 random(42);
+
+	// Mostly single words, with some phrases and some non-ASCII terms
+	for (size_t i = 0; i < FILTER_BENCH_TERMS; i++)
+	{
+		string term = PostCorpus::makeWord(random, 5, 12);
+		unsigned int kind = random() % 10;
+		if (kind == 0)
+		{
+			term += " " + PostCorpus::makeWord(random, 3, 8);
+		}
+		else if (kind == 1)
+		{
+			term += "ñé";
+		}
+		else if (i % FILTER_BENCH_MALFORMED_RATE == 0)
+		{
+			term += FILTER_BENCH_OVERLONG_NUL;
+		}
+		data->blocked.push_back(term);
+	}
+
+	// Allowed terms contain a blocked one, as they would to let through an
+	// innocent word that has a rude one inside it
+	for (size_t i = 0; i < FILTER_BENCH_ALLOWED; i++)
+	{
+		data->allowed.push_back("un" + data->blocked[random() % FILTER_BENCH_TERMS] + "ly");
+	}
+
+	for (auto& term : data->blocked)
+	{
+		data->blockedPointers.push_back(term.c_str());
+	}
+	for (auto& term : data->allowed)
+	{
+		data->allowedPointers.push_back(term.c_str());
+	}
+
+	// Some posts get a blocked term, in upper case, so that matches are
+	// part of what is measured
+	PostCorpus corpus(FILTER_BENCH_POSTS);
+	data->posts = corpus.getPosts();
+	for (size_t i = 0; i < data->posts.size(); i += FILTER_BENCH_BLOCKED_RATE)
+	{
+		string term = data->blocked[random() % FILTER_BENCH_TERMS];
+		for (auto& c : term)
+		{
+			c = toupper(c);
+		}
+		data->posts[i] += " " + term;
+	}
+
+	// Some posts have malformed UTF-8 in them, which is stepped over as a
+	// replacement character like any other bad byte
+	for (size_t i = FILTER_BENCH_MALFORMED_RATE / 2; i < data->posts.size(); i += FILTER_BENCH_MALFORMED_RATE)
+	{
+		data->posts[i].insert(data->posts[i].size() / 2, FILTER_BENCH_OVERLONG_NUL);
+	}
+
+	data->filter = aura_filter_create();
+	aura_filter_set_rules(data->filter, aura_filter_rules_compile(&data->blockedPointers[0], data->blockedPointers.size(), &data->allowedPointers[0], data->allowedPointers.size()));
+	return data;
+}
+
+/// Adds the moderation filter benchmarks
+void addFilterBenchmarks(BenchmarkSuite& suite)
+{
+	shared_ptr<filter_bench_data_t> data = make_data();
+
+	suite.add("filter/compile/10k", "list", [data](size_t operations)
+	{
+		for (size_t i = 0; i < operations; i++)
+		{
+			aura_filter_rules_t rules = aura_filter_rules_compile(&data->blockedPointers[0], data->blockedPointers.size(), &data->allowedPointers[0], data->allowedPointers.size());
+			BenchmarkSuite::keep(aura_filter_rules_get_state_count(rules));
+			aura_filter_rules_delete(rules);
+		}
+	});
+
+	suite.add("filter/check/10k", "post", [data](size_t operations)
+	{
+		size_t blocked = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			blocked += aura_filter_check(data->filter, data->posts[i % data->posts.size()].c_str(), NULL);
+		}
+		BenchmarkSuite::keep(blocked);
+	});
+
+	// Every thread checks with the same filter, as the live display and the
+	// filter tool would, so this shows how well sharing the rules scales
+	suite.add("filter/check/10k/threads", "post", [data](size_t operations)
+	{
+		unsigned int threadCount = thread::hardware_concurrency();
+		if (threadCount == 0)
+		{
+			threadCount = 1;
+		}
+
+		vector<thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.push_back(thread([data, operations, threadCount, t]
+			{
+				size_t blocked = 0;
+				for (size_t i = t; i < operations; i += threadCount)
+				{
+					blocked += aura_filter_check(data->filter, data->posts[i % data->posts.size()].c_str(), NULL);
+				}
+				BenchmarkSuite::keep(blocked);
+			}));
+		}
+		for (auto& worker : threads)
+		{
+			worker.join();
+		}
+	});
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "LoopbackServer.h"
+#include "AuraException.h"
+
+/// Constructs a new LoopbackServer object, listening on a port of the system's
+/// choosing, and starts serving
+LoopbackServer::LoopbackServer() :
+	listenFd(-1),
+	port(0),
+	body(LOOPBACK_MAX_BODY, 'x'),
+	requestCount(0),
+	stopping(false)
+{
+	listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	if (listenFd < 0 ||
+		bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(listenFd, SOMAXCONN) != 0 ||
+		getsockname(listenFd, (struct sockaddr*)&address, &addressLength) != 0)
+	{
+		string reason = strerror(errno);
+		if (listenFd >= 0)
+		{
+			close(listenFd);
+		}
+		throw AuraException(AURA_ERR_BENCHSERVERFAILED, "Failed to listen on the loopback address: " + reason);
+	}
+	port = ntohs(address.sin_port);
+
+	serverThread = thread(&LoopbackServer::serverMain, this);
+}
+
+/// Destroys a LoopbackServer object, stopping the server
+LoopbackServer::~LoopbackServer()
+{
+	stopping = true;
+	serverThread.join();
+	close(listenFd);
+}
+
+/// Gets the URL of a response of the given size
+/// @param size The number of bytes in the body
+string LoopbackServer::getUrl(size_t size) const
+{
+	return "http://127.0.0.1:" + to_string(port) + "/" + to_string(size);
+}
+
+/// Gets the number of requests answered
+unsigned long long LoopbackServer::getRequestCount() const
+{
+	return requestCount;
+}
+
+/// Entry point for the thread that answers requests. Downloads are benchmarked
+/// one at a time, so connections are answered one at a time too
+void LoopbackServer::serverMain()
+{
+	while (!stopping)
+	{
+		struct pollfd pollFd;
+		pollFd.fd = listenFd;
+		pollFd.events = POLLIN;
+		if (poll(&pollFd, 1, LOOPBACK_POLL_MS) <= 0)
+		{
+			continue;
+		}
+
+		int fd = accept(listenFd, NULL, NULL);
+		if (fd >= 0)
+		{
+			handleConnection(fd);
+			close(fd);
+		}
+	}
+}
+
+/// Reads a request from a connection and answers it
+void LoopbackServer::handleConnection(int fd)
+{
+	// Read up to the end of the headers
+	char request[LOOPBACK_REQUEST_SIZE];
+	size_t length = 0;
+	while (length < sizeof(request) - 1)
+	{
+		ssize_t received = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+		if (received <= 0)
+		{
+			return;
+		}
+		length += received;
+		request[length] = '\0';
+		if (strstr(request, "\r\n\r\n") != NULL)
+		{
+			break;
+		}
+	}
+
+	size_t size = 0;
+	const char* status = "200 OK";
+	if (strncmp(request, "GET /", 5) != 0)
+	{
+		status = "405 Method Not Allowed";
+	}
+	else
+	{
+		size = strtoul(request + 5, NULL, 10);
+		if (size > body.size())
+		{
+			size = body.size();
+		}
+	}
+
+	char headers[256];
+	int headersLength = snprintf(headers, sizeof(headers), "HTTP/1.1 %s\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", status, size);
+	if (send(fd, headers, headersLength, MSG_NOSIGNAL) != headersLength)
+	{
+		return;
+	}
+
+	size_t sent = 0;
+	while (sent < size)
+	{
+		ssize_t result = send(fd, body.data() + sent, size - sent, MSG_NOSIGNAL);
+		if (result <= 0)
+		{
+			return;
+		}
+		sent += result;
+	}
+	requestCount++;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <stdio.h>
+#include <memory>
+#include "AuraException.h"
+#include "Benchmarks.h"
+#include "PluginLoader.h"
+
+/// Adds the plugin lookup benchmarks. Plugins are loaded from the given path
+/// (and any linked in), and the benchmarks are skipped if there are none
+/// @param pluginsPath The path to search for plugins in
+void addPluginBenchmarks(BenchmarkSuite& suite, const string& pluginsPath)
+{
+	shared_ptr<PluginLoader> loader;
+	try
+	{
+		loader.reset(new PluginLoader(pluginsPath));
+	}
+	catch (AuraException& e)
+	{
+		fprintf(stderr, "Skipping plugin benchmarks: %s\n", e.what());
+		return;
+	}
+
+	// Look up every object type there is, as the display does when it builds
+	// a scene
+	shared_ptr<vector<aura_object_class_t>> classes(new vector<aura_object_class_t>);
+	shared_ptr<vector<aura_object_class_t>> missingClasses(new vector<aura_object_class_t>);
+	static const aura_plugin_type_t pluginTypes[] = { AURA_PLUGIN_TYPE_ELEMENT, AURA_PLUGIN_TYPE_SOURCE, AURA_PLUGIN_TYPE_TRANSITION, AURA_PLUGIN_TYPE_LAYOUT };
+	for (auto pluginType : pluginTypes)
+	{
+		for (auto& objectType : loader->getObjectTypes(pluginType))
+		{
+			classes->push_back(aura_object_class_t(pluginType, objectType));
+			missingClasses->push_back(aura_object_class_t(pluginType, objectType + "-missing"));
+		}
+	}
+	if (classes->empty())
+	{
+		fprintf(stderr, "Skipping plugin benchmarks: No plugins found in '%s'\n", pluginsPath.c_str());
+		return;
+	}
+
+	suite.add("plugins/lookup", "lookup", [loader, classes](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			const aura_object_class_t& objectClass = (*classes)[i % classes->size()];
+			total += loader->getPluginFor(objectClass.first, objectClass.second) != NULL;
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	suite.add("plugins/lookup/missing", "lookup", [loader, missingClasses](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			const aura_object_class_t& objectClass = (*missingClasses)[i % missingClasses->size()];
+			total += loader->getPluginFor(objectClass.first, objectClass.second) != NULL;
+		}
+		BenchmarkSuite::keep(total);
+	});
+}
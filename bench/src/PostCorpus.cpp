@@ -0,0 +1,114 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include "PostCorpus.h"
+
+// Definitions:
+#define POST_MAX_CHARACTERS   280
+
+/// Common English words, which make up most of a post
+static const char* g_words[] = {
+	"the", "and", "to", "of", "a", "in", "is", "it", "you", "that", "was", "for",
+	"on", "are", "with", "as", "at", "be", "this", "have", "from", "or", "one",
+	"had", "by", "but", "not", "what", "all", "were", "we", "when", "your", "can",
+	"said", "there", "use", "an", "each", "which", "she", "do", "how", "their",
+	"if", "will", "up", "other", "about", "out", "many", "then", "them", "these",
+	"so", "some", "would", "make", "like", "him", "into", "time", "has", "look",
+	"two", "more", "write", "go", "see", "number", "no", "way", "could", "people",
+	"tonight", "amazing", "stage", "crowd", "festival", "music", "photo", "live",
+	"Thanks", "Great", "Love", "Wow", "Can't", "wait", "OMG", "Best", "ever"
+};
+
+/// Words and phrases from other scripts
+static const char* g_foreignWords[] = {
+	"café", "naïve", "Straße", "größeren", "Über", "déjà", "vu", "señor", "mañana",
+	"Ξεσκεπάζω", "ψυχοφθόρα", "βδελυγμία", "Съешь", "мягких", "французских",
+	"булок", "東京", "コンサート", "最高", "音楽", "你好", "世界", "서울", "감사합니다",
+	"🎉", "🔥", "😍", "👍", "🎶", "❤️"
+};
+
+/// Constructs a new PostCorpus object
+/// @param count The number of posts to make
+/// @param seed The seed for the random number generator
+PostCorpus::PostCorpus(size_t count, unsigned int seed) :
+	byteCount(0)
+{
+	mt19937 random(seed);
+	size_t wordCount = sizeof(g_words) / sizeof(g_words[0]);
+	size_t foreignCount = sizeof(g_foreignWords) / sizeof(g_foreignWords[0]);
+	for (size_t i = 0; i < count; i++)
+	{
+		// Lengths are spread from a few words to the limit
+		size_t target = 20 + random() % (POST_MAX_CHARACTERS - 20);
+		string post;
+		size_t characters = 0;
+		while (characters < target)
+		{
+			string word;
+			unsigned int kind = random() % 100;
+			if (kind < 80)
+			{
+				word = g_words[random() % wordCount];
+			}
+			else if (kind < 92)
+			{
+				word = g_foreignWords[random() % foreignCount];
+			}
+			else if (kind < 96)
+			{
+				word = (random() % 2 ? "#" : "@") + makeWord(random, 4, 12);
+			}
+			else
+			{
+				word = "https://t.co/" + makeWord(random, 10, 10);
+			}
+
+			size_t wordCharacters = utf8len(word.c_str());
+			if (characters + wordCharacters + 1 > POST_MAX_CHARACTERS)
+			{
+				break;
+			}
+			if (!post.empty())
+			{
+				post += ' ';
+				characters++;
+			}
+			post += word;
+			characters += wordCharacters;
+		}
+
+		byteCount += post.length();
+		posts.push_back(post);
+	}
+}
+
+/// Gets the posts
+const vector<string>& PostCorpus::getPosts() const
+{
+	return posts;
+}
+
+/// Gets the total length of the posts in bytes
+size_t PostCorpus::getByteCount() const
+{
+	return byteCount;
+}
+
+/// Makes a random word of lower case ASCII letters
+/// @param random The random number generator to use
+/// @param minLength The shortest the word can be
+/// @param maxLength The longest the word can be
+string PostCorpus::makeWord(mt19937& random, size_t minLength, size_t maxLength)
+{
+	size_t length = minLength + random() % (maxLength - minLength + 1);
+	string word;
+	for (size_t i = 0; i < length; i++)
+	{
+		word += (char)('a' + random() % 26);
+	}
+
+	return word;
+}
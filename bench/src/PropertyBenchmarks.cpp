@@ -0,0 +1,126 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <stdio.h>
+#include <memory>
+#include "Benchmarks.h"
+
+// Definitions:
+#define PROPERTY_BENCH_COUNT      1000
+
+/// A property list, and the properties and names in it. Property lists don't
+/// own their properties, so they're kept here
+typedef struct property_bench_data_t
+{
+	vector<string> names, missingNames;
+	vector<aura_property_int_t*> properties;
+	aura_properties_t list;
+
+	~property_bench_data_t()
+	{
+		aura_delete_property_list(list);
+		for (auto property : properties)
+		{
+			delete property;
+		}
+	}
+} property_bench_data_t;
+
+/// Makes the properties, with names like the ones plugins give theirs, and a
+/// list of all of them
+static shared_ptr<property_bench_data_t> make_data()
+{
+	shared_ptr<property_bench_data_t> data(new property_bench_data_t);
+	static const char* kinds[] = { "colour", "font", "position", "size", "border", "shadow", "opacity", "source" };
+
+	char name[64];
+	for (size_t i = 0; i < PROPERTY_BENCH_COUNT; i++)
+	{
+		snprintf(name, sizeof(name), "%s_%zu", kinds[i % (sizeof(kinds) / sizeof(kinds[0]))], i);
+		data->names.push_back(name);
+		snprintf(name, sizeof(name), "%s_%zu_missing", kinds[i % (sizeof(kinds) / sizeof(kinds[0]))], i);
+		data->missingNames.push_back(name);
+	}
+
+	data->list = aura_create_property_list();
+	for (auto& propertyName : data->names)
+	{
+		aura_property_int_t* property = (aura_property_int_t*)aura_allocate_property(AURA_VARTYPE_INT);
+		property->super.name = propertyName.c_str();
+		data->properties.push_back(property);
+		aura_add_property(data->list, &property->super);
+	}
+
+	return data;
+}
+
+/// Adds the property list benchmarks
+void addPropertyBenchmarks(BenchmarkSuite& suite)
+{
+	shared_ptr<property_bench_data_t> data = make_data();
+
+	suite.add("properties/build/1k", "list", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			aura_properties_t list = aura_create_property_list();
+			for (auto property : data->properties)
+			{
+				aura_add_property(list, &property->super);
+			}
+			total += aura_get_property_count(list);
+			aura_delete_property_list(list);
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	suite.add("properties/get/1k", "lookup", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			total += aura_get_property(data->list, data->names[i % data->names.size()].c_str()) != NULL;
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	suite.add("properties/get/1k/missing", "lookup", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			total += aura_get_property(data->list, data->missingNames[i % data->missingNames.size()].c_str()) != NULL;
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	// Walking a list by index is how properties are shown and saved
+	suite.add("properties/iterate/1k", "list", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			size_t count = aura_get_property_count(data->list);
+			for (size_t j = 0; j < count; j++)
+			{
+				total += aura_get_property_at(data->list, j)->type;
+			}
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	suite.add("properties/replace/1k", "property", [data](size_t operations)
+	{
+		for (size_t i = 0; i < operations; i++)
+		{
+			aura_property_int_t* property = data->properties[i % data->properties.size()];
+			aura_delete_property(data->list, property->super.name);
+			aura_add_property(data->list, &property->super);
+		}
+		BenchmarkSuite::keep(aura_get_property_count(data->list));
+	});
+}
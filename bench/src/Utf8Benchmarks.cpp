@@ -0,0 +1,104 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <string.h>
+#include <memory>
+#include "Benchmarks.h"
+#include "PostCorpus.h"
+
+// Definitions:
+#define UTF8_BENCH_POSTS          10000
+#define UTF8_BENCH_BUFFER_SIZE    4096
+
+/// The posts the UTF-8 benchmarks share, with their lengths in characters and
+/// a copy of each so that comparing equal posts doesn't just compare pointers
+typedef struct utf8_bench_data_t
+{
+	vector<string> posts, copies;
+	vector<size_t> lengths;
+	char buffer[UTF8_BENCH_BUFFER_SIZE];
+} utf8_bench_data_t;
+
+/// Makes the posts
+static shared_ptr<utf8_bench_data_t> make_data()
+{
+	shared_ptr<utf8_bench_data_t> data(new utf8_bench_data_t);
+	PostCorpus corpus(UTF8_BENCH_POSTS);
+	data->posts = corpus.getPosts();
+	for (auto& post : data->posts)
+	{
+		data->copies.push_back(string(post.c_str()));
+		data->lengths.push_back(utf8len(post.c_str()));
+	}
+
+	// utf8ncpy() looks past what it copied, so start from an empty buffer
+	memset(data->buffer, 0, sizeof(data->buffer));
+	return data;
+}
+
+/// Adds the UTF-8 string benchmarks
+void addUtf8Benchmarks(BenchmarkSuite& suite)
+{
+	shared_ptr<utf8_bench_data_t> data = make_data();
+
+	suite.add("utf8/length", "post", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			total += utf8len(data->posts[i % data->posts.size()].c_str());
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	// Halfway through is the average place that text is split or truncated
+	suite.add("utf8/index/middle", "post", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			size_t post = i % data->posts.size();
+			const char* s = data->posts[post].c_str();
+			total += utf8idx(s, data->lengths[post] / 2) - s;
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	suite.add("utf8/copy/half", "post", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			size_t post = i % data->posts.size();
+			total += utf8ncpy(data->buffer, data->posts[post].c_str(), data->lengths[post] / 2) != NULL;
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	// Equal posts are compared all the way to the end, which is the worst case
+	suite.add("utf8/compare/equal", "post", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			size_t post = i % data->posts.size();
+			total += utf8ncmp(data->posts[post].c_str(), data->copies[post].c_str(), data->lengths[post]) == 0;
+		}
+		BenchmarkSuite::keep(total);
+	});
+
+	suite.add("utf8/compare/different", "post", [data](size_t operations)
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < operations; i++)
+		{
+			size_t post = i % data->posts.size();
+			size_t other = (post + 1) % data->posts.size();
+			total += utf8ncmp(data->posts[post].c_str(), data->posts[other].c_str(), data->lengths[post]) == 0;
+		}
+		BenchmarkSuite::keep(total);
+	});
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include "BenchmarkSuite.h"
+#include "Benchmarks.h"
+
+/// Defines the entry point for the benchmarks. Runs the benchmarks named on
+/// the command line (or whose names start with what is given), or all of them,
+/// and writes one line of JSON per benchmark to stdout
+/// @param argc The number of arguments passed to the application
+/// @param argv The parameters passed on the command line
+int main(int argc, char** argv)
+{
+	bool list = false;
+	double minTime = BENCH_DEFAULT_MIN_TIME;
+	string pluginsPath = "./plugins";
+
+	// Definitions of our command line arguments
+	struct option cmdOptions[] = {
+		{ "list", no_argument, 0, 'l' },
+		{ "min-time", required_argument, 0, 't' },
+		{ "plugins-path", required_argument, 0, 'p' },
+		{ 0, 0, 0, 0 },
+	};
+
+	// Iterate over our command line arguments
+	int option, optionIndex = 0;
+	while ((option = getopt_long(argc, argv, "lt:p:", cmdOptions, &optionIndex)) != -1)
+	{
+		switch (option)
+		{
+			case 'l':
+				list = true;
+				break;
+			case 't':
+				minTime = atof(optarg);
+				break;
+			case 'p':
+				pluginsPath = optarg;
+				break;
+			default:
+				return 1;
+				break;
+		}
+	}
+	if (minTime <= 0.0)
+	{
+		fprintf(stderr, "Invalid minimum time, expected a number of seconds\n");
+		return 1;
+	}
+
+	if (aura_init() != 0)
+	{
+		fprintf(stderr, "libaura initialisation failed\n");
+		return 1;
+	}
+
+	BenchmarkSuite suite(minTime);
+	addFilterBenchmarks(suite);
+	addUtf8Benchmarks(suite);
+	addPropertyBenchmarks(suite);
+	addPluginBenchmarks(suite, pluginsPath);
+	addDownloadBenchmarks(suite);
+
+	if (list)
+	{
+		for (auto& name : suite.getNames())
+		{
+			printf("%s\n", name.c_str());
+		}
+		return 0;
+	}
+
+	vector<string> prefixes(argv + optind, argv + argc);
+	if (suite.run(prefixes, stdout) == 0)
+	{
+		fprintf(stderr, "No benchmarks match\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -43,6 +43,10 @@ typedef struct aura_download_data_t
 
 	/// The amount of time taken, in seconds, to perform the download
 	double totalTime;
+
+	/// The headers of the final response (after any redirects), as received
+	/// and null terminated, e.g. for rate limits
+	char* headers;
 } aura_download_data_t;
 
 /// Helper function to download a file using CURL and OpenSSL
@@ -51,6 +55,29 @@ LIBAURA_EXPORTED aura_download_data_t* aura_download_sync(const char* url);
 /// Frees all the information associated with a download
 LIBAURA_EXPORTED void aura_free_download_data(aura_download_data_t* downloadData);
 
+/// Identifies an asynchronous download. Zero is never a valid identifier
+typedef unsigned long long aura_download_id_t;
+
+/// Called on a download thread when an asynchronous download finishes. The
+/// data is NULL if the transfer failed, and otherwise belongs to the callee,
+/// who must free it with aura_free_download_data()
+typedef void (*aura_download_callback_t)(aura_download_id_t id, aura_download_data_t* data, void* userData);
+
+/// Queues a download to happen on one of a small pool of worker threads. The
+/// waiting download with the lowest priority value is started first
+/// @returns The identifier of the download, or zero on failure
+LIBAURA_EXPORTED aura_download_id_t aura_download_async(const char* url, int priority, aura_download_callback_t callback, void* userData);
+
+/// Changes the priority of a download that hasn't started yet
+/// @returns true if the download was still waiting, false otherwise
+LIBAURA_EXPORTED bool aura_download_set_priority(aura_download_id_t id, int priority);
+
+/// Cancels a download. A waiting download is dropped and one in progress is
+/// aborted; either way its callback won't be called. If the callback is
+/// already running then this waits for it to return, so a callback must only
+/// ever cancel its own download
+LIBAURA_EXPORTED void aura_download_cancel(aura_download_id_t id);
+
 // UTF-8 versions of libc string functions /////////////////////////////////////
 
 // Some of them are the same:
@@ -93,6 +120,385 @@ LIBAURA_EXPORTED char* utf8ncat(char* dst, const char* src, size_t num);
 /// @returns See strncmp(3)
 LIBAURA_EXPORTED int utf8ncmp(const char* str1, const char* str2, size_t num);
 
+/// Decodes the character at the start of a UTF-8 encoded string. Malformed
+/// sequences, including overlong forms, surrogates and code points past the
+/// end of Unicode, decode as U+FFFD and consume a single byte
+/// @param s The string to decode from
+/// @param next If not NULL, set to point at the character after the one
+/// decoded. This only stays at s for the NUL terminator
+/// @returns The Unicode code point of the character, or 0 at the end of the string
+LIBAURA_EXPORTED unsigned int utf8decode(const char* s, const char** next);
+
+/// Encodes a code point as UTF-8. Code points past the end of Unicode are
+/// encoded as U+FFFD
+/// @param codepoint The code point to encode
+/// @param s Where to write the encoded bytes, which needs room for four
+/// @returns The number of bytes written
+LIBAURA_EXPORTED size_t utf8encode(unsigned int codepoint, char* s);
+
+/// Folds the case of a code point, so that upper and lower case compare equal.
+/// This covers ASCII, Latin-1, Latin Extended-A, Greek, Cyrillic and fullwidth
+/// Latin, which is simple one-to-one folding rather than the full Unicode rules
+/// @param codepoint The code point to fold
+/// @returns The lower case form of the code point, or the code point itself
+LIBAURA_EXPORTED unsigned int utf8fold(unsigned int codepoint);
+
+// Feed item store /////////////////////////////////////////////////////////////
+
+/// Results of aura_item_store_insert()
+#define AURA_ITEM_INSERTED         0
+#define AURA_ITEM_DUPLICATE        1
+#define AURA_ITEM_TOO_LARGE        2
+
+/// A feed item store (internally this is a pointer to an item_store_t)
+typedef void *aura_item_store_t;
+
+/// A key-value pair of a feed item
+typedef struct aura_item_field_t
+{
+	/// The name of the field, e.g. "text"
+	const char* key;
+
+	/// The value of the field, UTF-8 encoded
+	const char* value;
+} aura_item_field_t;
+
+/// A feed item held in a store. Everything it points to belongs to the store
+typedef struct aura_item_t
+{
+	/// The unique identifier of the item
+	const char* id;
+
+	/// The fields of the item, in the order they were inserted
+	const aura_item_field_t* fields;
+
+	/// The number of fields
+	size_t fieldCount;
+
+	/// The position of the item in the order of insertion, from one
+	unsigned long long sequence;
+} aura_item_t;
+
+/// Creates a feed item store. The store holds at most capacity items, and
+/// their strings are packed in to an arena of arenaBytes bytes. When either
+/// is full the oldest items are evicted, so the memory used never grows
+/// @param capacity The maximum number of items
+/// @param arenaBytes The size of the arena that the items' strings live in
+/// @returns The new store, or NULL if either size is zero
+LIBAURA_EXPORTED aura_item_store_t aura_item_store_create(size_t capacity, size_t arenaBytes);
+
+/// Deletes a feed item store and all of its items
+LIBAURA_EXPORTED void aura_item_store_delete(aura_item_store_t store);
+
+/// Adds an item to a store, unless there is already one with the same
+/// identifier. The identifier and fields are copied. This may be called from
+/// any thread
+/// @param id The unique identifier of the item
+/// @param fields The fields of the item
+/// @param fieldCount The number of fields
+/// @returns AURA_ITEM_INSERTED, AURA_ITEM_DUPLICATE if the identifier is
+/// already in the store, or AURA_ITEM_TOO_LARGE if the item wouldn't fit in
+/// the arena even if it were empty
+LIBAURA_EXPORTED int aura_item_store_insert(aura_item_store_t store, const char* id, const aura_item_field_t* fields, size_t fieldCount);
+
+/// Locks a store so that its items can be read in place. Items returned by
+/// aura_item_store_get() and aura_item_store_find() remain valid until the
+/// store is unlocked, as inserting (which evicts items) has to wait
+LIBAURA_EXPORTED void aura_item_store_lock(aura_item_store_t store);
+
+/// Unlocks a store locked with aura_item_store_lock()
+LIBAURA_EXPORTED void aura_item_store_unlock(aura_item_store_t store);
+
+/// Gets the number of items in a store. The store should be locked
+LIBAURA_EXPORTED size_t aura_item_store_count(aura_item_store_t store);
+
+/// Gets an item from a store by position, the oldest being zero. The store
+/// should be locked
+/// @returns The item, or NULL if the index is out of range
+LIBAURA_EXPORTED const aura_item_t* aura_item_store_get(aura_item_store_t store, size_t index);
+
+/// Gets an item from a store by identifier. The store should be locked
+/// @returns The item, or NULL if there is no such item
+LIBAURA_EXPORTED const aura_item_t* aura_item_store_find(aura_item_store_t store, const char* id);
+
+/// Gets the value of a field of an item
+/// @returns The value, or NULL if the item has no such field
+LIBAURA_EXPORTED const char* aura_item_get_field(const aura_item_t* item, const char* key);
+
+/// Gets the sequence number of the newest item ever inserted in to a store,
+/// which changes whenever items are added, so readers can tell if they need to
+/// look again
+LIBAURA_EXPORTED unsigned long long aura_item_store_get_sequence(aura_item_store_t store);
+
+/// Gets the number of items that have been rejected as duplicates, and that
+/// have been evicted to make room for new ones
+LIBAURA_EXPORTED unsigned long long aura_item_store_get_duplicates(aura_item_store_t store);
+LIBAURA_EXPORTED unsigned long long aura_item_store_get_evictions(aura_item_store_t store);
+
+// Streaming JSON parser ///////////////////////////////////////////////////////
+
+/// A streaming JSON parser (internally this is a pointer to a json_parser_t)
+typedef void *aura_json_parser_t;
+
+/// Maps a value in a JSON item to a field of a feed item
+typedef struct aura_json_field_t
+{
+	/// The name of the field in the feed item, e.g. "user"
+	const char* key;
+
+	/// The path of the value within the JSON item, e.g. "user.screen_name"
+	const char* path;
+} aura_json_field_t;
+
+/// Describes which parts of a JSON document are items and what to take from
+/// them. Paths are object keys separated by dots, with "[]" for any element of
+/// an array, e.g. "statuses[]" for each element of the "statuses" array of the
+/// top-level object, or "" for each top-level value of a stream of them. Only
+/// scalar values (strings, numbers and booleans) are extracted, as text; where
+/// a path matches more than one value the first is taken
+typedef struct aura_json_selector_t
+{
+	/// The path of the objects that are items
+	const char* itemPath;
+
+	/// The path, within an item, of its unique identifier. Items without one
+	/// are dropped
+	const char* idPath;
+
+	/// The fields to extract
+	const aura_json_field_t* fields;
+
+	/// The number of fields
+	size_t fieldCount;
+} aura_json_selector_t;
+
+/// Function pointer called by a JSON parser with each complete item
+/// @param void* The user data given to aura_json_parser_set_callback()
+/// @param const char* The identifier of the item
+/// @param const aura_item_field_t* The fields that were found, in selector order
+/// @param size_t The number of fields that were found
+typedef void (*aura_json_item_callback_t)(void*, const char*, const aura_item_field_t*, size_t);
+
+/// Creates a streaming JSON parser. Data is fed in as it is downloaded, and
+/// items are inserted in to the store (or passed to a callback) as soon as
+/// they are complete. Nothing outside the selected paths is kept, so memory
+/// use doesn't depend on the size of the document
+/// @param selector What to extract. It is copied
+/// @param store The store to insert items in to, or NULL to use a callback
+/// @returns The new parser
+LIBAURA_EXPORTED aura_json_parser_t aura_json_parser_create(const aura_json_selector_t* selector, aura_item_store_t store);
+
+/// Deletes a streaming JSON parser
+LIBAURA_EXPORTED void aura_json_parser_delete(aura_json_parser_t parser);
+
+/// Passes items to a callback instead of inserting them in to a store
+LIBAURA_EXPORTED void aura_json_parser_set_callback(aura_json_parser_t parser, aura_json_item_callback_t callback, void* userData);
+
+/// Parses the next chunk of a document. Chunks may split tokens anywhere
+/// @param data The chunk
+/// @param length The length of the chunk in bytes
+/// @returns 0 on success, or -1 if the document is malformed, after which
+/// the parser ignores any more data until it is reset
+LIBAURA_EXPORTED int aura_json_parser_feed(aura_json_parser_t parser, const char* data, size_t length);
+
+/// Tells a parser that the document has ended
+/// @returns 0 on success, or -1 if the document is malformed or incomplete
+LIBAURA_EXPORTED int aura_json_parser_finish(aura_json_parser_t parser);
+
+/// Gets a parser ready for a new document, e.g. for the next poll
+LIBAURA_EXPORTED void aura_json_parser_reset(aura_json_parser_t parser);
+
+/// Gets a description of why a document was malformed
+/// @returns The description, or NULL if it wasn't
+LIBAURA_EXPORTED const char* aura_json_parser_get_error(aura_json_parser_t parser);
+
+/// Gets the number of items a parser has emitted since it was created
+LIBAURA_EXPORTED unsigned long long aura_json_parser_get_item_count(aura_json_parser_t parser);
+
+// Moderation filter ///////////////////////////////////////////////////////////
+
+/// Results of aura_filter_check()
+#define AURA_FILTER_PASS           0
+#define AURA_FILTER_BLOCK          1
+
+/// A compiled set of blocked and allowed terms (internally this is a pointer to
+/// a filter_rules_t)
+typedef void *aura_filter_rules_t;
+
+/// A moderation filter (internally this is a pointer to a filter_t)
+typedef void *aura_filter_t;
+
+/// Where a blocked term was found in some text
+typedef struct aura_filter_match_t
+{
+	/// The position and length of the match in the text, in bytes
+	size_t offset, length;
+
+	/// The index of the term in the list of blocked terms
+	size_t term;
+} aura_filter_match_t;
+
+/// Compiles lists of blocked and allowed terms in to an Aho-Corasick
+/// automaton, so that text is checked against every term in a single pass.
+/// Terms are UTF-8 and match anywhere in the text, ignoring case (see
+/// utf8fold()). An allowed term cancels any blocked terms found inside it, so
+/// blocking "ass" whilst allowing "class" lets "classic" through
+/// @param blocked The blocked terms
+/// @param blockedCount The number of blocked terms
+/// @param allowed The allowed terms, or NULL
+/// @param allowedCount The number of allowed terms
+/// @returns The compiled rules
+LIBAURA_EXPORTED aura_filter_rules_t aura_filter_rules_compile(const char* const* blocked, size_t blockedCount, const char* const* allowed, size_t allowedCount);
+
+/// Deletes compiled rules that were never given to a filter
+LIBAURA_EXPORTED void aura_filter_rules_delete(aura_filter_rules_t rules);
+
+/// Gets the number of states in the automaton of some compiled rules
+LIBAURA_EXPORTED size_t aura_filter_rules_get_state_count(aura_filter_rules_t rules);
+
+/// Creates a moderation filter. Until it is given rules, it passes everything
+LIBAURA_EXPORTED aura_filter_t aura_filter_create();
+
+/// Deletes a moderation filter and its rules
+LIBAURA_EXPORTED void aura_filter_delete(aura_filter_t filter);
+
+/// Replaces the rules of a filter, which takes ownership of them. This is safe
+/// whilst other threads are checking text: checks already under way finish
+/// with the old rules, which are deleted once the last of them is done
+LIBAURA_EXPORTED void aura_filter_set_rules(aura_filter_t filter, aura_filter_rules_t rules);
+
+/// Checks some text against a filter's rules. Any number of threads can check
+/// text with the same filter at once
+/// @param filter The filter
+/// @param text The UTF-8 encoded text to check
+/// @param match If not NULL, filled in with the first blocked term found
+/// @returns AURA_FILTER_BLOCK if the text contains a blocked term that isn't
+/// part of an allowed one, or AURA_FILTER_PASS
+LIBAURA_EXPORTED int aura_filter_check(aura_filter_t filter, const char* text, aura_filter_match_t* match);
+
+/// Gets the number of texts a filter has checked, and how many it blocked
+LIBAURA_EXPORTED unsigned long long aura_filter_get_checked_count(aura_filter_t filter);
+LIBAURA_EXPORTED unsigned long long aura_filter_get_blocked_count(aura_filter_t filter);
+
+// Moderation queue ////////////////////////////////////////////////////////////
+
+/// Results of aura_mod_queue_push() and aura_mod_queue_peek()
+#define AURA_MOD_QUEUE_OK          0
+#define AURA_MOD_QUEUE_TIMEOUT     1
+#define AURA_MOD_QUEUE_TOO_LARGE   2
+#define AURA_MOD_QUEUE_CLOSED      3
+
+/// One end of a moderation queue (internally this is a pointer to a
+/// mod_queue_t)
+typedef void *aura_mod_queue_t;
+
+/// Creates a moderation queue in POSIX shared memory, for passing approved
+/// items from one process (the producer) to another (the consumer) without
+/// copying them through a socket or file. The queue is a ring of fixed size
+/// slots: each item is written once, straight in to a slot, and read in place
+/// from there. There must only be one producer and one consumer. Any queue
+/// left behind with the same name is replaced
+/// @param name The name of the shared memory object, e.g. "/aura-approved"
+/// @param slotCount The number of items the queue can hold, which is rounded
+/// up to a power of two
+/// @param slotBytes The most space an item can take, including its strings
+/// @returns The producer end of the queue, or NULL on failure
+LIBAURA_EXPORTED aura_mod_queue_t aura_mod_queue_create(const char* name, size_t slotCount, size_t slotBytes);
+
+/// Opens a moderation queue created by another process, as its consumer
+/// @param name The name the queue was created with
+/// @returns The consumer end of the queue, or NULL if there is no such queue
+LIBAURA_EXPORTED aura_mod_queue_t aura_mod_queue_open(const char* name);
+
+/// Closes one end of a moderation queue. Closing the producer end removes the
+/// name and tells the consumer that no more items are coming
+LIBAURA_EXPORTED void aura_mod_queue_close(aura_mod_queue_t queue);
+
+/// Writes an item in to the next free slot of a queue, waiting for one if the
+/// queue is full. A consumer waiting for an item is woken
+/// @param queue The producer end of the queue
+/// @param id The unique identifier of the item
+/// @param fields The fields of the item
+/// @param fieldCount The number of fields
+/// @param timeoutMs How long to wait for a free slot, or less than zero to
+/// wait for as long as it takes
+/// @returns AURA_MOD_QUEUE_OK, AURA_MOD_QUEUE_TIMEOUT if the queue stayed full,
+/// or AURA_MOD_QUEUE_TOO_LARGE if the item will never fit in a slot
+LIBAURA_EXPORTED int aura_mod_queue_push(aura_mod_queue_t queue, const char* id, const aura_item_field_t* fields, size_t fieldCount, int timeoutMs);
+
+/// Gets the oldest item in a queue without removing it, waiting for one if the
+/// queue is empty. The item's strings are read in place from shared memory, so
+/// they remain valid until aura_mod_queue_release() is called
+/// @param queue The consumer end of the queue
+/// @param item Filled in with the item. Its sequence is the number of items
+/// the producer had pushed, including this one
+/// @param timeoutMs How long to wait for an item, zero not to wait at all, or
+/// less than zero to wait for as long as it takes
+/// @returns AURA_MOD_QUEUE_OK, AURA_MOD_QUEUE_TIMEOUT if the queue stayed
+/// empty, or AURA_MOD_QUEUE_CLOSED if it is empty and the producer has closed
+LIBAURA_EXPORTED int aura_mod_queue_peek(aura_mod_queue_t queue, aura_item_t* item, int timeoutMs);
+
+/// Removes the item returned by aura_mod_queue_peek() from a queue, freeing its
+/// slot for the producer
+LIBAURA_EXPORTED void aura_mod_queue_release(aura_mod_queue_t queue);
+
+/// Gets the number of items waiting in a queue
+LIBAURA_EXPORTED size_t aura_mod_queue_count(aura_mod_queue_t queue);
+
+// Item journal ////////////////////////////////////////////////////////////////
+
+/// An item journal (internally this is a pointer to a journal_t)
+typedef void *aura_journal_t;
+
+/// Called for each item when a journal is replayed. The item and its strings
+/// are only valid during the call
+/// @param void* The user data given to aura_journal_replay()
+/// @param const aura_item_t* The item
+typedef void (*aura_journal_item_callback_t)(void*, const aura_item_t*);
+
+/// Opens an item journal, creating the file if it doesn't exist. A journal is
+/// an append-only file of items in a compact binary form, so that what was on
+/// display can be shown again straight away after a restart. Anything at the
+/// end of the file that was only partly written is discarded. Once the file
+/// grows past maxBytes (or twice the size the last compaction left it, if
+/// that is more) it is compacted on a background thread, keeping only the
+/// latest version of the newest maxItems items
+/// @param path The file name of the journal
+/// @param maxItems The most items to keep when compacting
+/// @param maxBytes The size the file can grow to before it is compacted
+/// @returns The journal, or NULL if the file couldn't be opened
+LIBAURA_EXPORTED aura_journal_t aura_journal_open(const char* path, size_t maxItems, size_t maxBytes);
+
+/// Closes an item journal, waiting for any compaction to finish
+LIBAURA_EXPORTED void aura_journal_close(aura_journal_t journal);
+
+/// Replays the items in a journal, read in place from a mapping of the file.
+/// Each item is given once, in its latest version, in the order the items
+/// were first added, and only the newest maxItems are given
+/// @param journal The journal
+/// @param callback Called for each item
+/// @param userData Passed to the callback
+/// @returns The number of items replayed
+LIBAURA_EXPORTED size_t aura_journal_replay(aura_journal_t journal, aura_journal_item_callback_t callback, void* userData);
+
+/// Adds an item to the end of a journal. Adding an item with the identifier of
+/// one already there replaces it. This may be called from any thread
+/// @returns true on success, false if the file couldn't be written
+LIBAURA_EXPORTED bool aura_journal_append(aura_journal_t journal, const char* id, const aura_item_field_t* fields, size_t fieldCount);
+
+/// Notes in a journal that an item has been removed
+/// @returns true on success, false if the file couldn't be written
+LIBAURA_EXPORTED bool aura_journal_remove(aura_journal_t journal, const char* id);
+
+/// Compacts a journal now, on the calling thread
+/// @returns true on success, false if the compacted file couldn't be written
+LIBAURA_EXPORTED bool aura_journal_compact(aura_journal_t journal);
+
+/// Gets the size of a journal's file in bytes, and the number of times it has
+/// been compacted
+LIBAURA_EXPORTED size_t aura_journal_get_size(aura_journal_t journal);
+LIBAURA_EXPORTED unsigned long long aura_journal_get_compaction_count(aura_journal_t journal);
+
 /// An enumeration defining the valid types of plugins to Aura
 typedef enum aura_plugin_type_t
 {
@@ -292,6 +698,10 @@ typedef bool (*aura_plugin_func_object_property_changed_t)(aura_object_instance_
 /// of an object of the given type
 typedef aura_object_instance_t* (*aura_plugin_func_create_object_t)(const char*);
 
+/// Function pointer to the destroy() function for plugins to free an instance
+/// of an object that their create() function returned
+typedef void (*aura_plugin_func_destroy_object_t)(aura_object_instance_t*);
+
 /// Function point to plugin propertyChanged function
 typedef bool (*aura_plugin_func_property_changed_t)(aura_property_t*);
 
@@ -310,6 +720,10 @@ typedef struct aura_plugin_t
 	/// Function-pointer: Notification of property change. Aura Live will
 	/// call this to notify the plugin that something has changed
 	aura_plugin_func_property_changed_t propertyChanged;
+
+	/// Function-pointer: Destroy object instance. If this is NULL then the
+	/// objects the plugin creates are never freed
+	aura_plugin_func_destroy_object_t destroy;
 } aura_plugin_t;
 
 /// Structure defining an 'element' plugin. An element is any low-level item 
@@ -320,6 +734,16 @@ typedef struct aura_element_plugin_t
 	aura_plugin_t super;
 } aura_element_plugin_t;
 
+/// Function pointer to a source plugin's poll() function. Aura Live only ever
+/// calls this from a dedicated worker thread, so it may block (e.g. whilst
+/// downloading), but a call that runs past its time budget counts as an overrun
+/// and a source that overruns repeatedly will be quarantined. How often it is
+/// called depends on what the plugin reports with aura_source_report_items()
+/// and aura_source_report_response()
+/// @param aura_object_instance_t* The source object instance to poll
+/// @returns true if the poll succeeded, false otherwise
+typedef bool (*aura_plugin_func_source_poll_t)(aura_object_instance_t*);
+
 /// Structure defining a 'source' plugin. A source is any kind of data source
 /// that is used to provide an array of key-value pairs to build something that
 /// appears on the display
@@ -327,12 +751,169 @@ typedef struct aura_source_plugin_t
 {
 	/// The plugin 'superclass' for this plugin
 	aura_plugin_t super;
+
+	/// Function-pointer: Poll the source for new items
+	aura_plugin_func_source_poll_t poll;
 } aura_source_plugin_t;
 
+/// Function pointer to a transition plugin's getShader() function. The
+/// returned string is the source of a GLSL 1.50 fragment shader that blends the
+/// outgoing and incoming items. Aura Live draws it as a single fullscreen pass
+/// and provides:
+///   uniform sampler2D from;    // The outgoing item
+///   uniform sampler2D to;      // The incoming item
+///   uniform float progress;    // From 0 (all 'from') to 1 (all 'to')
+///   uniform vec2 resolution;   // The size of the display in pixels
+///   in vec2 texCoord;          // From (0, 0) bottom-left to (1, 1) top-right
+/// and expects the result in 'out vec4 fragColour'. Any integer, boolean,
+/// floating point or colour properties of the object are also set as uniforms
+/// of the same name (int, bool, float and vec4 respectively), and a floating
+/// point property named "duration" sets the length of the transition in
+/// seconds
+/// @param aura_object_instance_t* The transition object instance
+/// @returns The fragment shader source, which must remain valid whilst the
+/// object exists
+typedef const char* (*aura_plugin_func_transition_get_shader_t)(aura_object_instance_t*);
+
+/// Structure defining a 'transition' plugin. A transition is an effect used to
+/// replace one item on the display with the next, e.g. fading or sliding
+typedef struct aura_transition_plugin_t
+{
+	/// The plugin 'superclass' for this plugin
+	aura_plugin_t super;
+
+	/// Function-pointer: Get the fragment shader for a transition object
+	aura_plugin_func_transition_get_shader_t getShader;
+} aura_transition_plugin_t;
+
+/// Structure describing an item placed by a layout plugin
+typedef struct aura_layout_item_t
+{
+	/// The size of the item in pixels, measured at the width the layout
+	/// asked for with getItemWidth()
+	float width, height;
+
+	/// The position of the top-left of the item within the content, set by
+	/// the layout
+	float x, y;
+} aura_layout_item_t;
+
+/// Structure describing the state of a layout, passed to a layout plugin's
+/// arrange() function
+typedef struct aura_layout_t
+{
+	/// The size of the area being laid out, in pixels
+	float width, height;
+
+	/// The items, in order
+	aura_layout_item_t* items;
+
+	/// The number of items
+	size_t itemCount;
+
+	/// The first item that has been added, removed or changed size since
+	/// the last call. Items before it keep their positions, so the layout
+	/// only needs to place this item and those after it
+	size_t firstChanged;
+
+	/// Set by the layout: whether the content scrolls horizontally rather
+	/// than vertically
+	bool horizontal;
+
+	/// Set by the layout: the length of the content in the direction it
+	/// scrolls
+	float extent;
+
+	/// Set by the layout: if not zero, the content moves a page of this many
+	/// pixels at a time instead of scrolling smoothly
+	float page;
+} aura_layout_t;
+
+/// Function pointer to a layout plugin's getItemWidth() function
+/// @param aura_object_instance_t* The layout object instance
+/// @param float The width of the area being laid out
+/// @param float The height of the area being laid out
+/// @returns The width that items should be measured at
+typedef float (*aura_plugin_func_layout_item_width_t)(aura_object_instance_t*, float, float);
+
+/// Function pointer to a layout plugin's arrange() function, which positions
+/// items from layout->firstChanged onwards and sets the outputs of the layout.
+/// Aura Live measures the items and handles scrolling, reading the speed in
+/// pixels per second from a floating point property named "speed" or, for a
+/// paged layout, the time spent on each page from one named "interval"
+/// @param aura_object_instance_t* The layout object instance
+/// @param aura_layout_t* The layout state
+typedef void (*aura_plugin_func_layout_arrange_t)(aura_object_instance_t*, aura_layout_t*);
+
+/// Structure defining a 'layout' plugin. A layout arranges items from sources
+/// on the display, e.g. as a scrolling list or a ticker
+typedef struct aura_layout_plugin_t
+{
+	/// The plugin 'superclass' for this plugin
+	aura_plugin_t super;
+
+	/// Function-pointer: Get the width to measure items at
+	aura_plugin_func_layout_item_width_t getItemWidth;
+
+	/// Function-pointer: Position the items
+	aura_plugin_func_layout_arrange_t arrange;
+} aura_layout_plugin_t;
+
 /// Function pointer to plugin load() function
 /// @returns A pointer to a filled aura_plugin_t structure
 typedef aura_plugin_t* (*aura_plugin_func_load_t)(void);
 
+/// The version of the layout of the plugin structures. A plugin built as a
+/// shared library exports the version it was built against (which
+/// AURA_PLUGIN_ENTRY_POINT does for it), and one built against any other
+/// version is refused. Bump this whenever a plugin structure changes
+#define AURA_PLUGIN_ABI_VERSION    2
+
+/// Structure describing a plugin that has been linked directly in to the
+/// application rather than being built as a shared library. These form a
+/// linked list that PluginLoader reads instead of calling dlopen()
+typedef struct aura_static_plugin_t
+{
+	/// The name the plugin was registered under
+	const char* name;
+
+	/// The entry point of the plugin (the equivalent of aura_plugin_load)
+	aura_plugin_func_load_t load;
+
+	/// The next registered plugin, or NULL if this is the last
+	struct aura_static_plugin_t* next;
+} aura_static_plugin_t;
+
+/// Registers a statically-linked plugin. This is normally called for you by
+/// AURA_PLUGIN_ENTRY_POINT during static initialisation, so it does not depend
+/// on anything else in libaura having been initialised
+/// @param plugin The plugin registration, which must remain valid forever
+LIBAURA_EXPORTED void aura_register_static_plugin(aura_static_plugin_t* plugin);
+
+/// Gets the list of statically-linked plugins
+/// @returns The first registered plugin, or NULL if there are none
+LIBAURA_EXPORTED aura_static_plugin_t* aura_get_static_plugins();
+
+/// Declares the entry point of a plugin. When plugins are built as shared
+/// libraries this is the exported aura_plugin_load function, along with the
+/// aura_plugin_abi_version the plugin was built against. When they are built
+/// with AURA_STATIC_PLUGINS the entry point is given a unique name and registered
+/// in the static plugin list instead, so that many plugins can be linked in to
+/// one binary. Use it in place of the function signature, e.g.
+///   AURA_PLUGIN_ENTRY_POINT(aura_core_elements) { ... return &plugin; }
+/// @param id A unique C identifier for the plugin
+#if defined(AURA_STATIC_PLUGINS)
+#	define AURA_PLUGIN_ENTRY_POINT(id) \
+		static aura_plugin_t* id##_plugin_load(); \
+		static aura_static_plugin_t id##_static_plugin = { #id, id##_plugin_load, NULL }; \
+		static struct id##_registrar_t { id##_registrar_t() { aura_register_static_plugin(&id##_static_plugin); } } id##_registrar; \
+		static aura_plugin_t* id##_plugin_load()
+#else
+#	define AURA_PLUGIN_ENTRY_POINT(id) \
+		extern "C" const int aura_plugin_abi_version = AURA_PLUGIN_ABI_VERSION; \
+		extern "C" aura_plugin_t* aura_plugin_load()
+#endif
+
 /// Allocates a new property of the given type. The function returns a pointer of
 /// type aura_property_t, but this should be casted to the appropriate 
 /// pointer for whatever class of property was requested, for example,
@@ -352,7 +933,10 @@ LIBAURA_EXPORTED const char** aura_get_object_types(aura_plugin_type_t pluginTyp
 /// @param name The string identifier of the object to create, e.g. 'image'
 LIBAURA_EXPORTED aura_object_instance_t* aura_create_object(aura_plugin_type_t pluginType, const char* name);
 
-/// Delete an instance of an object
+/// Delete the properties of an instance of an object, and its property list.
+/// Plugins call this from their destroy() function before freeing the object
+/// structure itself, which only they know the type of. The values of string
+/// and filename properties are not freed
 LIBAURA_EXPORTED void aura_delete_object(aura_object_instance_t* object);
 
 /// Creates a property list
@@ -365,11 +949,247 @@ LIBAURA_EXPORTED void aura_delete_property_list(aura_properties_t properties);
 /// returns that property from the list
 LIBAURA_EXPORTED aura_property_t* aura_get_property(aura_properties_t properties, const char* name);
 
+/// Gets the number of properties in an aura_properties_t property list
+LIBAURA_EXPORTED size_t aura_get_property_count(aura_properties_t properties);
+
+/// Gets a property from an aura_properties_t property list by its position, for
+/// iterating over the list. Properties are in order of name
+/// @returns The property, or NULL if the index is out of range
+LIBAURA_EXPORTED aura_property_t* aura_get_property_at(aura_properties_t properties, size_t index);
+
 /// Takes an aura_properties_t property list and deletes the given property from the list
 LIBAURA_EXPORTED void aura_delete_property(aura_properties_t properties, const char* name);
 
 /// Takes an aura_properties_t property list and adds the given property to the list
 LIBAURA_EXPORTED void aura_add_property(aura_properties_t properties, aura_property_t* property);
 
+// Source scheduling ///////////////////////////////////////////////////////////
+
+/// A snapshot of how a source is being scheduled
+typedef struct aura_source_schedule_t
+{
+	/// The measured rate that new items arrive at, per second
+	double itemRate;
+
+	/// The time between polls at the moment, in seconds
+	double interval;
+
+	/// The requests left before the source's rate limit resets, or -1 if it
+	/// hasn't said
+	long rateLimitRemaining;
+
+	/// The number of polls in a row that have failed
+	unsigned int failures;
+
+	/// Whether a streaming connection is delivering the source's items, in
+	/// which case polling only backs it up
+	bool streaming;
+
+	/// The number of polls, and of items reported
+	unsigned long long polls, items;
+} aura_source_schedule_t;
+
+/// Starts scheduling the polls of a source. Rather than polling on a fixed
+/// timer, a source is polled about as often as a new item turns up, within
+/// the given limits, and never faster than its rate limit allows. Failures back
+/// off exponentially. Sources are scheduled centrally, so any thread (e.g. a
+/// plugin's poll() or a streaming connection) can report on them. A source that
+/// never reports any items is polled at its usual interval
+/// @param source The source object instance
+/// @param interval The usual time between polls, in seconds
+/// @param minInterval The shortest time between polls, in seconds
+/// @param maxInterval The longest time between polls, in seconds
+LIBAURA_EXPORTED void aura_source_schedule_add(aura_object_instance_t* source, double interval, double minInterval, double maxInterval);
+
+/// Stops scheduling a source
+LIBAURA_EXPORTED void aura_source_schedule_remove(aura_object_instance_t* source);
+
+/// Reports that new items have arrived from a source, during a poll or from a
+/// streaming connection
+LIBAURA_EXPORTED void aura_source_report_items(aura_object_instance_t* source, size_t count);
+
+/// Reports a response a source received, so that its rate limit headers
+/// (X-RateLimit-*, X-Rate-Limit-*, RateLimit-* and Retry-After) and status are
+/// taken in to account
+LIBAURA_EXPORTED void aura_source_report_response(aura_object_instance_t* source, const aura_download_data_t* response);
+
+/// Reports that a poll of a source has finished, which works out when the
+/// next one is due
+/// @param source The source object instance
+/// @param success Whether the poll succeeded
+LIBAURA_EXPORTED void aura_source_report_poll(aura_object_instance_t* source, bool success);
+
+/// Gets how long to wait before polling a source again
+/// @returns The delay in seconds, which is zero if a poll is due, or less than
+/// zero if the source isn't being scheduled
+LIBAURA_EXPORTED double aura_source_get_poll_delay(aura_object_instance_t* source);
+
+/// Gets a snapshot of how a source is being scheduled
+/// @returns true if the source is being scheduled, false otherwise
+LIBAURA_EXPORTED bool aura_source_get_schedule(aura_object_instance_t* source, aura_source_schedule_t* schedule);
+
+/// A streaming connection (internally this is a pointer to a stream_t)
+typedef void *aura_stream_t;
+
+/// Called on a streaming connection's thread with each chunk of data as it
+/// arrives. A chunk with no data (NULL and zero) means the connection was
+/// made again, and anything part way through should be thrown away
+/// @param void* The user data given to aura_stream_open()
+/// @param const char* The data
+/// @param size_t The length of the data in bytes
+typedef void (*aura_stream_callback_t)(void*, const char*, size_t);
+
+/// Opens a long-lived streaming connection (e.g. chunked HTTP) on a thread of
+/// its own, so that a busy feed has new items pushed to it rather than waiting
+/// for its next poll. If the connection drops, stalls or can't be made, it is
+/// made again after a delay that grows with each failure. Whilst it is
+/// connected, the source it belongs to is polled only at its longest interval
+/// @param url The URL to stream from
+/// @param source The source the stream belongs to, or NULL
+/// @param callback Called with each chunk of data
+/// @param userData Passed to the callback
+/// @returns The stream, or NULL on failure
+LIBAURA_EXPORTED aura_stream_t aura_stream_open(const char* url, aura_object_instance_t* source, aura_stream_callback_t callback, void* userData);
+
+/// Closes a streaming connection, waiting for its thread to finish. This must
+/// not be called from the stream's callback
+LIBAURA_EXPORTED void aura_stream_close(aura_stream_t stream);
+
+/// Determines whether a streaming connection is connected at the moment
+LIBAURA_EXPORTED bool aura_stream_is_connected(aura_stream_t stream);
+
+/// Gets the number of times a streaming connection has been made
+LIBAURA_EXPORTED unsigned long long aura_stream_get_connect_count(aura_stream_t stream);
+
+// Tracing /////////////////////////////////////////////////////////////////////
+
+/// The most events each thread keeps, and the longest detail recorded
+#define AURA_TRACE_THREAD_EVENTS   32768
+#define AURA_TRACE_DETAIL_LENGTH   64
+
+/// A span that has been started with aura_trace_begin(). It is only a token, to
+/// be passed back to aura_trace_end(), and costs nothing whilst tracing is off
+typedef struct aura_trace_span_t
+{
+	/// The category, name and detail given when it began
+	const char* category;
+	const char* name;
+	const char* detail;
+
+	/// When it began, in nanoseconds on the monotonic clock, or zero if
+	/// tracing was off
+	unsigned long long start;
+} aura_trace_span_t;
+
+/// Turns recording spans on or off. Tracing is off to begin with, and whilst it
+/// is off beginning and ending a span does nothing more than check this
+LIBAURA_EXPORTED void aura_trace_set_enabled(bool enabled);
+
+/// Determines whether spans are being recorded
+LIBAURA_EXPORTED bool aura_trace_is_enabled();
+
+/// Begins a span of time on the calling thread, e.g. a phase of a frame or a
+/// call in to a plugin. Each thread records in to a buffer of its own, which
+/// keeps its most recent AURA_TRACE_THREAD_EVENTS events
+/// @param category The category of the span, e.g. "download"
+/// @param name The name of the span. The category and name aren't copied, so
+/// they must be string literals, and a plugin's must not be exported after
+/// the plugin has been unloaded
+/// @param detail Something to tell this span apart from others of the same
+/// name (e.g. a URL), or NULL. It is copied when the span ends
+/// @returns The span, to pass to aura_trace_end()
+LIBAURA_EXPORTED aura_trace_span_t aura_trace_begin(const char* category, const char* name, const char* detail);
+
+/// Ends a span and records it. The span must be ended on the thread it began
+/// on, and the detail it was given must still be valid
+LIBAURA_EXPORTED void aura_trace_end(const aura_trace_span_t* span);
+
+/// Records something that happened at a point in time on the calling thread.
+/// The parameters are as for aura_trace_begin()
+LIBAURA_EXPORTED void aura_trace_instant(const char* category, const char* name, const char* detail);
+
+/// Names the calling thread in exported traces. The name is copied
+LIBAURA_EXPORTED void aura_trace_set_thread_name(const char* name);
+
+/// Writes everything recorded to a file in the Chrome trace event format, as
+/// opened by chrome://tracing and Perfetto. Recording carries on regardless
+/// @param path The file name to write to
+/// @returns true on success, false if the file couldn't be written
+LIBAURA_EXPORTED bool aura_trace_export(const char* path);
+
+/// Throws away everything recorded so far
+LIBAURA_EXPORTED void aura_trace_clear();
+
+/// Gets the number of events recorded in total, and the number that have been
+/// overwritten by newer events since
+LIBAURA_EXPORTED unsigned long long aura_trace_get_event_count();
+LIBAURA_EXPORTED unsigned long long aura_trace_get_overwritten_count();
+
+// Metrics /////////////////////////////////////////////////////////////////////
+
+/// The number of shards a counter or histogram is split in to, so that threads
+/// updating the same metric rarely touch the same memory
+#define AURA_METRIC_SHARDS         16
+
+/// A metric (internally this is a pointer to a metric_t)
+typedef void *aura_metric_t;
+
+/// Gets a counter, creating it the first time it's asked for. Metrics last
+/// until the library is unloaded, so the handle can be kept
+/// @param name The name of the metric, following Prometheus' conventions,
+/// e.g. "aura_downloads_total"
+/// @param labels The labels that tell this series apart from others with the
+/// same name, as they appear between the braces, e.g. "result=\"ok\"", or
+/// NULL for none
+/// @param help A description of the metric
+/// @returns The counter, or NULL if the name is in use by another kind of
+/// metric
+LIBAURA_EXPORTED aura_metric_t aura_metric_counter(const char* name, const char* labels, const char* help);
+
+/// Gets a gauge, creating it the first time it's asked for. The parameters are
+/// as for aura_metric_counter()
+LIBAURA_EXPORTED aura_metric_t aura_metric_gauge(const char* name, const char* labels, const char* help);
+
+/// Gets a histogram, creating it the first time it's asked for. The other
+/// parameters are as for aura_metric_counter()
+/// @param bounds The upper bounds of the buckets, in ascending order. There
+/// is always a last bucket for everything above them
+/// @param boundCount The number of bounds
+LIBAURA_EXPORTED aura_metric_t aura_metric_histogram(const char* name, const char* labels, const char* help, const double* bounds, size_t boundCount);
+
+/// Adds to a counter or a gauge. Nothing happens if the metric is NULL
+LIBAURA_EXPORTED void aura_metric_add(aura_metric_t metric, double value);
+
+/// Sets a gauge, or sets a counter to a total that is kept elsewhere (which
+/// must never go down). Nothing happens if the metric is NULL
+LIBAURA_EXPORTED void aura_metric_set(aura_metric_t metric, double value);
+
+/// Adds a value to a histogram. Nothing happens if the metric is NULL
+LIBAURA_EXPORTED void aura_metric_observe(aura_metric_t metric, double value);
+
+/// Gets the value of a counter or gauge, or the number of values a histogram
+/// has been given
+LIBAURA_EXPORTED double aura_metric_get(aura_metric_t metric);
+
+/// Formats every metric in the Prometheus text exposition format, along with
+/// the resident memory of the process
+/// @returns The text, which must be freed with aura_metrics_free_text()
+LIBAURA_EXPORTED char* aura_metrics_format();
+
+/// Frees text returned by aura_metrics_format()
+LIBAURA_EXPORTED void aura_metrics_free_text(char* text);
+
+/// Serves the metrics on a Unix domain socket, from a thread of its own so that
+/// whatever is being measured is never held up by a scrape. An HTTP GET is
+/// answered with an HTTP response, and a client that sends nothing is sent
+/// the bare text after a moment, e.g. for socat
+/// @param path The file name of the socket. Anything already there is removed
+/// @returns true on success, false if the socket couldn't be listened on or
+/// the metrics are already being served
+LIBAURA_EXPORTED bool aura_metrics_serve(const char* path);
+
+/// Stops serving the metrics, and removes the socket
+LIBAURA_EXPORTED void aura_metrics_stop_serving();
+
 #endif // !defined(AURA_H_INCLUDED)
 
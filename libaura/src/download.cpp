@@ -0,0 +1,416 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <curl/curl.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define DOWNLOAD_THREADS    4
+
+/// Where a download's data and headers go, and the flag that aborts it
+typedef struct download_buffer_t
+{
+	stringbuf buffer;
+	string headers;
+	const atomic<bool>* cancelled;
+} download_buffer_t;
+
+/// A download waiting for a worker
+typedef struct download_request_t
+{
+	string url;
+	int priority;
+	aura_download_callback_t callback;
+	void* userData;
+} download_request_t;
+
+/// A download a worker has taken
+typedef struct download_running_t
+{
+	/// Set to abort the transfer and drop the result
+	atomic<bool> cancelled;
+
+	/// Set whilst the callback is running, and the thread it's running on
+	bool inCallback;
+	thread::id worker;
+} download_running_t;
+
+/// The asynchronous download queue. Workers are started the first time a
+/// download is queued, and each takes the most urgent download waiting
+typedef struct download_queue_t
+{
+	download_queue_t() : nextId(1), stopping(false) {}
+	~download_queue_t();
+
+	/// Protects everything below
+	mutex lock;
+
+	/// Signalled when there is a new download or we're stopping, and when a
+	/// callback finishes
+	condition_variable wake, callbackDone;
+
+	/// Downloads waiting for a worker, in the order they were queued
+	map<aura_download_id_t, download_request_t> queued;
+
+	/// Downloads being transferred or calling back
+	map<aura_download_id_t, download_running_t*> running;
+
+	/// The worker threads
+	vector<thread> workers;
+
+	/// The identifier of the next download
+	aura_download_id_t nextId;
+
+	/// Set to ask the workers to stop
+	bool stopping;
+} download_queue_t;
+
+static download_queue_t g_downloads;
+
+/// The metrics downloads are measured by
+typedef struct download_metrics_t
+{
+	/// Transfers by how they ended
+	aura_metric_t succeeded, httpErrors, failed, cancelled;
+
+	/// How long successful transfers took
+	aura_metric_t seconds;
+
+	/// The downloads waiting for a worker, and those being transferred or
+	/// calling back
+	aura_metric_t queued, running;
+} download_metrics_t;
+
+/// Gets the metrics downloads are measured by, registering them the first time
+static const download_metrics_t& download_metrics()
+{
+	static const double bounds[] = { 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0 };
+	static const download_metrics_t metrics = {
+		aura_metric_counter("aura_downloads_total", "result=\"ok\"", "Downloads by how they ended"),
+		aura_metric_counter("aura_downloads_total", "result=\"http_error\"", "Downloads by how they ended"),
+		aura_metric_counter("aura_downloads_total", "result=\"failed\"", "Downloads by how they ended"),
+		aura_metric_counter("aura_downloads_total", "result=\"cancelled\"", "Downloads by how they ended"),
+		aura_metric_histogram("aura_download_seconds", NULL, "Time taken by downloads that completed", bounds, sizeof(bounds) / sizeof(bounds[0])),
+		aura_metric_gauge("aura_download_queue_length", NULL, "Asynchronous downloads waiting for a worker"),
+		aura_metric_gauge("aura_downloads_running", NULL, "Asynchronous downloads being transferred or calling back")
+	};
+	return metrics;
+}
+
+/// Publishes the length of the queue. The queue's lock must be held
+static void download_update_queue_metrics(const download_queue_t& queue)
+{
+	const download_metrics_t& metrics = download_metrics();
+	aura_metric_set(metrics.queued, (double)queue.queued.size());
+	aura_metric_set(metrics.running, (double)queue.running.size());
+}
+
+/// Stops the workers when the library is unloaded, aborting their transfers
+download_queue_t::~download_queue_t()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+		queued.clear();
+		for (auto& entry : running)
+		{
+			entry.second->cancelled = true;
+		}
+	}
+	wake.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/// Called from CURL when we have data
+static size_t curl_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+	// Returning less than we were given makes CURL abort the transfer
+	download_buffer_t* buffer = (download_buffer_t*)userdata;
+	if (buffer->cancelled != NULL && *buffer->cancelled)
+	{
+		return 0;
+	}
+
+	buffer->buffer.sputn(ptr, size * nmemb);
+	return size * nmemb;
+}
+
+/// Called from CURL with each header line
+static size_t curl_header_callback(char* ptr, size_t size, size_t nitems, void* userdata)
+{
+	// A status line starts the headers of another response, after a
+	// redirect, and we only want the last one
+	download_buffer_t* buffer = (download_buffer_t*)userdata;
+	if (size * nitems >= 5 && strncmp(ptr, "HTTP/", 5) == 0)
+	{
+		buffer->headers.clear();
+	}
+
+	buffer->headers.append(ptr, size * nitems);
+	return size * nitems;
+}
+
+/// Called from CURL periodically during a transfer, so that a cancelled
+/// download stops even when no data is arriving
+static int curl_cancel_callback(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+	download_buffer_t* buffer = (download_buffer_t*)userdata;
+	return *buffer->cancelled ? 1 : 0;
+}
+
+/// Downloads a resource on the calling thread
+/// @param url The URL to download
+/// @param cancelled A flag that aborts the transfer when set, or NULL
+/// @returns The response, or NULL if the transfer failed or was aborted
+static aura_download_data_t* download(const char* url, const atomic<bool>* cancelled)
+{
+	aura_download_data_t* response = NULL;
+
+	// Initialise CURL for this request
+	CURL* curl = curl_easy_init();
+	if (curl == NULL)
+	{
+		return NULL;
+	}
+
+	// Set up a string buffer
+	download_buffer_t buffer;
+	buffer.cancelled = cancelled;
+
+	// Set up what we want CURL to do
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curl_header_callback);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, &buffer);
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 15);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+	if (cancelled != NULL)
+	{
+		curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, curl_cancel_callback);
+		curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &buffer);
+		curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+	}
+	//curl_easy_setopt(curl, CURLOPT_PROXY, TODO);
+	//curl_easy_setopt(curl, CURLOPT_PROXYPORT, TODO);
+	//curl_easy_setopt(curl, CURLOPT_PROXYTYPE, TODO);
+
+	// Perform the operation
+	aura_trace_span_t span = aura_trace_begin("download", "transfer", url);
+	CURLcode result = curl_easy_perform(curl);
+	aura_trace_end(&span);
+	const download_metrics_t& metrics = download_metrics();
+	if (result == 0)
+	{
+		string bufferData = buffer.buffer.str();
+
+		// Build our response object
+		response = new aura_download_data_t;
+		response->dataLength = bufferData.length();
+
+		// Copy in the response data (we add one to add a null terminator)
+		response->data = new char[bufferData.length() + 1];
+		memcpy(response->data, bufferData.c_str(), bufferData.length());
+		response->data[bufferData.length()] = '\0';
+
+		// And the headers
+		response->headers = new char[buffer.headers.length() + 1];
+		memcpy(response->headers, buffer.headers.c_str(), buffer.headers.length() + 1);
+
+		// Get the HTTP response code
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response->responseCode);
+
+		// Get the elapsed time
+		curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &response->totalTime);
+
+		aura_metric_add(response->responseCode < 400 ? metrics.succeeded : metrics.httpErrors, 1.0);
+		aura_metric_observe(metrics.seconds, response->totalTime);
+	}
+	else
+	{
+		aura_metric_add(cancelled != NULL && *cancelled ? metrics.cancelled : metrics.failed, 1.0);
+	}
+
+	// Tidy up
+	curl_easy_cleanup(curl);
+
+	return response;
+}
+
+/// Entry point for the download worker threads
+static void download_worker_main()
+{
+	download_queue_t& queue = g_downloads;
+	aura_trace_set_thread_name("aura download");
+	unique_lock<mutex> guard(queue.lock);
+	while (true)
+	{
+		queue.wake.wait(guard, [&queue] { return queue.stopping || !queue.queued.empty(); });
+		if (queue.stopping)
+		{
+			return;
+		}
+
+		// Take the most urgent download, the oldest if there's a tie. There
+		// are only ever a handful waiting, so a scan is fine
+		auto best = queue.queued.begin();
+		for (auto requestIter = queue.queued.begin(); requestIter != queue.queued.end(); ++requestIter)
+		{
+			if (requestIter->second.priority < best->second.priority)
+			{
+				best = requestIter;
+			}
+		}
+		aura_download_id_t id = best->first;
+		download_request_t request = best->second;
+		queue.queued.erase(best);
+
+		download_running_t running;
+		running.cancelled = false;
+		running.inCallback = false;
+		running.worker = this_thread::get_id();
+		queue.running[id] = &running;
+		download_update_queue_metrics(queue);
+
+		// Do the slow part without the lock
+		guard.unlock();
+		aura_download_data_t* data = download(request.url.c_str(), &running.cancelled);
+		guard.lock();
+
+		// Once the callback has started, cancelling waits for it instead
+		if (!running.cancelled && !queue.stopping)
+		{
+			running.inCallback = true;
+			guard.unlock();
+			aura_trace_span_t span = aura_trace_begin("download", "callback", request.url.c_str());
+			request.callback(id, data, request.userData);
+			aura_trace_end(&span);
+			guard.lock();
+		}
+		else if (data != NULL)
+		{
+			aura_free_download_data(data);
+		}
+
+		queue.running.erase(id);
+		download_update_queue_metrics(queue);
+		queue.callbackDone.notify_all();
+	}
+}
+
+/// Uses CURL to synchronously download the given resource
+aura_download_data_t* aura_download_sync(const char* url)
+{
+	return download(url, NULL);
+}
+
+/// Queues a download to happen on a worker thread
+aura_download_id_t aura_download_async(const char* url, int priority, aura_download_callback_t callback, void* userData)
+{
+	if (url == NULL || callback == NULL)
+	{
+		return 0;
+	}
+
+	download_queue_t& queue = g_downloads;
+	aura_download_id_t id;
+	{
+		lock_guard<mutex> guard(queue.lock);
+		if (queue.stopping)
+		{
+			return 0;
+		}
+
+		if (queue.workers.empty())
+		{
+			for (int i = 0; i < DOWNLOAD_THREADS; i++)
+			{
+				queue.workers.push_back(thread(download_worker_main));
+			}
+		}
+
+		id = queue.nextId++;
+		download_request_t& request = queue.queued[id];
+		request.url = url;
+		request.priority = priority;
+		request.callback = callback;
+		request.userData = userData;
+		download_update_queue_metrics(queue);
+	}
+	queue.wake.notify_one();
+
+	return id;
+}
+
+/// Changes the priority of a download that hasn't started yet
+bool aura_download_set_priority(aura_download_id_t id, int priority)
+{
+	download_queue_t& queue = g_downloads;
+	lock_guard<mutex> guard(queue.lock);
+	auto requestIter = queue.queued.find(id);
+	if (requestIter == queue.queued.end())
+	{
+		return false;
+	}
+
+	requestIter->second.priority = priority;
+	return true;
+}
+
+/// Cancels a download, waiting for its callback if it is already running
+void aura_download_cancel(aura_download_id_t id)
+{
+	download_queue_t& queue = g_downloads;
+	unique_lock<mutex> guard(queue.lock);
+	if (queue.queued.erase(id) > 0)
+	{
+		download_update_queue_metrics(queue);
+		return;
+	}
+
+	auto runningIter = queue.running.find(id);
+	if (runningIter == queue.running.end())
+	{
+		return;
+	}
+
+	// A transfer that is still going is just abandoned: the worker sees the
+	// flag and won't call back. A callback can cancel its own download
+	download_running_t* running = runningIter->second;
+	running->cancelled = true;
+	if (running->inCallback && running->worker != this_thread::get_id())
+	{
+		queue.callbackDone.wait(guard, [&queue, id] { return queue.running.find(id) == queue.running.end(); });
+	}
+}
+
+/// Frees all the information associated with a download
+void aura_free_download_data(aura_download_data_t* downloadData)
+{
+	if (downloadData->data != NULL)
+	{
+		delete [] downloadData->data;
+	}
+	if (downloadData->headers != NULL)
+	{
+		delete [] downloadData->headers;
+	}
+	delete downloadData;
+}
@@ -0,0 +1,513 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define FILTER_ROOT         0
+#define FILTER_NONE         ((uint32_t)-1)
+#define FILTER_LINEAR_EDGES 8
+#define FILTER_DENSE_BYTES  (2 * 1024 * 1024)
+
+/// A transition of the automaton on a byte
+typedef struct filter_edge_t
+{
+	unsigned char byte;
+	uint32_t target;
+} filter_edge_t;
+
+/// A state of the automaton, i.e. a prefix of one or more terms
+typedef struct filter_state_t
+{
+	/// The transitions out of the state, sorted by byte, are edges[firstEdge]
+	/// onwards
+	uint32_t firstEdge, edgeCount;
+
+	/// The state for the longest proper suffix of this one that is also a
+	/// prefix of a term
+	uint32_t fail;
+
+	/// The term that ends at this state, or FILTER_NONE
+	uint32_t term;
+
+	/// The nearest state along the failure links that ends a term, or
+	/// FILTER_NONE
+	uint32_t output;
+} filter_state_t;
+
+/// A compiled term
+typedef struct filter_term_t
+{
+	/// The index of the term in the list it came from
+	size_t index;
+
+	/// The length of the term in characters
+	size_t length;
+
+	/// Whether the term is allowed rather than blocked
+	bool allowed;
+} filter_term_t;
+
+/// A compiled set of rules. The automaton works on the bytes of case-folded
+/// UTF-8, which keeps transitions small; as UTF-8 is self-synchronising, a term
+/// can only ever match on character boundaries. States are numbered breadth
+/// first, and text spends nearly all of its time in the shallowest ones, so
+/// those get a full row of transitions (failure links included) over the
+/// classes of bytes that appear in terms, as far as a memory budget allows.
+/// Deeper states have sorted lists of their own transitions and fall back
+/// along the failure links
+typedef struct filter_rules_t
+{
+	vector<filter_state_t> states;
+	vector<filter_edge_t> edges;
+	vector<filter_term_t> terms;
+
+	/// The class of each byte, zero being bytes that are in no term
+	unsigned char byteClass[256];
+	uint32_t classCount;
+
+	/// The full rows of transitions of the first denseCount states
+	vector<uint32_t> dense;
+	uint32_t denseCount;
+
+	/// The length of the longest term, and of the longest allowed term, in
+	/// characters
+	size_t maxLength, maxAllowedLength;
+} filter_rules_t;
+
+/// A moderation filter. Checks take their own reference to the rules, so
+/// that they can be replaced at any time
+typedef struct filter_t
+{
+	shared_ptr<filter_rules_t> rules;
+	atomic<unsigned long long> checkedCount, blockedCount;
+} filter_t;
+
+/// A term found in some text
+typedef struct filter_found_t
+{
+	/// Where the term starts and ends, in characters
+	size_t start, end;
+
+	/// Where the term starts and ends, in bytes
+	size_t startOffset, endOffset;
+
+	uint32_t term;
+} filter_found_t;
+
+/// Makes a state with no transitions or terms
+static filter_state_t make_state()
+{
+	filter_state_t state;
+	state.firstEdge = state.edgeCount = 0;
+	state.fail = FILTER_ROOT;
+	state.term = state.output = FILTER_NONE;
+	return state;
+}
+
+/// Decodes the character at some text, which mustn't be the terminator, and
+/// moves past it. Anything that doesn't decode to a character is U+FFFD and
+/// moves on by a byte, so that a loop to the terminator always gets there
+static inline unsigned int decode_char(const char*& text)
+{
+	const char* start = text;
+	unsigned int codepoint = utf8decode(start, &text);
+	if (codepoint == 0 || text == start)
+	{
+		text = start + 1;
+		return 0xfffd;
+	}
+
+	return codepoint;
+}
+
+/// Folds the case of some UTF-8 text
+static string fold_text(const char* text, size_t& length)
+{
+	string folded;
+	char encoded[4];
+	length = 0;
+	while (*text)
+	{
+		unsigned int codepoint = utf8fold(decode_char(text));
+		folded.append(encoded, utf8encode(codepoint, encoded));
+		length++;
+	}
+
+	return folded;
+}
+
+/// Adds a term to the trie being built
+static void add_term(vector<map<unsigned char, uint32_t> >& trie, filter_rules_t* rules, const char* text, size_t index, bool allowed)
+{
+	size_t length;
+	string folded = fold_text(text, length);
+	if (folded.empty())
+	{
+		return;
+	}
+
+	uint32_t state = FILTER_ROOT;
+	for (unsigned char byte : folded)
+	{
+		auto edgeIter = trie[state].find(byte);
+		if (edgeIter != trie[state].end())
+		{
+			state = edgeIter->second;
+			continue;
+		}
+
+		uint32_t next = (uint32_t)trie.size();
+		trie[state][byte] = next;
+		trie.push_back(map<unsigned char, uint32_t>());
+		state = next;
+	}
+
+	// If a term is both blocked and allowed then allowing it wins
+	rules->states.resize(trie.size(), make_state());
+	filter_state_t& end = rules->states[state];
+	if (end.term != FILTER_NONE && (rules->terms[end.term].allowed || !allowed))
+	{
+		return;
+	}
+
+	filter_term_t term;
+	term.index = index;
+	term.length = length;
+	term.allowed = allowed;
+	end.term = (uint32_t)rules->terms.size();
+	rules->terms.push_back(term);
+	if (length > rules->maxLength)
+	{
+		rules->maxLength = length;
+	}
+	if (allowed && length > rules->maxAllowedLength)
+	{
+		rules->maxAllowedLength = length;
+	}
+}
+
+/// Follows the transition from a state on a byte, falling back along the
+/// failure links until there is one
+static inline uint32_t next_state(const filter_rules_t* rules, uint32_t state, unsigned char byte)
+{
+	while (state >= rules->denseCount)
+	{
+		const filter_state_t& current = rules->states[state];
+		const filter_edge_t* edges = &rules->edges[current.firstEdge];
+		if (current.edgeCount <= FILTER_LINEAR_EDGES)
+		{
+			for (uint32_t i = 0; i < current.edgeCount; i++)
+			{
+				if (edges[i].byte == byte)
+				{
+					return edges[i].target;
+				}
+			}
+		}
+		else
+		{
+			uint32_t low = 0, high = current.edgeCount;
+			while (low < high)
+			{
+				uint32_t middle = (low + high) / 2;
+				if (edges[middle].byte < byte)
+				{
+					low = middle + 1;
+				}
+				else
+				{
+					high = middle;
+				}
+			}
+			if (low < current.edgeCount && edges[low].byte == byte)
+			{
+				return edges[low].target;
+			}
+		}
+		state = current.fail;
+	}
+
+	return rules->dense[(size_t)state * rules->classCount + rules->byteClass[byte]];
+}
+
+/// Compiles lists of blocked and allowed terms in to an Aho-Corasick automaton
+aura_filter_rules_t aura_filter_rules_compile(const char* const* blocked, size_t blockedCount, const char* const* allowed, size_t allowedCount)
+{
+	filter_rules_t* rules = new filter_rules_t();
+	rules->maxLength = 0;
+	rules->maxAllowedLength = 0;
+
+	// Build a trie of the terms
+	vector<map<unsigned char, uint32_t> > trie(1);
+	rules->states.push_back(make_state());
+	for (size_t i = 0; i < blockedCount; i++)
+	{
+		add_term(trie, rules, blocked[i], i, false);
+	}
+	for (size_t i = 0; i < allowedCount; i++)
+	{
+		add_term(trie, rules, allowed[i], i, true);
+	}
+	rules->states.resize(trie.size(), make_state());
+
+	// Number the states breadth first, so that a state's suffixes, and so
+	// its failure links, always come before it
+	vector<uint32_t> order(1, FILTER_ROOT), number(trie.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		number[order[i]] = (uint32_t)i;
+		for (auto& edge : trie[order[i]])
+		{
+			order.push_back(edge.second);
+		}
+	}
+
+	// Give each byte used in a term a class
+	memset(rules->byteClass, 0, sizeof(rules->byteClass));
+	rules->classCount = 1;
+	for (auto& node : trie)
+	{
+		for (auto& edge : node)
+		{
+			if (rules->byteClass[edge.first] == 0)
+			{
+				rules->byteClass[edge.first] = (unsigned char)rules->classCount++;
+			}
+		}
+	}
+	rules->denseCount = (uint32_t)(FILTER_DENSE_BYTES / (sizeof(uint32_t) * rules->classCount));
+	if (rules->denseCount > trie.size())
+	{
+		rules->denseCount = (uint32_t)trie.size();
+	}
+	rules->dense.resize((size_t)rules->denseCount * rules->classCount);
+
+	// Flatten the transitions in to their new numbering, sorted by byte as
+	// the maps are
+	vector<filter_state_t> states(trie.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		states[i] = rules->states[order[i]];
+		states[i].firstEdge = (uint32_t)rules->edges.size();
+		states[i].edgeCount = (uint32_t)trie[order[i]].size();
+		for (auto& edge : trie[order[i]])
+		{
+			filter_edge_t flat;
+			flat.byte = edge.first;
+			flat.target = number[edge.second];
+			rules->edges.push_back(flat);
+		}
+	}
+	rules->states.swap(states);
+
+	// Work out the failure links, outputs and full rows in order. Children
+	// of the root fail back to it, and every other state to where its
+	// parent's failure link goes on the same byte
+	for (uint32_t state = 0; state < rules->states.size(); state++)
+	{
+		filter_state_t& current = rules->states[state];
+		if (state != FILTER_ROOT)
+		{
+			const filter_state_t& fail = rules->states[current.fail];
+			current.output = fail.term != FILTER_NONE ? current.fail : fail.output;
+		}
+
+		if (state < rules->denseCount)
+		{
+			uint32_t* row = &rules->dense[(size_t)state * rules->classCount];
+			if (state == FILTER_ROOT)
+			{
+				for (uint32_t byteClass = 0; byteClass < rules->classCount; byteClass++)
+				{
+					row[byteClass] = FILTER_ROOT;
+				}
+			}
+			else
+			{
+				memcpy(row, &rules->dense[(size_t)current.fail * rules->classCount], sizeof(uint32_t) * rules->classCount);
+			}
+			for (uint32_t i = 0; i < current.edgeCount; i++)
+			{
+				const filter_edge_t& edge = rules->edges[current.firstEdge + i];
+				row[rules->byteClass[edge.byte]] = edge.target;
+			}
+		}
+
+		for (uint32_t i = 0; i < current.edgeCount; i++)
+		{
+			const filter_edge_t& edge = rules->edges[current.firstEdge + i];
+			rules->states[edge.target].fail = state == FILTER_ROOT ? FILTER_ROOT : next_state(rules, current.fail, edge.byte);
+		}
+	}
+
+	return rules;
+}
+
+/// Deletes compiled rules that were never given to a filter
+void aura_filter_rules_delete(aura_filter_rules_t rules)
+{
+	delete (filter_rules_t*)rules;
+}
+
+/// Gets the number of states in the automaton of some compiled rules
+size_t aura_filter_rules_get_state_count(aura_filter_rules_t rules)
+{
+	return ((filter_rules_t*)rules)->states.size();
+}
+
+/// Creates a moderation filter
+aura_filter_t aura_filter_create()
+{
+	filter_t* filter = new filter_t();
+	filter->checkedCount = 0;
+	filter->blockedCount = 0;
+	return filter;
+}
+
+/// Deletes a moderation filter and its rules
+void aura_filter_delete(aura_filter_t filter)
+{
+	delete (filter_t*)filter;
+}
+
+/// Replaces the rules of a filter, which takes ownership of them
+void aura_filter_set_rules(aura_filter_t _filter, aura_filter_rules_t rules)
+{
+	filter_t* filter = (filter_t*)_filter;
+	atomic_store(&filter->rules, shared_ptr<filter_rules_t>((filter_rules_t*)rules));
+}
+
+/// Checks some text against a filter's rules
+int aura_filter_check(aura_filter_t _filter, const char* text, aura_filter_match_t* match)
+{
+	filter_t* filter = (filter_t*)_filter;
+	filter->checkedCount.fetch_add(1, memory_order_relaxed);
+	shared_ptr<filter_rules_t> rules = atomic_load(&filter->rules);
+	if (!rules || rules->terms.empty())
+	{
+		return AURA_FILTER_PASS;
+	}
+
+	// Remember where the last few characters started, so that the start of
+	// a term can be found from its length when it's found. These are per
+	// thread so that a check doesn't allocate
+	static thread_local vector<size_t> starts;
+	static thread_local vector<filter_found_t> blocked, allowed;
+	blocked.clear();
+	allowed.clear();
+	size_t ringSize = 1;
+	while (ringSize <= rules->maxLength)
+	{
+		ringSize <<= 1;
+	}
+	if (starts.size() < ringSize)
+	{
+		starts.resize(ringSize);
+	}
+	size_t ringMask = ringSize - 1;
+
+	size_t nextBlocked = 0;
+	const char* position = text;
+	size_t index = 0;
+	uint32_t state = FILTER_ROOT;
+	char encoded[4];
+	while (true)
+	{
+		// A blocked term counts unless an allowed one covers it. A cover
+		// ends no further on than the longest allowed term, so once that
+		// far past the start of a blocked one it's settled (straight away
+		// if nothing is allowed). At the end of the text everything is
+		while (nextBlocked < blocked.size() && (*position == '\0' || index - blocked[nextBlocked].start > rules->maxAllowedLength))
+		{
+			const filter_found_t& found = blocked[nextBlocked++];
+			bool covered = false;
+			for (auto& cover : allowed)
+			{
+				if (cover.start <= found.start && cover.end >= found.end)
+				{
+					covered = true;
+					break;
+				}
+			}
+			if (covered)
+			{
+				continue;
+			}
+
+			if (match != NULL)
+			{
+				match->offset = found.startOffset;
+				match->length = found.endOffset - found.startOffset;
+				match->term = rules->terms[found.term].index;
+			}
+			filter->blockedCount.fetch_add(1, memory_order_relaxed);
+			return AURA_FILTER_BLOCK;
+		}
+
+		if (*position == '\0')
+		{
+			break;
+		}
+
+		// Most text is ASCII, which folds and encodes as itself
+		starts[index & ringMask] = position - text;
+		unsigned char byte = (unsigned char)*position;
+		if (byte < 0x80)
+		{
+			state = next_state(rules.get(), state, byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte);
+			position++;
+		}
+		else
+		{
+			unsigned int codepoint = utf8fold(decode_char(position));
+			size_t length = utf8encode(codepoint, encoded);
+			for (size_t i = 0; i < length; i++)
+			{
+				state = next_state(rules.get(), state, (unsigned char)encoded[i]);
+			}
+		}
+		index++;
+
+		// Every term ending here is either this state's or along its
+		// chain of outputs
+		uint32_t output = rules->states[state].term != FILTER_NONE ? state : rules->states[state].output;
+		while (output != FILTER_NONE)
+		{
+			const filter_state_t& ending = rules->states[output];
+			filter_found_t found;
+			found.term = ending.term;
+			found.end = index;
+			found.start = index - rules->terms[ending.term].length;
+			found.endOffset = position - text;
+			found.startOffset = starts[found.start & ringMask];
+			(rules->terms[ending.term].allowed ? allowed : blocked).push_back(found);
+			output = ending.output;
+		}
+	}
+
+	return AURA_FILTER_PASS;
+}
+
+/// Gets the number of texts a filter has checked
+unsigned long long aura_filter_get_checked_count(aura_filter_t filter)
+{
+	return ((filter_t*)filter)->checkedCount;
+}
+
+/// Gets the number of texts a filter has blocked
+unsigned long long aura_filter_get_blocked_count(aura_filter_t filter)
+{
+	return ((filter_t*)filter)->blockedCount;
+}
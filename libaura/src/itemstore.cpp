@@ -0,0 +1,343 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define ITEM_STORE_ALIGNMENT    sizeof(void*)
+#define ITEM_STORE_EMPTY_SLOT   ((size_t)-1)
+
+/// The hash of an item's identifier, and where its block is in the arena
+typedef struct item_slot_t
+{
+	uint64_t hash;
+	size_t arenaOffset;
+} item_slot_t;
+
+/// A feed item store. Items live in a ring of fixed capacity, oldest first, and
+/// each one's fields and strings are packed in to a single block of an arena
+/// that is also used as a ring. Items only ever leave in the order they
+/// arrived, so freeing the oldest block always frees space at the tail of the
+/// arena. An open-addressed hash table maps identifiers to positions in the
+/// ring so duplicates are found without searching
+typedef struct item_store_t
+{
+	/// The items and their slots, as a ring buffer
+	vector<aura_item_t> items;
+	vector<item_slot_t> slots;
+	size_t first, count;
+
+	/// The arena, the offset after the newest block, and the offset of the
+	/// oldest block
+	vector<char> arena;
+	size_t arenaHead, arenaTail;
+
+	/// Linear probing hash table of ring positions, sized to a power of two
+	/// that keeps it at most half full
+	vector<size_t> table;
+	size_t tableMask;
+
+	/// Statistics
+	unsigned long long sequence, duplicates, evictions;
+
+	/// Held whilst inserting and whilst reading items in place
+	recursive_mutex lock;
+} item_store_t;
+
+/// Hashes an identifier with FNV-1a
+static uint64_t hash_id(const char* id)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	while (*id)
+	{
+		hash ^= (unsigned char)*id++;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/// Finds the table entry holding an identifier, or the empty entry where it
+/// would go
+static size_t find_entry(item_store_t* store, const char* id, uint64_t hash)
+{
+	size_t entry = (size_t)hash & store->tableMask;
+	while (store->table[entry] != ITEM_STORE_EMPTY_SLOT)
+	{
+		size_t slot = store->table[entry];
+		if (store->slots[slot].hash == hash && strcmp(store->items[slot].id, id) == 0)
+		{
+			break;
+		}
+		entry = (entry + 1) & store->tableMask;
+	}
+
+	return entry;
+}
+
+/// Removes a ring position from the hash table, moving back any entries after
+/// it that would otherwise no longer be found
+static void remove_entry(item_store_t* store, size_t slot)
+{
+	size_t entry = (size_t)store->slots[slot].hash & store->tableMask;
+	while (store->table[entry] != slot)
+	{
+		entry = (entry + 1) & store->tableMask;
+	}
+
+	size_t next = entry;
+	for (;;)
+	{
+		next = (next + 1) & store->tableMask;
+		if (store->table[next] == ITEM_STORE_EMPTY_SLOT)
+		{
+			break;
+		}
+
+		// An entry can fill the gap if its home isn't between the gap and
+		// where it is now
+		size_t home = (size_t)store->slots[store->table[next]].hash & store->tableMask;
+		if (((next - home) & store->tableMask) >= ((next - entry) & store->tableMask))
+		{
+			store->table[entry] = store->table[next];
+			entry = next;
+		}
+	}
+	store->table[entry] = ITEM_STORE_EMPTY_SLOT;
+}
+
+/// Evicts the oldest item
+static void evict_oldest(item_store_t* store)
+{
+	remove_entry(store, store->first);
+	store->first = (store->first + 1) % store->items.size();
+	store->count--;
+	store->evictions++;
+
+	if (store->count == 0)
+	{
+		store->arenaHead = store->arenaTail = 0;
+	}
+	else
+	{
+		store->arenaTail = store->slots[store->first].arenaOffset;
+	}
+}
+
+/// Finds room in the arena for a block without evicting anything
+/// @returns The offset of the block, or ITEM_STORE_EMPTY_SLOT if there isn't
+/// room
+static size_t allocate_block(item_store_t* store, size_t length)
+{
+	size_t arenaSize = store->arena.size();
+	if (store->count == 0)
+	{
+		return length <= arenaSize ? 0 : ITEM_STORE_EMPTY_SLOT;
+	}
+
+	// Blocks run from the tail to the head, perhaps wrapping round to the
+	// start, in which case the head is behind the tail
+	if (store->arenaHead > store->arenaTail)
+	{
+		if (store->arenaHead + length <= arenaSize)
+		{
+			return store->arenaHead;
+		}
+		return length <= store->arenaTail ? 0 : ITEM_STORE_EMPTY_SLOT;
+	}
+
+	return store->arenaHead + length <= store->arenaTail ? store->arenaHead : ITEM_STORE_EMPTY_SLOT;
+}
+
+/// Creates a feed item store
+aura_item_store_t aura_item_store_create(size_t capacity, size_t arenaBytes)
+{
+	if (capacity == 0 || arenaBytes == 0)
+	{
+		return NULL;
+	}
+
+	item_store_t* store = new item_store_t();
+	store->items.resize(capacity);
+	store->slots.resize(capacity);
+	store->first = store->count = 0;
+	store->arena.resize(arenaBytes);
+	store->arenaHead = store->arenaTail = 0;
+	store->sequence = store->duplicates = store->evictions = 0;
+
+	size_t tableSize = 1;
+	while (tableSize < capacity * 2)
+	{
+		tableSize <<= 1;
+	}
+	store->table.assign(tableSize, ITEM_STORE_EMPTY_SLOT);
+	store->tableMask = tableSize - 1;
+
+	return store;
+}
+
+/// Deletes a feed item store and all of its items
+void aura_item_store_delete(aura_item_store_t store)
+{
+	delete (item_store_t*)store;
+}
+
+/// Adds an item to a store, unless there is already one with the same
+/// identifier
+int aura_item_store_insert(aura_item_store_t _store, const char* id, const aura_item_field_t* fields, size_t fieldCount)
+{
+	item_store_t* store = (item_store_t*)_store;
+
+	// Work out the size of the block before taking the lock
+	size_t length = sizeof(aura_item_field_t) * fieldCount + strlen(id) + 1;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		length += strlen(fields[i].key) + strlen(fields[i].value) + 2;
+	}
+	length = (length + ITEM_STORE_ALIGNMENT - 1) & ~(ITEM_STORE_ALIGNMENT - 1);
+	if (length > store->arena.size())
+	{
+		return AURA_ITEM_TOO_LARGE;
+	}
+
+	uint64_t hash = hash_id(id);
+	lock_guard<recursive_mutex> guard(store->lock);
+	if (store->table[find_entry(store, id, hash)] != ITEM_STORE_EMPTY_SLOT)
+	{
+		store->duplicates++;
+		return AURA_ITEM_DUPLICATE;
+	}
+
+	// Make room, oldest first
+	if (store->count == store->items.size())
+	{
+		evict_oldest(store);
+	}
+	size_t offset;
+	while ((offset = allocate_block(store, length)) == ITEM_STORE_EMPTY_SLOT)
+	{
+		evict_oldest(store);
+	}
+
+	// Pack the fields, then the identifier, then the keys and values
+	char* block = &store->arena[offset];
+	aura_item_field_t* blockFields = (aura_item_field_t*)block;
+	char* strings = block + sizeof(aura_item_field_t) * fieldCount;
+	size_t idLength = strlen(id) + 1;
+	memcpy(strings, id, idLength);
+	const char* blockId = strings;
+	strings += idLength;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		size_t keyLength = strlen(fields[i].key) + 1;
+		size_t valueLength = strlen(fields[i].value) + 1;
+		memcpy(strings, fields[i].key, keyLength);
+		blockFields[i].key = strings;
+		strings += keyLength;
+		memcpy(strings, fields[i].value, valueLength);
+		blockFields[i].value = strings;
+		strings += valueLength;
+	}
+
+	size_t slot = (store->first + store->count) % store->items.size();
+	aura_item_t& item = store->items[slot];
+	item.id = blockId;
+	item.fields = blockFields;
+	item.fieldCount = fieldCount;
+	item.sequence = ++store->sequence;
+	store->slots[slot].hash = hash;
+	store->slots[slot].arenaOffset = offset;
+	if (store->count == 0)
+	{
+		store->arenaTail = offset;
+	}
+	store->arenaHead = offset + length;
+	store->count++;
+
+	// Evicting may have moved entries about, so look for the gap again
+	store->table[find_entry(store, id, hash)] = slot;
+	return AURA_ITEM_INSERTED;
+}
+
+/// Locks a store so that its items can be read in place
+void aura_item_store_lock(aura_item_store_t store)
+{
+	((item_store_t*)store)->lock.lock();
+}
+
+/// Unlocks a store locked with aura_item_store_lock()
+void aura_item_store_unlock(aura_item_store_t store)
+{
+	((item_store_t*)store)->lock.unlock();
+}
+
+/// Gets the number of items in a store
+size_t aura_item_store_count(aura_item_store_t store)
+{
+	return ((item_store_t*)store)->count;
+}
+
+/// Gets an item from a store by position, the oldest being zero
+const aura_item_t* aura_item_store_get(aura_item_store_t _store, size_t index)
+{
+	item_store_t* store = (item_store_t*)_store;
+	if (index >= store->count)
+	{
+		return NULL;
+	}
+
+	return &store->items[(store->first + index) % store->items.size()];
+}
+
+/// Gets an item from a store by identifier
+const aura_item_t* aura_item_store_find(aura_item_store_t _store, const char* id)
+{
+	item_store_t* store = (item_store_t*)_store;
+	size_t slot = store->table[find_entry(store, id, hash_id(id))];
+	return slot != ITEM_STORE_EMPTY_SLOT ? &store->items[slot] : NULL;
+}
+
+/// Gets the value of a field of an item
+const char* aura_item_get_field(const aura_item_t* item, const char* key)
+{
+	for (size_t i = 0; i < item->fieldCount; i++)
+	{
+		if (strcmp(item->fields[i].key, key) == 0)
+		{
+			return item->fields[i].value;
+		}
+	}
+
+	return NULL;
+}
+
+/// Gets the sequence number of the newest item ever inserted in to a store
+unsigned long long aura_item_store_get_sequence(aura_item_store_t _store)
+{
+	item_store_t* store = (item_store_t*)_store;
+	lock_guard<recursive_mutex> guard(store->lock);
+	return store->sequence;
+}
+
+/// Gets the number of items that have been rejected as duplicates
+unsigned long long aura_item_store_get_duplicates(aura_item_store_t _store)
+{
+	item_store_t* store = (item_store_t*)_store;
+	lock_guard<recursive_mutex> guard(store->lock);
+	return store->duplicates;
+}
+
+/// Gets the number of items that have been evicted to make room for new ones
+unsigned long long aura_item_store_get_evictions(aura_item_store_t _store)
+{
+	item_store_t* store = (item_store_t*)_store;
+	lock_guard<recursive_mutex> guard(store->lock);
+	return store->evictions;
+}
@@ -0,0 +1,528 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define JOURNAL_MAGIC           "AURAJNL"
+#define JOURNAL_VERSION         1
+#define JOURNAL_RECORD_MAGIC    0x4a524543
+#define JOURNAL_ITEM            1
+#define JOURNAL_REMOVE          2
+#define JOURNAL_ALIGNMENT       8
+
+/// The start of a journal file
+typedef struct journal_header_t
+{
+	char magic[8];
+	uint32_t version, reserved;
+} journal_header_t;
+
+/// The start of a record. The payload that follows is the identifier, then
+/// the key and value of each field, all terminated, padded to the alignment
+typedef struct journal_record_t
+{
+	uint32_t magic;
+
+	/// The length of the payload, including the padding
+	uint32_t length;
+
+	/// The checksum of the type, field count and payload, so that a record
+	/// that was only partly written is spotted
+	uint32_t checksum;
+
+	uint16_t type, fieldCount;
+} journal_record_t;
+
+/// An item found in the file, for replaying and compacting
+typedef struct journal_live_t
+{
+	/// Where the item was first added, and where its latest version is
+	size_t first, latest;
+} journal_live_t;
+
+/// An item journal. Appends go straight to the end of the file. Compaction
+/// writes what is live to a new file without holding the lock, then takes it
+/// to copy across anything appended meanwhile and rename the new file over
+/// the old one
+typedef struct journal_t
+{
+	string path;
+	size_t maxItems, maxBytes;
+
+	/// Protects the descriptor and size, and the compaction state
+	mutex lock;
+	int fd;
+	size_t size;
+
+	/// The size the file was left at by the last compaction
+	size_t compactedSize;
+
+	/// The background compaction thread, started the first time it's needed
+	thread compactor;
+	condition_variable wake;
+	bool compactRequested, compacting, stopping;
+
+	/// Held whilst compacting, so that only one runs at once
+	mutex compactLock;
+
+	atomic<unsigned long long> compactions;
+} journal_t;
+
+static void journal_compactor_main(journal_t* journal);
+
+/// Checksums some bytes with FNV-1a, carrying on from a previous hash
+static uint32_t checksum(const void* data, size_t length, uint32_t hash = 2166136261U)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/// Works out the checksum of a record
+static uint32_t record_checksum(const journal_record_t* record, const char* payload)
+{
+	uint16_t kind[2] = { record->type, record->fieldCount };
+	return checksum(payload, record->length, checksum(kind, sizeof(kind)));
+}
+
+/// Checks the record at an offset is whole and makes sense
+/// @returns The length of the record, or zero if it isn't valid
+static size_t check_record(const char* data, size_t size, size_t offset)
+{
+	if (size - offset < sizeof(journal_record_t))
+	{
+		return 0;
+	}
+
+	const journal_record_t* record = (const journal_record_t*)(data + offset);
+	const char* payload = data + offset + sizeof(journal_record_t);
+	if (record->magic != JOURNAL_RECORD_MAGIC || record->length > size - offset - sizeof(journal_record_t) || record->length % JOURNAL_ALIGNMENT != 0 || (record->type != JOURNAL_ITEM && record->type != JOURNAL_REMOVE) || record_checksum(record, payload) != record->checksum)
+	{
+		return 0;
+	}
+
+	// Every string has to end inside the payload
+	size_t strings = 1 + record->fieldCount * 2;
+	const char* position = payload;
+	const char* end = payload + record->length;
+	for (size_t i = 0; i < strings; i++)
+	{
+		const char* terminator = (const char*)memchr(position, '\0', end - position);
+		if (terminator == NULL)
+		{
+			return 0;
+		}
+		position = terminator + 1;
+	}
+
+	return sizeof(journal_record_t) + record->length;
+}
+
+/// Finds the items that are live in a file, i.e. have been added and not
+/// since removed, keeping the newest maxItems of them
+/// @param data The contents of the file
+/// @param size The size of the file
+/// @param maxItems The most items to keep
+/// @param live Filled in with the items, in the order they were first added
+/// @returns The size of the part of the file that is valid
+static size_t find_live(const char* data, size_t size, size_t maxItems, vector<journal_live_t>& live)
+{
+	unordered_map<string, journal_live_t> items;
+	size_t offset = sizeof(journal_header_t);
+	size_t length;
+	while (offset < size && (length = check_record(data, size, offset)) != 0)
+	{
+		const journal_record_t* record = (const journal_record_t*)(data + offset);
+		string id = data + offset + sizeof(journal_record_t);
+		if (record->type == JOURNAL_REMOVE)
+		{
+			items.erase(id);
+		}
+		else
+		{
+			auto itemIter = items.find(id);
+			if (itemIter == items.end())
+			{
+				journal_live_t& item = items[id];
+				item.first = item.latest = offset;
+			}
+			else
+			{
+				itemIter->second.latest = offset;
+			}
+		}
+		offset += length;
+	}
+
+	live.clear();
+	live.reserve(items.size());
+	for (auto& item : items)
+	{
+		live.push_back(item.second);
+	}
+	sort(live.begin(), live.end(), [](const journal_live_t& a, const journal_live_t& b) { return a.first < b.first; });
+	if (live.size() > maxItems)
+	{
+		live.erase(live.begin(), live.end() - maxItems);
+	}
+
+	return offset;
+}
+
+/// Writes all of a buffer to a file
+static bool write_all(int fd, const char* data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(fd, data, length);
+		if (written <= 0)
+		{
+			return false;
+		}
+		data += written;
+		length -= (size_t)written;
+	}
+
+	return true;
+}
+
+/// Writes the header of a new file
+static bool write_header(int fd)
+{
+	journal_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+	header.version = JOURNAL_VERSION;
+	return write_all(fd, (const char*)&header, sizeof(header));
+}
+
+/// Maps the first part of a file for reading
+/// @returns The mapping, or NULL if the file is empty or can't be mapped
+static const char* map_file(int fd, size_t size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	void* memory = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	return memory != MAP_FAILED ? (const char*)memory : NULL;
+}
+
+/// Adds a record to the end of a journal
+static bool append_record(journal_t* journal, uint16_t type, const char* id, const aura_item_field_t* fields, size_t fieldCount)
+{
+	if (fieldCount > UINT16_MAX)
+	{
+		return false;
+	}
+
+	// Build the record before taking the lock
+	size_t length = strlen(id) + 1;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		length += strlen(fields[i].key) + strlen(fields[i].value) + 2;
+	}
+	length = (length + JOURNAL_ALIGNMENT - 1) & ~(size_t)(JOURNAL_ALIGNMENT - 1);
+	if (length > UINT32_MAX)
+	{
+		return false;
+	}
+
+	vector<char> buffer(sizeof(journal_record_t) + length, '\0');
+	journal_record_t* record = (journal_record_t*)&buffer[0];
+	char* payload = &buffer[sizeof(journal_record_t)];
+	char* position = payload;
+	position = stpcpy(position, id) + 1;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		position = stpcpy(position, fields[i].key) + 1;
+		position = stpcpy(position, fields[i].value) + 1;
+	}
+	record->magic = JOURNAL_RECORD_MAGIC;
+	record->length = (uint32_t)length;
+	record->type = type;
+	record->fieldCount = (uint16_t)fieldCount;
+	record->checksum = record_checksum(record, payload);
+
+	lock_guard<mutex> guard(journal->lock);
+	if (!write_all(journal->fd, &buffer[0], buffer.size()))
+	{
+		// Don't leave half a record for the next one to follow
+		while (ftruncate(journal->fd, (off_t)journal->size) != 0 && errno == EINTR)
+		{
+		}
+		return false;
+	}
+	journal->size += buffer.size();
+
+	// If the newest items alone are over the limit then compacting won't
+	// help much, so wait for the file to double
+	if (journal->size > max(journal->maxBytes, journal->compactedSize * 2) && !journal->compactRequested && !journal->compacting && !journal->stopping)
+	{
+		journal->compactRequested = true;
+		if (!journal->compactor.joinable())
+		{
+			journal->compactor = thread(journal_compactor_main, journal);
+		}
+		journal->wake.notify_one();
+	}
+
+	return true;
+}
+
+/// Entry point for the background compaction thread
+static void journal_compactor_main(journal_t* journal)
+{
+	unique_lock<mutex> guard(journal->lock);
+	while (true)
+	{
+		journal->wake.wait(guard, [journal] { return journal->stopping || journal->compactRequested; });
+		if (journal->stopping)
+		{
+			return;
+		}
+
+		journal->compactRequested = false;
+		guard.unlock();
+		aura_journal_compact(journal);
+		guard.lock();
+	}
+}
+
+/// Opens an item journal, creating the file if it doesn't exist
+aura_journal_t aura_journal_open(const char* path, size_t maxItems, size_t maxBytes)
+{
+	if (path == NULL || maxItems == 0)
+	{
+		return NULL;
+	}
+
+	int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	// A file that isn't a journal is started again, as is a torn end
+	struct stat info;
+	size_t size = fstat(fd, &info) == 0 ? (size_t)info.st_size : 0;
+	size_t valid = 0;
+	const char* data = size >= sizeof(journal_header_t) ? map_file(fd, size) : NULL;
+	if (data != NULL)
+	{
+		const journal_header_t* header = (const journal_header_t*)data;
+		if (memcmp(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 && header->version == JOURNAL_VERSION)
+		{
+			vector<journal_live_t> live;
+			valid = find_live(data, size, maxItems, live);
+		}
+		munmap((void*)data, size);
+	}
+	if ((valid != size && ftruncate(fd, (off_t)valid) != 0) || (valid == 0 && !write_header(fd)))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	journal_t* journal = new journal_t();
+	journal->path = path;
+	journal->maxItems = maxItems;
+	journal->maxBytes = maxBytes;
+	journal->fd = fd;
+	journal->size = valid != 0 ? valid : sizeof(journal_header_t);
+	journal->compactedSize = 0;
+	journal->compactRequested = journal->compacting = journal->stopping = false;
+	journal->compactions = 0;
+
+	return journal;
+}
+
+/// Closes an item journal, waiting for any compaction to finish
+void aura_journal_close(aura_journal_t _journal)
+{
+	journal_t* journal = (journal_t*)_journal;
+	{
+		lock_guard<mutex> guard(journal->lock);
+		journal->stopping = true;
+	}
+	journal->wake.notify_all();
+	if (journal->compactor.joinable())
+	{
+		journal->compactor.join();
+	}
+
+	close(journal->fd);
+	delete journal;
+}
+
+/// Replays the items in a journal
+size_t aura_journal_replay(aura_journal_t _journal, aura_journal_item_callback_t callback, void* userData)
+{
+	journal_t* journal = (journal_t*)_journal;
+
+	// The mapping stays valid even if compaction replaces the file, and
+	// appends after this point aren't in it
+	size_t size;
+	const char* data;
+	{
+		lock_guard<mutex> guard(journal->lock);
+		size = journal->size;
+		data = map_file(journal->fd, size);
+	}
+	if (data == NULL)
+	{
+		return 0;
+	}
+
+	vector<journal_live_t> live;
+	find_live(data, size, journal->maxItems, live);
+
+	vector<aura_item_field_t> fields;
+	size_t sequence = 0;
+	for (auto& entry : live)
+	{
+		const journal_record_t* record = (const journal_record_t*)(data + entry.latest);
+		const char* position = data + entry.latest + sizeof(journal_record_t);
+
+		aura_item_t item;
+		item.id = position;
+		position += strlen(position) + 1;
+		fields.resize(record->fieldCount);
+		for (size_t i = 0; i < fields.size(); i++)
+		{
+			fields[i].key = position;
+			position += strlen(position) + 1;
+			fields[i].value = position;
+			position += strlen(position) + 1;
+		}
+		item.fields = fields.empty() ? NULL : &fields[0];
+		item.fieldCount = fields.size();
+		item.sequence = ++sequence;
+		callback(userData, &item);
+	}
+
+	munmap((void*)data, size);
+	return sequence;
+}
+
+/// Adds an item to the end of a journal
+bool aura_journal_append(aura_journal_t journal, const char* id, const aura_item_field_t* fields, size_t fieldCount)
+{
+	return append_record((journal_t*)journal, JOURNAL_ITEM, id, fields, fieldCount);
+}
+
+/// Notes in a journal that an item has been removed
+bool aura_journal_remove(aura_journal_t journal, const char* id)
+{
+	return append_record((journal_t*)journal, JOURNAL_REMOVE, id, NULL, 0);
+}
+
+/// Compacts a journal now, on the calling thread
+bool aura_journal_compact(aura_journal_t _journal)
+{
+	journal_t* journal = (journal_t*)_journal;
+	lock_guard<mutex> compactGuard(journal->compactLock);
+
+	size_t end;
+	const char* data;
+	{
+		lock_guard<mutex> guard(journal->lock);
+		journal->compacting = true;
+		end = journal->size;
+		data = map_file(journal->fd, end);
+	}
+
+	// Write the latest version of each live item to a new file, without
+	// holding up appends
+	string compactPath = journal->path + ".compact";
+	int fd = open(compactPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	bool success = fd >= 0 && data != NULL && write_header(fd);
+	size_t size = sizeof(journal_header_t);
+	if (success)
+	{
+		vector<journal_live_t> live;
+		find_live(data, end, journal->maxItems, live);
+
+		vector<char> buffer;
+		for (auto& entry : live)
+		{
+			const journal_record_t* record = (const journal_record_t*)(data + entry.latest);
+			buffer.insert(buffer.end(), data + entry.latest, data + entry.latest + sizeof(journal_record_t) + record->length);
+		}
+		success = buffer.empty() || write_all(fd, &buffer[0], buffer.size());
+		size += buffer.size();
+	}
+	if (data != NULL)
+	{
+		munmap((void*)data, end);
+	}
+
+	lock_guard<mutex> guard(journal->lock);
+	journal->compacting = false;
+
+	// Bring across whatever was appended whilst we were at it, then swap
+	if (success && journal->size > end)
+	{
+		vector<char> appended(journal->size - end);
+		success = pread(journal->fd, &appended[0], appended.size(), (off_t)end) == (ssize_t)appended.size() && write_all(fd, &appended[0], appended.size());
+		size += appended.size();
+	}
+	if (success)
+	{
+		success = fdatasync(fd) == 0 && rename(compactPath.c_str(), journal->path.c_str()) == 0;
+	}
+	if (!success)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+			unlink(compactPath.c_str());
+		}
+		return false;
+	}
+
+	close(journal->fd);
+	journal->fd = fd;
+	journal->size = journal->compactedSize = size;
+	journal->compactions++;
+	return true;
+}
+
+/// Gets the size of a journal's file in bytes
+size_t aura_journal_get_size(aura_journal_t _journal)
+{
+	journal_t* journal = (journal_t*)_journal;
+	lock_guard<mutex> guard(journal->lock);
+	return journal->size;
+}
+
+/// Gets the number of times a journal has been compacted
+unsigned long long aura_journal_get_compaction_count(aura_journal_t journal)
+{
+	return ((journal_t*)journal)->compactions;
+}
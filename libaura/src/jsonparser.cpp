@@ -0,0 +1,837 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdio.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define JSON_MAX_DEPTH     256
+#define JSON_MAX_TOKEN     (1024 * 1024)
+#define JSON_NO_FIELD      -1
+
+/// What the parser expects next, outside of a token
+typedef enum json_state_t
+{
+	/// A value (top-level, after a colon, or after a comma in an array)
+	JSON_VALUE = 0,
+
+	/// A key or the end of an empty object
+	JSON_FIRST_KEY,
+
+	/// A key, after a comma
+	JSON_KEY,
+
+	/// The colon after a key
+	JSON_COLON,
+
+	/// A comma or the end of an object
+	JSON_OBJECT_NEXT,
+
+	/// A value or the end of an empty array
+	JSON_FIRST_VALUE,
+
+	/// A comma or the end of an array
+	JSON_ARRAY_NEXT,
+} json_state_t;
+
+/// The kind of token being read
+typedef enum json_token_t
+{
+	JSON_TOKEN_NONE = 0,
+	JSON_TOKEN_STRING,
+	JSON_TOKEN_NUMBER,
+	JSON_TOKEN_LITERAL,
+} json_token_t;
+
+/// An object or array that we're inside
+typedef struct json_frame_t
+{
+	/// Whether it's an array
+	bool array;
+
+	/// Whether it lies outside anything selected, so its contents are
+	/// scanned but not kept
+	bool skip;
+
+	/// The length of the path of the object or array itself
+	size_t pathLength;
+} json_frame_t;
+
+/// A streaming JSON parser. The document is read a byte at a time, so chunks
+/// can end anywhere, and only the path to the current value is tracked rather
+/// than the document itself. Keys and values are only copied when they lie on
+/// a selected path, and anything else is skipped over
+typedef struct json_parser_t
+{
+	/// The selector
+	string itemPath, idPath;
+	vector<string> fieldKeys, fieldPaths;
+
+	/// Where items go
+	aura_item_store_t store;
+	aura_json_item_callback_t callback;
+	void* userData;
+
+	/// The structure we're inside, and the path of the current value
+	json_state_t state;
+	vector<json_frame_t> stack;
+	string path;
+
+	/// The token being read, and whether it is a key
+	json_token_t token;
+	bool tokenIsKey;
+	string tokenText;
+
+	/// Whether the token is being kept, and what it is kept for
+	bool buffering;
+	bool captureId;
+	int captureField;
+
+	/// String escape state: after a backslash, the number of hex digits
+	/// still to come in a \u escape and their value so far, and a high
+	/// surrogate waiting for its pair
+	bool escape;
+	int unicodeDigits;
+	unsigned int unicodeValue, highSurrogate;
+
+	/// The depth of the item being built, or zero if we're not in one
+	size_t itemDepth;
+
+	/// The item being built
+	string itemId;
+	bool hasId;
+	vector<string> values;
+	vector<bool> found;
+
+	/// The number of bytes read, and of items emitted
+	unsigned long long offset, itemCount;
+
+	/// Why the document is malformed, if it is
+	bool failed;
+	string error;
+} json_parser_t;
+
+/// Determines whether a path is, or leads to, another
+static bool path_leads_to(const string& path, const string& target)
+{
+	if (path.empty())
+	{
+		return true;
+	}
+	if (target.compare(0, path.size(), path) != 0)
+	{
+		return false;
+	}
+
+	return target.size() == path.size() || target[path.size()] == '.' || target[path.size()] == '[';
+}
+
+/// Gets the path of the current value relative to the item it is in
+static string relative_path(json_parser_t* parser)
+{
+	if (parser->itemPath.empty())
+	{
+		return parser->path;
+	}
+
+	string rest = parser->path.substr(parser->itemPath.size());
+	if (!rest.empty() && rest[0] == '.')
+	{
+		rest.erase(0, 1);
+	}
+
+	return rest;
+}
+
+/// Determines whether we're skipping the current container
+static bool is_skipping(json_parser_t* parser)
+{
+	return !parser->stack.empty() && parser->stack.back().skip;
+}
+
+/// Marks the document as malformed
+static void fail(json_parser_t* parser, const char* message)
+{
+	char error[128];
+	snprintf(error, sizeof(error), "Malformed JSON at byte %llu: %s", parser->offset, message);
+	parser->failed = true;
+	parser->error = error;
+}
+
+/// Appends a code point to the token as UTF-8
+static void append_code_point(json_parser_t* parser, unsigned int codePoint)
+{
+	if (!parser->buffering)
+	{
+		return;
+	}
+
+	string& text = parser->tokenText;
+	if (codePoint < 0x80)
+	{
+		text += (char)codePoint;
+	}
+	else if (codePoint < 0x800)
+	{
+		text += (char)(0xc0 | (codePoint >> 6));
+		text += (char)(0x80 | (codePoint & 0x3f));
+	}
+	else if (codePoint < 0x10000)
+	{
+		text += (char)(0xe0 | (codePoint >> 12));
+		text += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+		text += (char)(0x80 | (codePoint & 0x3f));
+	}
+	else
+	{
+		text += (char)(0xf0 | (codePoint >> 18));
+		text += (char)(0x80 | ((codePoint >> 12) & 0x3f));
+		text += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+		text += (char)(0x80 | (codePoint & 0x3f));
+	}
+}
+
+/// Writes out a high surrogate that didn't get its pair as U+FFFD
+static void flush_surrogate(json_parser_t* parser)
+{
+	if (parser->highSurrogate != 0)
+	{
+		append_code_point(parser, 0xfffd);
+		parser->highSurrogate = 0;
+	}
+}
+
+/// Handles the code point of a complete \u escape
+static void add_escaped_code_point(json_parser_t* parser, unsigned int codePoint)
+{
+	if (codePoint >= 0xdc00 && codePoint <= 0xdfff && parser->highSurrogate != 0)
+	{
+		append_code_point(parser, 0x10000 + ((parser->highSurrogate - 0xd800) << 10) + (codePoint - 0xdc00));
+		parser->highSurrogate = 0;
+		return;
+	}
+
+	flush_surrogate(parser);
+	if (codePoint >= 0xd800 && codePoint <= 0xdbff)
+	{
+		parser->highSurrogate = codePoint;
+	}
+	else if (codePoint >= 0xdc00 && codePoint <= 0xdfff)
+	{
+		append_code_point(parser, 0xfffd);
+	}
+	else
+	{
+		append_code_point(parser, codePoint);
+	}
+}
+
+/// Determines whether some text is a valid JSON number
+static bool is_json_number(const string& text)
+{
+	size_t i = 0, length = text.size();
+	if (i < length && text[i] == '-')
+	{
+		i++;
+	}
+	if (i >= length || !isdigit((unsigned char)text[i]))
+	{
+		return false;
+	}
+	if (text[i] == '0')
+	{
+		i++;
+	}
+	else
+	{
+		while (i < length && isdigit((unsigned char)text[i]))
+		{
+			i++;
+		}
+	}
+
+	if (i < length && text[i] == '.')
+	{
+		if (++i >= length || !isdigit((unsigned char)text[i]))
+		{
+			return false;
+		}
+		while (i < length && isdigit((unsigned char)text[i]))
+		{
+			i++;
+		}
+	}
+
+	if (i < length && (text[i] == 'e' || text[i] == 'E'))
+	{
+		if (++i < length && (text[i] == '+' || text[i] == '-'))
+		{
+			i++;
+		}
+		if (i >= length || !isdigit((unsigned char)text[i]))
+		{
+			return false;
+		}
+		while (i < length && isdigit((unsigned char)text[i]))
+		{
+			i++;
+		}
+	}
+
+	return i == length;
+}
+
+/// Works out what, if anything, the value at the current path is wanted for
+static void select_capture(json_parser_t* parser)
+{
+	parser->captureId = false;
+	parser->captureField = JSON_NO_FIELD;
+	if (parser->itemDepth == 0 || is_skipping(parser))
+	{
+		return;
+	}
+
+	string relative = relative_path(parser);
+	parser->captureId = !parser->hasId && relative == parser->idPath;
+	for (size_t i = 0; i < parser->fieldPaths.size(); i++)
+	{
+		if (!parser->found[i] && relative == parser->fieldPaths[i])
+		{
+			parser->captureField = (int)i;
+			break;
+		}
+	}
+}
+
+/// Determines whether anything selected lies at or below the current path
+static bool is_relevant(json_parser_t* parser)
+{
+	if (parser->itemDepth == 0)
+	{
+		return path_leads_to(parser->path, parser->itemPath);
+	}
+
+	string relative = relative_path(parser);
+	if (path_leads_to(relative, parser->idPath))
+	{
+		return true;
+	}
+	for (auto& fieldPath : parser->fieldPaths)
+	{
+		if (path_leads_to(relative, fieldPath))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// Hands a complete item on
+static void emit_item(json_parser_t* parser)
+{
+	if (!parser->hasId)
+	{
+		return;
+	}
+
+	vector<aura_item_field_t> fields;
+	for (size_t i = 0; i < parser->fieldKeys.size(); i++)
+	{
+		if (parser->found[i])
+		{
+			aura_item_field_t field;
+			field.key = parser->fieldKeys[i].c_str();
+			field.value = parser->values[i].c_str();
+			fields.push_back(field);
+		}
+	}
+
+	if (parser->callback != NULL)
+	{
+		parser->callback(parser->userData, parser->itemId.c_str(), fields.empty() ? NULL : &fields[0], fields.size());
+	}
+	else if (parser->store != NULL)
+	{
+		aura_item_store_insert(parser->store, parser->itemId.c_str(), fields.empty() ? NULL : &fields[0], fields.size());
+	}
+	parser->itemCount++;
+}
+
+/// Sets what is expected after a value has ended
+static void end_value(json_parser_t* parser)
+{
+	if (parser->stack.empty())
+	{
+		parser->state = JSON_VALUE;
+	}
+	else
+	{
+		parser->state = parser->stack.back().array ? JSON_ARRAY_NEXT : JSON_OBJECT_NEXT;
+	}
+}
+
+/// Keeps a scalar value if it is wanted
+static void capture_value(json_parser_t* parser, const string& value)
+{
+	if (parser->captureId)
+	{
+		parser->itemId = value;
+		parser->hasId = true;
+	}
+	if (parser->captureField != JSON_NO_FIELD)
+	{
+		parser->values[parser->captureField] = value;
+		parser->found[parser->captureField] = true;
+	}
+}
+
+/// Handles the end of a string, number or literal
+static void end_token(json_parser_t* parser)
+{
+	json_token_t token = parser->token;
+	parser->token = JSON_TOKEN_NONE;
+
+	if (token == JSON_TOKEN_STRING && parser->tokenIsKey)
+	{
+		// The key becomes the last part of the path of the value after it
+		if (!is_skipping(parser))
+		{
+			parser->path.resize(parser->stack.back().pathLength);
+			if (!parser->path.empty())
+			{
+				parser->path += '.';
+			}
+			parser->path += parser->tokenText;
+		}
+		parser->state = JSON_COLON;
+		return;
+	}
+
+	if (token == JSON_TOKEN_NUMBER && !is_json_number(parser->tokenText))
+	{
+		fail(parser, "invalid number");
+		return;
+	}
+	if (token == JSON_TOKEN_LITERAL)
+	{
+		if (parser->tokenText != "true" && parser->tokenText != "false" && parser->tokenText != "null")
+		{
+			fail(parser, "invalid literal");
+			return;
+		}
+		if (parser->tokenText == "null")
+		{
+			parser->captureId = false;
+			parser->captureField = JSON_NO_FIELD;
+		}
+	}
+
+	capture_value(parser, parser->tokenText);
+	end_value(parser);
+}
+
+/// Starts reading a token
+static void begin_token(json_parser_t* parser, json_token_t token, bool isKey)
+{
+	parser->token = token;
+	parser->tokenIsKey = isKey;
+	parser->tokenText.clear();
+	parser->escape = false;
+	parser->unicodeDigits = 0;
+	parser->highSurrogate = 0;
+	if (isKey)
+	{
+		parser->captureId = false;
+		parser->captureField = JSON_NO_FIELD;
+		parser->buffering = !is_skipping(parser);
+	}
+	else
+	{
+		select_capture(parser);
+		parser->buffering = parser->captureId || parser->captureField != JSON_NO_FIELD || token != JSON_TOKEN_STRING;
+	}
+}
+
+/// Enters an object or array
+static void open_container(json_parser_t* parser, bool array)
+{
+	if (parser->stack.size() >= JSON_MAX_DEPTH)
+	{
+		fail(parser, "nested too deeply");
+		return;
+	}
+
+	json_frame_t frame;
+	frame.array = array;
+	frame.pathLength = parser->path.size();
+	frame.skip = is_skipping(parser) || !is_relevant(parser);
+
+	// An object at the item path starts a new item
+	if (!frame.skip && !array && parser->itemDepth == 0 && parser->path == parser->itemPath)
+	{
+		parser->itemDepth = parser->stack.size() + 1;
+		parser->hasId = false;
+		parser->itemId.clear();
+		for (size_t i = 0; i < parser->found.size(); i++)
+		{
+			parser->found[i] = false;
+			parser->values[i].clear();
+		}
+	}
+
+	parser->stack.push_back(frame);
+	if (array && !frame.skip)
+	{
+		parser->path += "[]";
+	}
+	parser->state = array ? JSON_FIRST_VALUE : JSON_FIRST_KEY;
+}
+
+/// Leaves an object or array
+static void close_container(json_parser_t* parser)
+{
+	json_frame_t frame = parser->stack.back();
+	if (!frame.skip)
+	{
+		parser->path.resize(frame.pathLength);
+	}
+	if (parser->stack.size() == parser->itemDepth)
+	{
+		emit_item(parser);
+		parser->itemDepth = 0;
+	}
+	parser->stack.pop_back();
+	end_value(parser);
+}
+
+/// Handles a byte of a string
+static void string_byte(json_parser_t* parser, char c)
+{
+	if (parser->unicodeDigits > 0)
+	{
+		unsigned int digit;
+		if (c >= '0' && c <= '9')
+		{
+			digit = c - '0';
+		}
+		else if (c >= 'a' && c <= 'f')
+		{
+			digit = c - 'a' + 10;
+		}
+		else if (c >= 'A' && c <= 'F')
+		{
+			digit = c - 'A' + 10;
+		}
+		else
+		{
+			fail(parser, "invalid \\u escape");
+			return;
+		}
+
+		parser->unicodeValue = (parser->unicodeValue << 4) | digit;
+		if (--parser->unicodeDigits == 0)
+		{
+			add_escaped_code_point(parser, parser->unicodeValue);
+		}
+		return;
+	}
+
+	if (parser->escape)
+	{
+		parser->escape = false;
+		if (c == 'u')
+		{
+			parser->unicodeDigits = 4;
+			parser->unicodeValue = 0;
+			return;
+		}
+
+		flush_surrogate(parser);
+		switch (c)
+		{
+			case '"': case '\\': case '/':
+				break;
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case 'n':
+				c = '\n';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			default:
+				fail(parser, "invalid escape");
+				return;
+		}
+	}
+	else if (c == '\\')
+	{
+		parser->escape = true;
+		return;
+	}
+	else if (c == '"')
+	{
+		flush_surrogate(parser);
+		end_token(parser);
+		return;
+	}
+	else if ((unsigned char)c < 0x20)
+	{
+		fail(parser, "control character in string");
+		return;
+	}
+	else
+	{
+		flush_surrogate(parser);
+	}
+
+	if (parser->buffering)
+	{
+		parser->tokenText += c;
+	}
+}
+
+/// Handles a byte outside of a string
+static void structure_byte(json_parser_t* parser, char c)
+{
+	// Numbers and literals end at the first byte that can't be part of them,
+	// which is then handled as usual
+	if (parser->token == JSON_TOKEN_NUMBER || parser->token == JSON_TOKEN_LITERAL)
+	{
+		bool continues = parser->token == JSON_TOKEN_NUMBER ? (isdigit((unsigned char)c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') : (c >= 'a' && c <= 'z');
+		if (continues)
+		{
+			parser->tokenText += c;
+			return;
+		}
+
+		end_token(parser);
+		if (parser->failed)
+		{
+			return;
+		}
+	}
+
+	if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+	{
+		return;
+	}
+
+	switch (parser->state)
+	{
+		case JSON_FIRST_VALUE:
+			if (c == ']')
+			{
+				close_container(parser);
+				return;
+			}
+			// Fall through
+		case JSON_VALUE:
+			if (c == '{' || c == '[')
+			{
+				open_container(parser, c == '[');
+			}
+			else if (c == '"')
+			{
+				begin_token(parser, JSON_TOKEN_STRING, false);
+			}
+			else if (c == '-' || isdigit((unsigned char)c))
+			{
+				begin_token(parser, JSON_TOKEN_NUMBER, false);
+				parser->tokenText += c;
+			}
+			else if (c >= 'a' && c <= 'z')
+			{
+				begin_token(parser, JSON_TOKEN_LITERAL, false);
+				parser->tokenText += c;
+			}
+			else
+			{
+				fail(parser, "expected a value");
+			}
+			break;
+		case JSON_FIRST_KEY:
+			if (c == '}')
+			{
+				close_container(parser);
+				return;
+			}
+			// Fall through
+		case JSON_KEY:
+			if (c == '"')
+			{
+				begin_token(parser, JSON_TOKEN_STRING, true);
+			}
+			else
+			{
+				fail(parser, "expected a key");
+			}
+			break;
+		case JSON_COLON:
+			if (c == ':')
+			{
+				parser->state = JSON_VALUE;
+			}
+			else
+			{
+				fail(parser, "expected ':'");
+			}
+			break;
+		case JSON_OBJECT_NEXT:
+			if (c == ',')
+			{
+				parser->state = JSON_KEY;
+			}
+			else if (c == '}')
+			{
+				close_container(parser);
+			}
+			else
+			{
+				fail(parser, "expected ',' or '}'");
+			}
+			break;
+		case JSON_ARRAY_NEXT:
+			if (c == ',')
+			{
+				parser->state = JSON_VALUE;
+			}
+			else if (c == ']')
+			{
+				close_container(parser);
+			}
+			else
+			{
+				fail(parser, "expected ',' or ']'");
+			}
+			break;
+	}
+}
+
+/// Creates a streaming JSON parser
+aura_json_parser_t aura_json_parser_create(const aura_json_selector_t* selector, aura_item_store_t store)
+{
+	json_parser_t* parser = new json_parser_t();
+	parser->itemPath = selector->itemPath != NULL ? selector->itemPath : "";
+	parser->idPath = selector->idPath != NULL ? selector->idPath : "";
+	for (size_t i = 0; i < selector->fieldCount; i++)
+	{
+		parser->fieldKeys.push_back(selector->fields[i].key);
+		parser->fieldPaths.push_back(selector->fields[i].path);
+	}
+	parser->values.resize(selector->fieldCount);
+	parser->found.resize(selector->fieldCount);
+	parser->store = store;
+	parser->callback = NULL;
+	parser->userData = NULL;
+	parser->itemCount = 0;
+	aura_json_parser_reset(parser);
+
+	return parser;
+}
+
+/// Deletes a streaming JSON parser
+void aura_json_parser_delete(aura_json_parser_t parser)
+{
+	delete (json_parser_t*)parser;
+}
+
+/// Passes items to a callback instead of inserting them in to a store
+void aura_json_parser_set_callback(aura_json_parser_t _parser, aura_json_item_callback_t callback, void* userData)
+{
+	json_parser_t* parser = (json_parser_t*)_parser;
+	parser->callback = callback;
+	parser->userData = userData;
+}
+
+/// Parses the next chunk of a document
+int aura_json_parser_feed(aura_json_parser_t _parser, const char* data, size_t length)
+{
+	json_parser_t* parser = (json_parser_t*)_parser;
+	for (size_t i = 0; i < length && !parser->failed; i++, parser->offset++)
+	{
+		if (parser->token == JSON_TOKEN_STRING)
+		{
+			string_byte(parser, data[i]);
+		}
+		else
+		{
+			structure_byte(parser, data[i]);
+		}
+
+		if (parser->tokenText.size() > JSON_MAX_TOKEN)
+		{
+			fail(parser, "token too long");
+		}
+	}
+
+	return parser->failed ? -1 : 0;
+}
+
+/// Tells a parser that the document has ended
+int aura_json_parser_finish(aura_json_parser_t _parser)
+{
+	json_parser_t* parser = (json_parser_t*)_parser;
+	if (!parser->failed && (parser->token == JSON_TOKEN_NUMBER || parser->token == JSON_TOKEN_LITERAL))
+	{
+		end_token(parser);
+	}
+	if (!parser->failed && (parser->token != JSON_TOKEN_NONE || !parser->stack.empty()))
+	{
+		fail(parser, "unexpected end of document");
+	}
+
+	return parser->failed ? -1 : 0;
+}
+
+/// Gets a parser ready for a new document
+void aura_json_parser_reset(aura_json_parser_t _parser)
+{
+	json_parser_t* parser = (json_parser_t*)_parser;
+	parser->state = JSON_VALUE;
+	parser->stack.clear();
+	parser->path.clear();
+	parser->token = JSON_TOKEN_NONE;
+	parser->tokenIsKey = false;
+	parser->tokenText.clear();
+	parser->buffering = false;
+	parser->captureId = false;
+	parser->captureField = JSON_NO_FIELD;
+	parser->escape = false;
+	parser->unicodeDigits = 0;
+	parser->unicodeValue = 0;
+	parser->highSurrogate = 0;
+	parser->itemDepth = 0;
+	parser->hasId = false;
+	parser->offset = 0;
+	parser->failed = false;
+	parser->error.clear();
+}
+
+/// Gets a description of why a document was malformed
+const char* aura_json_parser_get_error(aura_json_parser_t _parser)
+{
+	json_parser_t* parser = (json_parser_t*)_parser;
+	return parser->failed ? parser->error.c_str() : NULL;
+}
+
+/// Gets the number of items a parser has emitted since it was created
+unsigned long long aura_json_parser_get_item_count(aura_json_parser_t parser)
+{
+	return ((json_parser_t*)parser)->itemCount;
+}
@@ -5,7 +5,6 @@
 // Includes:
 #include <curl/curl.h>
 #include <string>
-#include <sstream>
 #include <map>
 #include "aura.h"
 
@@ -26,80 +25,38 @@ int aura_init()
 	return 0;
 }
 
-/// Called from CURL when we have data
-static size_t curl_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+/// Allocates a new property of the given type, with all of its values zeroed
+aura_property_t* aura_allocate_property(aura_vartype_t type)
 {
-	// Get our buffer from the custom userdata, put the data from ptr in the buffer, snf yrll
-	// CURL we processed everythong
-	stringbuf* buffer = (stringbuf*)userdata;
-	buffer->sputn(ptr, size * nmemb);
-	return size * nmemb;
-}
-
-/// Uses CURL to synchronously download the given resource
-aura_download_data_t* aura_download_sync(const char* url)
-{
-	aura_download_data_t* response = NULL;
-
-	// Initialise CURL for this request
-	CURL* curl = curl_easy_init();
-	if (curl == NULL)
+	aura_property_t* property = NULL;
+	switch (type)
 	{
-		return NULL;
+		case AURA_VARTYPE_INT:
+			property = (aura_property_t*)new aura_property_int_t();
+			break;
+		case AURA_VARTYPE_BOOLEAN:
+			property = (aura_property_t*)new aura_property_bool_t();
+			break;
+		case AURA_VARTYPE_FLOAT:
+			property = (aura_property_t*)new aura_property_float_t();
+			break;
+		case AURA_VARTYPE_TEXT:
+			property = (aura_property_t*)new aura_property_string_t();
+			break;
+		case AURA_VARTYPE_FILENAME:
+			property = (aura_property_t*)new aura_property_file_t();
+			break;
+		case AURA_VARTYPE_COLOR:
+			property = (aura_property_t*)new aura_property_color_t();
+			break;
 	}
 
-	// Set up a string buffer
-	stringbuf buffer;
-
-	// Set up what we want CURL to do
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_callback);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
-	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 15);
-	//curl_easy_setopt(curl, CURLOPT_PROXY, TODO);
-	//curl_easy_setopt(curl, CURLOPT_PROXYPORT, TODO);
-	//curl_easy_setopt(curl, CURLOPT_PROXYTYPE, TODO);
-
-	// Perform the operation
-	CURLcode result = curl_easy_perform(curl);
-	if (result == 0)
-	{
-		string bufferData = buffer.str();
-
-		// Build our response object
-		response = new aura_download_data_t;
-		response->dataLength = bufferData.length();
-
-		// Copy in the response data (we add one to add a null terminator)
-		response->data = new char[bufferData.length() + 1];
-		memcpy(response->data, bufferData.c_str(), bufferData.length());
-		response->data[bufferData.length()] = '\0';
-
-		// Get the HTTP response code
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response->responseCode);
-
-		// Get the elapsed time
-		curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &response->totalTime);
-	}
-	else
+	if (property != NULL)
 	{
+		property->type = type;
 	}
 
-	// Tidy up
-	curl_easy_cleanup(curl);
-
-	return response;
-}
-
-/// Frees all the information associated with a download
-void aura_free_download_data(aura_download_data_t* downloadData)
-{
-	if (downloadData->data != NULL)
-	{
-		delete [] downloadData->data;
-	}
-	delete downloadData;
+	return property;
 }
 
 /// Creates a property list
@@ -117,6 +74,45 @@ void aura_delete_property_list(aura_properties_t properties)
 	delete propertyMap;
 }
 
+/// Frees a property that was allocated by aura_allocate_property
+static void free_property(aura_property_t* property)
+{
+	switch (property->type)
+	{
+		case AURA_VARTYPE_INT:
+			delete (aura_property_int_t*)property;
+			break;
+		case AURA_VARTYPE_BOOLEAN:
+			delete (aura_property_bool_t*)property;
+			break;
+		case AURA_VARTYPE_FLOAT:
+			delete (aura_property_float_t*)property;
+			break;
+		case AURA_VARTYPE_TEXT:
+			delete (aura_property_string_t*)property;
+			break;
+		case AURA_VARTYPE_FILENAME:
+			delete (aura_property_file_t*)property;
+			break;
+		case AURA_VARTYPE_COLOR:
+			delete (aura_property_color_t*)property;
+			break;
+	}
+}
+
+/// Deletes the properties of an object instance and its property list. The
+/// object structure itself belongs to the plugin that created it
+void aura_delete_object(aura_object_instance_t* object)
+{
+	property_map_t* propertyMap = (property_map_t*)object->properties;
+	for (auto propertyPair : *propertyMap)
+	{
+		free_property(propertyPair.second);
+	}
+	delete propertyMap;
+	object->properties = NULL;
+}
+
 /// Takes an aura_properties_t property list and a string for the name of the property to get and
 /// returns that property from the list
 aura_property_t* aura_get_property(aura_properties_t properties, const char* name)
@@ -126,6 +122,27 @@ aura_property_t* aura_get_property(aura_properties_t properties, const char* nam
 	return (propertyIter == propertyMap.end()) ? NULL : propertyIter->second;
 }
 
+/// Gets the number of properties in an aura_properties_t property list
+size_t aura_get_property_count(aura_properties_t properties)
+{
+	return ((property_map_t*)properties)->size();
+}
+
+/// Gets a property from an aura_properties_t property list by its position, for
+/// iterating over the list. Properties are in order of name
+aura_property_t* aura_get_property_at(aura_properties_t properties, size_t index)
+{
+	property_map_t& propertyMap = *(property_map_t*)properties;
+	if (index >= propertyMap.size())
+	{
+		return NULL;
+	}
+
+	auto propertyIter = propertyMap.begin();
+	advance(propertyIter, index);
+	return propertyIter->second;
+}
+
 /// Takes an aura_properties_t property list and deletes the given property from the list
 void aura_delete_property(aura_properties_t properties, const char* name)
 {
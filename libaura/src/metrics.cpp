@@ -0,0 +1,624 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define METRIC_SHARD_SIZE         128
+#define METRICS_MAX_REQUEST       4096
+#define METRICS_REQUEST_WAIT_MS   200
+#define METRICS_SEND_TIMEOUT_MS   1000
+
+/// The kinds of metric
+typedef enum metric_type_t
+{
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM
+} metric_type_t;
+
+/// One share of a counter or histogram. Shards are padded out so that no two
+/// share a cache line
+typedef struct metric_shard_t
+{
+	/// The counter's total, or the sum of the histogram's values
+	atomic<double> value;
+
+	/// The number of values in each of the histogram's buckets
+	atomic<unsigned long long>* buckets;
+
+	char padding[METRIC_SHARD_SIZE - sizeof(atomic<double>) - sizeof(atomic<unsigned long long>*)];
+} metric_shard_t;
+
+/// A metric. Gauges are set by whatever owns them rather than added to from
+/// all over, so they aren't sharded
+typedef struct metric_t
+{
+	metric_type_t type;
+
+	/// The labels, as they appear between the braces
+	string labels;
+
+	/// The histogram's bucket bounds
+	vector<double> bounds;
+
+	/// The gauge's value
+	atomic<double> gauge;
+
+	/// The counter or histogram's shards
+	metric_shard_t shards[AURA_METRIC_SHARDS];
+} metric_t;
+
+/// The metrics with the same name, which differ by their labels
+typedef struct metric_family_t
+{
+	metric_type_t type;
+	string help;
+	map<string, metric_t*> series;
+} metric_family_t;
+
+/// Every metric, by name
+typedef struct metric_registry_t
+{
+	mutex lock;
+	map<string, metric_family_t> families;
+} metric_registry_t;
+
+/// The socket the metrics are served on
+typedef struct metrics_server_t
+{
+	metrics_server_t() : listenSocket(-1) { wakePipe[0] = wakePipe[1] = -1; }
+	~metrics_server_t();
+
+	/// Protects starting and stopping
+	mutex lock;
+
+	/// The listening socket and its file name
+	int listenSocket;
+	string path;
+
+	/// A pipe written to to stop the server thread
+	int wakePipe[2];
+	thread worker;
+} metrics_server_t;
+
+static metrics_server_t g_metricsServer;
+
+/// The shard the next thread to update a metric uses
+static atomic<unsigned int> g_nextMetricShard(0);
+
+/// The shard the calling thread uses, or AURA_METRIC_SHARDS until it has one
+static thread_local unsigned int t_metricShard = AURA_METRIC_SHARDS;
+
+/// Gets the registry. It is never destroyed, as threads can still be updating
+/// metrics whilst the library is unloaded
+static metric_registry_t& metric_registry()
+{
+	static metric_registry_t* registry = new metric_registry_t;
+	return *registry;
+}
+
+/// Gets the calling thread's share of a metric
+static metric_shard_t& metric_get_shard(metric_t* metric)
+{
+	if (t_metricShard >= AURA_METRIC_SHARDS)
+	{
+		t_metricShard = g_nextMetricShard++ % AURA_METRIC_SHARDS;
+	}
+	return metric->shards[t_metricShard];
+}
+
+/// Adds to an atomic double. The shards make it rare for this to go round
+/// more than once
+static void metric_atomic_add(atomic<double>& target, double value)
+{
+	double current = target.load(memory_order_relaxed);
+	while (!target.compare_exchange_weak(current, current + value, memory_order_relaxed))
+	{
+	}
+}
+
+/// Adds up a counter's shards, or a histogram's sums
+static double metric_sum(const metric_t* metric)
+{
+	double sum = 0.0;
+	for (size_t i = 0; i < AURA_METRIC_SHARDS; i++)
+	{
+		sum += metric->shards[i].value.load(memory_order_relaxed);
+	}
+	return sum;
+}
+
+/// Adds up the number of values in one of a histogram's buckets
+static unsigned long long metric_bucket_count(const metric_t* metric, size_t bucket)
+{
+	unsigned long long count = 0;
+	for (size_t i = 0; i < AURA_METRIC_SHARDS; i++)
+	{
+		count += metric->shards[i].buckets[bucket].load(memory_order_relaxed);
+	}
+	return count;
+}
+
+/// Gets a metric, creating it the first time
+/// @returns The metric, or NULL if the name is in use by another kind
+static metric_t* metric_get(metric_type_t type, const char* name, const char* labels, const char* help, const double* bounds, size_t boundCount)
+{
+	metric_registry_t& registry = metric_registry();
+	lock_guard<mutex> guard(registry.lock);
+
+	auto familyIter = registry.families.find(name);
+	if (familyIter == registry.families.end())
+	{
+		metric_family_t family;
+		family.type = type;
+		family.help = help != NULL ? help : "";
+		familyIter = registry.families.insert(make_pair(string(name), family)).first;
+	}
+	else if (familyIter->second.type != type)
+	{
+		return NULL;
+	}
+
+	metric_family_t& family = familyIter->second;
+	string labelText = labels != NULL ? labels : "";
+	auto seriesIter = family.series.find(labelText);
+	if (seriesIter != family.series.end())
+	{
+		return seriesIter->second;
+	}
+
+	metric_t* metric = new metric_t;
+	metric->type = type;
+	metric->labels = labelText;
+	metric->bounds.assign(bounds, bounds + boundCount);
+	metric->gauge = 0.0;
+	for (size_t i = 0; i < AURA_METRIC_SHARDS; i++)
+	{
+		metric->shards[i].value = 0.0;
+		metric->shards[i].buckets = NULL;
+		if (type == METRIC_HISTOGRAM)
+		{
+			metric->shards[i].buckets = new atomic<unsigned long long>[boundCount + 1];
+			for (size_t j = 0; j <= boundCount; j++)
+			{
+				metric->shards[i].buckets[j] = 0;
+			}
+		}
+	}
+	family.series[labelText] = metric;
+	return metric;
+}
+
+/// Appends a value in the form Prometheus expects
+static void metrics_append_value(string& output, double value)
+{
+	if (isnan(value))
+	{
+		output += "NaN";
+	}
+	else if (isinf(value))
+	{
+		output += value > 0 ? "+Inf" : "-Inf";
+	}
+	else
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.15g", value);
+		output += text;
+	}
+}
+
+/// Appends a line for one value of a metric
+/// @param name The name, with any suffix
+/// @param labels The metric's labels
+/// @param extraLabel Another label to add, e.g. a bucket bound, or NULL
+static void metrics_append_line(string& output, const string& name, const string& labels, const char* extraLabel, double value)
+{
+	output += name;
+	if (!labels.empty() || extraLabel != NULL)
+	{
+		output += '{';
+		output += labels;
+		if (extraLabel != NULL)
+		{
+			if (!labels.empty())
+			{
+				output += ',';
+			}
+			output += extraLabel;
+		}
+		output += '}';
+	}
+	output += ' ';
+	metrics_append_value(output, value);
+	output += '\n';
+}
+
+/// Appends the HELP and TYPE lines of a metric
+static void metrics_append_header(string& output, const string& name, const string& help, const char* type)
+{
+	output += "# HELP " + name + " ";
+	for (char c : help)
+	{
+		if (c == '\\')
+		{
+			output += "\\\\";
+		}
+		else if (c == '\n')
+		{
+			output += "\\n";
+		}
+		else
+		{
+			output += c;
+		}
+	}
+	output += "\n# TYPE " + name + " " + type + "\n";
+}
+
+/// Gets the resident memory of the process in bytes, or zero if it can't be
+/// found out
+static double metrics_resident_bytes()
+{
+	FILE* fp = fopen("/proc/self/statm", "r");
+	if (fp == NULL)
+	{
+		return 0.0;
+	}
+
+	unsigned long long size, resident;
+	int fields = fscanf(fp, "%llu %llu", &size, &resident);
+	fclose(fp);
+	return fields == 2 ? (double)resident * sysconf(_SC_PAGESIZE) : 0.0;
+}
+
+/// Answers a client of the metrics socket
+static void metrics_answer(int client)
+{
+	struct timeval timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_usec = METRICS_REQUEST_WAIT_MS * 1000;
+	setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	timeout.tv_sec = METRICS_SEND_TIMEOUT_MS / 1000;
+	timeout.tv_usec = (METRICS_SEND_TIMEOUT_MS % 1000) * 1000;
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// Read the request, if there is one
+	string request;
+	char buffer[1024];
+	while (request.size() < METRICS_MAX_REQUEST && request.find("\r\n\r\n") == string::npos)
+	{
+		ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+		{
+			break;
+		}
+		request.append(buffer, received);
+	}
+
+	string response;
+	if (request.empty())
+	{
+		char* text = aura_metrics_format();
+		response = text;
+		aura_metrics_free_text(text);
+	}
+	else if (request.compare(0, 4, "GET ") == 0)
+	{
+		char* text = aura_metrics_format();
+		response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + to_string(strlen(text)) + "\r\nConnection: close\r\n\r\n" + text;
+		aura_metrics_free_text(text);
+	}
+	else
+	{
+		response = "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET\r\nConnection: close\r\n\r\n";
+	}
+
+	size_t sent = 0;
+	while (sent < response.size())
+	{
+		ssize_t result = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if (result <= 0)
+		{
+			break;
+		}
+		sent += result;
+	}
+}
+
+/// Entry point for the thread serving the metrics. Clients are answered one at
+/// a time, as there is only ever the odd local scraper
+static void metrics_server_main(metrics_server_t* server)
+{
+	while (true)
+	{
+		struct pollfd pollFds[2];
+		pollFds[0].fd = server->listenSocket;
+		pollFds[0].events = POLLIN;
+		pollFds[1].fd = server->wakePipe[0];
+		pollFds[1].events = POLLIN;
+		if (poll(pollFds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+		if (pollFds[1].revents != 0)
+		{
+			return;
+		}
+
+		int client = accept(server->listenSocket, NULL, NULL);
+		if (client >= 0)
+		{
+			metrics_answer(client);
+			close(client);
+		}
+	}
+}
+
+/// Stops serving the metrics when the library is unloaded
+metrics_server_t::~metrics_server_t()
+{
+	aura_metrics_stop_serving();
+}
+
+/// Gets a counter, creating it the first time it's asked for
+aura_metric_t aura_metric_counter(const char* name, const char* labels, const char* help)
+{
+	return metric_get(METRIC_COUNTER, name, labels, help, NULL, 0);
+}
+
+/// Gets a gauge, creating it the first time it's asked for
+aura_metric_t aura_metric_gauge(const char* name, const char* labels, const char* help)
+{
+	return metric_get(METRIC_GAUGE, name, labels, help, NULL, 0);
+}
+
+/// Gets a histogram, creating it the first time it's asked for
+aura_metric_t aura_metric_histogram(const char* name, const char* labels, const char* help, const double* bounds, size_t boundCount)
+{
+	return metric_get(METRIC_HISTOGRAM, name, labels, help, bounds, boundCount);
+}
+
+/// Adds to a counter or a gauge
+void aura_metric_add(aura_metric_t metric, double value)
+{
+	metric_t* m = (metric_t*)metric;
+	if (m == NULL)
+	{
+		return;
+	}
+
+	if (m->type == METRIC_COUNTER)
+	{
+		metric_atomic_add(metric_get_shard(m).value, value);
+	}
+	else if (m->type == METRIC_GAUGE)
+	{
+		metric_atomic_add(m->gauge, value);
+	}
+}
+
+/// Sets a gauge, or sets a counter to a total kept elsewhere
+void aura_metric_set(aura_metric_t metric, double value)
+{
+	metric_t* m = (metric_t*)metric;
+	if (m == NULL)
+	{
+		return;
+	}
+
+	if (m->type == METRIC_COUNTER)
+	{
+		// The difference goes in to this thread's shard, so the shards
+		// still add up to the total
+		double difference = value - metric_sum(m);
+		if (difference > 0.0)
+		{
+			metric_atomic_add(metric_get_shard(m).value, difference);
+		}
+	}
+	else if (m->type == METRIC_GAUGE)
+	{
+		m->gauge.store(value, memory_order_relaxed);
+	}
+}
+
+/// Adds a value to a histogram
+void aura_metric_observe(aura_metric_t metric, double value)
+{
+	metric_t* m = (metric_t*)metric;
+	if (m == NULL || m->type != METRIC_HISTOGRAM)
+	{
+		return;
+	}
+
+	size_t bucket = 0;
+	while (bucket < m->bounds.size() && value > m->bounds[bucket])
+	{
+		bucket++;
+	}
+
+	metric_shard_t& shard = metric_get_shard(m);
+	shard.buckets[bucket].fetch_add(1, memory_order_relaxed);
+	metric_atomic_add(shard.value, value);
+}
+
+/// Gets the value of a counter or gauge, or the number of values a histogram
+/// has been given
+double aura_metric_get(aura_metric_t metric)
+{
+	metric_t* m = (metric_t*)metric;
+	if (m == NULL)
+	{
+		return 0.0;
+	}
+
+	if (m->type == METRIC_GAUGE)
+	{
+		return m->gauge.load(memory_order_relaxed);
+	}
+	else if (m->type == METRIC_COUNTER)
+	{
+		return metric_sum(m);
+	}
+
+	unsigned long long count = 0;
+	for (size_t i = 0; i <= m->bounds.size(); i++)
+	{
+		count += metric_bucket_count(m, i);
+	}
+	return (double)count;
+}
+
+/// Formats every metric in the Prometheus text exposition format
+char* aura_metrics_format()
+{
+	string output;
+	metric_registry_t& registry = metric_registry();
+	{
+		lock_guard<mutex> guard(registry.lock);
+		for (auto& familyPair : registry.families)
+		{
+			const string& name = familyPair.first;
+			const metric_family_t& family = familyPair.second;
+			metrics_append_header(output, name, family.help, family.type == METRIC_COUNTER ? "counter" : family.type == METRIC_GAUGE ? "gauge" : "histogram");
+			for (auto& seriesPair : family.series)
+			{
+				const metric_t* metric = seriesPair.second;
+				if (metric->type == METRIC_GAUGE)
+				{
+					metrics_append_line(output, name, metric->labels, NULL, metric->gauge.load(memory_order_relaxed));
+					continue;
+				}
+				else if (metric->type == METRIC_COUNTER)
+				{
+					metrics_append_line(output, name, metric->labels, NULL, metric_sum(metric));
+					continue;
+				}
+
+				// Buckets are cumulative, and the count is the last of
+				// them so that the two always agree
+				unsigned long long count = 0;
+				for (size_t i = 0; i <= metric->bounds.size(); i++)
+				{
+					count += metric_bucket_count(metric, i);
+					string bound = "le=\"";
+					if (i < metric->bounds.size())
+					{
+						metrics_append_value(bound, metric->bounds[i]);
+					}
+					else
+					{
+						bound += "+Inf";
+					}
+					bound += "\"";
+					metrics_append_line(output, name + "_bucket", metric->labels, bound.c_str(), (double)count);
+				}
+				metrics_append_line(output, name + "_sum", metric->labels, NULL, metric_sum(metric));
+				metrics_append_line(output, name + "_count", metric->labels, NULL, (double)count);
+			}
+		}
+	}
+
+	metrics_append_header(output, "process_resident_memory_bytes", "Resident memory size in bytes.", "gauge");
+	metrics_append_line(output, "process_resident_memory_bytes", "", NULL, metrics_resident_bytes());
+
+	char* text = (char*)malloc(output.size() + 1);
+	if (text != NULL)
+	{
+		memcpy(text, output.c_str(), output.size() + 1);
+	}
+	return text;
+}
+
+/// Frees text returned by aura_metrics_format()
+void aura_metrics_free_text(char* text)
+{
+	free(text);
+}
+
+/// Serves the metrics on a Unix domain socket
+bool aura_metrics_serve(const char* path)
+{
+	metrics_server_t& server = g_metricsServer;
+	lock_guard<mutex> guard(server.lock);
+	struct sockaddr_un address;
+	if (server.listenSocket >= 0 || strlen(path) >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+
+	int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+	{
+		return false;
+	}
+	if (bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(listenSocket, 8) != 0 ||
+		fcntl(listenSocket, F_SETFL, O_NONBLOCK) != 0 ||
+		pipe(server.wakePipe) != 0)
+	{
+		close(listenSocket);
+		unlink(path);
+		return false;
+	}
+
+	server.listenSocket = listenSocket;
+	server.path = path;
+	server.worker = thread(metrics_server_main, &server);
+	return true;
+}
+
+/// Stops serving the metrics, and removes the socket
+void aura_metrics_stop_serving()
+{
+	metrics_server_t& server = g_metricsServer;
+	lock_guard<mutex> guard(server.lock);
+	if (server.listenSocket < 0)
+	{
+		return;
+	}
+
+	if (write(server.wakePipe[1], "", 1) < 0)
+	{
+		// The thread only misses this if it has already stopped
+	}
+	server.worker.join();
+	close(server.listenSocket);
+	close(server.wakePipe[0]);
+	close(server.wakePipe[1]);
+	unlink(server.path.c_str());
+	server.listenSocket = -1;
+	server.wakePipe[0] = server.wakePipe[1] = -1;
+}
@@ -0,0 +1,463 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#	include <linux/futex.h>
+#	include <sys/syscall.h>
+#endif
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define MOD_QUEUE_MAGIC       0x41555251
+#define MOD_QUEUE_VERSION     1
+#define MOD_QUEUE_LINE        64
+#define MOD_QUEUE_MAX_SLOTS   (1 << 24)
+
+// The counters live in memory shared with another process, so they have to be
+// plain words that the atomic operations (and the kernel) work on directly
+static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t), "atomic<uint32_t> must be a plain word");
+
+/// The start of the shared memory. Each side only ever writes to its own
+/// cache line, so the producer and consumer don't fight over one
+typedef struct mod_queue_header_t
+{
+	/// Set last of all by the producer, once the queue is ready
+	atomic<uint32_t> magic;
+	uint32_t version;
+
+	/// The number of slots, a power of two, and the size of each
+	uint32_t slotCount, slotBytes;
+
+	/// Written by the producer: the number of items pushed, whether it is
+	/// waiting for a free slot, and whether it has closed
+	alignas(MOD_QUEUE_LINE) atomic<uint32_t> head;
+	atomic<uint32_t> producerWaiting;
+	atomic<uint32_t> closed;
+
+	/// Written by the consumer: the number of items released, and whether it
+	/// is waiting for an item
+	alignas(MOD_QUEUE_LINE) atomic<uint32_t> tail;
+	atomic<uint32_t> consumerWaiting;
+} mod_queue_header_t;
+
+/// The start of a slot, which is followed by the offsets of the key and value
+/// of each field, then the strings. Offsets are from the start of the slot, as
+/// the two processes map the memory at different addresses
+typedef struct mod_queue_slot_t
+{
+	/// The number of bytes used, and the number of fields
+	uint32_t bytes, fieldCount;
+
+	/// The position of the item in the order it was pushed, from one
+	uint64_t sequence;
+
+	/// The offset of the identifier
+	uint32_t id;
+} mod_queue_slot_t;
+
+/// One end of a moderation queue
+typedef struct mod_queue_t
+{
+	/// The name of the shared memory object, and whether this is the
+	/// producer's end
+	string name;
+	bool producer;
+
+	/// The mapping
+	void* memory;
+	size_t memoryBytes;
+	mod_queue_header_t* header;
+	char* slots;
+
+	/// The number of items pushed, for the producer
+	uint64_t sequence;
+
+	/// The fields of the item being peeked at, for the consumer
+	vector<aura_item_field_t> fields;
+	bool peeked;
+} mod_queue_t;
+
+/// Gets the size of the header, rounded up so that slots start on a line
+static size_t header_bytes()
+{
+	return (sizeof(mod_queue_header_t) + MOD_QUEUE_LINE - 1) & ~(size_t)(MOD_QUEUE_LINE - 1);
+}
+
+/// Makes a shared memory name of the form POSIX wants
+static string make_name(const char* name)
+{
+	return name[0] == '/' ? string(name) : "/" + string(name);
+}
+
+/// Sleeps until a counter moves away from a value, the other side wakes us, or
+/// the time runs out. Spurious wake ups are fine, as callers check again
+static void wait_word(atomic<uint32_t>* word, uint32_t value, long long timeoutNs)
+{
+#if defined(__linux__)
+	struct timespec timeout;
+	timeout.tv_sec = timeoutNs / 1000000000LL;
+	timeout.tv_nsec = timeoutNs % 1000000000LL;
+	syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, value, timeoutNs >= 0 ? &timeout : NULL, NULL, 0);
+#else
+	// Without futexes (which work across processes), fall back to napping
+	if (*word == value)
+	{
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+#endif
+}
+
+/// Wakes the other side if it is sleeping on a counter
+static void wake_word(atomic<uint32_t>* word)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+	(void)word;
+#endif
+}
+
+/// Waits until a counter written by the other side moves away from a value,
+/// or the queue is closed
+/// @param word The counter to watch
+/// @param value The value to wait for it to leave
+/// @param waiting Our flag that tells the other side to wake us
+/// @param closed If not NULL, stop waiting when this is set
+/// @param timeoutMs How long to wait, or less than zero for ever
+/// @returns true if the counter moved, false if the time ran out or the queue
+/// was closed
+static bool wait_for_change(atomic<uint32_t>* word, uint32_t value, atomic<uint32_t>* waiting, atomic<uint32_t>* closed, int timeoutMs)
+{
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 0);
+	while (word->load(memory_order_acquire) == value)
+	{
+		if (timeoutMs == 0 || (closed != NULL && closed->load(memory_order_acquire)))
+		{
+			return false;
+		}
+
+		long long remainingNs = -1;
+		if (timeoutMs > 0)
+		{
+			remainingNs = chrono::duration_cast<chrono::nanoseconds>(deadline - chrono::steady_clock::now()).count();
+			if (remainingNs <= 0)
+			{
+				return false;
+			}
+		}
+
+		// Say we're waiting before looking one last time, so that the other
+		// side either sees the flag or we see its change. The futex won't
+		// sleep if the counter has already moved
+		waiting->store(1, memory_order_seq_cst);
+		if (word->load(memory_order_seq_cst) == value && (closed == NULL || !closed->load(memory_order_seq_cst)))
+		{
+			wait_word(word, value, remainingNs);
+		}
+		waiting->store(0, memory_order_relaxed);
+	}
+
+	return true;
+}
+
+/// Wakes the other side after we've moved a counter, if it is waiting on it
+static void notify_change(atomic<uint32_t>* word, atomic<uint32_t>* waiting)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (waiting->load(memory_order_relaxed))
+	{
+		wake_word(word);
+	}
+}
+
+/// Marks a queue that a previous producer left behind as closed, so that a
+/// consumer still mapping it (e.g. after the producer crashed without calling
+/// aura_mod_queue_close()) lets go of it and opens the new one
+static void close_abandoned(const string& sharedName)
+{
+	int fd = shm_open(sharedName.c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	struct stat info;
+	void* memory = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= header_bytes())
+	{
+		memory = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		return;
+	}
+
+	// Wake the consumer whether or not it says it's waiting, as the producer
+	// may have died part way through telling it
+	mod_queue_header_t* header = (mod_queue_header_t*)memory;
+	if (header->magic.load(memory_order_acquire) == MOD_QUEUE_MAGIC)
+	{
+		header->closed.store(1, memory_order_seq_cst);
+		wake_word(&header->head);
+	}
+	munmap(memory, (size_t)info.st_size);
+}
+
+/// Creates a moderation queue in shared memory, as its producer
+aura_mod_queue_t aura_mod_queue_create(const char* name, size_t slotCount, size_t slotBytes)
+{
+	if (name == NULL || slotCount == 0 || slotCount > MOD_QUEUE_MAX_SLOTS || slotBytes < sizeof(mod_queue_slot_t) + 1 || slotBytes > UINT32_MAX - MOD_QUEUE_LINE)
+	{
+		return NULL;
+	}
+
+	size_t count = 1;
+	while (count < slotCount)
+	{
+		count <<= 1;
+	}
+	size_t bytes = (slotBytes + MOD_QUEUE_LINE - 1) & ~(size_t)(MOD_QUEUE_LINE - 1);
+
+	// Start from scratch, rather than join a queue a previous producer left
+	// behind. That one is closed first, so the consumer notices even if the
+	// previous producer never got to close it
+	string sharedName = make_name(name);
+	close_abandoned(sharedName);
+	shm_unlink(sharedName.c_str());
+	int fd = shm_open(sharedName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	size_t memoryBytes = header_bytes() + count * bytes;
+	void* memory = MAP_FAILED;
+	if (ftruncate(fd, (off_t)memoryBytes) == 0)
+	{
+		memory = mmap(NULL, memoryBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		shm_unlink(sharedName.c_str());
+		return NULL;
+	}
+
+	// The memory starts zeroed, which is an empty queue
+	mod_queue_t* queue = new mod_queue_t();
+	queue->name = sharedName;
+	queue->producer = true;
+	queue->memory = memory;
+	queue->memoryBytes = memoryBytes;
+	queue->header = (mod_queue_header_t*)memory;
+	queue->slots = (char*)memory + header_bytes();
+	queue->sequence = 0;
+	queue->peeked = false;
+
+	queue->header->version = MOD_QUEUE_VERSION;
+	queue->header->slotCount = (uint32_t)count;
+	queue->header->slotBytes = (uint32_t)bytes;
+	queue->header->magic.store(MOD_QUEUE_MAGIC, memory_order_release);
+
+	return queue;
+}
+
+/// Opens a moderation queue created by another process, as its consumer
+aura_mod_queue_t aura_mod_queue_open(const char* name)
+{
+	if (name == NULL)
+	{
+		return NULL;
+	}
+
+	string sharedName = make_name(name);
+	int fd = shm_open(sharedName.c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	// Only trust the sizes once the producer has finished setting up, and
+	// then only if they fit in what is there
+	struct stat info;
+	void* memory = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= header_bytes())
+	{
+		memory = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	mod_queue_header_t* header = (mod_queue_header_t*)memory;
+	uint32_t count = header->slotCount;
+	if (header->magic.load(memory_order_acquire) != MOD_QUEUE_MAGIC || header->version != MOD_QUEUE_VERSION || count == 0 || (count & (count - 1)) != 0 || header->slotBytes < sizeof(mod_queue_slot_t) + 1 || header_bytes() + (size_t)count * header->slotBytes > (size_t)info.st_size)
+	{
+		munmap(memory, (size_t)info.st_size);
+		return NULL;
+	}
+
+	mod_queue_t* queue = new mod_queue_t();
+	queue->name = sharedName;
+	queue->producer = false;
+	queue->memory = memory;
+	queue->memoryBytes = (size_t)info.st_size;
+	queue->header = header;
+	queue->slots = (char*)memory + header_bytes();
+	queue->sequence = 0;
+	queue->peeked = false;
+
+	return queue;
+}
+
+/// Closes one end of a moderation queue
+void aura_mod_queue_close(aura_mod_queue_t _queue)
+{
+	mod_queue_t* queue = (mod_queue_t*)_queue;
+	if (queue->producer)
+	{
+		queue->header->closed.store(1, memory_order_release);
+		notify_change(&queue->header->head, &queue->header->consumerWaiting);
+		shm_unlink(queue->name.c_str());
+	}
+
+	munmap(queue->memory, queue->memoryBytes);
+	delete queue;
+}
+
+/// Writes an item in to the next free slot of a queue
+int aura_mod_queue_push(aura_mod_queue_t _queue, const char* id, const aura_item_field_t* fields, size_t fieldCount, int timeoutMs)
+{
+	mod_queue_t* queue = (mod_queue_t*)_queue;
+	mod_queue_header_t* header = queue->header;
+
+	// Work out the size before waiting, as it might never fit
+	size_t bytes = sizeof(mod_queue_slot_t) + sizeof(uint32_t) * 2 * fieldCount + strlen(id) + 1;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		bytes += strlen(fields[i].key) + strlen(fields[i].value) + 2;
+	}
+	if (bytes > header->slotBytes)
+	{
+		return AURA_MOD_QUEUE_TOO_LARGE;
+	}
+
+	uint32_t head = header->head.load(memory_order_relaxed);
+	uint32_t full = head - header->slotCount;
+	if (header->tail.load(memory_order_acquire) == full && !wait_for_change(&header->tail, full, &header->producerWaiting, NULL, timeoutMs))
+	{
+		return AURA_MOD_QUEUE_TIMEOUT;
+	}
+
+	// Write the item straight in to its slot
+	char* slot = queue->slots + (size_t)(head & (header->slotCount - 1)) * header->slotBytes;
+	mod_queue_slot_t* item = (mod_queue_slot_t*)slot;
+	uint32_t* offsets = (uint32_t*)(slot + sizeof(mod_queue_slot_t));
+	uint32_t position = (uint32_t)(sizeof(mod_queue_slot_t) + sizeof(uint32_t) * 2 * fieldCount);
+
+	item->id = position;
+	strcpy(slot + position, id);
+	position += (uint32_t)strlen(id) + 1;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		offsets[i * 2] = position;
+		strcpy(slot + position, fields[i].key);
+		position += (uint32_t)strlen(fields[i].key) + 1;
+		offsets[i * 2 + 1] = position;
+		strcpy(slot + position, fields[i].value);
+		position += (uint32_t)strlen(fields[i].value) + 1;
+	}
+	item->bytes = position;
+	item->fieldCount = (uint32_t)fieldCount;
+	item->sequence = ++queue->sequence;
+
+	// Publish it
+	header->head.store(head + 1, memory_order_release);
+	notify_change(&header->head, &header->consumerWaiting);
+
+	return AURA_MOD_QUEUE_OK;
+}
+
+/// Gets the oldest item in a queue without removing it
+int aura_mod_queue_peek(aura_mod_queue_t _queue, aura_item_t* item, int timeoutMs)
+{
+	mod_queue_t* queue = (mod_queue_t*)_queue;
+	mod_queue_header_t* header = queue->header;
+
+	// Wait for the producer to publish an item
+	uint32_t tail = header->tail.load(memory_order_relaxed);
+	if (header->head.load(memory_order_acquire) == tail && !wait_for_change(&header->head, tail, &header->consumerWaiting, &header->closed, timeoutMs))
+	{
+		return header->closed.load(memory_order_acquire) ? AURA_MOD_QUEUE_CLOSED : AURA_MOD_QUEUE_TIMEOUT;
+	}
+
+	// The producer is another process, so don't follow anything out of the
+	// slot. If every offset is inside the used part and that ends with a
+	// terminator, then every string ends inside the slot too
+	char* slot = queue->slots + (size_t)(tail & (header->slotCount - 1)) * header->slotBytes;
+	const mod_queue_slot_t* written = (const mod_queue_slot_t*)slot;
+	const uint32_t* offsets = (const uint32_t*)(slot + sizeof(mod_queue_slot_t));
+	uint32_t bytes = written->bytes, fieldCount = written->fieldCount;
+	bool valid = bytes > sizeof(mod_queue_slot_t) && bytes <= header->slotBytes && slot[bytes - 1] == '\0' && fieldCount <= (bytes - sizeof(mod_queue_slot_t)) / (sizeof(uint32_t) * 2) && written->id < bytes;
+	for (uint32_t i = 0; valid && i < fieldCount * 2; i++)
+	{
+		valid = offsets[i] < bytes;
+	}
+
+	queue->fields.resize(valid ? fieldCount : 0);
+	for (size_t i = 0; i < queue->fields.size(); i++)
+	{
+		queue->fields[i].key = slot + offsets[i * 2];
+		queue->fields[i].value = slot + offsets[i * 2 + 1];
+	}
+
+	// A corrupt item comes through with no identifier or fields, so that
+	// it can still be released
+	item->id = valid ? slot + written->id : "";
+	item->fields = queue->fields.empty() ? NULL : &queue->fields[0];
+	item->fieldCount = queue->fields.size();
+	item->sequence = written->sequence;
+	queue->peeked = true;
+
+	return AURA_MOD_QUEUE_OK;
+}
+
+/// Removes the item returned by aura_mod_queue_peek() from a queue
+void aura_mod_queue_release(aura_mod_queue_t _queue)
+{
+	mod_queue_t* queue = (mod_queue_t*)_queue;
+	if (!queue->peeked)
+	{
+		return;
+	}
+
+	mod_queue_header_t* header = queue->header;
+	queue->peeked = false;
+	header->tail.store(header->tail.load(memory_order_relaxed) + 1, memory_order_release);
+	notify_change(&header->tail, &header->producerWaiting);
+}
+
+/// Gets the number of items waiting in a queue
+size_t aura_mod_queue_count(aura_mod_queue_t _queue)
+{
+	mod_queue_t* queue = (mod_queue_t*)_queue;
+	return queue->header->head.load(memory_order_acquire) - queue->header->tail.load(memory_order_acquire);
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "aura.h"
+
+/// The head of the list of statically-linked plugins. This is a plain pointer
+/// so it is zero-initialised before any static constructors run
+static aura_static_plugin_t* g_staticPlugins = NULL;
+
+/// Registers a statically-linked plugin
+/// @param plugin The plugin registration, which must remain valid forever
+LIBAURA_EXPORTED void aura_register_static_plugin(aura_static_plugin_t* plugin)
+{
+	plugin->next = g_staticPlugins;
+	g_staticPlugins = plugin;
+}
+
+/// Gets the list of statically-linked plugins
+/// @returns The first registered plugin, or NULL if there are none
+LIBAURA_EXPORTED aura_static_plugin_t* aura_get_static_plugins()
+{
+	return g_staticPlugins;
+}
@@ -0,0 +1,533 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <curl/curl.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define SCHEDULE_TARGET_ITEMS     1.0
+#define SCHEDULE_RATE_BLEND       0.3
+#define SCHEDULE_MAX_GROWTH       2.0
+#define SCHEDULE_EPOCH_THRESHOLD  1000000000.0
+#define STREAM_RETRY_MIN          1.0
+#define STREAM_RETRY_MAX          300.0
+#define STREAM_RETRY_LIMITED      60.0
+#define STREAM_STALL_SECONDS      90
+#define STREAM_CONNECT_SECONDS    30
+
+/// How a source is being scheduled. Times are in seconds on the steady clock
+typedef struct source_schedule_t
+{
+	/// The limits on the time between polls, the usual time, and the time at
+	/// the moment
+	double minInterval, maxInterval, baseInterval, interval;
+
+	/// The measured rate of new items, per second, if there is one yet
+	double itemRate;
+	bool hasRate;
+
+	/// The items reported since the last poll finished
+	size_t pendingItems;
+
+	/// When the last poll finished (less than zero before the first), and
+	/// when the next is due
+	double lastPoll, nextPoll;
+
+	/// No poll may happen before this, e.g. until the rate limit resets
+	double notBefore;
+
+	/// The time between polls that spreads the requests left evenly over
+	/// the rest of the rate limit window
+	double quotaInterval;
+	long rateLimitRemaining;
+
+	/// Set if a response showed the poll failed, whatever the plugin says
+	bool responseFailed;
+	unsigned int failures;
+
+	/// The number of streaming connections that are connected
+	int streams;
+
+	/// Statistics
+	unsigned long long polls, items;
+} source_schedule_t;
+
+/// Every source being scheduled, keyed by object
+typedef struct schedule_registry_t
+{
+	mutex lock;
+	map<aura_object_instance_t*, source_schedule_t> sources;
+} schedule_registry_t;
+
+static schedule_registry_t g_schedules;
+
+/// A streaming connection
+typedef struct stream_t
+{
+	string url;
+	aura_object_instance_t* source;
+	aura_stream_callback_t callback;
+	void* userData;
+
+	/// The thread the connection runs on
+	thread worker;
+
+	/// Signalled when the stream is closed, to cut a retry delay short
+	mutex lock;
+	condition_variable wake;
+	atomic<bool> stopping;
+
+	/// Whether data is flowing, and the number of times it has started to
+	atomic<bool> connected;
+	atomic<unsigned long long> connects;
+
+	/// The HTTP status of the connection being made
+	long responseCode;
+} stream_t;
+
+/// Gets the time on the steady clock, in seconds
+static double now_seconds()
+{
+	return chrono::duration_cast<chrono::duration<double> >(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Works out when the next poll of a source is due, from its interval, the
+/// rate limit and any streams. Must be called with the registry locked
+static void reschedule(source_schedule_t& schedule, double now)
+{
+	double interval = schedule.streams > 0 ? schedule.maxInterval : schedule.interval;
+	if (interval < schedule.quotaInterval)
+	{
+		interval = schedule.quotaInterval;
+	}
+
+	double from = schedule.lastPoll >= 0.0 ? schedule.lastPoll : now;
+	schedule.nextPoll = from + interval;
+	if (schedule.nextPoll < schedule.notBefore)
+	{
+		schedule.nextPoll = schedule.notBefore;
+	}
+}
+
+/// Notes a stream of a source connecting or disconnecting
+static void set_streaming(aura_object_instance_t* source, bool connected)
+{
+	if (source == NULL)
+	{
+		return;
+	}
+
+	lock_guard<mutex> guard(g_schedules.lock);
+	auto scheduleIter = g_schedules.sources.find(source);
+	if (scheduleIter == g_schedules.sources.end())
+	{
+		return;
+	}
+
+	// Whilst a stream is up polling only backs it up, and when it goes
+	// down polling takes over again straight away
+	source_schedule_t& schedule = scheduleIter->second;
+	schedule.streams += connected ? 1 : -1;
+	reschedule(schedule, now_seconds());
+}
+
+/// Starts scheduling the polls of a source
+void aura_source_schedule_add(aura_object_instance_t* source, double interval, double minInterval, double maxInterval)
+{
+	source_schedule_t schedule;
+	schedule.minInterval = minInterval;
+	schedule.maxInterval = maxInterval > minInterval ? maxInterval : minInterval;
+	schedule.baseInterval = interval < minInterval ? minInterval : (interval > schedule.maxInterval ? schedule.maxInterval : interval);
+	schedule.interval = schedule.baseInterval;
+	schedule.itemRate = 0.0;
+	schedule.hasRate = false;
+	schedule.pendingItems = 0;
+	schedule.lastPoll = -1.0;
+	schedule.nextPoll = 0.0;
+	schedule.notBefore = 0.0;
+	schedule.quotaInterval = 0.0;
+	schedule.rateLimitRemaining = -1;
+	schedule.responseFailed = false;
+	schedule.failures = 0;
+	schedule.streams = 0;
+	schedule.polls = schedule.items = 0;
+
+	lock_guard<mutex> guard(g_schedules.lock);
+	g_schedules.sources[source] = schedule;
+}
+
+/// Stops scheduling a source
+void aura_source_schedule_remove(aura_object_instance_t* source)
+{
+	lock_guard<mutex> guard(g_schedules.lock);
+	g_schedules.sources.erase(source);
+}
+
+/// Reports that new items have arrived from a source
+void aura_source_report_items(aura_object_instance_t* source, size_t count)
+{
+	lock_guard<mutex> guard(g_schedules.lock);
+	auto scheduleIter = g_schedules.sources.find(source);
+	if (scheduleIter != g_schedules.sources.end())
+	{
+		scheduleIter->second.pendingItems += count;
+		scheduleIter->second.items += count;
+	}
+}
+
+/// Reports a response a source received
+void aura_source_report_response(aura_object_instance_t* source, const aura_download_data_t* response)
+{
+	if (response == NULL)
+	{
+		return;
+	}
+
+	// Pick out the rate limit headers. Resets are either a time in seconds
+	// since the epoch or a number of seconds from now, depending on the API
+	long remaining = -1;
+	double resetIn = -1.0, retryAfter = -1.0;
+	const char* line = response->headers;
+	while (line != NULL && *line != '\0')
+	{
+		const char* end = strchr(line, '\n');
+		const char* colon = (const char*)memchr(line, ':', end != NULL ? end - line : strlen(line));
+		if (colon != NULL)
+		{
+			string name(line, colon - line);
+			for (auto& c : name)
+			{
+				c = (char)tolower((unsigned char)c);
+			}
+			string value(colon + 1, end != NULL ? end : colon + 1 + strlen(colon + 1));
+			value.erase(0, value.find_first_not_of(" \t"));
+			value.erase(value.find_last_not_of(" \t\r") + 1);
+
+			if (name == "x-ratelimit-remaining" || name == "x-rate-limit-remaining" || name == "ratelimit-remaining")
+			{
+				remaining = strtol(value.c_str(), NULL, 10);
+			}
+			else if (name == "x-ratelimit-reset" || name == "x-rate-limit-reset" || name == "ratelimit-reset")
+			{
+				resetIn = strtod(value.c_str(), NULL);
+				if (resetIn > SCHEDULE_EPOCH_THRESHOLD)
+				{
+					resetIn -= (double)time(NULL);
+				}
+			}
+			else if (name == "retry-after")
+			{
+				// Either a number of seconds or an HTTP date
+				char* numberEnd;
+				retryAfter = strtod(value.c_str(), &numberEnd);
+				if (*numberEnd != '\0')
+				{
+					time_t date = curl_getdate(value.c_str(), NULL);
+					retryAfter = date >= 0 ? (double)(date - time(NULL)) : -1.0;
+				}
+			}
+		}
+		line = end != NULL ? end + 1 : NULL;
+	}
+
+	lock_guard<mutex> guard(g_schedules.lock);
+	auto scheduleIter = g_schedules.sources.find(source);
+	if (scheduleIter == g_schedules.sources.end())
+	{
+		return;
+	}
+
+	source_schedule_t& schedule = scheduleIter->second;
+	double now = now_seconds();
+	if (remaining >= 0)
+	{
+		schedule.rateLimitRemaining = remaining;
+		if (resetIn >= 0.0)
+		{
+			// Spread what's left over the rest of the window, or wait for
+			// it to reset if there's nothing left
+			if (remaining == 0)
+			{
+				schedule.quotaInterval = 0.0;
+				schedule.notBefore = now + resetIn;
+			}
+			else
+			{
+				schedule.quotaInterval = resetIn / remaining;
+			}
+		}
+	}
+	if (retryAfter >= 0.0 && now + retryAfter > schedule.notBefore)
+	{
+		schedule.notBefore = now + retryAfter;
+	}
+	if (response->responseCode == 429 || response->responseCode >= 500)
+	{
+		schedule.responseFailed = true;
+	}
+}
+
+/// Reports that a poll of a source has finished
+void aura_source_report_poll(aura_object_instance_t* source, bool success)
+{
+	lock_guard<mutex> guard(g_schedules.lock);
+	auto scheduleIter = g_schedules.sources.find(source);
+	if (scheduleIter == g_schedules.sources.end())
+	{
+		return;
+	}
+
+	source_schedule_t& schedule = scheduleIter->second;
+	double now = now_seconds();
+	success = success && !schedule.responseFailed;
+	schedule.responseFailed = false;
+	schedule.polls++;
+
+	// Measure the rate items are arriving at, from polls and streams alike
+	if (schedule.lastPoll >= 0.0 && now > schedule.lastPoll)
+	{
+		double observed = schedule.pendingItems / (now - schedule.lastPoll);
+		schedule.itemRate = schedule.hasRate ? schedule.itemRate + (observed - schedule.itemRate) * SCHEDULE_RATE_BLEND : observed;
+		schedule.hasRate = true;
+	}
+	schedule.pendingItems = 0;
+	schedule.lastPoll = now;
+
+	// Aim to find about one new item per poll, once the source has told us
+	// about any. A feed that goes quiet is backed off gradually rather than
+	// all at once, and failures back off exponentially
+	double interval = schedule.interval;
+	if (!success)
+	{
+		schedule.failures++;
+		interval = schedule.interval * 2.0;
+	}
+	else if (schedule.failures > 0)
+	{
+		schedule.failures = 0;
+		interval = schedule.baseInterval;
+	}
+	else if (schedule.items > 0)
+	{
+		interval = schedule.itemRate > 0.0 ? SCHEDULE_TARGET_ITEMS / schedule.itemRate : schedule.maxInterval;
+		if (interval > schedule.interval * SCHEDULE_MAX_GROWTH)
+		{
+			interval = schedule.interval * SCHEDULE_MAX_GROWTH;
+		}
+	}
+	if (interval < schedule.minInterval)
+	{
+		interval = schedule.minInterval;
+	}
+	if (interval > schedule.maxInterval)
+	{
+		interval = schedule.maxInterval;
+	}
+	schedule.interval = interval;
+
+	reschedule(schedule, now);
+}
+
+/// Gets how long to wait before polling a source again
+double aura_source_get_poll_delay(aura_object_instance_t* source)
+{
+	lock_guard<mutex> guard(g_schedules.lock);
+	auto scheduleIter = g_schedules.sources.find(source);
+	if (scheduleIter == g_schedules.sources.end())
+	{
+		return -1.0;
+	}
+
+	double delay = scheduleIter->second.nextPoll - now_seconds();
+	return delay > 0.0 ? delay : 0.0;
+}
+
+/// Gets a snapshot of how a source is being scheduled
+bool aura_source_get_schedule(aura_object_instance_t* source, aura_source_schedule_t* schedule)
+{
+	lock_guard<mutex> guard(g_schedules.lock);
+	auto scheduleIter = g_schedules.sources.find(source);
+	if (scheduleIter == g_schedules.sources.end())
+	{
+		return false;
+	}
+
+	const source_schedule_t& current = scheduleIter->second;
+	schedule->itemRate = current.itemRate;
+	schedule->interval = current.streams > 0 ? current.maxInterval : current.interval;
+	schedule->rateLimitRemaining = current.rateLimitRemaining;
+	schedule->failures = current.failures;
+	schedule->streaming = current.streams > 0;
+	schedule->polls = current.polls;
+	schedule->items = current.items;
+	return true;
+}
+
+/// Called from CURL with data from a streaming connection
+static size_t stream_write_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+	stream_t* stream = (stream_t*)userdata;
+	if (stream->stopping)
+	{
+		return 0;
+	}
+
+	// The stream only counts as connected once data is flowing from a
+	// successful response. Anything else is an error, so give up on it
+	if (!stream->connected)
+	{
+		if (stream->responseCode < 200 || stream->responseCode >= 300)
+		{
+			return 0;
+		}
+
+		stream->connected = true;
+		if (++stream->connects > 1)
+		{
+			stream->callback(stream->userData, NULL, 0);
+		}
+		set_streaming(stream->source, true);
+	}
+
+	aura_trace_span_t span = aura_trace_begin("download", "stream callback", stream->url.c_str());
+	stream->callback(stream->userData, ptr, size * nmemb);
+	aura_trace_end(&span);
+	return size * nmemb;
+}
+
+/// Called from CURL with each header line of a streaming connection
+static size_t stream_header_callback(char* ptr, size_t size, size_t nitems, void* userdata)
+{
+	stream_t* stream = (stream_t*)userdata;
+	long code;
+	if (size * nitems > 9 && strncmp(ptr, "HTTP/", 5) == 0 && sscanf(ptr, "HTTP/%*s %ld", &code) == 1)
+	{
+		stream->responseCode = code;
+	}
+
+	return size * nitems;
+}
+
+/// Called from CURL periodically, so that closing a stream that has gone quiet
+/// doesn't wait for data
+static int stream_cancel_callback(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+	return ((stream_t*)userdata)->stopping ? 1 : 0;
+}
+
+/// Entry point for streaming connection threads
+static void stream_main(stream_t* stream)
+{
+	double retryDelay = STREAM_RETRY_MIN;
+	aura_trace_set_thread_name("aura stream");
+	while (!stream->stopping)
+	{
+		CURL* curl = curl_easy_init();
+		if (curl != NULL)
+		{
+			stream->responseCode = 0;
+			curl_easy_setopt(curl, CURLOPT_URL, stream->url.c_str());
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, stream);
+			curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, stream_header_callback);
+			curl_easy_setopt(curl, CURLOPT_HEADERDATA, stream);
+			curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, stream_cancel_callback);
+			curl_easy_setopt(curl, CURLOPT_XFERINFODATA, stream);
+			curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+			curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 15);
+			curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+			curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)STREAM_CONNECT_SECONDS);
+			curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+			// Feeds send keep-alives, so a stream that goes silent has
+			// stalled and needs making again
+			curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+			curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)STREAM_STALL_SECONDS);
+
+			curl_easy_perform(curl);
+			curl_easy_cleanup(curl);
+		}
+
+		// Start backing off again from scratch once a connection has
+		// worked, but be patient if the server asked us to calm down
+		if (stream->connected)
+		{
+			stream->connected = false;
+			set_streaming(stream->source, false);
+			retryDelay = STREAM_RETRY_MIN;
+		}
+		if ((stream->responseCode == 420 || stream->responseCode == 429) && retryDelay < STREAM_RETRY_LIMITED)
+		{
+			retryDelay = STREAM_RETRY_LIMITED;
+		}
+
+		unique_lock<mutex> guard(stream->lock);
+		stream->wake.wait_for(guard, chrono::duration<double>(retryDelay), [stream] { return (bool)stream->stopping; });
+		retryDelay = retryDelay * 2.0 < STREAM_RETRY_MAX ? retryDelay * 2.0 : STREAM_RETRY_MAX;
+	}
+}
+
+/// Opens a long-lived streaming connection on a thread of its own
+aura_stream_t aura_stream_open(const char* url, aura_object_instance_t* source, aura_stream_callback_t callback, void* userData)
+{
+	if (url == NULL || callback == NULL)
+	{
+		return NULL;
+	}
+
+	stream_t* stream = new stream_t();
+	stream->url = url;
+	stream->source = source;
+	stream->callback = callback;
+	stream->userData = userData;
+	stream->stopping = false;
+	stream->connected = false;
+	stream->connects = 0;
+	stream->responseCode = 0;
+	stream->worker = thread(stream_main, stream);
+
+	return stream;
+}
+
+/// Closes a streaming connection, waiting for its thread to finish
+void aura_stream_close(aura_stream_t _stream)
+{
+	stream_t* stream = (stream_t*)_stream;
+	{
+		lock_guard<mutex> guard(stream->lock);
+		stream->stopping = true;
+	}
+	stream->wake.notify_all();
+	stream->worker.join();
+
+	delete stream;
+}
+
+/// Determines whether a streaming connection is connected at the moment
+bool aura_stream_is_connected(aura_stream_t stream)
+{
+	return ((stream_t*)stream)->connected;
+}
+
+/// Gets the number of times a streaming connection has been made
+unsigned long long aura_stream_get_connect_count(aura_stream_t stream)
+{
+	return ((stream_t*)stream)->connects;
+}
@@ -0,0 +1,369 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "aura.h"
+
+using namespace std;
+
+// Definitions:
+#define TRACE_MAX_EXITED_BUFFERS  16
+
+/// A span or instant that has been recorded
+typedef struct trace_event_t
+{
+	/// What it was, as given to aura_trace_begin()
+	const char* category;
+	const char* name;
+
+	/// When it began and how long it took, in nanoseconds
+	unsigned long long start, duration;
+
+	/// Whether it happened at a point in time rather than being a span
+	bool instant;
+
+	/// A copy of its detail, empty if it had none
+	char detail[AURA_TRACE_DETAIL_LENGTH];
+} trace_event_t;
+
+/// The events recorded by a thread. Once it's full, the oldest events are
+/// overwritten so that the most recent are always there
+typedef struct trace_buffer_t
+{
+	/// Only ever contended whilst the events are being exported or cleared
+	mutex lock;
+
+	/// The events, and where the next will be recorded
+	vector<trace_event_t> events;
+	size_t next;
+
+	/// The number of events recorded, and of those overwritten since
+	unsigned long long recorded, overwritten;
+
+	/// The thread's ID and name
+	long threadId;
+	string threadName;
+
+	/// Set once the thread has exited
+	bool exited;
+} trace_buffer_t;
+
+/// Every thread's buffer
+typedef struct trace_registry_t
+{
+	/// Protects the list of buffers
+	mutex lock;
+	vector<trace_buffer_t*> buffers;
+} trace_registry_t;
+
+/// Whether spans are being recorded
+static atomic<bool> g_traceEnabled(false);
+
+/// Gets the registry. It is never destroyed, as threads (e.g. the download
+/// workers) can still be exiting whilst the library is unloaded
+static trace_registry_t& trace_registry()
+{
+	static trace_registry_t* registry = new trace_registry_t;
+	return *registry;
+}
+
+/// Owns the calling thread's buffer. When the thread exits its events are kept
+/// for exporting, up to a limit
+typedef struct trace_thread_t
+{
+	trace_thread_t() : buffer(NULL) {}
+	~trace_thread_t();
+
+	trace_buffer_t* buffer;
+} trace_thread_t;
+
+static thread_local trace_thread_t t_trace;
+
+/// Keeps an exited thread's buffer if it has events in it, and throws away the
+/// oldest exited threads' buffers beyond the limit
+trace_thread_t::~trace_thread_t()
+{
+	if (buffer == NULL)
+	{
+		return;
+	}
+
+	trace_registry_t& registry = trace_registry();
+	lock_guard<mutex> guard(registry.lock);
+	{
+		lock_guard<mutex> bufferGuard(buffer->lock);
+		buffer->exited = true;
+	}
+
+	size_t exitedCount = 0;
+	for (size_t i = registry.buffers.size(); i-- > 0;)
+	{
+		trace_buffer_t* other = registry.buffers[i];
+		if (other->exited && (other->events.empty() || ++exitedCount > TRACE_MAX_EXITED_BUFFERS))
+		{
+			registry.buffers.erase(registry.buffers.begin() + i);
+			delete other;
+		}
+	}
+	buffer = NULL;
+}
+
+/// Gets the current time in nanoseconds on the monotonic clock
+static unsigned long long trace_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/// Gets the calling thread's buffer, creating it the first time
+static trace_buffer_t* trace_get_buffer()
+{
+	if (t_trace.buffer == NULL)
+	{
+		trace_buffer_t* buffer = new trace_buffer_t;
+		buffer->next = 0;
+		buffer->recorded = 0;
+		buffer->overwritten = 0;
+		buffer->threadId = syscall(SYS_gettid);
+		buffer->exited = false;
+
+		trace_registry_t& registry = trace_registry();
+		lock_guard<mutex> guard(registry.lock);
+		registry.buffers.push_back(buffer);
+		t_trace.buffer = buffer;
+	}
+	return t_trace.buffer;
+}
+
+/// Records an event in the calling thread's buffer
+static void trace_record(const char* category, const char* name, const char* detail, unsigned long long start, unsigned long long duration, bool instant)
+{
+	trace_buffer_t* buffer = trace_get_buffer();
+	lock_guard<mutex> guard(buffer->lock);
+
+	trace_event_t* event;
+	if (buffer->events.size() < AURA_TRACE_THREAD_EVENTS)
+	{
+		buffer->events.push_back(trace_event_t());
+		event = &buffer->events.back();
+	}
+	else
+	{
+		event = &buffer->events[buffer->next];
+		buffer->overwritten++;
+	}
+	buffer->next = (buffer->next + 1) % AURA_TRACE_THREAD_EVENTS;
+	buffer->recorded++;
+
+	event->category = category;
+	event->name = name;
+	event->start = start;
+	event->duration = duration;
+	event->instant = instant;
+	event->detail[0] = '\0';
+	if (detail != NULL)
+	{
+		strncpy(event->detail, detail, AURA_TRACE_DETAIL_LENGTH - 1);
+		event->detail[AURA_TRACE_DETAIL_LENGTH - 1] = '\0';
+	}
+}
+
+/// Writes a string to a file as a JSON string, with quotes
+static void trace_write_string(FILE* fp, const char* s)
+{
+	fputc('"', fp);
+	for (; *s != '\0'; s++)
+	{
+		unsigned char c = (unsigned char)*s;
+		if (c == '"' || c == '\\')
+		{
+			fputc('\\', fp);
+			fputc(c, fp);
+		}
+		else if (c < 0x20)
+		{
+			fprintf(fp, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+/// Turns recording spans on or off
+void aura_trace_set_enabled(bool enabled)
+{
+	g_traceEnabled.store(enabled, memory_order_relaxed);
+}
+
+/// Determines whether spans are being recorded
+bool aura_trace_is_enabled()
+{
+	return g_traceEnabled.load(memory_order_relaxed);
+}
+
+/// Begins a span of time on the calling thread
+aura_trace_span_t aura_trace_begin(const char* category, const char* name, const char* detail)
+{
+	aura_trace_span_t span;
+	span.category = category;
+	span.name = name;
+	span.detail = detail;
+	span.start = g_traceEnabled.load(memory_order_relaxed) ? trace_now() : 0;
+	return span;
+}
+
+/// Ends a span and records it. A span that began whilst tracing was off, or
+/// ends after it was turned off, isn't recorded
+void aura_trace_end(const aura_trace_span_t* span)
+{
+	if (span->start == 0 || !g_traceEnabled.load(memory_order_relaxed))
+	{
+		return;
+	}
+	trace_record(span->category, span->name, span->detail, span->start, trace_now() - span->start, false);
+}
+
+/// Records something that happened at a point in time on the calling thread
+void aura_trace_instant(const char* category, const char* name, const char* detail)
+{
+	if (!g_traceEnabled.load(memory_order_relaxed))
+	{
+		return;
+	}
+	trace_record(category, name, detail, trace_now(), 0, true);
+}
+
+/// Names the calling thread in exported traces
+void aura_trace_set_thread_name(const char* name)
+{
+	trace_buffer_t* buffer = trace_get_buffer();
+	lock_guard<mutex> guard(buffer->lock);
+	buffer->threadName = name;
+}
+
+/// Writes everything recorded to a file in the Chrome trace event format
+bool aura_trace_export(const char* path)
+{
+	FILE* fp = fopen(path, "w");
+	if (fp == NULL)
+	{
+		return false;
+	}
+
+	// Times are written in microseconds, to the nanosecond
+	int pid = getpid();
+	bool first = true;
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	trace_registry_t& registry = trace_registry();
+	lock_guard<mutex> guard(registry.lock);
+	for (auto buffer : registry.buffers)
+	{
+		lock_guard<mutex> bufferGuard(buffer->lock);
+		if (!buffer->threadName.empty())
+		{
+			fprintf(fp, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":", first ? "" : ",", pid, buffer->threadId);
+			trace_write_string(fp, buffer->threadName.c_str());
+			fprintf(fp, "}}");
+			first = false;
+		}
+
+		// Oldest first, which once the buffer is full is the next to be
+		// overwritten
+		size_t count = buffer->events.size();
+		size_t oldest = count < AURA_TRACE_THREAD_EVENTS ? 0 : buffer->next;
+		for (size_t i = 0; i < count; i++)
+		{
+			const trace_event_t& event = buffer->events[(oldest + i) % count];
+			fprintf(fp, "%s\n{\"ph\":\"%s\",\"cat\":", first ? "" : ",", event.instant ? "i" : "X");
+			trace_write_string(fp, event.category);
+			fprintf(fp, ",\"name\":");
+			trace_write_string(fp, event.name);
+			fprintf(fp, ",\"pid\":%d,\"tid\":%ld,\"ts\":%llu.%03llu", pid, buffer->threadId, event.start / 1000ULL, event.start % 1000ULL);
+			if (event.instant)
+			{
+				fprintf(fp, ",\"s\":\"t\"");
+			}
+			else
+			{
+				fprintf(fp, ",\"dur\":%llu.%03llu", event.duration / 1000ULL, event.duration % 1000ULL);
+			}
+			if (event.detail[0] != '\0')
+			{
+				fprintf(fp, ",\"args\":{\"detail\":");
+				trace_write_string(fp, event.detail);
+				fprintf(fp, "}");
+			}
+			fprintf(fp, "}");
+			first = false;
+		}
+	}
+	fprintf(fp, "\n]}\n");
+
+	bool success = !ferror(fp);
+	return fclose(fp) == 0 && success;
+}
+
+/// Throws away everything recorded so far
+void aura_trace_clear()
+{
+	trace_registry_t& registry = trace_registry();
+	lock_guard<mutex> guard(registry.lock);
+	for (size_t i = registry.buffers.size(); i-- > 0;)
+	{
+		trace_buffer_t* buffer = registry.buffers[i];
+		if (buffer->exited)
+		{
+			registry.buffers.erase(registry.buffers.begin() + i);
+			delete buffer;
+			continue;
+		}
+
+		lock_guard<mutex> bufferGuard(buffer->lock);
+		buffer->events.clear();
+		buffer->next = 0;
+		buffer->recorded = 0;
+		buffer->overwritten = 0;
+	}
+}
+
+/// Gets the number of events recorded in total
+unsigned long long aura_trace_get_event_count()
+{
+	unsigned long long count = 0;
+	trace_registry_t& registry = trace_registry();
+	lock_guard<mutex> guard(registry.lock);
+	for (auto buffer : registry.buffers)
+	{
+		lock_guard<mutex> bufferGuard(buffer->lock);
+		count += buffer->recorded;
+	}
+	return count;
+}
+
+/// Gets the number of events that have been overwritten by newer events
+unsigned long long aura_trace_get_overwritten_count()
+{
+	unsigned long long count = 0;
+	trace_registry_t& registry = trace_registry();
+	lock_guard<mutex> guard(registry.lock);
+	for (auto buffer : registry.buffers)
+	{
+		lock_guard<mutex> bufferGuard(buffer->lock);
+		count += buffer->overwritten;
+	}
+	return count;
+}
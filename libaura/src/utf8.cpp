@@ -141,3 +141,179 @@ LIBAURA_EXPORTED int utf8ncmp(const char* str1, const char* str2, size_t num)
 	return 0;
 }
 
+/// Decodes the character at the start of a UTF-8 encoded string. Malformed
+/// sequences, including overlong forms, surrogates and code points past the
+/// end of Unicode, decode as U+FFFD and consume a single byte
+/// @param s The string to decode from
+/// @param next If not NULL, set to point at the character after the one
+/// decoded. This only stays at s for the NUL terminator
+/// @returns The Unicode code point of the character, or 0 at the end of the string
+LIBAURA_EXPORTED unsigned int utf8decode(const char* s, const char** next)
+{
+	const unsigned char* u = (const unsigned char*)s;
+	unsigned int codepoint;
+	size_t length;
+
+	// Work out the length of the sequence from the lead byte
+	if (u[0] < 0x80)
+	{
+		codepoint = u[0];
+		length = 1;
+	}
+	else if ((u[0] & 0xe0) == 0xc0)
+	{
+		codepoint = u[0] & 0x1f;
+		length = 2;
+	}
+	else if ((u[0] & 0xf0) == 0xe0)
+	{
+		codepoint = u[0] & 0x0f;
+		length = 3;
+	}
+	else if ((u[0] & 0xf8) == 0xf0)
+	{
+		codepoint = u[0] & 0x07;
+		length = 4;
+	}
+	else
+	{
+		// A stray continuation byte or an invalid lead byte
+		if (next != NULL)
+		{
+			*next = s + 1;
+		}
+		return 0xfffd;
+	}
+
+	// Pull in the continuation bytes (this stops at a NUL terminator too)
+	for (size_t i = 1; i < length; i++)
+	{
+		if ((u[i] & 0xc0) != 0x80)
+		{
+			if (next != NULL)
+			{
+				*next = s + 1;
+			}
+			return 0xfffd;
+		}
+		codepoint = (codepoint << 6) | (u[i] & 0x3f);
+	}
+
+	// Only the shortest form of a code point is valid, and surrogates and
+	// anything past the end of Unicode can't be encoded at all
+	static const unsigned int minimums[] = { 0, 0, 0x80, 0x800, 0x10000 };
+	if (codepoint < minimums[length] || (codepoint >= 0xd800 && codepoint <= 0xdfff) || codepoint > 0x10ffff)
+	{
+		if (next != NULL)
+		{
+			*next = s + 1;
+		}
+		return 0xfffd;
+	}
+
+	if (next != NULL)
+	{
+		*next = (codepoint == 0) ? s : s + length;
+	}
+	return codepoint;
+}
+
+/// Encodes a code point as UTF-8. Code points past the end of Unicode are
+/// encoded as U+FFFD
+/// @param codepoint The code point to encode
+/// @param s Where to write the encoded bytes, which needs room for four
+/// @returns The number of bytes written
+LIBAURA_EXPORTED size_t utf8encode(unsigned int codepoint, char* s)
+{
+	if (codepoint > 0x10ffff)
+	{
+		codepoint = 0xfffd;
+	}
+
+	if (codepoint < 0x80)
+	{
+		s[0] = (char)codepoint;
+		return 1;
+	}
+	else if (codepoint < 0x800)
+	{
+		s[0] = (char)(0xc0 | (codepoint >> 6));
+		s[1] = (char)(0x80 | (codepoint & 0x3f));
+		return 2;
+	}
+	else if (codepoint < 0x10000)
+	{
+		s[0] = (char)(0xe0 | (codepoint >> 12));
+		s[1] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+		s[2] = (char)(0x80 | (codepoint & 0x3f));
+		return 3;
+	}
+
+	s[0] = (char)(0xf0 | (codepoint >> 18));
+	s[1] = (char)(0x80 | ((codepoint >> 12) & 0x3f));
+	s[2] = (char)(0x80 | ((codepoint >> 6) & 0x3f));
+	s[3] = (char)(0x80 | (codepoint & 0x3f));
+	return 4;
+}
+
+/// Folds the case of a code point, so that upper and lower case compare equal.
+/// This covers ASCII, Latin-1, Latin Extended-A, Greek, Cyrillic and fullwidth
+/// Latin, which is simple one-to-one folding rather than the full Unicode rules
+/// @param codepoint The code point to fold
+/// @returns The lower case form of the code point, or the code point itself
+LIBAURA_EXPORTED unsigned int utf8fold(unsigned int codepoint)
+{
+	if (codepoint < 0x80)
+	{
+		return (codepoint >= 'A' && codepoint <= 'Z') ? codepoint + 32 : codepoint;
+	}
+
+	// Latin-1, apart from the multiplication sign
+	if (codepoint >= 0xc0 && codepoint <= 0xde && codepoint != 0xd7)
+	{
+		return codepoint + 32;
+	}
+
+	// Latin Extended-A is mostly pairs of upper then lower case, but the
+	// pairs change from even to odd and back again
+	if ((codepoint >= 0x100 && codepoint <= 0x137) || (codepoint >= 0x14a && codepoint <= 0x177))
+	{
+		return codepoint | 1;
+	}
+	if ((codepoint >= 0x139 && codepoint <= 0x148) || (codepoint >= 0x179 && codepoint <= 0x17e))
+	{
+		return (codepoint & 1) ? codepoint + 1 : codepoint;
+	}
+	if (codepoint == 0x178)
+	{
+		return 0xff;
+	}
+
+	// Greek, where final sigma folds to sigma
+	if (codepoint >= 0x391 && codepoint <= 0x3a9 && codepoint != 0x3a2)
+	{
+		return codepoint + 32;
+	}
+	if (codepoint == 0x3c2)
+	{
+		return 0x3c3;
+	}
+
+	// Cyrillic
+	if (codepoint >= 0x410 && codepoint <= 0x42f)
+	{
+		return codepoint + 32;
+	}
+	if (codepoint >= 0x400 && codepoint <= 0x40f)
+	{
+		return codepoint + 80;
+	}
+
+	// Fullwidth Latin
+	if (codepoint >= 0xff21 && codepoint <= 0xff3a)
+	{
+		return codepoint + 32;
+	}
+
+	return codepoint;
+}
@@ -19,6 +19,10 @@ using namespace std;
 #define AURA_ERR_SDLWINDOWFAILED      5
 #define AURA_ERR_SDLGLCONTEXTFAILED   6
 #define AURA_ERR_LIBAURAINIT          7
+#define AURA_ERR_SHADERCOMPILE        8
+#define AURA_ERR_HEADLESSFAILED       9
+#define AURA_ERR_STREAMFAILED        10
+#define AURA_ERR_BENCHSERVERFAILED   11
 
 /// The AuraException class is a class for exceptions in Aura that are specific to the application
 /// @author Clayton Peters
@@ -8,12 +8,43 @@
 // Includes:
 #include <libaura/aura.h>
 #include <string>
+#include <map>
+#include <vector>
 #include <SDL.h>
 #include "PluginLoader.h"
+#include "SourceRunner.h"
+#include "FrameStats.h"
+#include "SceneNode.h"
+#include "BatchRenderer.h"
+#include "TextRenderer.h"
+#include "GradientRenderer.h"
+#include "ImageCache.h"
+#include "TransitionCompositor.h"
+#include "LayoutEngine.h"
+#include "HeadlessContext.h"
+#include "Output.h"
+#include "QualityController.h"
+#include "ScaledRenderTarget.h"
+#include "BenchmarkScene.h"
+#include "ModerationFeed.h"
+#include "FrameCapture.h"
+#include "FrameEncoder.h"
+#include "StreamServer.h"
 
 // Namespaces:
 using namespace std;
 
+// Definitions:
+#define AURA_UPDATE_TIMESTEP       (1.0 / 120.0)
+#define AURA_MAX_FRAME_TIME        0.25
+#define AURA_STATS_LOG_INTERVAL    10.0
+#define AURA_DEFAULT_WIDTH         640
+#define AURA_DEFAULT_HEIGHT        480
+#define AURA_MAX_OUTPUTS           8
+#define AURA_STREAM_FRAME_RATE     30.0
+#define AURA_METRICS_INTERVAL      1.0
+#define AURA_FRAME_TIME_BUCKETS    0.004, 0.008, 0.0125, 0.0167, 0.025, 0.0334, 0.05, 0.1, 0.25
+
 /// The AuraLive class is the main application class.
 /// @author Clayton Peters
 class AuraLive
@@ -23,26 +54,322 @@ class AuraLive
 		static AuraLive& getInstance();
 
 		/// Initialise the single instance of the application.
-		static AuraLive& initInstance(string pluginPath);
+		/// @param pluginPath The directory to load plugins from
+		/// @param headless Render offscreen without a window or display
+		/// @param windowed Open windows rather than filling the screens
+		/// @param width The width of each output, or zero to use the
+		/// desktop resolution when filling the screens
+		/// @param height The height of each output
+		/// @param outputCount The number of windows or screens to drive
+		static AuraLive& initInstance(string pluginPath, bool headless = false, bool windowed = true, int width = AURA_DEFAULT_WIDTH, int height = AURA_DEFAULT_HEIGHT, int outputCount = 1);
 
 		/// Destroys an AuraLive object
 		~AuraLive();
 
+		/// Runs the frame loop until quit() is called or the window is
+		/// closed
+		/// @param maxFrames Stop after this many frames have been rendered,
+		/// or zero to run forever
+		void run(unsigned long long maxFrames = 0);
+
+		/// Asks the frame loop to stop after the current frame
+		void quit();
+
+		/// Gets the frame pacing statistics
+		const FrameStats& getFrameStats() const;
+
+		/// Gets the quad batch renderer
+		BatchRenderer& getBatchRenderer();
+
+		/// Gets the text renderer
+		TextRenderer& getTextRenderer();
+
+		/// Gets the image cache
+		ImageCache& getImageCache();
+
+		/// Gets the size of the drawable area of the display in pixels. With
+		/// several outputs this is the size of the canvas they show, with
+		/// the outputs side by side from left to right
+		void getDrawableSize(int& width, int& height);
+
+		/// Saves every rendered frame as a numbered PNG. Only available
+		/// when headless
+		/// @param directory The directory to save in, or empty to stop
+		void setFrameDump(const string& directory);
+
+		/// Replaces the scene with one of the built-in benchmark scenes
+		/// @param name The name of the benchmark scene, e.g. "quads"
+		/// @returns true if the scene was built, false otherwise
+		bool setBenchmark(const string& name);
+
+		/// Shows the items approved in the filter tool, in a list down the
+		/// display, as they arrive through a moderation queue
+		/// @param name The name of the moderation queue
+		/// @param journalPath A file to keep the items in, so they are shown
+		/// again straight away after a restart, or empty not to
+		/// @returns true if the list was created, false otherwise
+		bool setModerationQueue(const string& name, const string& journalPath = "");
+
+		/// Streams the display over HTTP as Motion JPEG, for showing on other
+		/// screens. Frames are read back and encoded without holding up the
+		/// display
+		/// @param port The port to serve the stream on
+		/// @param width The width of the stream, or zero for the canvas'.
+		/// This is rounded down to a multiple of 16
+		/// @param height The height of the stream, or zero for the canvas'
+		/// @param frameRate The most frames to stream per second
+		/// @returns true if the stream was started, false otherwise
+		bool setStream(unsigned short port, int width = 0, int height = 0, double frameRate = AURA_STREAM_FRAME_RATE);
+
+		/// Serves the display's metrics (frame rate and times, caches,
+		/// queues, downloads, memory and so on) in the Prometheus text
+		/// format on a Unix domain socket. They are served from a thread of
+		/// libaura's, so scraping never touches the frame loop
+		/// @param socketPath The file name of the socket
+		/// @returns true if the metrics are being served, false otherwise
+		bool setMetrics(const string& socketPath);
+
+		/// Gets the root of the scene graph
+		SceneNode& getScene();
+
+		/// Creates an element instance and adds it to the scene graph
+		/// @param objectType The name of the element object type, e.g. "colour"
+		/// @param parent The node to add the new node to, or NULL for the root
+		/// @returns The new node, or NULL if the element could not be created
+		SceneNode* createElement(const string& objectType, SceneNode* parent = NULL);
+
+		/// Creates an object from a source plugin and starts polling it on
+		/// its own worker thread
+		/// @param objectType The name of the source object type, e.g. "twitter"
+		/// @param pollIntervalMs The time to wait between polls
+		/// @returns The new source object, or NULL if it could not be created
+		aura_object_instance_t* createSource(const string& objectType, unsigned int pollIntervalMs);
+
+		/// Creates a layout object and an engine to drive it. The engine is
+		/// updated every timestep until the scene is replaced
+		/// @param objectType The name of the layout object type, e.g. "list"
+		/// @param parent The node to add the layout's elements under, or NULL
+		/// for the root
+		/// @returns The new layout engine, or NULL if the layout could not be
+		/// created
+		LayoutEngine* createLayout(const string& objectType, SceneNode* parent = NULL);
+
+		/// Gets a transition object, creating it the first time it is asked
+		/// for, so that its properties can be set before it is used
+		/// @param objectType The name of the transition object type, e.g. "fade"
+		/// @returns The transition object, or NULL if it could not be created
+		aura_object_instance_t* getTransition(const string& objectType);
+
+		/// Replaces one node with another using a transition plugin. Both
+		/// nodes are shown until the transition ends, after which the
+		/// outgoing node is hidden. Items are expected to cover the display
+		/// @param objectType The name of the transition object type, e.g. "fade"
+		/// @param from The outgoing node
+		/// @param to The incoming node
+		/// @returns true if the transition started, false if the nodes were
+		/// swapped immediately instead
+		bool startTransition(const string& objectType, SceneNode* from, SceneNode* to);
+
+		/// Gets the transition compositor
+		TransitionCompositor& getTransitionCompositor();
+
+		/// Lets the quality level follow how well frames keep up with the
+		/// display, or fixes it where it is
+		void setAdaptiveQuality(bool adaptive);
+
+		/// Sets the quality level, from 0 (full quality) to
+		/// QUALITY_LEVEL_COUNT - 1
+		void setQualityLevel(int level);
+
+		/// Gets the number of outputs
+		size_t getOutputCount() const;
+
+		/// Gets where an output is on the canvas and its size, so that
+		/// content can be placed on a particular screen
+		/// @param index The number of the output, from zero
+		/// @returns true on success, false if there is no such output
+		bool getOutputGeometry(size_t index, int& x, int& y, int& width, int& height) const;
+
 		/// The plugin loader object
 		PluginLoader pluginLoader;
 
+		/// Runs source plugins away from the render thread
+		SourceRunner sourceRunner;
+
 	private:
 		/// Private constructor. Constructs a new AuraLive object
-		AuraLive(string pluginPath);
+		AuraLive(string pluginPath, bool headless, bool windowed, int width, int height, int outputCount);
+
+		/// Creates the SDL windows and the OpenGL context they share
+		void createOutputs(bool windowed, int width, int height, int outputCount);
+
+		/// Places the outputs side by side on the canvas and works out its
+		/// size, after the outputs are created or resized
+		void layoutOutputs();
+
+		/// Handles any pending SDL events
+		void processEvents();
+
+		/// Advances animations by one fixed timestep
+		/// @param timestep The time to advance by, in seconds
+		void update(double timestep);
+
+		/// Draws a frame
+		void render();
+
+		/// Draws the scene on to an output
+		void renderOutput(Output* output);
+
+		/// Draws the part of the canvas shown by an output in to the current
+		/// framebuffer, at the current quality level
+		void renderView(int x, int y, int width, int height);
+
+		/// Puts the settings of the current quality level in to effect
+		void applyQuality();
+
+		/// Draws a node and its children
+		/// @param node The node to draw
+		void renderNode(SceneNode* node);
+
+		/// Determines whether an element lies entirely outside the output
+		/// being drawn, so that it can be skipped
+		bool isCulled(SceneNode* node) const;
+
+		/// Renders the items of the transition in progress in to the
+		/// compositor's framebuffers, if they have changed
+		void renderTransitionItems(int width, int height);
+
+		/// Ends the transition in progress, hiding the outgoing node
+		void endTransition();
+
+		/// Draws a "colour" element
+		/// @param node The node holding the element
+		void renderColourNode(SceneNode* node);
+
+		/// Draws a "gradient" element
+		/// @param node The node holding the element
+		void renderGradientNode(SceneNode* node);
+
+		/// Draws a "text" element
+		/// @param node The node holding the element
+		void renderTextNode(SceneNode* node);
+
+		/// Draws an "image" element
+		/// @param node The node holding the element
+		void renderImageNode(SceneNode* node);
+
+		/// Determines the vsync interval of the display the first output is on
+		double getDisplayVsyncInterval();
+
+		/// Registers the metrics the display publishes
+		void createMetrics();
+
+		/// Publishes the numbers that are only kept on the render thread,
+		/// every AURA_METRICS_INTERVAL seconds
+		void publishMetrics();
 
 		/// The single global instance
 		static AuraLive* globalInstance;
 
-		/// The SDL main window
-		SDL_Window* mainWindow;
+		/// The windows we draw on, the first of which paces the frame loop
+		vector<Output*> outputs;
 
-		/// The SDL GL context
+		/// The SDL GL context, shared by every output
 		SDL_GLContext mainContext;
+
+		/// The size of the canvas the outputs show
+		int canvasWidth, canvasHeight;
+
+		/// The part of the canvas being drawn, for culling elements, and
+		/// whether culling is on at the moment
+		int viewX, viewY, viewWidth, viewHeight;
+		bool cullToView;
+
+		/// The offscreen context and framebuffer, when headless
+		HeadlessContext* headlessContext;
+
+		/// The directory to save rendered frames in, when headless
+		string frameDumpPath;
+
+		/// Whether the frame loop should keep running
+		bool running;
+
+		/// Whether swapping is synchronised to vsync by the driver
+		bool vsyncEnabled;
+
+		/// The total amount of animation time that has been simulated
+		double animationTime;
+
+		/// Frame pacing statistics
+		FrameStats frameStats;
+
+		/// Picks the quality level from the frame times
+		QualityController qualityController;
+
+		/// Draws frames at a lower resolution at low quality levels
+		ScaledRenderTarget* scaledTarget;
+
+		/// The root of the retained scene graph
+		SceneNode scene;
+
+		/// Draws quads for elements in batches
+		BatchRenderer* batchRenderer;
+
+		/// Draws text elements
+		TextRenderer* textRenderer;
+
+		/// Draws gradient elements
+		GradientRenderer* gradientRenderer;
+
+		/// Loads images for image elements
+		ImageCache* imageCache;
+
+		/// The layout engines in the scene
+		vector<LayoutEngine*> layouts;
+
+		/// Blends between items for transition plugins
+		TransitionCompositor* transitionCompositor;
+
+		/// The transition objects, keyed by object type
+		map<string, aura_object_instance_t*> transitionObjects;
+
+		/// The outgoing and incoming nodes of the transition in progress
+		SceneNode* transitionFrom;
+		SceneNode* transitionTo;
+
+		/// The transition node being rendered in to a framebuffer, if any
+		SceneNode* capturingNode;
+
+		/// The active benchmark scene, if any
+		BenchmarkScene* benchmark;
+
+		/// The feed of approved items, if any
+		ModerationFeed* moderationFeed;
+
+		/// Captures, encodes and serves the display, when it is streamed
+		FrameCapture* frameCapture;
+		FrameEncoder* frameEncoder;
+		StreamServer* streamServer;
+
+		/// The metrics the display publishes
+		typedef struct live_metrics_t
+		{
+			/// Frame pacing
+			aura_metric_t frameSeconds, frames, idleFrames, missedVsyncs;
+			aura_metric_t fps, frameP50, frameP99, qualityLevel;
+
+			/// Text and glyph caches
+			aura_metric_t textRunHits, textRunMisses, glyphsRasterised, glyphEvictions;
+
+			/// Images
+			aura_metric_t imagesDecoded, imageUploadBytes, imagePageEvictions;
+			aura_metric_t imagePages, imageCacheBytes, imageDecodeQueue;
+			aura_metric_t prefetchHits, prefetchMisses;
+
+			/// Moderation and streaming
+			aura_metric_t moderationReceived, streamClients, streamFramesSent;
+		} live_metrics_t;
+		live_metrics_t metrics;
 };
 
 #endif
@@ -0,0 +1,123 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef BATCHRENDERER_H_INCLUDED
+#define BATCHRENDERER_H_INCLUDED
+
+// Includes:
+#include <vector>
+#include "OpenGL.h"
+#include "ShaderProgram.h"
+
+// Namespaces:
+using namespace std;
+
+/// A single quad as it is stored in the instance buffer. The layout matches
+/// three RGBA32F texels, which the vertex shader fetches by instance ID
+typedef struct batch_quad_t
+{
+	/// Position and size, in pixels from the top-left of the viewport
+	float x, y, width, height;
+
+	/// Texture coordinates of the top-left and bottom-right corners
+	float u0, v0, u1, v1;
+
+	/// Colour to multiply the texture by
+	float r, g, b, a;
+} batch_quad_t;
+
+/// The BatchRenderer class collects quads between begin() and end() and draws
+/// every consecutive run of quads that share a material (texture) with a
+/// single instanced draw call. All the instance data for a frame is uploaded in
+/// one go to a texture buffer that is orphaned every frame, so the driver never
+/// has to wait for the GPU to finish with last frame's data.
+/// @author Clayton Peters
+class BatchRenderer
+{
+	public:
+		/// Constructs a new BatchRenderer object. A GL context must be current
+		BatchRenderer();
+
+		/// Destroys a BatchRenderer object and its GL resources
+		~BatchRenderer();
+
+		/// Starts collecting quads for a frame
+		/// @param _viewportWidth The width of the viewport in pixels
+		/// @param _viewportHeight The height of the viewport in pixels
+		void begin(int _viewportWidth, int _viewportHeight);
+
+		/// Adds a textured quad
+		/// @param texture The texture to draw with, or 0 for a plain colour
+		/// @param quad The quad to draw
+		void addQuad(GLuint texture, const batch_quad_t& quad);
+
+		/// Adds a plain coloured quad
+		void addColourQuad(float x, float y, float width, float height, float r, float g, float b, float a);
+
+		/// Draws everything collected since begin()
+		void end();
+
+		/// Draws everything collected so far without ending the frame, so
+		/// that something drawn by another renderer can go on top of it
+		void flush();
+
+		/// Gets the number of draw calls issued for the last frame
+		unsigned int getDrawCalls() const;
+
+		/// Gets the number of quads drawn for the last frame
+		unsigned int getQuadCount() const;
+
+	private:
+		/// A run of consecutive quads that share a material
+		typedef struct batch_t
+		{
+			/// The texture the quads are drawn with
+			GLuint texture;
+
+			/// The index of the first quad in the run
+			size_t first;
+
+			/// The number of quads in the run
+			size_t count;
+		} batch_t;
+
+		/// The shader used for all quads
+		ShaderProgram program;
+
+		/// Uniform locations
+		GLint viewportUniform, instanceBaseUniform, instancesUniform, textureUniform;
+
+		/// An empty vertex array object; all vertex data comes from the
+		/// instance buffer
+		GLuint vertexArray;
+
+		/// The buffer holding the instance data
+		GLuint instanceBuffer;
+
+		/// The buffer texture used to read the instance buffer in the shader
+		GLuint instanceTexture;
+
+		/// A 1x1 white texture used for plain coloured quads
+		GLuint whiteTexture;
+
+		/// The size of the instance buffer in quads
+		size_t bufferCapacity;
+
+		/// The most quads the buffer texture can address
+		size_t maxQuads;
+
+		/// The quads collected for the current frame
+		vector<batch_quad_t> quads;
+
+		/// The runs of quads collected for the current frame
+		vector<batch_t> batches;
+
+		/// The viewport size
+		int viewportWidth, viewportHeight;
+
+		/// Statistics for the current and last frames
+		unsigned int drawCalls, quadCount, lastDrawCalls, lastQuadCount;
+};
+
+#endif
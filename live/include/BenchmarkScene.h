@@ -0,0 +1,46 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef BENCHMARKSCENE_H_INCLUDED
+#define BENCHMARKSCENE_H_INCLUDED
+
+// Includes:
+#include <string>
+#include <vector>
+
+// Namespaces:
+using namespace std;
+
+// Forward declarations:
+class AuraLive;
+
+/// The BenchmarkScene class is the base for the built-in benchmark scenes that
+/// can be selected with --benchmark. A scene builds itself in to the scene
+/// graph and then animates every update so that every frame is drawn.
+/// @author Clayton Peters
+class BenchmarkScene
+{
+	public:
+		/// Creates a benchmark scene by name
+		/// @param name The name of the scene, e.g. "quads"
+		/// @returns The new scene, or NULL if there is no such scene
+		static BenchmarkScene* create(const string& name);
+
+		/// Gets the names of all the benchmark scenes
+		static vector<string> getNames();
+
+		/// Destroys a BenchmarkScene object
+		virtual ~BenchmarkScene() {}
+
+		/// Builds the scene
+		/// @param auraLive The application to build the scene in
+		/// @returns true on success, false otherwise
+		virtual bool setup(AuraLive& auraLive) = 0;
+
+		/// Animates the scene
+		/// @param time The total animation time in seconds
+		virtual void update(double time) = 0;
+};
+
+#endif
@@ -0,0 +1,193 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef FRAMECAPTURE_H_INCLUDED
+#define FRAMECAPTURE_H_INCLUDED
+
+// Includes:
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "OpenGL.h"
+#include "ShaderProgram.h"
+#include "FrameEncoder.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define FRAME_CAPTURE_RING          4
+#define FRAME_CAPTURE_MAX_QUERIES   8
+
+/// The FrameCapture class copies what is on the display back from the GPU to
+/// be streamed, without ever waiting for it. The outputs are scaled in to a
+/// texture at the size of the stream as they are drawn, converted to I420 on
+/// the GPU, and read back in to the next of a ring of pixel buffers. A buffer
+/// is only mapped once a fence says the GPU has finished with it, a few frames
+/// later, and the mapping itself is handed to the encoder so the frame is
+/// never copied on the CPU. The encoder gives the buffer back when it is done;
+/// if it's still busy with every buffer then frames are dropped rather than
+/// holding up the display. The time the render thread spends capturing and,
+/// where the driver supports timer queries, the GPU time are measured.
+/// @author Clayton Peters
+class FrameCapture
+{
+	public:
+		/// Constructs a new FrameCapture object. A GL context must be current
+		/// @param _width The width of the stream, a multiple of 16
+		/// @param _height The height of the stream, a multiple of 16
+		/// @param frameRate The most frames to capture per second
+		/// @param _encoder The encoder to hand captured frames to
+		FrameCapture(int _width, int _height, double frameRate, FrameEncoder* _encoder);
+
+		/// Destroys a FrameCapture object and its GL resources. The encoder
+		/// must have been stopped first
+		~FrameCapture();
+
+		/// Passes on any frames that have finished reading back and takes
+		/// back buffers the encoder is done with. This should be called
+		/// every time round the frame loop, whether or not a frame is drawn
+		void update();
+
+		/// Decides whether to capture the frame about to be drawn
+		/// @param canvasWidth The width of the canvas the outputs show
+		/// @param canvasHeight The height of the canvas
+		/// @returns true if the frame is being captured, in which case each
+		/// output should be grabbed once it has been drawn
+		bool beginFrame(int canvasWidth, int canvasHeight);
+
+		/// Scales an output that has just been drawn, in the framebuffer
+		/// that is bound, in to its place in the captured frame
+		/// @param x Where the output is on the canvas
+		/// @param y Where the output is on the canvas
+		/// @param width The width of the output in pixels
+		/// @param height The height of the output in pixels
+		void grabView(int x, int y, int width, int height);
+
+		/// Converts the captured frame and starts reading it back
+		void endFrame();
+
+		/// Gets the size of the stream
+		void getSize(int& _width, int& _height) const;
+
+		/// Gets the number of frames read back and handed to the encoder
+		unsigned long long getCapturedCount() const;
+
+		/// Gets the number of frames that weren't captured because every
+		/// buffer was in use
+		unsigned long long getDroppedCount() const;
+
+		/// Gets the mean and longest time the render thread spent capturing
+		/// a frame, in milliseconds
+		double getAverageCpuMs() const;
+		double getMaxCpuMs() const;
+
+		/// Gets the mean and longest GPU time of converting and reading back
+		/// a frame, in milliseconds, or zero if it can't be measured
+		double getAverageGpuMs() const;
+		double getMaxGpuMs() const;
+
+	private:
+		/// The states of a pixel buffer in the ring
+		typedef enum slot_state_t
+		{
+			/// Free to read back in to
+			SLOT_FREE,
+
+			/// Being read back in to by the GPU
+			SLOT_READING,
+
+			/// Mapped and handed to the encoder
+			SLOT_ENCODING
+		} slot_state_t;
+
+		/// A pixel buffer in the ring
+		typedef struct slot_t
+		{
+			/// The pixel buffer
+			GLuint buffer;
+
+			/// What is happening to it
+			slot_state_t state;
+
+			/// Signalled by the GPU when the read back has finished
+			GLsync fence;
+
+			/// Set by the encoder when it no longer needs the mapping
+			atomic<bool> released;
+
+			/// The frame number and when it was captured
+			unsigned long long sequence;
+			double captureTime;
+		} slot_t;
+
+		/// Unmaps buffers the encoder has finished with, and hands over the
+		/// frames that have finished reading back, oldest first
+		void collect();
+
+		/// Collects the results of any finished timer queries
+		void collectTimings();
+
+		/// Adds the time spent on the render thread since a point to the
+		/// current frame's total
+		void addCpuTime(chrono::steady_clock::time_point since);
+
+		/// Gets the current time in seconds
+		static double nowSeconds();
+
+		/// The size of the stream
+		int width, height;
+
+		/// The shortest time between captures, in seconds
+		double minInterval;
+
+		/// The encoder frames go to
+		FrameEncoder* encoder;
+
+		/// The size of the canvas being captured
+		int canvasWidth, canvasHeight;
+
+		/// The ring of pixel buffers, and the next to read back in to
+		slot_t slots[FRAME_CAPTURE_RING];
+		size_t nextSlot;
+
+		/// The order the buffers being read back in to were captured in
+		deque<size_t> readingSlots;
+
+		/// The frame the outputs are scaled in to, and its framebuffer
+		GLuint frameTexture, frameFramebuffer;
+
+		/// The luma and chroma planes, and their framebuffers. The chroma
+		/// texture is half as wide as the stream and as tall, with the U
+		/// plane above the V, as they are laid out in I420
+		GLuint lumaTexture, chromaTexture;
+		GLuint lumaFramebuffer, chromaFramebuffer;
+
+		/// The conversion shaders, and an empty vertex array to draw them
+		ShaderProgram* lumaProgram;
+		ShaderProgram* chromaProgram;
+		GLint lumaFrameUniform, chromaFrameUniform;
+		GLuint vertexArray;
+
+		/// Whether the frame being drawn is being captured, and when the
+		/// last capture was
+		bool capturing;
+		double lastCaptureTime;
+
+		/// Timer queries that aren't in use, and those waiting for results
+		bool timingSupported;
+		vector<GLuint> freeQueries;
+		deque<GLuint> pendingQueries;
+
+		/// The render thread's time capturing the current frame
+		double frameCpuMs;
+
+		/// Statistics
+		unsigned long long sequence, capturedCount, droppedCount;
+		unsigned long long cpuFrames, gpuFrames;
+		double totalCpuMs, maxCpuMs, totalGpuMs, maxGpuMs;
+};
+
+#endif
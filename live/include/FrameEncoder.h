@@ -0,0 +1,121 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef FRAMEENCODER_H_INCLUDED
+#define FRAMEENCODER_H_INCLUDED
+
+// Includes:
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "StreamServer.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define FRAME_ENCODER_DEFAULT_THREADS   2
+#define FRAME_ENCODER_DEFAULT_QUALITY   80
+
+/// A frame captured from the display, ready to be encoded
+typedef struct captured_frame_t
+{
+	/// The frame in I420: the luma plane followed by the U and V planes at
+	/// half the size, with the top row first. This is mapped GPU memory and
+	/// mustn't be touched once released is set
+	const unsigned char* data;
+
+	/// The size of the frame, multiples of 16
+	int width, height;
+
+	/// The frame number, and when it was captured in seconds on the steady
+	/// clock
+	unsigned long long sequence;
+	double captureTime;
+
+	/// Set when the encoder is done with the data
+	atomic<bool>* released;
+} captured_frame_t;
+
+/// The FrameEncoder class compresses captured frames on a small pool of
+/// threads, so that frames are encoded side by side and a slow frame doesn't
+/// hold up the next. Frames are encoded as JPEG straight from the planes the
+/// GPU produced, without converting or copying them first, and given to the
+/// stream server, which sends the newest one to each client.
+/// @author Clayton Peters
+class FrameEncoder
+{
+	public:
+		/// Constructs a new FrameEncoder object and starts its threads
+		/// @param _server The server to give encoded frames to
+		/// @param threadCount The number of frames to encode at once
+		/// @param _quality The JPEG quality, from 1 to 100
+		FrameEncoder(StreamServer* _server, unsigned int threadCount = FRAME_ENCODER_DEFAULT_THREADS, int _quality = FRAME_ENCODER_DEFAULT_QUALITY);
+
+		/// Destroys a FrameEncoder object, stopping its threads
+		~FrameEncoder();
+
+		/// Queues a frame to be encoded. This never blocks, and the frame's
+		/// released flag is set once the data is no longer needed
+		void submit(const captured_frame_t& frame);
+
+		/// Stops the threads, waiting for the frames being encoded and
+		/// releasing any that are still queued
+		void stop();
+
+		/// Gets the number of frames encoded
+		unsigned long long getEncodedCount() const;
+
+		/// Gets the mean and longest time to encode a frame, in milliseconds
+		double getAverageEncodeMs() const;
+		double getMaxEncodeMs() const;
+
+		/// Gets the mean time from capturing a frame to it being encoded, in
+		/// milliseconds
+		double getAverageLatencyMs() const;
+
+		/// Gets the mean size of an encoded frame in bytes
+		double getAverageFrameBytes() const;
+
+	private:
+		/// Entry point for the encoding threads
+		void workerMain();
+
+		/// Encodes a frame as JPEG
+		/// @param frame The frame to encode
+		/// @param output Set to the encoded frame, allocated with malloc()
+		/// @param outputLength Set to the length of the encoded frame
+		/// @returns true on success, false otherwise
+		bool encode(const captured_frame_t& frame, unsigned char** output, unsigned long* outputLength);
+
+		/// The server encoded frames go to
+		StreamServer* server;
+
+		/// The JPEG quality
+		int quality;
+
+		/// The encoding threads
+		vector<thread> workers;
+
+		/// Protects the queue and the statistics
+		mutable mutex lock;
+
+		/// Signalled when a frame is queued or the threads should stop
+		condition_variable wake;
+
+		/// Frames waiting to be encoded, oldest first
+		deque<captured_frame_t> queue;
+
+		/// Set to stop the threads
+		bool stopping;
+
+		/// Statistics
+		unsigned long long encodedCount;
+		double totalEncodeMs, maxEncodeMs, totalLatencyMs, totalBytes;
+};
+
+#endif
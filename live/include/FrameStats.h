@@ -0,0 +1,131 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef FRAMESTATS_H_INCLUDED
+#define FRAMESTATS_H_INCLUDED
+
+// Includes:
+#include <vector>
+#include <deque>
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define FRAMESTATS_DEFAULT_HISTORY   600
+#define FRAMESTATS_QUALITY_HISTORY   64
+
+/// A change of rendering quality level
+typedef struct quality_change_t
+{
+	/// The number of frames presented before the change
+	unsigned long long frame;
+
+	/// The levels changed from and to (0 being full quality)
+	int fromLevel, toLevel;
+
+	/// The mean and 99th percentile recent frame times when it changed, in
+	/// seconds
+	double meanFrameTime, p99FrameTime;
+} quality_change_t;
+
+/// The FrameStats class keeps a rolling record of recent frame times so that
+/// frame pacing can be queried and logged
+/// @author Clayton Peters
+class FrameStats
+{
+	public:
+		/// Constructs a new FrameStats object
+		/// @param _historySize The number of recent frames to keep
+		FrameStats(size_t _historySize = FRAMESTATS_DEFAULT_HISTORY);
+
+		/// Sets the expected time between vsyncs, used to spot missed vsyncs
+		/// @param _vsyncInterval The vsync interval in seconds
+		void setVsyncInterval(double _vsyncInterval);
+
+		/// Gets the expected time between vsyncs in seconds
+		double getVsyncInterval() const;
+
+		/// Records a presented frame
+		/// @param frameTime The time since the previous frame was presented, in seconds
+		/// @param timed false if there was no previously presented frame to
+		/// time this one against, in which case only the total is updated
+		void addFrame(double frameTime, bool timed = true);
+
+		/// Records a frame interval in which nothing had changed, so nothing
+		/// was drawn or presented
+		void addIdleFrame();
+
+		/// Records a change of rendering quality level
+		/// @param fromLevel The level before the change
+		/// @param toLevel The level after the change
+		void addQualityChange(int fromLevel, int toLevel);
+
+		/// Gets the recent quality level changes, oldest first
+		const deque<quality_change_t>& getQualityChanges() const;
+
+		/// Gets the total number of quality level changes
+		unsigned long long getTotalQualityChanges() const;
+
+		/// Gets the current quality level
+		int getQualityLevel() const;
+
+		/// Clears the rolling record (but not the running totals)
+		void reset();
+
+		/// Gets a percentile of the recent frame times
+		/// @param percentile The percentile to get, from 0 to 100
+		/// @returns The frame time in seconds, or zero if there are no frames
+		double getPercentile(double percentile) const;
+
+		/// Gets the mean of the recent frame times in seconds
+		double getMean() const;
+
+		/// Gets the number of frames in the rolling record
+		size_t getHistoryCount() const;
+
+		/// Gets the total number of frames presented
+		unsigned long long getTotalFrames() const;
+
+		/// Gets the total number of frame intervals that were skipped because
+		/// nothing had changed
+		unsigned long long getIdleFrames() const;
+
+		/// Gets the total number of frames that missed at least one vsync
+		unsigned long long getMissedVsyncs() const;
+
+		/// Writes a one-line summary of the statistics to the log
+		/// @param logLevel The level to log at
+		void log(int logLevel) const;
+
+	private:
+		/// Ring buffer of recent frame times
+		vector<double> history;
+
+		/// The next slot in the ring buffer to write to
+		size_t historyNext;
+
+		/// The number of valid slots in the ring buffer
+		size_t historyCount;
+
+		/// The expected time between vsyncs in seconds
+		double vsyncInterval;
+
+		/// The total number of frames presented
+		unsigned long long totalFrames;
+
+		/// The total number of idle frame intervals
+		unsigned long long idleFrames;
+
+		/// The total number of frames that missed at least one vsync
+		unsigned long long missedVsyncs;
+
+		/// Recent quality level changes, the total number of them, and the
+		/// current level
+		deque<quality_change_t> qualityChanges;
+		unsigned long long totalQualityChanges;
+		int qualityLevel;
+};
+
+#endif
@@ -0,0 +1,138 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef GLYPHATLAS_H_INCLUDED
+#define GLYPHATLAS_H_INCLUDED
+
+// Includes:
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <map>
+#include <vector>
+#include "OpenGL.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define GLYPHATLAS_DEFAULT_SIZE   1024
+
+/// Where a rasterised glyph lives in the atlas and how to position it
+typedef struct atlas_glyph_t
+{
+	/// Texture coordinates of the top-left and bottom-right corners
+	float u0, v0, u1, v1;
+
+	/// The size of the glyph bitmap in pixels
+	int width, height;
+
+	/// The offset from the pen position to the top-left of the bitmap
+	int bearingX, bearingY;
+
+	/// The shelf the glyph is on, for passing to GlyphAtlas::touch
+	int shelf;
+} atlas_glyph_t;
+
+/// The GlyphAtlas class rasterises glyphs on demand in to a single-channel
+/// texture. Glyphs are packed on to shelves; when the atlas is full, the
+/// least-recently-used shelf that hasn't been used this frame is evicted. Each
+/// shelf has a generation that its evictions bump, so that anything holding on
+/// to texture coordinates knows when it must look the glyphs on that shelf up
+/// again, and nothing else is disturbed.
+/// @author Clayton Peters
+class GlyphAtlas
+{
+	public:
+		/// Constructs a new GlyphAtlas object. A GL context must be current
+		/// @param _size The width and height of the atlas texture
+		GlyphAtlas(int _size = GLYPHATLAS_DEFAULT_SIZE);
+
+		/// Destroys a GlyphAtlas object and its texture
+		~GlyphAtlas();
+
+		/// Starts a new frame. Glyphs used in this frame will not be evicted
+		/// until a later frame
+		void beginFrame();
+
+		/// Gets a glyph, rasterising it in to the atlas if necessary
+		/// @param face The face to rasterise with, already set to pixelSize
+		/// @param faceId A unique identifier for the face
+		/// @param pixelSize The pixel size the face is set to
+		/// @param glyphIndex The index of the glyph within the face
+		/// @returns The glyph, or NULL if it couldn't be rasterised or fitted in
+		const atlas_glyph_t* getGlyph(FT_Face face, unsigned int faceId, unsigned int pixelSize, FT_UInt glyphIndex);
+
+		/// Marks a shelf as used in this frame, for when a glyph on it is
+		/// drawn without being looked up again
+		/// @param shelf The shelf, from atlas_glyph_t::shelf
+		void touch(int shelf);
+
+		/// Gets the atlas texture
+		GLuint getTexture() const;
+
+		/// Gets the generation of a shelf, which changes whenever its glyphs
+		/// are evicted
+		/// @param shelf The shelf, from atlas_glyph_t::shelf
+		unsigned int getShelfGeneration(int shelf) const;
+
+		/// Gets the number of glyphs rasterised since the atlas was created
+		unsigned long long getRasterisedCount() const;
+
+		/// Gets the number of shelves evicted since the atlas was created
+		unsigned long long getEvictionCount() const;
+
+	private:
+		/// A row of glyphs of similar height
+		typedef struct shelf_t
+		{
+			/// The top of the shelf
+			int y;
+
+			/// The height of the shelf
+			int height;
+
+			/// The next free position along the shelf
+			int x;
+
+			/// The last frame a glyph on this shelf was used in
+			unsigned long long lastUsedFrame;
+
+			/// Bumped every time the shelf is evicted
+			unsigned int generation;
+
+			/// The keys of the glyphs on this shelf
+			vector<unsigned long long> glyphs;
+		} shelf_t;
+
+		/// Finds space for a bitmap of the given size, evicting if needed
+		/// @param width The width needed, including padding
+		/// @param height The height needed, including padding
+		/// @param x Set to the left of the space
+		/// @param y Set to the top of the space
+		/// @returns The index of the shelf, or -1 if there is no space
+		int allocate(int width, int height, int& x, int& y);
+
+		/// Evicts every glyph on a shelf and clears it
+		void evictShelf(size_t shelfIndex);
+
+		/// The width and height of the texture
+		int size;
+
+		/// The texture
+		GLuint texture;
+
+		/// The shelves, from top to bottom
+		vector<shelf_t> shelves;
+
+		/// The glyphs in the atlas, keyed by face, size and glyph index
+		map<unsigned long long, atlas_glyph_t> glyphs;
+
+		/// The current frame number
+		unsigned long long frame;
+
+		/// Statistics
+		unsigned long long rasterisedCount, evictionCount;
+};
+
+#endif
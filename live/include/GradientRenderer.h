@@ -0,0 +1,77 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef GRADIENTRENDERER_H_INCLUDED
+#define GRADIENTRENDERER_H_INCLUDED
+
+// Includes:
+#include "OpenGL.h"
+#include "ShaderProgram.h"
+
+// Definitions:
+#define GRADIENT_MAX_STOPS   8
+
+/// Everything needed to draw a gradient
+typedef struct gradient_t
+{
+	/// Position and size, in pixels from the top-left of the viewport
+	float x, y, width, height;
+
+	/// Whether the gradient radiates from the centre rather than running
+	/// across the rectangle
+	bool radial;
+
+	/// The direction of a linear gradient, in degrees clockwise from
+	/// left-to-right
+	float angle;
+
+	/// The number of colour stops, from 2 to GRADIENT_MAX_STOPS
+	int stopCount;
+
+	/// The colour of each stop
+	float colours[GRADIENT_MAX_STOPS][4];
+
+	/// The position of each stop, from 0 to 1, in increasing order
+	float positions[GRADIENT_MAX_STOPS];
+} gradient_t;
+
+/// The GradientRenderer class draws linear and radial gradients entirely in
+/// the fragment shader. The colour stops are passed as uniforms, so animating a
+/// gradient costs nothing more than a few uniform updates: there is no bitmap
+/// to generate and no texture to upload.
+/// @author Clayton Peters
+class GradientRenderer
+{
+	public:
+		/// Constructs a new GradientRenderer object. A GL context must be
+		/// current
+		GradientRenderer();
+
+		/// Destroys a GradientRenderer object and its GL resources
+		~GradientRenderer();
+
+		/// Starts a new frame
+		/// @param _viewportWidth The width of the viewport in pixels
+		/// @param _viewportHeight The height of the viewport in pixels
+		void beginFrame(int _viewportWidth, int _viewportHeight);
+
+		/// Draws a gradient
+		void draw(const gradient_t& gradient);
+
+	private:
+		/// The gradient shader
+		ShaderProgram program;
+
+		/// Uniform locations
+		GLint viewportUniform, rectUniform, radialUniform, directionUniform;
+		GLint stopCountUniform, coloursUniform, positionsUniform;
+
+		/// An empty vertex array object; the quad comes from gl_VertexID
+		GLuint vertexArray;
+
+		/// The viewport size
+		int viewportWidth, viewportHeight;
+};
+
+#endif
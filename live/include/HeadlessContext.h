@@ -0,0 +1,57 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef HEADLESSCONTEXT_H_INCLUDED
+#define HEADLESSCONTEXT_H_INCLUDED
+
+// Includes:
+#include <EGL/egl.h>
+#include <string>
+#include "OpenGL.h"
+
+// Namespaces:
+using namespace std;
+
+/// The HeadlessContext class creates an OpenGL 3.2 context without a window or
+/// display, using EGL's surfaceless platform (e.g. Mesa's llvmpipe on a machine
+/// with no GPU), and renders in to a framebuffer object instead. Frames can be
+/// read back and saved as PNGs for comparison against golden images.
+/// @author Clayton Peters
+class HeadlessContext
+{
+	public:
+		/// Constructs a new HeadlessContext object, makes the context
+		/// current and binds the framebuffer. Throws an AuraException on
+		/// failure
+		/// @param _width The width of the framebuffer in pixels
+		/// @param _height The height of the framebuffer in pixels
+		HeadlessContext(int _width, int _height);
+
+		/// Destroys a HeadlessContext object, its framebuffer and context
+		~HeadlessContext();
+
+		/// Gets the size of the framebuffer in pixels
+		void getSize(int& _width, int& _height) const;
+
+		/// Waits for rendering to finish, in place of swapping buffers
+		void finish();
+
+		/// Saves the contents of the framebuffer as a PNG
+		/// @param filename The file to write
+		/// @returns true on success, false otherwise
+		bool saveFrame(const string& filename);
+
+	private:
+		/// The size of the framebuffer
+		int width, height;
+
+		/// The EGL display and context
+		EGLDisplay display;
+		EGLContext context;
+
+		/// The framebuffer and its colour buffer
+		GLuint framebuffer, colourBuffer;
+};
+
+#endif
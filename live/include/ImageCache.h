@@ -0,0 +1,234 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef IMAGECACHE_H_INCLUDED
+#define IMAGECACHE_H_INCLUDED
+
+// Includes:
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include "OpenGL.h"
+#include "ImageDecoder.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define IMAGECACHE_PAGE_SIZE        2048
+#define IMAGECACHE_MAX_PAGES        8
+#define IMAGECACHE_SIZE_STEP        64
+#define IMAGECACHE_UPLOAD_BUDGET    (4 * 1024 * 1024)
+#define IMAGECACHE_UPLOAD_BUFFERS   3
+
+/// Where a loaded image lives and how big it is
+typedef struct cached_image_t
+{
+	/// The atlas page texture the image is on
+	GLuint texture;
+
+	/// Texture coordinates of the top-left and bottom-right corners
+	float u0, v0, u1, v1;
+
+	/// The size of the image in pixels
+	int width, height;
+} cached_image_t;
+
+/// The ImageCache class gets images on to the GPU without stalling the render
+/// thread. Images are fetched and decoded (and scaled down to the size they
+/// are displayed at) by an ImageDecoder, then streamed in to RGBA atlas pages
+/// through a ring of pixel buffer objects, a limited number of bytes per call
+/// to update(), so that a new photo appearing costs a few frames of small
+/// uploads rather than one long hitch. When there is no room left, the
+/// least-recently-used page that wasn't drawn this frame is emptied.
+/// @author Clayton Peters
+class ImageCache
+{
+	public:
+		/// Constructs a new ImageCache object. A GL context must be current
+		ImageCache();
+
+		/// Destroys an ImageCache object and its textures
+		~ImageCache();
+
+		/// Starts a new frame. Images used in this frame will not be evicted
+		/// until a later frame
+		void beginFrame();
+
+		/// Gets an image, starting to load it if necessary
+		/// @param source The URL or file name of the image
+		/// @param width The width the image will be displayed at
+		/// @param height The height the image will be displayed at
+		/// @returns The image, or NULL if it isn't loaded (yet)
+		const cached_image_t* get(const string& source, int width, int height);
+
+		/// Starts loading an image that will be displayed soon, without
+		/// waiting for it to be drawn. Images that are drawn are always
+		/// loaded first, and prefetched ones are kept as if they were drawn
+		/// @param source The URL or file name of the image
+		/// @param width The width the image will be displayed at
+		/// @param height The height the image will be displayed at
+		/// @param priority How soon the image is needed, from one upwards;
+		/// lower values are loaded first
+		/// @returns true if the image is ready to draw
+		bool prefetch(const string& source, int width, int height, int priority);
+
+		/// Stops loading an image that is no longer needed. Images that have
+		/// already been decoded are kept
+		/// @param source The URL or file name of the image
+		/// @param width The width the image was to be displayed at
+		/// @param height The height the image was to be displayed at
+		void cancel(const string& source, int width, int height);
+
+		/// Collects decoded images and uploads some of them. Call this once
+		/// per loop whether or not a frame is drawn
+		/// @returns true if an image has finished loading since the last call
+		bool update();
+
+		/// Gets the number of images decoded since the cache was created
+		unsigned long long getDecodedCount() const;
+
+		/// Gets the number of bytes uploaded since the cache was created
+		unsigned long long getUploadedBytes() const;
+
+		/// Gets the number of pages evicted since the cache was created
+		unsigned long long getEvictionCount() const;
+
+		/// Gets the number of images prefetched, and the number of those
+		/// cancelled before they were decoded
+		unsigned long long getPrefetchCount() const;
+		unsigned long long getCancelCount() const;
+
+		/// Gets the average time taken to fetch and decode an image, in
+		/// seconds, or zero if none have been loaded yet
+		double getAverageLatency() const;
+
+		/// Gets the number of images waiting to be fetched or decoded
+		size_t getDecodeQueueLength() const;
+
+		/// Gets the number of atlas pages allocated, each of which takes
+		/// IMAGECACHE_PAGE_SIZE squared RGBA pixels of GPU memory
+		size_t getPageCount() const;
+
+	private:
+		/// The loading state of an image
+		typedef enum image_state_t
+		{
+			/// Waiting for the decoder
+			IMAGE_STATE_DECODING,
+
+			/// Decoded, waiting for space in a page
+			IMAGE_STATE_WAITING,
+
+			/// Being uploaded in to its page
+			IMAGE_STATE_UPLOADING,
+
+			/// Ready to draw
+			IMAGE_STATE_READY,
+
+			/// Couldn't be fetched or decoded
+			IMAGE_STATE_FAILED
+		} image_state_t;
+
+		/// An image in the cache
+		typedef struct image_entry_t
+		{
+			/// The loading state
+			image_state_t state;
+
+			/// The priority the image was requested with, while decoding
+			int priority;
+
+			/// The decoded pixels, whilst waiting or uploading
+			decoded_image_t* decoded;
+
+			/// The page the image is on, and where
+			int page, x, y;
+
+			/// The number of rows uploaded so far
+			int uploadedRows;
+
+			/// Where the image is, once it's ready
+			cached_image_t image;
+		} image_entry_t;
+
+		/// A row of images within a page
+		typedef struct shelf_t
+		{
+			/// The top and height of the shelf
+			int y, height;
+
+			/// The left of the free space on the shelf
+			int x;
+		} shelf_t;
+
+		/// An atlas texture holding many images
+		typedef struct page_t
+		{
+			/// The texture
+			GLuint texture;
+
+			/// The shelves, top to bottom
+			vector<shelf_t> shelves;
+
+			/// The keys of the images on this page
+			vector<string> keys;
+
+			/// The last frame an image on this page was drawn in
+			unsigned long long lastUsedFrame;
+		} page_t;
+
+		/// Gets the key of an image, rounding its size up to a step so that
+		/// an element that changes size slightly doesn't cause the image to
+		/// be decoded again
+		/// @returns false if the image can't be loaded
+		static bool makeKey(const string& source, int& width, int& height, string& key);
+
+		/// Finds an image or starts loading it
+		/// @returns The entry, or NULL if the image can't be loaded
+		image_entry_t* find(const string& source, int width, int height, int priority);
+
+		/// Finds space for an image, evicting a page if needed
+		/// @returns false if there is no space
+		bool allocate(int width, int height, int& page, int& x, int& y);
+
+		/// Finds space for an image in a page
+		/// @returns false if there is no space
+		bool allocateInPage(page_t& page, int width, int height, int& x, int& y);
+
+		/// Removes every image on a page and empties it
+		void evictPage(size_t pageIndex);
+
+		/// Uploads up to the per-call budget of waiting rows
+		/// @returns true if an image finished uploading
+		bool upload();
+
+		/// Fetches and decodes images
+		ImageDecoder decoder;
+
+		/// The images, keyed by source and display size
+		map<string, image_entry_t> entries;
+
+		/// The keys of images waiting for space or being uploaded, in order
+		deque<string> uploadQueue;
+
+		/// The atlas pages
+		vector<page_t> pages;
+
+		/// The ring of pixel buffer objects used for uploads
+		GLuint uploadBuffers[IMAGECACHE_UPLOAD_BUFFERS];
+
+		/// The next pixel buffer object to use
+		unsigned int nextUploadBuffer;
+
+		/// The current frame number
+		unsigned long long frame;
+
+		/// Statistics
+		unsigned long long decodedCount, uploadedBytes, evictionCount;
+		unsigned long long prefetchCount, cancelCount;
+};
+
+#endif
@@ -0,0 +1,175 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef IMAGEDECODER_H_INCLUDED
+#define IMAGEDECODER_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define IMAGE_DECODER_MAX_THREADS   4
+#define IMAGE_DECODER_LATENCY_BLEND 0.2
+#define IMAGE_DECODER_MAX_DIMENSION 8192
+
+/// An image that has been fetched and decoded by the ImageDecoder
+typedef struct decoded_image_t
+{
+	/// The key the image was requested with
+	string key;
+
+	/// The size of the decoded image in pixels
+	int width, height;
+
+	/// The pixels, as tightly-packed rows of RGBA bytes from the top down
+	vector<unsigned char> pixels;
+
+	/// Set if the image couldn't be fetched or decoded
+	bool failed;
+} decoded_image_t;
+
+/// The ImageDecoder class fetches (from a URL, via libaura, or from a file) and
+/// decodes JPEG and PNG images on a pool of worker threads, so that the render
+/// thread never waits for either. Images are scaled down as they are decoded to
+/// fit the size they will be displayed at, using libjpeg's DCT scaling where it
+/// can so that a large photo is never fully decoded. Each request has a
+/// priority, and both downloads and decodes take the most urgent first, so an
+/// image that is on screen overtakes ones that are only being fetched ahead.
+/// Images that would decode to more than IMAGE_DECODER_MAX_DIMENSION pixels
+/// across or down are rejected before any memory is allocated for them.
+/// @author Clayton Peters
+class ImageDecoder
+{
+	public:
+		/// Constructs a new ImageDecoder object and starts the workers
+		/// @param threadCount The number of worker threads, or zero to pick
+		/// one from the number of CPUs
+		ImageDecoder(unsigned int threadCount = 0);
+
+		/// Destroys an ImageDecoder object, waiting for the workers to finish
+		/// their current images. Images still queued are discarded
+		~ImageDecoder();
+
+		/// Queues an image to be fetched and decoded. Requesting a key that is
+		/// already queued only raises its priority
+		/// @param key The key to return the image with
+		/// @param source The URL or file name of the image
+		/// @param maxWidth The largest width the image will be displayed at
+		/// @param maxHeight The largest height the image will be displayed at
+		/// @param priority Lower values are fetched and decoded sooner
+		void request(const string& key, const string& source, int maxWidth, int maxHeight, int priority = 0);
+
+		/// Changes the priority of a queued image
+		void setPriority(const string& key, int priority);
+
+		/// Drops a queued image, aborting its download. An image that is
+		/// already being decoded is still returned
+		void cancel(const string& key);
+
+		/// Takes a decoded image, if there is one
+		/// @returns The image, which the caller must delete, or NULL if none
+		/// are ready
+		decoded_image_t* collect();
+
+		/// Gets the average time from requesting an image to it being
+		/// decoded, in seconds, or zero if none have been decoded yet
+		double getAverageLatency() const;
+
+		/// Gets the number of images waiting to be fetched or decoded
+		size_t getQueuedCount() const;
+
+		/// Fetches and decodes an image on the calling thread
+		/// @param source The URL or file name of the image
+		/// @param maxWidth The largest width the image will be displayed at
+		/// @param maxHeight The largest height the image will be displayed at
+		/// @param image The image to fill in
+		/// @returns true on success, false otherwise
+		static bool decode(const string& source, int maxWidth, int maxHeight, decoded_image_t& image);
+
+	private:
+		/// A queued request
+		typedef struct request_t
+		{
+			string source;
+			int maxWidth, maxHeight, priority;
+
+			/// The download fetching the image, or zero once it has been
+			/// downloaded or if it's a file
+			aura_download_id_t download;
+
+			/// The downloaded bytes of the image
+			vector<unsigned char> data;
+
+			/// When the image was first requested
+			chrono::steady_clock::time_point requested;
+		} request_t;
+
+		/// Called by libaura when a download finishes
+		static void downloadCallback(aura_download_id_t id, aura_download_data_t* data, void* userData);
+
+		/// Entry point for the worker threads
+		void workerMain();
+
+		/// Finds the most urgent request that is ready to decode. The lock
+		/// must be held
+		map<string, request_t>::iterator findReady();
+
+		/// Queues an image that couldn't be fetched. The lock must be held
+		void fail(const string& key);
+
+		/// Decodes the encoded bytes of an image
+		static bool decodeData(const string& source, const vector<unsigned char>& data, int maxWidth, int maxHeight, decoded_image_t& image);
+
+		/// Reads the encoded bytes of an image from a URL or file
+		static bool fetch(const string& source, vector<unsigned char>& data);
+
+		/// Decodes a JPEG, scaling by a power of two on the way if that still
+		/// leaves at least maxWidth x maxHeight pixels
+		static bool decodeJpeg(const vector<unsigned char>& data, int maxWidth, int maxHeight, decoded_image_t& image);
+
+		/// Decodes a PNG, unless it is larger than
+		/// IMAGE_DECODER_MAX_DIMENSION in either direction
+		static bool decodePng(const vector<unsigned char>& data, decoded_image_t& image);
+
+		/// Scales an image down with a box filter so that it fits within
+		/// maxWidth x maxHeight, keeping its aspect ratio
+		static void fitWithin(decoded_image_t& image, int maxWidth, int maxHeight);
+
+		/// Protects the queues
+		mutable mutex lock;
+
+		/// Signalled when a request is ready to decode or we're stopping
+		condition_variable wake;
+
+		/// Requests being downloaded or waiting for a worker, by key
+		map<string, request_t> requests;
+
+		/// The keys of the requests being downloaded
+		map<aura_download_id_t, string> downloads;
+
+		/// Images waiting to be collected
+		deque<decoded_image_t*> results;
+
+		/// The moving average of the time taken to load an image
+		double averageLatency;
+
+		/// Set to ask the workers to stop
+		bool stopping;
+
+		/// The worker threads
+		vector<thread> workers;
+};
+
+#endif
@@ -0,0 +1,231 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef LAYOUTENGINE_H_INCLUDED
+#define LAYOUTENGINE_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+#include <string>
+#include <map>
+#include <vector>
+#include "SceneNode.h"
+#include "Prefetcher.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define LAYOUT_PADDING         12.0f
+#define LAYOUT_TEXT_SIZE       24
+#define LAYOUT_IMAGE_ASPECT    0.5625f
+#define LAYOUT_NEAR_VISIBLE    0.5f
+#define LAYOUT_NONE_CHANGED    ((size_t)-1)
+
+// Forward declarations:
+class AuraLive;
+
+/// The LayoutEngine class drives a layout plugin, arranging a list of items
+/// (each some text and an optional image) in an area of the display and
+/// scrolling them. Measuring an item means laying out its text, so sizes are
+/// cached and only items that are new or have changed are measured again, and
+/// the plugin is only asked to place the items from the first change onwards.
+/// Only items that are on screen, or about to be, have element instances:
+/// these are recycled from item to item as the content scrolls, so a list of
+/// thousands of items needs no more elements than fit on the display. The
+/// images of the items that come next are prefetched, so they are ready by
+/// the time the items appear.
+/// @author Clayton Peters
+class LayoutEngine
+{
+	public:
+		/// Constructs a new LayoutEngine object
+		/// @param _auraLive The application, for creating elements and
+		/// measuring text
+		/// @param _plugin The plugin that created the layout object
+		/// @param _layout The layout object, which the engine takes ownership of
+		/// @param _root The group node to add the items' elements to
+		LayoutEngine(AuraLive& _auraLive, aura_layout_plugin_t* _plugin, aura_object_instance_t* _layout, SceneNode* _root);
+
+		/// Destroys a LayoutEngine object and its layout object. The elements
+		/// belong to the scene graph and are left there
+		~LayoutEngine();
+
+		/// Sets the area of the display to lay items out in
+		void setGeometry(float _x, float _y, float _width, float _height);
+
+		/// Adds an item
+		/// @param id A unique identifier for the item
+		/// @param text The UTF-8 encoded text of the item
+		/// @param imageSource The URL or file name of an image, or empty
+		/// @param atStart Add the item before the others instead of after
+		/// @returns true on success, false if the identifier is in use
+		bool addItem(const string& id, const string& text, const string& imageSource, bool atStart = false);
+
+		/// Changes the content of an item
+		/// @returns true on success, false if there is no such item
+		bool updateItem(const string& id, const string& text, const string& imageSource);
+
+		/// Removes an item
+		/// @returns true on success, false if there is no such item
+		bool removeItem(const string& id);
+
+		/// Gets the number of items
+		size_t getItemCount() const;
+
+		/// Measures and places anything that has changed, scrolls, and
+		/// updates the elements of the items that can be seen
+		/// @param timestep The time to advance by, in seconds
+		void update(double timestep);
+
+		/// Gets the number of times an item has been measured
+		unsigned long long getMeasureCount() const;
+
+		/// Gets the number of times the plugin has arranged the items, and
+		/// the total number of items it was asked to place
+		unsigned long long getArrangeCount() const;
+		unsigned long long getArrangedItemCount() const;
+
+		/// Gets the number of items that have elements at the moment
+		size_t getLiveViewCount() const;
+
+		/// Gets the number of sets of elements that have been created
+		size_t getViewCount() const;
+
+		/// Gets the prefetcher for the items' images
+		const Prefetcher& getPrefetcher() const;
+
+	private:
+		struct view_t;
+
+		/// An item
+		typedef struct entry_t
+		{
+			/// The identifier and content of the item
+			string id, text, imageSource;
+
+			/// The position of the item in the list
+			size_t index;
+
+			/// The item width the height was measured at, or less than zero
+			/// if it needs measuring
+			float measuredWidth;
+
+			/// The measured height of the text
+			float textHeight;
+
+			/// The elements showing the item, if it can be seen
+			view_t* view;
+		} entry_t;
+
+		/// The elements that show an item
+		typedef struct view_t
+		{
+			/// The group holding the elements
+			SceneNode* group;
+
+			/// The elements
+			SceneNode* background;
+			SceneNode* text;
+			SceneNode* image;
+
+			/// The item being shown, or NULL if the view is free
+			entry_t* entry;
+		} view_t;
+
+		/// Measures an item at the current item width
+		void measure(entry_t* entry);
+
+		/// Renumbers items from the given position, after an insertion or
+		/// removal, and notes that they need placing again
+		void renumber(size_t first);
+
+		/// Asks the plugin to place the items that have moved
+		void arrange();
+
+		/// Moves the scroll position on
+		void scroll(double timestep);
+
+		/// Gives elements to the items that can be seen and takes them from
+		/// those that can't, then positions them
+		void updateViews();
+
+		/// Tells the prefetcher which images are shown now and which come
+		/// next
+		void updatePrefetch();
+
+		/// Gets a free set of elements, creating one if there are none
+		/// @returns The view, or NULL if its elements couldn't be created
+		view_t* acquireView();
+
+		/// Sets the content of a view from its item
+		void bindView(view_t* view);
+
+		/// Hides a view and returns it to the free list
+		void releaseView(view_t* view);
+
+		/// Gets a floating point property of the layout object
+		double getLayoutProperty(const char* name, double defaultValue) const;
+
+		/// The application
+		AuraLive& auraLive;
+
+		/// The layout plugin and object
+		aura_layout_plugin_t* plugin;
+		aura_object_instance_t* layout;
+
+		/// The group node the elements are added to
+		SceneNode* root;
+
+		/// The area to lay items out in
+		float x, y, width, height;
+
+		/// The items, in order, and keyed by identifier
+		vector<entry_t*> entries;
+		map<string, entry_t*> entriesById;
+
+		/// The sizes and positions of the items, in the same order
+		vector<aura_layout_item_t> items;
+
+		/// Items waiting to be measured
+		vector<entry_t*> unmeasured;
+
+		/// The first item that needs placing, or LAYOUT_NONE_CHANGED
+		size_t firstChanged;
+
+		/// The width items are measured at
+		float itemWidth;
+
+		/// What the plugin said about the content last time it arranged it
+		bool horizontal;
+		float extent, page;
+
+		/// The scroll position, and the time spent on the current page
+		double scrollPosition, pageTime;
+
+		/// Set when the views need positioning again
+		bool viewsDirty;
+
+		/// Every view, and those that are free
+		vector<view_t*> views;
+		vector<view_t*> freeViews;
+
+		/// The range of items that have views
+		size_t firstLive, lastLive;
+
+		/// Loads the images of the items that are about to appear
+		Prefetcher prefetcher;
+
+		/// The number of items that have appeared since the last update, and
+		/// the prefetch depth when the prefetcher was last updated
+		size_t shownCount, prefetchDepth;
+
+		/// Set when the prefetcher needs updating
+		bool prefetchDirty;
+
+		/// Statistics
+		unsigned long long measureCount, arrangeCount, arrangedItemCount;
+};
+
+#endif
@@ -16,6 +16,32 @@
 #define LOG_ERROR  10
 #define LOG_FATAL  0
 
+// The most verbose level that is compiled in at all. Builds that never want
+// the chattier levels can lower this, e.g. -DLOG_COMPILE_LEVEL=LOG_WARN, and
+// any LOG() above it disappears along with its arguments
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_INFO
+#endif
+
+// Definitions:
+#define LOG_RING_SIZE          65536
+#define LOG_MAX_LINE           2048
+#define LOG_WRITER_INTERVAL_MS 20
+
+/// Logs a message if its level is both compiled in and currently enabled. The
+/// arguments are only evaluated if the message is going to be logged, so this
+/// is what should be used rather than calling log() directly
+/// @param logLevel The loglevel to format at
+/// @param ... The format string, followed by arguments
+#define LOG(logLevel, ...) \
+	do \
+	{ \
+		if ((logLevel) <= LOG_COMPILE_LEVEL && (logLevel) <= log_get_level()) \
+		{ \
+			::log((logLevel), __VA_ARGS__); \
+		} \
+	} while (0)
+
 /// Set up logging to log to another file handle
 /// @param fp The file pointer of the file/stream to log to
 void log_set_handle(FILE* fp);
@@ -27,7 +53,15 @@ void log_set_level(int logLevel);
 /// Gets the current log level
 int log_get_level();
 
-/// Logging function
+/// Waits until every message logged so far has been written out. This
+/// happens by itself at exit and after a LOG_FATAL message
+void log_flush();
+
+/// Logging function. The message is formatted on the calling thread and put
+/// in that thread's buffer, and a background thread writes it out with the
+/// time and thread ID, so this never waits on the file being logged to. If
+/// a thread logs faster than its messages can be written, the extra messages
+/// are dropped and a count of them is logged instead
 /// @param logLevel The loglevel to format at
 /// @param format The format string, followed by arguments
 void log(int logLevel, const char* format, ...);
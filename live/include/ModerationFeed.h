@@ -0,0 +1,94 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef MODERATIONFEED_H_INCLUDED
+#define MODERATIONFEED_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+#include <string>
+#include <deque>
+#include "LayoutEngine.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define MODERATION_RETRY_INTERVAL   2.0
+#define MODERATION_MAX_PER_UPDATE   64
+#define MODERATION_JOURNAL_ITEMS    500
+#define MODERATION_JOURNAL_BYTES    (4 * 1024 * 1024)
+
+/// The ModerationFeed class shows the items that moderators approve in the
+/// filter tool, which hands them over through a moderation queue in shared
+/// memory. Items are read in place from the queue on the render thread every
+/// update, which costs nothing when the queue is empty, so they appear within
+/// a timestep of being approved without the render loop ever blocking. The
+/// queue is opened when the filter tool creates it and again whenever it is
+/// restarted. An item whose identifier is already shown replaces it, so a post
+/// can be corrected after approval. Items can also be kept in a journal, which
+/// is replayed in to the layout when the feed is created, so that after a
+/// restart the display shows what it did before on its first frame rather than
+/// waiting for moderators to approve more. Only the newest
+/// MODERATION_JOURNAL_ITEMS items are shown, as the journal keeps, and older
+/// ones are removed from both. Images are referred to by their source, and
+/// load through the image cache as usual.
+/// @author Clayton Peters
+class ModerationFeed
+{
+	public:
+		/// Constructs a new ModerationFeed object
+		/// @param _queueName The name of the moderation queue
+		/// @param _layout The layout to add the approved items to
+		/// @param journalPath The file to keep the items in, or empty not to
+		ModerationFeed(const string& _queueName, LayoutEngine* _layout, const string& journalPath = "");
+
+		/// Destroys a ModerationFeed object, closing the queue and journal
+		~ModerationFeed();
+
+		/// Adds any items that have arrived to the layout, and opens the
+		/// queue if it isn't yet
+		/// @param timestep The time since the last update, in seconds
+		void update(double timestep);
+
+		/// Determines whether the queue is open
+		bool isConnected() const;
+
+		/// Gets the number of items received from the queue
+		unsigned long long getReceivedCount() const;
+
+		/// Gets the number of items replayed from the journal
+		size_t getReplayedCount() const;
+
+	private:
+		/// Shows an item, adding it or replacing the one with its identifier
+		void showItem(const aura_item_t* item);
+
+		/// Called for each item when the journal is replayed
+		static void replayCallback(void* userData, const aura_item_t* item);
+
+		/// The name of the queue
+		string queueName;
+
+		/// The layout the items go in to
+		LayoutEngine* layout;
+
+		/// The consumer end of the queue, or NULL if it isn't open
+		aura_mod_queue_t queue;
+
+		/// The journal of items shown, or NULL if there isn't one
+		aura_journal_t journal;
+
+		/// The identifiers of the items shown, oldest first
+		deque<string> shownIds;
+
+		/// The time until we next try to open the queue
+		double retryTime;
+
+		/// Statistics
+		unsigned long long receivedCount;
+		size_t replayedCount;
+};
+
+#endif
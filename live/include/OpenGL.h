@@ -0,0 +1,15 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef OPENGL_H_INCLUDED
+#define OPENGL_H_INCLUDED
+
+// Includes: we use OpenGL 3.2 entry points directly, which libGL exports
+#ifndef GL_GLEXT_PROTOTYPES
+#	define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#endif
@@ -0,0 +1,63 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef OUTPUT_H_INCLUDED
+#define OUTPUT_H_INCLUDED
+
+// Includes:
+#include <SDL.h>
+
+/// The Output class is a window on one of the screens that Aura Live drives.
+/// Every output shows part of one large canvas that the scene is laid out on,
+/// with the outputs side by side from left to right, so content can be placed
+/// on a particular screen or span several. All outputs are drawn with the same
+/// OpenGL context, so textures, glyph atlases and buffers are uploaded once
+/// and used on every screen.
+/// @author Clayton Peters
+class Output
+{
+	public:
+		/// Creates the window for an output. Throws an AuraException on
+		/// failure. The GL attributes must already have been set
+		/// @param _index The number of the output, from zero
+		/// @param windowed Whether to open a window rather than filling the
+		/// screen
+		/// @param width The width of the window, or of the display mode to
+		/// use when filling the screen (zero for the desktop mode)
+		/// @param height The height of the window or display mode
+		Output(int _index, bool windowed, int width, int height);
+
+		/// Destroys an Output object and its window
+		~Output();
+
+		/// Gets the number of the output
+		int getIndex() const;
+
+		/// Gets the window
+		SDL_Window* getWindow() const;
+
+		/// Gets the SDL identifier of the window, as given in window events
+		Uint32 getWindowId() const;
+
+		/// Gets the size of the drawable area of the window in pixels
+		void getDrawableSize(int& width, int& height) const;
+
+		/// Sets where the output is on the canvas
+		void setCanvasPosition(int _canvasX, int _canvasY);
+
+		/// Gets where the output is on the canvas
+		void getCanvasPosition(int& _canvasX, int& _canvasY) const;
+
+	private:
+		/// The number of the output
+		int index;
+
+		/// The window
+		SDL_Window* window;
+
+		/// Where the top-left of the output is on the canvas
+		int canvasX, canvasY;
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
 #ifndef WIN32
 #	include <dlfcn.h>
 #endif
@@ -19,6 +20,10 @@ using namespace std;
 
 typedef pair<aura_plugin_type_t, string> aura_object_class_t;
 
+/// A reference to a loaded plugin. The plugin stays loaded for as long as any
+/// reference to it is held, even after the PluginLoader has been destroyed
+typedef shared_ptr<aura_plugin_t> aura_plugin_ref_t;
+
 /// The PluginLoader class searches directories for shared libraries and loads
 /// them
 /// @author Clayton Peters
@@ -29,7 +34,9 @@ class PluginLoader
 		/// @param _rootDir The path to start searching for plugins from
 		PluginLoader(const string& _rootDir);
 
-		/// Destroys a PluginLoader object, unloading all loaded plugins
+		/// Destroys a PluginLoader object, unloading all loaded plugins that
+		/// aren't still referenced. Those are unloaded when the last reference
+		/// to them is released
 		~PluginLoader();
 
 		/// Gets the plugin responsible creating for objects of the given class
@@ -41,11 +48,34 @@ class PluginLoader
 		/// @param objectType The name of the object type, e.g. "text", "twitter"
 		aura_plugin_t* getPluginFor(aura_plugin_type_t pluginType, string objectType);
 
+		/// Gets a reference to a plugin, which keeps it loaded whilst held.
+		/// Anything that may run a plugin's code on another thread past the
+		/// lifetime of the PluginLoader must hold one
+		/// @param plugin A plugin returned by getPluginFor
+		aura_plugin_ref_t getPluginRef(aura_plugin_t* plugin);
+
 		/// Get the names of the object types available for a plugin type
 		/// @param pluginType The type of the plugin, e.g. AURA_PLUGIN_TYPE_ELEMENT
 		const vector<string>& getObjectTypes(aura_plugin_type_t pluginType);
  
 	private:
+		/// Reads the description of a loaded plugin and registers the
+		/// object types it provides
+		/// @param name The name to refer to the plugin by in log messages
+		/// @param plugin The loaded plugin structure
+		/// @returns true if the plugin was registered, false if it was invalid
+		bool registerPlugin(const string& name, aura_plugin_t* plugin);
+
+		/// Makes the first reference to a loaded plugin, which unloads it
+		/// when the last reference is released
+		/// @param name The name the plugin was loaded by
+		/// @param plugin The loaded plugin structure
+		/// @param handle The shared object handle, or NULL for static plugins
+		void addPlugin(const string& name, aura_plugin_t* plugin, void* handle);
+
+		/// Unloads a plugin once nothing references it any more
+		static void unloadPlugin(const string& name, aura_plugin_t* plugin, void* handle);
+
 		/// Scan the given directory for plugins, recursing down as 
 		/// necessary and adding them to the map
 		void scanPluginDir(const string& path);
@@ -56,9 +86,13 @@ class PluginLoader
 		/// The map of found plugin filenames and their shared object handles
 		map<string, void*> pluginHandles;
 
-		/// The map of found plugin filenames and their initialised plugin structures
+		/// The map of found plugin filenames (or "static:" names for plugins
+		/// linked in to the application) and their initialised plugin structures
 		map<string, aura_plugin_t*> plugins;
 
+		/// The PluginLoader's own reference to each plugin structure
+		map<aura_plugin_t*, aura_plugin_ref_t> pluginRefs;
+
 		/// The map of [plugin types, object types] to plugin structures
 		map<aura_object_class_t, aura_plugin_t*> objectPlugins;
 
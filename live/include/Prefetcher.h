@@ -0,0 +1,111 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef PREFETCHER_H_INCLUDED
+#define PREFETCHER_H_INCLUDED
+
+// Includes:
+#include <string>
+#include <map>
+#include <vector>
+#include "ImageCache.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define PREFETCH_MIN_DEPTH      2
+#define PREFETCH_MAX_DEPTH      32
+#define PREFETCH_MARGIN         1.5
+#define PREFETCH_RATE_WINDOW    2.0
+#define PREFETCH_RATE_BLEND     0.25
+
+/// An image that will be displayed
+typedef struct prefetch_item_t
+{
+	/// The URL or file name of the image
+	string source;
+
+	/// The size it will be displayed at
+	int width, height;
+} prefetch_item_t;
+
+/// The Prefetcher class keeps the images of the items about to come on screen
+/// loading before they get there, so that by the time an item appears its
+/// image has been fetched, decoded and uploaded. It is given the items that
+/// have elements now followed by those that come after them, in the order
+/// they will appear. The current items are always kept; of the rest, it
+/// prefetches as many as will appear in the time it takes to load an image
+/// (plus a margin and the largest number seen to appear at once, so a paged
+/// layout gets its whole next page), nearest first. Anything that drops out of
+/// that range before it has loaded, because it was skipped, removed or the
+/// range shrank, is cancelled.
+/// @author Clayton Peters
+class Prefetcher
+{
+	public:
+		/// Constructs a new Prefetcher object
+		/// @param _imageCache The cache to load images in to
+		Prefetcher(ImageCache& _imageCache);
+
+		/// Destroys a Prefetcher object, cancelling anything still loading
+		~Prefetcher();
+
+		/// Measures how quickly items are appearing
+		/// @param timestep The time since the last call, in seconds
+		/// @param shown The number of items that have appeared since the last
+		/// call
+		void update(double timestep, size_t shown);
+
+		/// Prefetches the images for the current and upcoming items and
+		/// cancels any that are no longer wanted
+		/// @param items The images of the current items, then the upcoming
+		/// ones in the order they will appear
+		/// @param currentCount The number of current items at the start of the
+		/// list
+		void setItems(const vector<prefetch_item_t>& items, size_t currentCount);
+
+		/// Gets the number of upcoming items to prefetch, from the measured
+		/// load latency and rate the items are appearing at
+		size_t getDepth() const;
+
+		/// Gets the number of prefetched images that were ready by the time
+		/// they appeared, and the number that weren't
+		unsigned long long getHitCount() const;
+		unsigned long long getMissCount() const;
+
+	private:
+		/// An image being prefetched
+		typedef struct outstanding_t
+		{
+			prefetch_item_t item;
+
+			/// Set if the image was upcoming rather than current
+			bool upcoming;
+		} outstanding_t;
+
+		/// The cache images are loaded in to
+		ImageCache& imageCache;
+
+		/// The images being prefetched, keyed by source and size
+		map<string, outstanding_t> outstanding;
+
+		/// The number of upcoming items to prefetch
+		size_t depth;
+
+		/// The rate items are appearing at, in items per second, and the most
+		/// that have appeared at once
+		double rate;
+		size_t burst;
+
+		/// The items that have appeared in the current measuring window, the
+		/// most at once, and the length of the window so far
+		size_t windowShown, windowBurst;
+		double windowTime;
+
+		/// Statistics
+		unsigned long long hitCount, missCount;
+};
+
+#endif
@@ -0,0 +1,110 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef QUALITYCONTROLLER_H_INCLUDED
+#define QUALITYCONTROLLER_H_INCLUDED
+
+// Includes:
+#include <stddef.h>
+
+// Definitions:
+#define QUALITY_LEVEL_COUNT        4
+#define QUALITY_WINDOW             30
+#define QUALITY_OVERRUN_LIMIT      5
+#define QUALITY_MISSED_VSYNC       1.5
+#define QUALITY_HEADROOM           0.6
+#define QUALITY_RECOVER_FRAMES     180
+#define QUALITY_MAX_RECOVER_FRAMES 1440
+#define QUALITY_UNSTABLE_FRAMES    120
+
+/// A set of rendering settings
+typedef struct quality_level_t
+{
+	/// A description of the level, for the log
+	const char* name;
+
+	/// The scale of the internal render resolution
+	float renderScale;
+
+	/// Whether transitions are drawn as a plain cross-fade rather than with
+	/// the plugin's shader
+	bool simpleTransitions;
+} quality_level_t;
+
+/// The QualityController class watches how long frames take against the vsync
+/// budget and picks a quality level. Level zero is full quality; each level
+/// after it is cheaper to draw. When frames keep overrunning the budget the
+/// quality is stepped down, and once there has been plenty of headroom for a
+/// while it is stepped back up. If stepping up leads straight back to
+/// overruns then it waits longer before trying again, so that it doesn't
+/// flip between two levels.
+/// @author Clayton Peters
+class QualityController
+{
+	public:
+		/// Constructs a new QualityController object at full quality
+		QualityController();
+
+		/// Sets the time available for each frame
+		/// @param _budget The vsync interval in seconds
+		void setBudget(double _budget);
+
+		/// Turns the controller on or off. When off, the level stays where
+		/// it is put
+		void setAdaptive(bool _adaptive);
+
+		/// Determines whether the controller picks the level itself
+		bool isAdaptive() const;
+
+		/// Sets the quality level
+		/// @param _level The level, from 0 (full quality) to
+		/// QUALITY_LEVEL_COUNT - 1
+		void setLevel(int _level);
+
+		/// Gets the current quality level
+		int getLevel() const;
+
+		/// Gets the settings of the current quality level
+		const quality_level_t& getSettings() const;
+
+		/// Gets the settings of a quality level
+		static const quality_level_t& getSettings(int _level);
+
+		/// Records a presented frame and changes the quality level if it's
+		/// called for
+		/// @param frameTime The time since the previous frame, in seconds
+		/// @param workTime The time spent producing the frame, in seconds
+		/// @returns true if the quality level changed
+		bool addFrame(double frameTime, double workTime);
+
+	private:
+		/// Moves to a new level and starts watching afresh
+		void changeLevel(int _level);
+
+		/// The time available for each frame, in seconds
+		double budget;
+
+		/// Whether the controller picks the level itself
+		bool adaptive;
+
+		/// The current level
+		int level;
+
+		/// Whether each of the recent frames overran, as a ring buffer, and
+		/// how many of them did
+		bool overruns[QUALITY_WINDOW];
+		size_t overrunNext, overrunCount;
+
+		/// The number of frames since the level last changed, and how many
+		/// of them in a row had headroom
+		unsigned long long framesAtLevel, headroomFrames;
+
+		/// The number of frames with headroom needed to step up
+		unsigned long long recoverFrames;
+
+		/// Whether the last change was a step up
+		bool steppedUp;
+};
+
+#endif
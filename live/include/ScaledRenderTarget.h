@@ -0,0 +1,52 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef SCALEDRENDERTARGET_H_INCLUDED
+#define SCALEDRENDERTARGET_H_INCLUDED
+
+// Includes:
+#include "OpenGL.h"
+
+/// The ScaledRenderTarget class lets a frame be drawn at a lower resolution
+/// than the display and then stretched to fit it, which cuts the fill cost of
+/// everything drawn in between.
+/// @author Clayton Peters
+class ScaledRenderTarget
+{
+	public:
+		/// Constructs a new ScaledRenderTarget object. A GL context must be
+		/// current
+		ScaledRenderTarget();
+
+		/// Destroys a ScaledRenderTarget object and its GL resources
+		~ScaledRenderTarget();
+
+		/// Binds a framebuffer that is a scaled-down copy of the current
+		/// viewport, ready to draw in to. The viewport is left for the
+		/// caller to set, in the scaled framebuffer's pixels
+		/// @param _width The width of the output in pixels
+		/// @param _height The height of the output in pixels
+		/// @param scale The resolution to draw at, as a fraction of the
+		/// output's
+		void begin(int _width, int _height, float scale);
+
+		/// Stretches what was drawn over the framebuffer that was bound
+		/// before begin(), and binds that framebuffer again
+		void end();
+
+	private:
+		/// (Re)creates the framebuffer at the given size
+		void resize(int _scaledWidth, int _scaledHeight);
+
+		/// The framebuffer and its colour buffer
+		GLuint framebuffer, colourBuffer;
+
+		/// The size of the output, and of the framebuffer
+		int width, height, scaledWidth, scaledHeight;
+
+		/// The framebuffer to go back to after drawing
+		GLint previousFramebuffer;
+};
+
+#endif
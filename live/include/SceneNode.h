@@ -0,0 +1,123 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef SCENENODE_H_INCLUDED
+#define SCENENODE_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+#include <vector>
+
+// Namespaces:
+using namespace std;
+
+/// The SceneNode class is a node in the retained scene graph. A node holds an
+/// element instance (or nothing, if it is just a group) along with where it is
+/// on the display and its children. Any change marks the node dirty. If the
+/// node can be seen this is propagated up to the root so the frame loop can
+/// tell whether it needs to draw at all, otherwise it only goes as far as the
+/// hidden node, which will be drawn afresh when it is shown.
+/// @author Clayton Peters
+class SceneNode
+{
+	public:
+		/// Constructs a new SceneNode object. The node takes ownership of the
+		/// element instance
+		/// @param _plugin The plugin that created the object, or NULL for a group
+		/// @param _object The element instance, or NULL for a group
+		SceneNode(aura_plugin_t* _plugin = NULL, aura_object_instance_t* _object = NULL);
+
+		/// Destroys a SceneNode object, its element instance and all of its
+		/// children
+		~SceneNode();
+
+		/// Adds a child node. The node takes ownership of the child
+		/// @param child The node to add
+		void addChild(SceneNode* child);
+
+		/// Removes a child node without deleting it. Ownership passes back
+		/// to the caller
+		/// @param child The node to remove
+		void removeChild(SceneNode* child);
+
+		/// Gets the children of this node, in drawing order
+		const vector<SceneNode*>& getChildren() const;
+
+		/// Gets the parent of this node, or NULL if it is the root
+		SceneNode* getParent() const;
+
+		/// Gets the plugin that created the element instance
+		aura_plugin_t* getPlugin() const;
+
+		/// Gets the element instance, or NULL for a group
+		aura_object_instance_t* getObject() const;
+
+		/// Gets a property of the element instance
+		/// @param name The name of the property
+		/// @returns The property, or NULL if there is no such property
+		aura_property_t* getProperty(const char* name) const;
+
+		/// Notifies the node that one of its properties has been changed,
+		/// passing the notification on to the plugin and marking the node
+		/// dirty
+		/// @param property The property that changed
+		void propertyChanged(aura_property_t* property);
+
+		/// Sets the position and size of the node on the display
+		void setGeometry(float _x, float _y, float _width, float _height);
+
+		/// Gets the position and size of the node on the display
+		void getGeometry(float& _x, float& _y, float& _width, float& _height) const;
+
+		/// Shows or hides the node (and its children)
+		void setVisible(bool _visible);
+
+		/// Determines whether the node itself is visible
+		bool isVisible() const;
+
+		/// Determines whether the node and all of its ancestors are visible
+		bool isVisibleInTree() const;
+
+		/// Marks the node as needing to be redrawn. If the node can't be seen
+		/// it is still marked, but the display doesn't need redrawing for it
+		void markDirty();
+
+		/// Determines whether this node or any of its descendants need to be
+		/// redrawn
+		bool needsRedraw() const;
+
+		/// Clears the dirty state of this node and its descendants
+		void clearDirty();
+
+	private:
+		/// Marks this node and its ancestors as having a dirty descendant, up
+		/// to the first one that is hidden
+		void markChildDirty();
+
+		/// The plugin that created the object
+		aura_plugin_t* plugin;
+
+		/// The element instance
+		aura_object_instance_t* object;
+
+		/// The parent node
+		SceneNode* parent;
+
+		/// The child nodes, in drawing order
+		vector<SceneNode*> children;
+
+		/// Position and size on the display
+		float x, y, width, height;
+
+		/// Whether the node is visible
+		bool visible;
+
+		/// Whether this node needs to be redrawn
+		bool dirty;
+
+		/// Whether any descendant of this node needs to be redrawn
+		bool childDirty;
+};
+
+#endif
@@ -0,0 +1,46 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef SHADERPROGRAM_H_INCLUDED
+#define SHADERPROGRAM_H_INCLUDED
+
+// Includes:
+#include "OpenGL.h"
+
+/// The ShaderProgram class compiles and links a GLSL vertex and fragment shader
+/// pair. A GL context must be current whenever it is used.
+/// @author Clayton Peters
+class ShaderProgram
+{
+	public:
+		/// Compiles and links a new shader program. Throws an AuraException
+		/// if either shader fails to compile or the program fails to link
+		/// @param vertexSource The source of the vertex shader
+		/// @param fragmentSource The source of the fragment shader
+		ShaderProgram(const char* vertexSource, const char* fragmentSource);
+
+		/// Destroys a ShaderProgram object, deleting the program
+		~ShaderProgram();
+
+		/// Makes this the current program
+		void use();
+
+		/// Gets the location of a uniform
+		/// @param name The name of the uniform
+		GLint getUniformLocation(const char* name);
+
+		/// Gets the GL program name
+		GLuint getProgram() const;
+
+	private:
+		/// Compiles a single shader, throwing an AuraException on failure
+		/// @param type The shader type, e.g. GL_VERTEX_SHADER
+		/// @param source The source of the shader
+		static GLuint compileShader(GLenum type, const char* source);
+
+		/// The GL program name
+		GLuint program;
+};
+
+#endif
@@ -0,0 +1,226 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef SOURCERUNNER_H_INCLUDED
+#define SOURCERUNNER_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "PluginLoader.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define SOURCE_DEFAULT_BUDGET_MS          10000
+#define SOURCE_DEFAULT_QUARANTINE_COUNT   3
+#define SOURCE_SCHEDULE_SPEEDUP           4
+#define SOURCE_SCHEDULE_SLOWDOWN          8
+#define SOURCE_SCHEDULE_RECHECK_MS        1000
+#define SOURCE_POLL_BUCKETS               0.001, 0.01, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0
+
+/// Statistics about a single source object, as tracked by the SourceRunner
+typedef struct source_stats_t
+{
+	/// The object type of the source, e.g. "twitter"
+	string objectType;
+
+	/// The number of completed calls in to the plugin
+	unsigned long long calls;
+
+	/// The number of calls that ran past the time budget
+	unsigned long long overruns;
+
+	/// The number of overruns in a row without a call completing in budget
+	unsigned int consecutiveOverruns;
+
+	/// The duration of the most recent completed call, in milliseconds
+	double lastCallMs;
+
+	/// The duration of the longest completed call, in milliseconds
+	double maxCallMs;
+
+	/// Whether the source has been quarantined (it will no longer be called)
+	bool quarantined;
+
+	/// The time between polls at the moment, as scheduled, in milliseconds
+	double pollIntervalMs;
+
+	/// The measured rate that new items arrive at, per second
+	double itemRate;
+} source_stats_t;
+
+/// The SourceRunner class runs each source plugin object on its own worker
+/// thread, so that a slow source can never hold up the render thread. Every
+/// call in to a plugin has a time budget that is policed by a watchdog thread:
+/// overruns are counted and a source that overruns too many times in a row is
+/// quarantined and never called again. Polls aren't on a fixed timer: each
+/// source is scheduled by libaura, which polls a busy source more often and a
+/// quiet one less, keeps within the source's rate limit and backs off when
+/// polls fail or a streaming connection is delivering the items.
+/// @author Clayton Peters
+class SourceRunner
+{
+	public:
+		/// Constructs a new SourceRunner object and starts the watchdog
+		/// @param _budgetMs The time budget for a single plugin call
+		/// @param _quarantineCount The number of consecutive overruns before
+		/// a source is quarantined
+		SourceRunner(unsigned int _budgetMs = SOURCE_DEFAULT_BUDGET_MS, unsigned int _quarantineCount = SOURCE_DEFAULT_QUARANTINE_COUNT);
+
+		/// Destroys a SourceRunner object, stopping all the worker threads and
+		/// destroying their source objects
+		~SourceRunner();
+
+		/// Starts polling a source object on a new worker thread. The source
+		/// object belongs to the SourceRunner from then on
+		/// @param plugin A reference to the source plugin that created the
+		/// object, which is held until the worker has exited
+		/// @param object The source object instance to poll
+		/// @param intervalMs The usual time to wait between polls. The scheduler
+		/// varies this from SOURCE_SCHEDULE_SPEEDUP times shorter to
+		/// SOURCE_SCHEDULE_SLOWDOWN times longer
+		void addSource(const aura_plugin_ref_t& plugin, aura_object_instance_t* object, unsigned int intervalMs);
+
+		/// Stops polling a source object, waiting for its worker to finish,
+		/// and destroys the object. If the worker is stuck then the object is
+		/// destroyed when it returns
+		/// @param object The source object instance to stop
+		void removeSource(aura_object_instance_t* object);
+
+		/// Gets a snapshot of the statistics for a source object
+		/// @param object The source object instance
+		/// @param stats The structure to fill in
+		/// @returns true if the object is known, false otherwise
+		bool getStats(aura_object_instance_t* object, source_stats_t& stats);
+
+		/// Gets a snapshot of the statistics of every source object
+		vector<source_stats_t> getAllStats();
+
+		/// Determines whether a source has been quarantined
+		/// @param object The source object instance
+		bool isQuarantined(aura_object_instance_t* object);
+
+	private:
+		/// State kept for each worker thread
+		typedef struct worker_t
+		{
+			/// The plugin the object came from
+			aura_source_plugin_t* plugin;
+
+			/// Keeps the plugin loaded until the worker has exited, even if
+			/// it has been abandoned
+			aura_plugin_ref_t pluginRef;
+
+			/// The object being polled
+			aura_object_instance_t* object;
+
+			/// The usual time to wait between polls, if the source isn't
+			/// being scheduled
+			unsigned int intervalMs;
+
+			/// The time budget for a single call (copied from the runner so
+			/// that an abandoned worker never touches the runner again)
+			unsigned int budgetMs;
+
+			/// The number of consecutive overruns before quarantine
+			unsigned int quarantineCount;
+
+			/// Protects the state and statistics of this worker
+			mutex lock;
+
+			/// The worker thread
+			thread workerThread;
+
+			/// Set to ask the worker to stop
+			bool stopping;
+
+			/// Signalled to wake the worker up early (e.g. to stop it)
+			condition_variable wake;
+
+			/// Set by the worker just before its thread exits
+			bool finished;
+
+			/// Signalled when the worker sets finished
+			condition_variable finishedSignal;
+
+			/// Set if the worker was stuck when it was stopped, in which case
+			/// nothing will join it and it destroys itself when it returns
+			bool abandoned;
+
+			/// The start time of the current call (steady clock nanoseconds),
+			/// or zero if the worker is not currently inside the plugin
+			atomic<long long> callStartNs;
+
+			/// Set by the watchdog once it has counted the current call as an
+			/// overrun, so that the worker does not count it again
+			bool overrunCounted;
+
+			/// The statistics for this source
+			source_stats_t stats;
+
+			/// The metrics the polls are published in, shared by sources of
+			/// the same type
+			aura_metric_t pollSeconds, pollFailures;
+		} worker_t;
+
+		/// Entry point for worker threads. This only ever touches the worker
+		/// state so that a stuck worker can be safely abandoned
+		static void workerMain(worker_t* worker);
+
+		/// Entry point for the watchdog thread
+		void watchdogMain();
+
+		/// Records an overrun against a worker, quarantining it if necessary.
+		/// Must be called with the worker mutex held
+		static void recordOverrun(worker_t* worker);
+
+		/// Stops and joins (or abandons, if stuck) a worker. Must be called
+		/// without any mutex held
+		static void stopWorker(worker_t* worker);
+
+		/// Destroys a worker whose thread has exited, along with the source
+		/// object it polled, releasing its reference to the plugin
+		static void destroyWorker(worker_t* worker);
+
+		/// Waits until the next poll of a worker's source is due, or the
+		/// worker is told to stop. Must be called with the worker mutex held
+		static void waitForPoll(worker_t* worker, unique_lock<mutex>& guard);
+
+		/// Fills in the scheduling statistics of a source
+		static void getScheduleStats(aura_object_instance_t* object, source_stats_t& stats);
+
+		/// Gets the current steady clock time in nanoseconds
+		static long long nowNs();
+
+		/// The time budget for a single plugin call
+		unsigned int budgetMs;
+
+		/// The number of consecutive overruns before quarantine
+		unsigned int quarantineCount;
+
+		/// Protects the worker map
+		mutex lock;
+
+		/// The workers, keyed by the object they poll
+		map<aura_object_instance_t*, worker_t*> workers;
+
+		/// Set to ask the watchdog to stop
+		bool watchdogStopping;
+
+		/// Signalled to wake the watchdog up early
+		condition_variable watchdogWake;
+
+		/// The watchdog thread
+		thread watchdogThread;
+};
+
+#endif
@@ -0,0 +1,147 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef STREAMSERVER_H_INCLUDED
+#define STREAMSERVER_H_INCLUDED
+
+// Includes:
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define STREAM_SERVER_MAX_CLIENTS    16
+#define STREAM_SERVER_MAX_REQUEST    8192
+#define STREAM_SERVER_BOUNDARY       "auraframe"
+
+/// The StreamServer class serves the display as a Motion JPEG stream over HTTP,
+/// which browsers, media players and renderers on other screens can show. It
+/// runs on a thread of its own and never blocks on a client: each client is
+/// sent the newest frame once it has taken the last, so a slow client skips
+/// frames instead of falling behind or holding up the others.
+/// @author Clayton Peters
+class StreamServer
+{
+	public:
+		/// Constructs a new StreamServer object, listening on every address.
+		/// Throws an AuraException if the port can't be listened on
+		/// @param port The port to listen on
+		StreamServer(unsigned short port);
+
+		/// Destroys a StreamServer object, disconnecting every client
+		~StreamServer();
+
+		/// Makes a frame the newest, to be sent to every client. Frames can
+		/// finish encoding out of order, so one older than the newest is
+		/// dropped
+		/// @param data The JPEG data, allocated with malloc(), which the
+		/// server takes ownership of
+		/// @param length The length of the data in bytes
+		/// @param sequence The number of the captured frame it came from
+		void publish(unsigned char* data, size_t length, unsigned long long sequence);
+
+		/// Gets the port being listened on
+		unsigned short getPort() const;
+
+		/// Gets the number of clients being streamed to
+		size_t getClientCount() const;
+
+		/// Gets the number of frames sent, to every client
+		unsigned long long getSentCount() const;
+
+		/// Gets the number of frames clients skipped because they were busy
+		unsigned long long getSkippedCount() const;
+
+	private:
+		/// An encoded frame, shared between the clients sending it
+		typedef struct stream_frame_t
+		{
+			/// The JPEG data, allocated with malloc()
+			unsigned char* data;
+			size_t length;
+
+			/// The order the frame was published in
+			unsigned long long serial;
+
+			/// The number of the captured frame it came from
+			unsigned long long sequence;
+
+			~stream_frame_t();
+		} stream_frame_t;
+
+		/// A connected client
+		typedef struct client_t
+		{
+			/// The socket
+			int socket;
+
+			/// The request received so far, until it is complete
+			string request;
+
+			/// Whether the request has been answered with the stream
+			bool streaming;
+
+			/// Text waiting to be sent ahead of the frame, and how much of
+			/// it has been
+			string pending;
+			size_t pendingSent;
+
+			/// The frame being sent, and how much of it has been
+			shared_ptr<stream_frame_t> frame;
+			size_t frameSent;
+
+			/// The serial number of the last frame sent
+			unsigned long long lastSerial;
+		} client_t;
+
+		/// Entry point for the server thread
+		void serverMain();
+
+		/// Reads from a client
+		/// @returns false if the client should be disconnected
+		bool readClient(client_t& client);
+
+		/// Sends what's waiting to a client
+		/// @returns false if the client should be disconnected
+		bool writeClient(client_t& client);
+
+		/// Starts sending the newest frame to a client, if it has finished
+		/// the last and there is a newer one
+		void nextFrame(client_t& client);
+
+		/// The port being listened on
+		unsigned short port;
+
+		/// The listening socket
+		int listenSocket;
+
+		/// A pipe written to to wake the server thread
+		int wakePipe[2];
+
+		/// The server thread, and the flag that stops it
+		thread serverThread;
+		atomic<bool> stopping;
+
+		/// Protects the newest frame
+		mutex lock;
+
+		/// The newest frame
+		shared_ptr<stream_frame_t> latest;
+		unsigned long long publishedCount;
+
+		/// The clients, only touched by the server thread
+		vector<client_t> clients;
+
+		/// Statistics
+		atomic<size_t> clientCount;
+		atomic<unsigned long long> sentCount, skippedCount;
+};
+
+#endif
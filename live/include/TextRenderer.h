@@ -0,0 +1,169 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef TEXTRENDERER_H_INCLUDED
+#define TEXTRENDERER_H_INCLUDED
+
+// Includes:
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <list>
+#include <vector>
+#include "OpenGL.h"
+#include "ShaderProgram.h"
+#include "GlyphAtlas.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define TEXT_DEFAULT_FONT        "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+#define TEXT_DEFAULT_RUN_CACHE   512
+
+/// The TextRenderer class draws blocks of text using glyphs from a GlyphAtlas.
+/// Laying out a string (mapping characters to glyphs, kerning and wrapping)
+/// and building its vertices only happens the first time it is seen: the
+/// result is kept in an LRU cache of runs keyed by a hash of the string, font,
+/// size and wrap width, each with its own vertex buffer, so text that is
+/// already on screen costs a single draw call per frame. A run is only rebuilt
+/// when a shelf of the atlas that its glyphs were on has been evicted.
+/// @author Clayton Peters
+class TextRenderer
+{
+	public:
+		/// Constructs a new TextRenderer object. A GL context must be current
+		/// @param _runCacheSize The maximum number of runs to keep
+		TextRenderer(size_t _runCacheSize = TEXT_DEFAULT_RUN_CACHE);
+
+		/// Destroys a TextRenderer object, its runs and its fonts
+		~TextRenderer();
+
+		/// Starts a new frame
+		/// @param _viewportWidth The width of the viewport in pixels
+		/// @param _viewportHeight The height of the viewport in pixels
+		void beginFrame(int _viewportWidth, int _viewportHeight);
+
+		/// Draws a block of text
+		/// @param text The UTF-8 encoded text
+		/// @param fontPath The font file to use, or empty for the default
+		/// @param pixelSize The size of the font in pixels
+		/// @param x The left of the text block
+		/// @param y The top of the text block
+		/// @param wrapWidth The width to wrap lines at, or zero not to wrap
+		void draw(const char* text, const string& fontPath, unsigned int pixelSize, float x, float y, float wrapWidth, float r, float g, float b, float a);
+
+		/// Measures the height of a block of text, without drawing it
+		/// @param text The UTF-8 encoded text
+		/// @param fontPath The font file to use, or empty for the default
+		/// @param pixelSize The size of the font in pixels
+		/// @param wrapWidth The width to wrap lines at, or zero not to wrap
+		/// @returns The height of the block in pixels
+		float measure(const char* text, const string& fontPath, unsigned int pixelSize, float wrapWidth);
+
+		/// Gets the glyph atlas
+		const GlyphAtlas& getAtlas() const;
+
+		/// Gets the number of draws that found their run in the cache
+		unsigned long long getRunHits() const;
+
+		/// Gets the number of draws that had to lay out their text
+		unsigned long long getRunMisses() const;
+
+	private:
+		/// A laid-out block of text, ready to draw
+		typedef struct text_run_t
+		{
+			/// The key this run is cached under, and what it was made from
+			unsigned long long key;
+			string text, fontPath;
+			unsigned int pixelSize;
+			int wrapWidth;
+
+			/// The vertex array and buffer holding the glyph quads
+			GLuint vertexArray, vertexBuffer;
+
+			/// The number of vertices to draw
+			GLsizei vertexCount;
+
+			/// Whether the vertices have been built
+			bool built;
+
+			/// The atlas shelves the glyphs are on, to keep them from being
+			/// evicted whilst the run is on screen, and the generations of
+			/// the shelves the texture coordinates are valid for
+			vector<int> shelves;
+			vector<unsigned int> shelfGenerations;
+
+			/// Where the run is in the LRU list
+			list<text_run_t*>::iterator lruPosition;
+		} text_run_t;
+
+		/// A loaded font file
+		typedef struct font_t
+		{
+			/// The FreeType face
+			FT_Face face;
+
+			/// A unique identifier for the face, for the atlas
+			unsigned int id;
+
+			/// The pixel size the face is currently set to
+			unsigned int pixelSize;
+		} font_t;
+
+		/// Gets a font, loading it if necessary, and sets its pixel size
+		/// @returns The font, or NULL if it couldn't be loaded
+		font_t* getFont(const string& fontPath, unsigned int pixelSize);
+
+		/// Lays out text and (re)builds the vertices of a run
+		/// @returns false if the run has no glyphs
+		bool buildRun(text_run_t* run, const char* text, font_t* font, unsigned int pixelSize, float wrapWidth);
+
+		/// Determines whether a run's texture coordinates are still valid,
+		/// i.e. none of the shelves its glyphs are on have been evicted
+		bool isRunCurrent(const text_run_t* run) const;
+
+		/// Deletes a run
+		void deleteRun(text_run_t* run);
+
+		/// Deletes the least-recently-used run
+		void evictRun();
+
+		/// The FreeType library
+		FT_Library library;
+
+		/// The loaded fonts, keyed by path
+		map<string, font_t> fonts;
+
+		/// The atlas the glyphs are stored in
+		GlyphAtlas atlas;
+
+		/// The shader for drawing runs
+		ShaderProgram program;
+
+		/// Attribute and uniform locations
+		GLint positionAttribute, texCoordAttribute;
+		GLint viewportUniform, offsetUniform, colourUniform, atlasUniform;
+
+		/// The cached runs, keyed by a hash of the string, font, size and
+		/// wrap width
+		unordered_map<unsigned long long, text_run_t*> runs;
+
+		/// The cached runs, most recently used first
+		list<text_run_t*> runLru;
+
+		/// The maximum number of runs to keep
+		size_t runCacheSize;
+
+		/// The viewport size
+		int viewportWidth, viewportHeight;
+
+		/// Statistics
+		unsigned long long runHits, runMisses;
+};
+
+#endif
@@ -0,0 +1,27 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef TRACESPAN_H_INCLUDED
+#define TRACESPAN_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+
+/// The TraceSpan class records a libaura trace span for as long as it is in
+/// scope, so that the span is ended however the scope is left
+/// @author Clayton Peters
+class TraceSpan
+{
+	public:
+		TraceSpan(const char* category, const char* name, const char* detail = NULL) : span(aura_trace_begin(category, name, detail)) {}
+		~TraceSpan() { aura_trace_end(&span); }
+
+	private:
+		TraceSpan(const TraceSpan&);
+		TraceSpan& operator=(const TraceSpan&);
+
+		aura_trace_span_t span;
+};
+
+#endif
@@ -0,0 +1,208 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef TRANSITIONCOMPOSITOR_H_INCLUDED
+#define TRANSITIONCOMPOSITOR_H_INCLUDED
+
+// Includes:
+#include <libaura/aura.h>
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include "OpenGL.h"
+#include "ShaderProgram.h"
+
+// Namespaces:
+using namespace std;
+
+// Definitions:
+#define TRANSITION_FROM            0
+#define TRANSITION_TO              1
+#define TRANSITION_MAX_QUERIES     8
+#define TRANSITION_HISTORY         32
+
+/// Statistics for a single transition
+typedef struct transition_stats_t
+{
+	/// The transition object type, e.g. "fade"
+	string objectType;
+
+	/// The number of frames composited
+	unsigned int frames;
+
+	/// The number of times either item had to be rendered
+	unsigned int captures;
+
+	/// The number of composited frames with a GPU time
+	unsigned int timedFrames;
+
+	/// The total and longest GPU time spent compositing, in milliseconds
+	double totalGpuMs, maxGpuMs;
+} transition_stats_t;
+
+/// The TransitionCompositor class drives transition plugins. The outgoing and
+/// incoming items are rendered in to a pair of framebuffers, and then every
+/// frame of the transition is a single fullscreen pass of the plugin's shader
+/// over the two textures. An item is only rendered again if it changes, so a
+/// transition between two still items costs one pass per frame no matter how
+/// complicated they are. Where the driver supports timer queries, the GPU time
+/// of each pass is measured without stalling, and collected a few frames later.
+/// @author Clayton Peters
+class TransitionCompositor
+{
+	public:
+		/// Constructs a new TransitionCompositor object. A GL context must be
+		/// current
+		TransitionCompositor();
+
+		/// Destroys a TransitionCompositor object and its GL resources
+		~TransitionCompositor();
+
+		/// Starts a transition, ending any that is in progress
+		/// @param plugin The plugin that created the transition object
+		/// @param transition The transition object
+		/// @returns true on success, false if the plugin's shader couldn't be
+		/// built
+		bool start(aura_transition_plugin_t* plugin, aura_object_instance_t* transition);
+
+		/// Determines whether a transition is in progress
+		bool isActive() const;
+
+		/// Gets how far through the transition we are (0 to 1)
+		double getProgress() const;
+
+		/// Advances the transition
+		/// @param timestep The time to advance by, in seconds
+		/// @returns true if the transition has finished
+		bool advance(double timestep);
+
+		/// Ends the transition in progress
+		void finish();
+
+		/// Determines whether an item needs to be rendered in to its
+		/// framebuffer, regardless of whether it has changed
+		/// @param item TRANSITION_FROM or TRANSITION_TO
+		bool needsCapture(int item) const;
+
+		/// Forgets what is in both framebuffers, so that both items are
+		/// rendered again
+		void invalidate();
+
+		/// Binds an item's framebuffer and clears it, ready to render the
+		/// item in to it
+		/// @param item TRANSITION_FROM or TRANSITION_TO
+		/// @param width The width of the display in pixels
+		/// @param height The height of the display in pixels
+		void beginCapture(int item, int width, int height);
+
+		/// Goes back to the framebuffer that was bound before beginCapture()
+		void endCapture();
+
+		/// Draws the current frame of the transition over the whole viewport
+		void draw();
+
+		/// Draws transitions as a plain cross-fade instead of with their
+		/// plugins' shaders, which is cheaper on slow hardware
+		void setSimplified(bool _simplified);
+
+		/// Collects the results of any finished timer queries
+		void collectTimings();
+
+		/// Determines whether the driver can measure GPU times
+		bool isTimingSupported() const;
+
+		/// Gets the statistics of recent transitions, oldest first
+		const deque<transition_stats_t>& getHistory() const;
+
+	private:
+		/// A built transition shader
+		typedef struct shader_t
+		{
+			/// The program
+			ShaderProgram* program;
+
+			/// Uniform locations
+			GLint fromUniform, toUniform, progressUniform, resolutionUniform;
+		} shader_t;
+
+		/// A property of the transition object that is set as a uniform
+		typedef struct property_uniform_t
+		{
+			aura_property_t* property;
+			GLint location;
+		} property_uniform_t;
+
+		/// A timer query waiting for its result
+		typedef struct pending_query_t
+		{
+			/// The query
+			GLuint query;
+
+			/// The serial number of the transition it timed
+			unsigned long long serial;
+		} pending_query_t;
+
+		/// Gets the shader for a transition object, building it if necessary
+		/// @returns The shader, or NULL if it can't be built
+		shader_t* getShader(aura_transition_plugin_t* plugin, aura_object_instance_t* transition);
+
+		/// (Re)creates the framebuffers at the given size
+		void resize(int _width, int _height);
+
+		/// Finds the statistics of a transition by serial number
+		/// @returns The statistics, or NULL if they have left the history
+		transition_stats_t* findStats(unsigned long long serial);
+
+		/// The shaders built so far, keyed by object type. Types whose
+		/// shader failed to build are kept as NULL so we don't retry
+		map<string, shader_t*> shaders;
+
+		/// An empty vertex array object; the quad comes from gl_VertexID
+		GLuint vertexArray;
+
+		/// The framebuffers and their textures, one for each item
+		GLuint framebuffers[2], textures[2];
+
+		/// The size of the framebuffers
+		int width, height;
+
+		/// Whether each framebuffer holds a rendering of its item
+		bool captured[2];
+
+		/// The framebuffer, viewport and clear colour to go back to after a
+		/// capture
+		GLint previousFramebuffer, previousViewport[4];
+		GLfloat previousClearColour[4];
+
+		/// The cross-fade used when simplified, built on first use
+		shader_t* simpleShader;
+		bool simplified;
+
+		/// The transition in progress
+		aura_object_instance_t* transition;
+		shader_t* shader;
+		vector<property_uniform_t> propertyUniforms;
+		bool active;
+		double progress, duration;
+
+		/// The serial number of the transition in progress
+		unsigned long long serial;
+
+		/// Whether the driver supports timer queries
+		bool timingSupported;
+
+		/// Timer queries that aren't in use
+		vector<GLuint> freeQueries;
+
+		/// Timer queries waiting for results, oldest first
+		deque<pending_query_t> pendingQueries;
+
+		/// Statistics of recent transitions, and the serial number of the
+		/// first of them
+		deque<transition_stats_t> history;
+		unsigned long long historySerial;
+};
+
+#endif
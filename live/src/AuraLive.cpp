@@ -6,69 +6,1345 @@
 #include "AuraLive.h"
 #include "AuraException.h"
 #include "Log.h"
-#include <GL/gl.h>
+#include "OpenGL.h"
+#include "TraceSpan.h"
+#include <stdio.h>
 
 /// Single static global instance (singleton)
 AuraLive* AuraLive::globalInstance = NULL;
 
 /// Private constructor. Constructs a new AuraLive object
-AuraLive::AuraLive(string pluginPath) :
+AuraLive::AuraLive(string pluginPath, bool headless, bool windowed, int width, int height, int outputCount) :
 	pluginLoader(pluginPath),
-	mainWindow(NULL),
-	mainContext(NULL)
+	mainContext(NULL),
+	canvasWidth(0),
+	canvasHeight(0),
+	viewX(0),
+	viewY(0),
+	viewWidth(0),
+	viewHeight(0),
+	cullToView(false),
+	headlessContext(NULL),
+	running(false),
+	vsyncEnabled(false),
+	animationTime(0.0),
+	scaledTarget(NULL),
+	batchRenderer(NULL),
+	textRenderer(NULL),
+	gradientRenderer(NULL),
+	imageCache(NULL),
+	transitionCompositor(NULL),
+	transitionFrom(NULL),
+	transitionTo(NULL),
+	capturingNode(NULL),
+	benchmark(NULL),
+	moderationFeed(NULL),
+	frameCapture(NULL),
+	frameEncoder(NULL),
+	streamServer(NULL)
+{
+	if (headless)
+	{
+		// No window and no vsync: frames are rendered back to back and
+		// timed against a nominal 60Hz display
+		LOG(LOG_DEBUG, "AuraLive::AuraLive: Creating %dx%d offscreen context", width, height);
+		headlessContext = new HeadlessContext(width, height);
+		headlessContext->getSize(canvasWidth, canvasHeight);
+		frameStats.setVsyncInterval(1.0 / 60.0);
+	}
+	else
+	{
+		createOutputs(windowed, width, height, outputCount);
+	}
+
+	// Set up the renderers
+	batchRenderer = new BatchRenderer();
+	textRenderer = new TextRenderer();
+	gradientRenderer = new GradientRenderer();
+	imageCache = new ImageCache();
+	transitionCompositor = new TransitionCompositor();
+	scaledTarget = new ScaledRenderTarget();
+	qualityController.setBudget(frameStats.getVsyncInterval());
+	createMetrics();
+
+	glClearColor(1.0, 0.0, 0.0, 1.0);
+	if (headlessContext != NULL)
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+	for (auto output : outputs)
+	{
+		SDL_GL_MakeCurrent(output->getWindow(), mainContext);
+		glClear(GL_COLOR_BUFFER_BIT);
+		SDL_GL_SwapWindow(output->getWindow());
+	}
+}
+
+/// Creates the SDL windows and the OpenGL context they share
+void AuraLive::createOutputs(bool windowed, int width, int height, int outputCount)
 {
 	// Initialise SDL
-	log(LOG_DEBUG, "AuraLive::AuraLive: Initialising SDL");
+	LOG(LOG_DEBUG, "AuraLive::createOutputs: Initialising SDL");
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 	{
 		throw AuraException(AURA_ERR_SDLINITFAILED, SDL_GetError());
 	}
 
-	// Set OpenGL 3.2
+	// Set OpenGL 3.2. Every window is created with the same attributes so
+	// that the one context can draw on all of them
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 
-	// Create the main window
-	log(LOG_DEBUG, "AuraLive::AuraLive: Creating main window");
-	mainWindow = SDL_CreateWindow("Aura Live!", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 640, 480, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
-	if (mainWindow == NULL)
+	// Filling the screen, there can't be more outputs than displays
+	int displayCount = SDL_GetNumVideoDisplays();
+	if (!windowed && displayCount > 0 && outputCount > displayCount)
+	{
+		LOG(LOG_WARN, "AuraLive::createOutputs: Only %d displays are connected, using %d outputs instead of %d", displayCount, displayCount, outputCount);
+		outputCount = displayCount;
+	}
+	if (outputCount < 1)
+	{
+		outputCount = 1;
+	}
+
+	// Create the windows
+	for (int i = 0; i < outputCount; i++)
 	{
-		throw AuraException(AURA_ERR_SDLWINDOWFAILED, SDL_GetError());
+		outputs.push_back(new Output(i, windowed, width, height));
 	}
 
-	// Create the OpenGL context
-	log(LOG_DEBUG, "AuraLive::AuraLive: Creating OpenGL 3.2 context");
-	mainContext = SDL_GL_CreateContext(mainWindow);
+	// Create the OpenGL context. Rather than a context per window with
+	// shared objects (which wouldn't share vertex arrays or framebuffers)
+	// there is a single context, made current on each window in turn, so
+	// every texture, glyph atlas and buffer is uploaded once
+	LOG(LOG_DEBUG, "AuraLive::createOutputs: Creating OpenGL 3.2 context");
+	mainContext = SDL_GL_CreateContext(outputs[0]->getWindow());
 	if (mainContext == NULL)
 	{
 		throw AuraException(AURA_ERR_SDLGLCONTEXTFAILED, SDL_GetError());
 	}
 
-	glClearColor(1.0, 0.0, 0.0, 1.0);
-	glClear(GL_COLOR_BUFFER_BIT);
-	SDL_GL_SwapWindow(mainWindow);
+	// Only the first output waits for vsync, otherwise each swap would wait
+	// for its own and the frame rate would drop with every output added
+	for (size_t i = 1; i < outputs.size(); i++)
+	{
+		SDL_GL_MakeCurrent(outputs[i]->getWindow(), mainContext);
+		SDL_GL_SetSwapInterval(0);
+	}
+	SDL_GL_MakeCurrent(outputs[0]->getWindow(), mainContext);
+
+	// Synchronise swaps to vsync. If the driver won't do it then the frame
+	// loop will pace itself instead
+	vsyncEnabled = SDL_GL_SetSwapInterval(1) == 0;
+	if (!vsyncEnabled)
+	{
+		LOG(LOG_WARN, "AuraLive::createOutputs: Failed to enable vsync, frames will be paced by timer: %s", SDL_GetError());
+	}
+	frameStats.setVsyncInterval(getDisplayVsyncInterval());
+	LOG(LOG_DEBUG, "AuraLive::createOutputs: Vsync interval is %.2fms", frameStats.getVsyncInterval() * 1000.0);
+
+	layoutOutputs();
+}
+
+/// Places the outputs side by side on the canvas and works out its size, after
+/// the outputs are created or resized
+void AuraLive::layoutOutputs()
+{
+	canvasWidth = canvasHeight = 0;
+	for (auto output : outputs)
+	{
+		int width, height;
+		output->getDrawableSize(width, height);
+		output->setCanvasPosition(canvasWidth, 0);
+		canvasWidth += width;
+		if (height > canvasHeight)
+		{
+			canvasHeight = height;
+		}
+	}
+	LOG(LOG_DEBUG, "AuraLive::layoutOutputs: Canvas is %dx%d over %zu outputs", canvasWidth, canvasHeight, outputs.size());
 }
 
 /// Destroys an AuraLive object
 AuraLive::~AuraLive()
 {
-	// Tidy up context and window
+	// Stop serving metrics before the things they come from go
+	aura_metrics_stop_serving();
+
+	if (benchmark != NULL)
+	{
+		delete benchmark;
+	}
+	if (moderationFeed != NULL)
+	{
+		delete moderationFeed;
+	}
+	for (auto layout : layouts)
+	{
+		delete layout;
+	}
+
+	// The encoder has to let go of the capture's buffers before they go
+	if (frameEncoder != NULL)
+	{
+		frameEncoder->stop();
+	}
+	if (frameCapture != NULL)
+	{
+		delete frameCapture;
+	}
+	if (frameEncoder != NULL)
+	{
+		delete frameEncoder;
+	}
+	if (streamServer != NULL)
+	{
+		delete streamServer;
+	}
+
+	// Tidy up renderers whilst the context still exists
+	if (scaledTarget != NULL)
+	{
+		delete scaledTarget;
+	}
+	if (transitionCompositor != NULL)
+	{
+		delete transitionCompositor;
+	}
+
+	// The transition objects can go once the compositor isn't using them
+	for (auto& transitionPair : transitionObjects)
+	{
+		aura_plugin_t* plugin = pluginLoader.getPluginFor(AURA_PLUGIN_TYPE_TRANSITION, transitionPair.first);
+		if (plugin != NULL && plugin->destroy != NULL)
+		{
+			plugin->destroy(transitionPair.second);
+		}
+	}
+	transitionObjects.clear();
+	if (imageCache != NULL)
+	{
+		delete imageCache;
+	}
+	if (gradientRenderer != NULL)
+	{
+		delete gradientRenderer;
+	}
+	if (textRenderer != NULL)
+	{
+		delete textRenderer;
+	}
+	if (batchRenderer != NULL)
+	{
+		delete batchRenderer;
+	}
+	if (headlessContext != NULL)
+	{
+		delete headlessContext;
+	}
+
+	// Tidy up context and windows
 	if (mainContext != NULL)
 	{
 		SDL_GL_DeleteContext(mainContext);
 	}
-	if (mainWindow != NULL)
+	for (auto output : outputs)
 	{
-		SDL_DestroyWindow(mainWindow);
+		delete output;
 	}
 
 	// Tidy up SDL
 	SDL_Quit();
 }
 
-AuraLive& AuraLive::initInstance(string pluginPath)
+/// Runs the frame loop until quit() is called or the window is closed
+/// @param maxFrames Stop after this many frames have been rendered, or zero to
+/// run forever
+void AuraLive::run(unsigned long long maxFrames)
+{
+	const double frequency = (double)SDL_GetPerformanceFrequency();
+	Uint64 previousFrame = SDL_GetPerformanceCounter();
+	double accumulator = 0.0;
+	double sinceStatsLog = 0.0;
+	double sinceMetrics = 0.0;
+	bool previousRendered = false;
+
+	LOG(LOG_DEBUG, "AuraLive::run: Starting frame loop");
+	aura_trace_set_thread_name("render");
+	running = true;
+	while (running)
+	{
+		TraceSpan frameSpan("frame", "frame");
+		if (headlessContext == NULL)
+		{
+			processEvents();
+		}
+
+		// Work out how long the last frame took. If we've stalled (e.g.
+		// whilst being dragged) then clamp it so we don't spend ages
+		// catching up on updates. The stats are given the time as
+		// measured, so that the stall still shows up in them
+		Uint64 thisFrame = SDL_GetPerformanceCounter();
+		double measuredFrameTime = (thisFrame - previousFrame) / frequency;
+		double frameTime = measuredFrameTime;
+		previousFrame = thisFrame;
+		if (frameTime > AURA_MAX_FRAME_TIME)
+		{
+			frameTime = AURA_MAX_FRAME_TIME;
+		}
+
+		// Offscreen, animate as if every frame were exactly one display
+		// interval apart so that runs (and dumped frames) are repeatable
+		if (headlessContext != NULL)
+		{
+			frameTime = frameStats.getVsyncInterval();
+		}
+
+		// Advance animations on a fixed timestep, independent of the
+		// rate at which we render
+		accumulator += frameTime;
+		if (accumulator >= AURA_UPDATE_TIMESTEP)
+		{
+			TraceSpan span("frame", "update");
+			while (accumulator >= AURA_UPDATE_TIMESTEP)
+			{
+				update(AURA_UPDATE_TIMESTEP);
+				accumulator -= AURA_UPDATE_TIMESTEP;
+			}
+		}
+
+		// Keep images streaming on to the GPU, even when we're not drawing,
+		// and redraw once one is ready
+		{
+			TraceSpan span("frame", "upload images");
+			if (imageCache->update())
+			{
+				scene.markDirty();
+				transitionCompositor->invalidate();
+			}
+		}
+
+		// Hand over captured frames as soon as they're read back
+		if (frameCapture != NULL)
+		{
+			TraceSpan span("frame", "collect captures");
+			frameCapture->update();
+		}
+
+		// Only draw and swap if something visible has changed. Offscreen
+		// we always draw, as we're there to measure it
+		bool rendered = headlessContext != NULL || scene.needsRedraw();
+		if (rendered)
+		{
+			render();
+			if (headlessContext != NULL)
+			{
+				TraceSpan span("frame", "finish");
+				headlessContext->finish();
+			}
+			scene.clearDirty();
+		}
+		double workTime = (SDL_GetPerformanceCounter() - thisFrame) / frequency;
+
+		// Publish what only the frame loop knows now and again, so that
+		// scraping the metrics never has to wait on it
+		sinceMetrics += frameTime;
+		if (sinceMetrics >= AURA_METRICS_INTERVAL)
+		{
+			publishMetrics();
+			sinceMetrics = 0.0;
+		}
+
+		// Offscreen, the frame time is the time spent producing the frame
+		// rather than the time between frames, and nothing sleeps
+		if (headlessContext != NULL)
+		{
+			frameStats.addFrame(workTime);
+			aura_metric_observe(metrics.frameSeconds, workTime);
+			if (qualityController.addFrame(workTime, workTime))
+			{
+				applyQuality();
+			}
+			if (!frameDumpPath.empty())
+			{
+				char filename[32];
+				snprintf(filename, sizeof(filename), "/frame-%06llu.png", frameStats.getTotalFrames());
+				TraceSpan span("frame", "save frame");
+				headlessContext->saveFrame(frameDumpPath + filename);
+			}
+			if (maxFrames > 0 && frameStats.getTotalFrames() >= maxFrames)
+			{
+				quit();
+			}
+			continue;
+		}
+
+		// If the driver isn't pacing us (or we didn't swap, so it couldn't)
+		// then sleep until the next interval
+		if (!vsyncEnabled || !rendered)
+		{
+			double spent = (SDL_GetPerformanceCounter() - thisFrame) / frequency;
+			if (spent < frameStats.getVsyncInterval())
+			{
+				TraceSpan span("frame", "sleep");
+				SDL_Delay((Uint32)((frameStats.getVsyncInterval() - spent) * 1000.0));
+			}
+		}
+
+		// Only time consecutive presented frames, as the gap after an idle
+		// spell isn't a pacing problem
+		if (rendered)
+		{
+			frameStats.addFrame(measuredFrameTime, previousRendered);
+			if (previousRendered)
+			{
+				aura_metric_observe(metrics.frameSeconds, measuredFrameTime);
+			}
+			if (previousRendered && qualityController.addFrame(measuredFrameTime, workTime))
+			{
+				applyQuality();
+			}
+		}
+		else
+		{
+			frameStats.addIdleFrame();
+		}
+		previousRendered = rendered;
+		if (maxFrames > 0 && frameStats.getTotalFrames() >= maxFrames)
+		{
+			quit();
+		}
+		sinceStatsLog += frameTime;
+		if (sinceStatsLog >= AURA_STATS_LOG_INTERVAL)
+		{
+			frameStats.log(LOG_DEBUG);
+			sinceStatsLog = 0.0;
+		}
+	}
+
+	publishMetrics();
+	frameStats.log(LOG_INFO);
+	for (auto& change : frameStats.getQualityChanges())
+	{
+		LOG(LOG_INFO, "AuraLive::run: Quality changed from %d to %d at frame %llu (mean %.2fms, p99 %.2fms)", change.fromLevel, change.toLevel, change.frame, change.meanFrameTime * 1000.0, change.p99FrameTime * 1000.0);
+	}
+	LOG(LOG_INFO, "AuraLive::run: Last frame drew %u quads in %u draw calls", batchRenderer->getQuadCount(), batchRenderer->getDrawCalls());
+	LOG(LOG_INFO, "AuraLive::run: Text runs: %llu cached, %llu laid out; glyphs: %llu rasterised, %llu atlas evictions", textRenderer->getRunHits(), textRenderer->getRunMisses(), textRenderer->getAtlas().getRasterisedCount(), textRenderer->getAtlas().getEvictionCount());
+	LOG(LOG_INFO, "AuraLive::run: Images: %llu decoded, %.1fMB uploaded, %llu page evictions, %llu prefetched, %llu cancelled, %.0fms average load", imageCache->getDecodedCount(), imageCache->getUploadedBytes() / (1024.0 * 1024.0), imageCache->getEvictionCount(), imageCache->getPrefetchCount(), imageCache->getCancelCount(), imageCache->getAverageLatency() * 1000.0);
+	for (auto layout : layouts)
+	{
+		const Prefetcher& prefetcher = layout->getPrefetcher();
+		LOG(LOG_INFO, "AuraLive::run: Layout: %zu items, %llu measured, %llu arranged in %llu passes, %zu of %zu element sets live", layout->getItemCount(), layout->getMeasureCount(), layout->getArrangedItemCount(), layout->getArrangeCount(), layout->getLiveViewCount(), layout->getViewCount());
+		LOG(LOG_INFO, "AuraLive::run: Layout: prefetching %zu ahead, %llu images ready when shown, %llu late", prefetcher.getDepth(), prefetcher.getHitCount(), prefetcher.getMissCount());
+	}
+	if (moderationFeed != NULL)
+	{
+		LOG(LOG_INFO, "AuraLive::run: Moderation queue: %zu items replayed, %llu received, %s", moderationFeed->getReplayedCount(), moderationFeed->getReceivedCount(), moderationFeed->isConnected() ? "connected" : "not connected");
+	}
+	if (frameCapture != NULL)
+	{
+		LOG(LOG_INFO, "AuraLive::run: Stream capture: %llu frames, %llu dropped, render thread %.3fms average, %.3fms max, GPU %.3fms average, %.3fms max", frameCapture->getCapturedCount(), frameCapture->getDroppedCount(), frameCapture->getAverageCpuMs(), frameCapture->getMaxCpuMs(), frameCapture->getAverageGpuMs(), frameCapture->getMaxGpuMs());
+		LOG(LOG_INFO, "AuraLive::run: Stream encoding: %llu frames, %.2fms average, %.2fms max, %.1fKB average, %.1fms from capture; %zu clients, %llu frames sent, %llu skipped", frameEncoder->getEncodedCount(), frameEncoder->getAverageEncodeMs(), frameEncoder->getMaxEncodeMs(), frameEncoder->getAverageFrameBytes() / 1024.0, frameEncoder->getAverageLatencyMs(), streamServer->getClientCount(), streamServer->getSentCount(), streamServer->getSkippedCount());
+	}
+	transitionCompositor->collectTimings();
+	for (auto& stats : transitionCompositor->getHistory())
+	{
+		LOG(LOG_INFO, "AuraLive::run: Transition '%s': %u frames, %u captures, GPU %.3fms average, %.3fms max", stats.objectType.c_str(), stats.frames, stats.captures, stats.timedFrames > 0 ? stats.totalGpuMs / stats.timedFrames : 0.0, stats.maxGpuMs);
+	}
+	LOG(LOG_DEBUG, "AuraLive::run: Frame loop finished");
+}
+
+/// Asks the frame loop to stop after the current frame
+void AuraLive::quit()
+{
+	running = false;
+}
+
+/// Gets the frame pacing statistics
+const FrameStats& AuraLive::getFrameStats() const
+{
+	return frameStats;
+}
+
+/// Gets the quad batch renderer
+BatchRenderer& AuraLive::getBatchRenderer()
+{
+	return *batchRenderer;
+}
+
+/// Gets the text renderer
+TextRenderer& AuraLive::getTextRenderer()
+{
+	return *textRenderer;
+}
+
+/// Gets the image cache
+ImageCache& AuraLive::getImageCache()
+{
+	return *imageCache;
+}
+
+/// Gets the size of the drawable area of the display in pixels. With several
+/// outputs this is the size of the canvas they show, with the outputs side by
+/// side from left to right
+void AuraLive::getDrawableSize(int& width, int& height)
+{
+	width = canvasWidth;
+	height = canvasHeight;
+}
+
+/// Lets the quality level follow how well frames keep up with the display, or
+/// fixes it where it is
+void AuraLive::setAdaptiveQuality(bool adaptive)
+{
+	qualityController.setAdaptive(adaptive);
+}
+
+/// Sets the quality level, from 0 (full quality) to QUALITY_LEVEL_COUNT - 1
+void AuraLive::setQualityLevel(int level)
+{
+	qualityController.setLevel(level);
+	applyQuality();
+}
+
+/// Puts the settings of the current quality level in to effect
+void AuraLive::applyQuality()
+{
+	int level = qualityController.getLevel();
+	if (level == frameStats.getQualityLevel())
+	{
+		return;
+	}
+
+	const quality_level_t& settings = qualityController.getSettings();
+	LOG(LOG_INFO, "AuraLive::applyQuality: Quality level %d -> %d (%s) after %llu frames", frameStats.getQualityLevel(), level, settings.name, frameStats.getTotalFrames());
+	frameStats.addQualityChange(frameStats.getQualityLevel(), level);
+	transitionCompositor->setSimplified(settings.simpleTransitions);
+	scene.markDirty();
+}
+
+/// Gets the number of outputs
+size_t AuraLive::getOutputCount() const
+{
+	// Offscreen there's a single output filling the canvas
+	return headlessContext != NULL ? 1 : outputs.size();
+}
+
+/// Gets where an output is on the canvas and its size, so that content can be
+/// placed on a particular screen
+/// @param index The number of the output, from zero
+/// @returns true on success, false if there is no such output
+bool AuraLive::getOutputGeometry(size_t index, int& x, int& y, int& width, int& height) const
+{
+	if (index >= getOutputCount())
+	{
+		return false;
+	}
+
+	if (headlessContext != NULL)
+	{
+		x = y = 0;
+		headlessContext->getSize(width, height);
+		return true;
+	}
+
+	outputs[index]->getCanvasPosition(x, y);
+	outputs[index]->getDrawableSize(width, height);
+	return true;
+}
+
+/// Saves every rendered frame as a numbered PNG. Only available when headless
+/// @param directory The directory to save in, or empty to stop
+void AuraLive::setFrameDump(const string& directory)
+{
+	if (headlessContext == NULL && !directory.empty())
+	{
+		LOG(LOG_WARN, "AuraLive::setFrameDump: Frames can only be saved when headless");
+		return;
+	}
+
+	frameDumpPath = directory;
+}
+
+/// Replaces the scene with one of the built-in benchmark scenes
+/// @param name The name of the benchmark scene, e.g. "quads"
+/// @returns true if the scene was built, false otherwise
+bool AuraLive::setBenchmark(const string& name)
+{
+	BenchmarkScene* newBenchmark = BenchmarkScene::create(name);
+	if (newBenchmark == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::setBenchmark: Unknown benchmark scene '%s'", name.c_str());
+		return false;
+	}
+
+	// Throw away whatever is in the scene at the moment
+	if (transitionCompositor->isActive())
+	{
+		endTransition();
+	}
+	for (auto layout : layouts)
+	{
+		delete layout;
+	}
+	layouts.clear();
+	while (!scene.getChildren().empty())
+	{
+		SceneNode* child = scene.getChildren().back();
+		scene.removeChild(child);
+		delete child;
+	}
+	if (benchmark != NULL)
+	{
+		delete benchmark;
+	}
+	if (moderationFeed != NULL)
+	{
+		delete moderationFeed;
+		moderationFeed = NULL;
+	}
+	benchmark = newBenchmark;
+
+	LOG(LOG_INFO, "AuraLive::setBenchmark: Building benchmark scene '%s'", name.c_str());
+	return benchmark->setup(*this);
+}
+
+/// Shows the items approved in the filter tool, in a list down the display, as
+/// they arrive through a moderation queue
+/// @param name The name of the moderation queue
+/// @param journalPath A file to keep the items in, so they are shown again
+/// straight away after a restart, or empty not to
+/// @returns true if the list was created, false otherwise
+bool AuraLive::setModerationQueue(const string& name, const string& journalPath)
+{
+	LayoutEngine* layout = createLayout("list");
+	if (layout == NULL)
+	{
+		return false;
+	}
+	layout->setGeometry(0.0f, 0.0f, (float)canvasWidth, (float)canvasHeight);
+
+	if (moderationFeed != NULL)
+	{
+		delete moderationFeed;
+	}
+	moderationFeed = new ModerationFeed(name, layout, journalPath);
+
+	LOG(LOG_INFO, "AuraLive::setModerationQueue: Showing items approved through '%s'", name.c_str());
+	return true;
+}
+
+/// Streams the display over HTTP as Motion JPEG, for showing on other screens.
+/// Frames are read back and encoded without holding up the display
+/// @param port The port to serve the stream on
+/// @param width The width of the stream, or zero for the canvas'. This is
+/// rounded down to a multiple of 16
+/// @param height The height of the stream, or zero for the canvas'
+/// @param frameRate The most frames to stream per second
+/// @returns true if the stream was started, false otherwise
+bool AuraLive::setStream(unsigned short port, int width, int height, double frameRate)
+{
+	if (streamServer != NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::setStream: Already streaming on port %u", streamServer->getPort());
+		return false;
+	}
+
+	// JPEG is encoded sixteen rows at a time, straight from the planes
+	width = (width > 0 ? width : canvasWidth) & ~15;
+	height = (height > 0 ? height : canvasHeight) & ~15;
+	if (width < 16 || height < 16)
+	{
+		LOG(LOG_ERROR, "AuraLive::setStream: Stream must be at least 16x16");
+		return false;
+	}
+
+	try
+	{
+		streamServer = new StreamServer(port);
+		frameEncoder = new FrameEncoder(streamServer);
+		frameCapture = new FrameCapture(width, height, frameRate, frameEncoder);
+	}
+	catch (AuraException& e)
+	{
+		LOG(LOG_ERROR, "AuraLive::setStream: %s", e.what());
+		if (frameEncoder != NULL)
+		{
+			delete frameEncoder;
+			frameEncoder = NULL;
+		}
+		if (streamServer != NULL)
+		{
+			delete streamServer;
+			streamServer = NULL;
+		}
+		return false;
+	}
+
+	LOG(LOG_INFO, "AuraLive::setStream: Streaming %dx%d at up to %.0f frames per second on port %u", width, height, frameRate, port);
+	return true;
+}
+
+/// Serves the display's metrics in the Prometheus text format on a Unix domain
+/// socket, from a thread of libaura's
+/// @param socketPath The file name of the socket
+/// @returns true if the metrics are being served, false otherwise
+bool AuraLive::setMetrics(const string& socketPath)
+{
+	if (!aura_metrics_serve(socketPath.c_str()))
+	{
+		LOG(LOG_ERROR, "AuraLive::setMetrics: Failed to serve metrics on '%s'", socketPath.c_str());
+		return false;
+	}
+
+	LOG(LOG_INFO, "AuraLive::setMetrics: Serving metrics on '%s'", socketPath.c_str());
+	return true;
+}
+
+/// Registers the metrics the display publishes
+void AuraLive::createMetrics()
+{
+	static const double frameBounds[] = { AURA_FRAME_TIME_BUCKETS };
+	metrics.frameSeconds = aura_metric_histogram("aura_frame_seconds", "", "Time between consecutive presented frames (offscreen, time to produce them)", frameBounds, sizeof(frameBounds) / sizeof(frameBounds[0]));
+	metrics.frames = aura_metric_counter("aura_frames_total", "", "Frames rendered");
+	metrics.idleFrames = aura_metric_counter("aura_idle_frames_total", "", "Frames skipped as nothing had changed");
+	metrics.missedVsyncs = aura_metric_counter("aura_missed_vsyncs_total", "", "Display intervals missed by presented frames");
+	metrics.fps = aura_metric_gauge("aura_fps", "", "Frames per second over the recent frames");
+	metrics.frameP50 = aura_metric_gauge("aura_frame_p50_seconds", "", "Median of the recent frame times");
+	metrics.frameP99 = aura_metric_gauge("aura_frame_p99_seconds", "", "99th percentile of the recent frame times");
+	metrics.qualityLevel = aura_metric_gauge("aura_quality_level", "", "Current rendering quality level");
+
+	metrics.textRunHits = aura_metric_counter("aura_text_run_cache_hits_total", "", "Text runs drawn from the run cache");
+	metrics.textRunMisses = aura_metric_counter("aura_text_run_cache_misses_total", "", "Text runs that had to be laid out");
+	metrics.glyphsRasterised = aura_metric_counter("aura_glyphs_rasterised_total", "", "Glyphs rasterised into the atlas");
+	metrics.glyphEvictions = aura_metric_counter("aura_glyph_atlas_evictions_total", "", "Glyph atlas evictions");
+
+	metrics.imagesDecoded = aura_metric_counter("aura_images_decoded_total", "", "Images decoded");
+	metrics.imageUploadBytes = aura_metric_counter("aura_image_upload_bytes_total", "", "Bytes of image data uploaded to the GPU");
+	metrics.imagePageEvictions = aura_metric_counter("aura_image_cache_evictions_total", "", "Image cache pages evicted");
+	metrics.imagePages = aura_metric_gauge("aura_image_cache_pages", "", "Image cache texture pages");
+	metrics.imageCacheBytes = aura_metric_gauge("aura_image_cache_bytes", "", "GPU memory held by the image cache's pages");
+	metrics.imageDecodeQueue = aura_metric_gauge("aura_image_decode_queue_length", "", "Images waiting to be decoded");
+	metrics.prefetchHits = aura_metric_counter("aura_prefetch_hits_total", "", "Images that were ready when their item was shown");
+	metrics.prefetchMisses = aura_metric_counter("aura_prefetch_misses_total", "", "Images that were still loading when their item was shown");
+
+	metrics.moderationReceived = aura_metric_counter("aura_moderation_items_received_total", "", "Items received from the moderation queue");
+	metrics.streamClients = aura_metric_gauge("aura_stream_clients", "", "Clients watching the stream");
+	metrics.streamFramesSent = aura_metric_counter("aura_stream_frames_sent_total", "", "Frames sent to stream clients");
+}
+
+/// Publishes the numbers that are only kept on the render thread. Counters are
+/// set to the running totals kept by each part of the display
+void AuraLive::publishMetrics()
+{
+	double mean = frameStats.getMean();
+	aura_metric_set(metrics.frames, frameStats.getTotalFrames());
+	aura_metric_set(metrics.idleFrames, frameStats.getIdleFrames());
+	aura_metric_set(metrics.missedVsyncs, frameStats.getMissedVsyncs());
+	aura_metric_set(metrics.fps, mean > 0.0 ? 1.0 / mean : 0.0);
+	aura_metric_set(metrics.frameP50, frameStats.getPercentile(50.0));
+	aura_metric_set(metrics.frameP99, frameStats.getPercentile(99.0));
+	aura_metric_set(metrics.qualityLevel, frameStats.getQualityLevel());
+
+	aura_metric_set(metrics.textRunHits, textRenderer->getRunHits());
+	aura_metric_set(metrics.textRunMisses, textRenderer->getRunMisses());
+	aura_metric_set(metrics.glyphsRasterised, textRenderer->getAtlas().getRasterisedCount());
+	aura_metric_set(metrics.glyphEvictions, textRenderer->getAtlas().getEvictionCount());
+
+	aura_metric_set(metrics.imagesDecoded, imageCache->getDecodedCount());
+	aura_metric_set(metrics.imageUploadBytes, imageCache->getUploadedBytes());
+	aura_metric_set(metrics.imagePageEvictions, imageCache->getEvictionCount());
+	aura_metric_set(metrics.imagePages, imageCache->getPageCount());
+	aura_metric_set(metrics.imageCacheBytes, imageCache->getPageCount() * (double)IMAGECACHE_PAGE_SIZE * IMAGECACHE_PAGE_SIZE * 4.0);
+	aura_metric_set(metrics.imageDecodeQueue, imageCache->getDecodeQueueLength());
+
+	unsigned long long prefetchHits = 0, prefetchMisses = 0;
+	for (auto layout : layouts)
+	{
+		prefetchHits += layout->getPrefetcher().getHitCount();
+		prefetchMisses += layout->getPrefetcher().getMissCount();
+	}
+	aura_metric_set(metrics.prefetchHits, prefetchHits);
+	aura_metric_set(metrics.prefetchMisses, prefetchMisses);
+
+	if (moderationFeed != NULL)
+	{
+		aura_metric_set(metrics.moderationReceived, moderationFeed->getReceivedCount());
+	}
+	if (streamServer != NULL)
+	{
+		aura_metric_set(metrics.streamClients, streamServer->getClientCount());
+		aura_metric_set(metrics.streamFramesSent, streamServer->getSentCount());
+	}
+}
+
+/// Handles any pending SDL events
+void AuraLive::processEvents()
+{
+	SDL_Event event;
+	while (SDL_PollEvent(&event))
+	{
+		switch (event.type)
+		{
+			case SDL_QUIT:
+				quit();
+				break;
+			case SDL_KEYDOWN:
+				if (event.key.keysym.sym == SDLK_ESCAPE)
+				{
+					quit();
+				}
+				break;
+			case SDL_WINDOWEVENT:
+				// With several windows, closing one doesn't send SDL_QUIT
+				if (event.window.event == SDL_WINDOWEVENT_CLOSE)
+				{
+					quit();
+				}
+
+				// A resized output moves those to the right of it
+				if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+				{
+					layoutOutputs();
+				}
+
+				// The window contents may have been lost
+				if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+				{
+					scene.markDirty();
+				}
+				break;
+		}
+	}
+}
+
+/// Advances animations by one fixed timestep
+/// @param timestep The time to advance by, in seconds
+void AuraLive::update(double timestep)
+{
+	animationTime += timestep;
+
+	if (benchmark != NULL)
+	{
+		benchmark->update(animationTime);
+	}
+	if (moderationFeed != NULL)
+	{
+		moderationFeed->update(timestep);
+	}
+
+	for (auto layout : layouts)
+	{
+		layout->update(timestep);
+	}
+
+	// Keep drawing until the transition is over
+	if (transitionCompositor->isActive())
+	{
+		if (transitionCompositor->advance(timestep))
+		{
+			endTransition();
+		}
+		else
+		{
+			scene.markDirty();
+		}
+	}
+}
+
+/// Draws a frame
+void AuraLive::render()
+{
+	TraceSpan span("frame", "render");
+	int width, height;
+	getDrawableSize(width, height);
+	textRenderer->beginFrame(width, height);
+	gradientRenderer->beginFrame(width, height);
+	imageCache->beginFrame();
+
+	// Transition items are captured once for the whole canvas, however many
+	// outputs they are shown on
+	if (transitionCompositor->isActive())
+	{
+		TraceSpan transitionSpan("frame", "transition items");
+		renderTransitionItems(width, height);
+	}
+
+	// Each output is grabbed for the stream as it's drawn
+	if (frameCapture != NULL)
+	{
+		frameCapture->beginFrame(width, height);
+	}
+
+	if (headlessContext != NULL)
+	{
+		{
+			TraceSpan viewSpan("frame", "draw output");
+			renderView(0, 0, width, height);
+		}
+		if (frameCapture != NULL)
+		{
+			frameCapture->grabView(0, 0, width, height);
+		}
+	}
+	else
+	{
+		// Draw the first output last: it's the one that waits for vsync,
+		// and it leaves its window current for the next frame
+		for (size_t i = outputs.size(); i-- > 0;)
+		{
+			renderOutput(outputs[i]);
+		}
+	}
+
+	if (frameCapture != NULL)
+	{
+		TraceSpan captureSpan("frame", "capture");
+		frameCapture->endFrame();
+	}
+}
+
+/// Draws the scene on to an output
+void AuraLive::renderOutput(Output* output)
+{
+	int x, y, width, height;
+	SDL_GL_MakeCurrent(output->getWindow(), mainContext);
+	output->getCanvasPosition(x, y);
+	output->getDrawableSize(width, height);
+	cullToView = outputs.size() > 1;
+	{
+		TraceSpan span("frame", "draw output");
+		renderView(x, y, width, height);
+	}
+	cullToView = false;
+	if (frameCapture != NULL)
+	{
+		frameCapture->grabView(x, y, width, height);
+	}
+	TraceSpan span("frame", "swap");
+	SDL_GL_SwapWindow(output->getWindow());
+}
+
+/// Draws the part of the canvas shown by an output in to the current
+/// framebuffer, at the current quality level
+void AuraLive::renderView(int x, int y, int width, int height)
+{
+	viewX = x;
+	viewY = y;
+	viewWidth = width;
+	viewHeight = height;
+
+	// At lower quality the frame is drawn small and stretched to fit
+	float scale = qualityController.getSettings().renderScale;
+	if (scale < 1.0f)
+	{
+		scaledTarget->begin(width, height, scale);
+	}
+
+	// The whole canvas is projected as usual, and the viewport is moved so
+	// that only this output's part of it lands in the window
+	glViewport((GLint)(-x * scale), (GLint)((height + y - canvasHeight) * scale), (GLsizei)(canvasWidth * scale + 0.5f), (GLsizei)(canvasHeight * scale + 0.5f));
+	glClear(GL_COLOR_BUFFER_BIT);
+	batchRenderer->begin(canvasWidth, canvasHeight);
+	renderNode(&scene);
+	batchRenderer->end();
+
+	if (scale < 1.0f)
+	{
+		scaledTarget->end();
+	}
+}
+
+/// Renders the items of the transition in progress in to the compositor's
+/// framebuffers, if they have changed
+void AuraLive::renderTransitionItems(int width, int height)
+{
+	SceneNode* items[2];
+	items[TRANSITION_FROM] = transitionFrom;
+	items[TRANSITION_TO] = transitionTo;
+	for (int i = 0; i < 2; i++)
+	{
+		if (!transitionCompositor->needsCapture(i) && !items[i]->needsRedraw())
+		{
+			continue;
+		}
+
+		float scale = qualityController.getSettings().renderScale;
+		transitionCompositor->beginCapture(i, (int)(width * scale + 0.5f), (int)(height * scale + 0.5f));
+		capturingNode = items[i];
+		batchRenderer->begin(width, height);
+		renderNode(items[i]);
+		batchRenderer->end();
+		capturingNode = NULL;
+		transitionCompositor->endCapture();
+	}
+}
+
+/// Draws a node and its children
+/// @param node The node to draw
+void AuraLive::renderNode(SceneNode* node)
+{
+	if (!node->isVisible())
+	{
+		return;
+	}
+
+	// Transition items are drawn from the compositor's framebuffers, in
+	// place of the outgoing item
+	if ((node == transitionFrom || node == transitionTo) && node != capturingNode)
+	{
+		if (node == transitionFrom)
+		{
+			batchRenderer->flush();
+			transitionCompositor->draw();
+		}
+		return;
+	}
+
+	aura_object_instance_t* object = node->getObject();
+	if (object != NULL && !isCulled(node))
+	{
+		if (strcmp(object->objectType, "colour") == 0)
+		{
+			renderColourNode(node);
+		}
+		else if (strcmp(object->objectType, "gradient") == 0)
+		{
+			renderGradientNode(node);
+		}
+		else if (strcmp(object->objectType, "text") == 0)
+		{
+			renderTextNode(node);
+		}
+		else if (strcmp(object->objectType, "image") == 0)
+		{
+			renderImageNode(node);
+		}
+	}
+
+	for (auto child : node->getChildren())
+	{
+		renderNode(child);
+	}
+}
+
+/// Determines whether an element lies entirely outside the output being drawn,
+/// so that it can be skipped
+bool AuraLive::isCulled(SceneNode* node) const
+{
+	if (!cullToView)
+	{
+		return false;
+	}
+
+	// Elements without a size (e.g. text that grows to fit) are always drawn
+	float x, y, width, height;
+	node->getGeometry(x, y, width, height);
+	if (width > 0.0f && (x + width <= viewX || x >= viewX + viewWidth))
+	{
+		return true;
+	}
+	if (height > 0.0f && (y + height <= viewY || y >= viewY + viewHeight))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+/// Draws a "colour" element
+/// @param node The node holding the element
+void AuraLive::renderColourNode(SceneNode* node)
+{
+	aura_property_color_t* colour = (aura_property_color_t*)node->getProperty("colour");
+	if (colour != NULL)
+	{
+		float x, y, width, height;
+		node->getGeometry(x, y, width, height);
+		batchRenderer->addColourQuad(x, y, width, height, colour->valueR, colour->valueG, colour->valueB, colour->hasAlpha ? colour->valueA : 1.0f);
+	}
+}
+
+/// Draws a "gradient" element
+/// @param node The node holding the element
+void AuraLive::renderGradientNode(SceneNode* node)
+{
+	aura_property_bool_t* radial = (aura_property_bool_t*)node->getProperty("radial");
+	aura_property_float_t* angle = (aura_property_float_t*)node->getProperty("angle");
+	aura_property_int_t* stops = (aura_property_int_t*)node->getProperty("stops");
+	if (stops == NULL)
+	{
+		return;
+	}
+
+	gradient_t gradient;
+	node->getGeometry(gradient.x, gradient.y, gradient.width, gradient.height);
+	gradient.radial = radial != NULL && radial->value;
+	gradient.angle = angle != NULL ? (float)angle->value : 0.0f;
+	gradient.stopCount = 0;
+	for (int i = 1; i <= stops->value && gradient.stopCount < GRADIENT_MAX_STOPS; i++)
+	{
+		char colourName[32], positionName[32];
+		snprintf(colourName, sizeof(colourName), "colour%d", i);
+		snprintf(positionName, sizeof(positionName), "position%d", i);
+		aura_property_color_t* colour = (aura_property_color_t*)node->getProperty(colourName);
+		aura_property_float_t* position = (aura_property_float_t*)node->getProperty(positionName);
+		if (colour == NULL || position == NULL)
+		{
+			break;
+		}
+
+		float* stopColour = gradient.colours[gradient.stopCount];
+		stopColour[0] = colour->valueR;
+		stopColour[1] = colour->valueG;
+		stopColour[2] = colour->valueB;
+		stopColour[3] = colour->hasAlpha ? colour->valueA : 1.0f;
+		gradient.positions[gradient.stopCount] = (float)position->value;
+		gradient.stopCount++;
+	}
+
+	// Anything batched so far has to be drawn underneath the gradient
+	batchRenderer->flush();
+	gradientRenderer->draw(gradient);
+}
+
+/// Draws a "text" element
+/// @param node The node holding the element
+void AuraLive::renderTextNode(SceneNode* node)
+{
+	aura_property_string_t* text = (aura_property_string_t*)node->getProperty("text");
+	aura_property_file_t* font = (aura_property_file_t*)node->getProperty("font");
+	aura_property_int_t* size = (aura_property_int_t*)node->getProperty("size");
+	aura_property_color_t* colour = (aura_property_color_t*)node->getProperty("colour");
+	if (text == NULL || text->value == NULL || size == NULL || colour == NULL)
+	{
+		return;
+	}
+
+	// Anything batched so far has to be drawn underneath the text
+	batchRenderer->flush();
+
+	float x, y, width, height;
+	node->getGeometry(x, y, width, height);
+	textRenderer->draw(text->value, (font != NULL && font->value != NULL) ? font->value : "", (unsigned int)size->value, x, y, width, colour->valueR, colour->valueG, colour->valueB, colour->hasAlpha ? colour->valueA : 1.0f);
+}
+
+/// Draws an "image" element
+/// @param node The node holding the element
+void AuraLive::renderImageNode(SceneNode* node)
+{
+	aura_property_string_t* source = (aura_property_string_t*)node->getProperty("source");
+	if (source == NULL || source->value == NULL)
+	{
+		return;
+	}
+
+	// Nothing is drawn until the image has finished loading
+	float x, y, width, height;
+	node->getGeometry(x, y, width, height);
+	const cached_image_t* image = imageCache->get(source->value, (int)(width + 0.5f), (int)(height + 0.5f));
+	if (image == NULL)
+	{
+		return;
+	}
+
+	// Fit the image in the element, keeping its aspect ratio, and centre it
+	float scaleX = width / image->width;
+	float scaleY = height / image->height;
+	float scale = scaleX < scaleY ? scaleX : scaleY;
+	batch_quad_t quad;
+	quad.width = image->width * scale;
+	quad.height = image->height * scale;
+	quad.x = x + (width - quad.width) / 2.0f;
+	quad.y = y + (height - quad.height) / 2.0f;
+	quad.u0 = image->u0;
+	quad.v0 = image->v0;
+	quad.u1 = image->u1;
+	quad.v1 = image->v1;
+	quad.r = quad.g = quad.b = quad.a = 1.0f;
+	batchRenderer->addQuad(image->texture, quad);
+}
+
+/// Determines the vsync interval of the display the first output is on
+double AuraLive::getDisplayVsyncInterval()
+{
+	SDL_DisplayMode mode;
+	int displayIndex = SDL_GetWindowDisplayIndex(outputs[0]->getWindow());
+	if (displayIndex < 0 || SDL_GetCurrentDisplayMode(displayIndex, &mode) != 0 || mode.refresh_rate <= 0)
+	{
+		// Assume 60Hz if we can't find out
+		return 1.0 / 60.0;
+	}
+
+	return 1.0 / mode.refresh_rate;
+}
+
+/// Gets the root of the scene graph
+SceneNode& AuraLive::getScene()
+{
+	return scene;
+}
+
+/// Creates an element instance and adds it to the scene graph
+/// @param objectType The name of the element object type, e.g. "colour"
+/// @param parent The node to add the new node to, or NULL for the root
+/// @returns The new node, or NULL if the element could not be created
+SceneNode* AuraLive::createElement(const string& objectType, SceneNode* parent)
+{
+	aura_plugin_t* plugin = pluginLoader.getPluginFor(AURA_PLUGIN_TYPE_ELEMENT, objectType);
+	if (plugin == NULL || plugin->create == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::createElement: No plugin provides element '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	aura_object_instance_t* object = plugin->create(objectType.c_str());
+	if (object == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::createElement: Plugin failed to create element '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	SceneNode* node = new SceneNode(plugin, object);
+	(parent != NULL ? parent : &scene)->addChild(node);
+	return node;
+}
+
+/// Creates an object from a source plugin and starts polling it on its own
+/// worker thread
+/// @param objectType The name of the source object type, e.g. "twitter"
+/// @param pollIntervalMs The time to wait between polls
+/// @returns The new source object, or NULL if it could not be created
+aura_object_instance_t* AuraLive::createSource(const string& objectType, unsigned int pollIntervalMs)
+{
+	aura_plugin_t* plugin = pluginLoader.getPluginFor(AURA_PLUGIN_TYPE_SOURCE, objectType);
+	if (plugin == NULL || plugin->create == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::createSource: No plugin provides source '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	aura_object_instance_t* object = plugin->create(objectType.c_str());
+	if (object == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::createSource: Plugin failed to create source '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	sourceRunner.addSource(pluginLoader.getPluginRef(plugin), object, pollIntervalMs);
+	return object;
+}
+
+/// Creates a layout object and an engine to drive it. The engine is updated
+/// every timestep until the scene is replaced
+/// @param objectType The name of the layout object type, e.g. "list"
+/// @param parent The node to add the layout's elements under, or NULL for the
+/// root
+/// @returns The new layout engine, or NULL if the layout could not be created
+LayoutEngine* AuraLive::createLayout(const string& objectType, SceneNode* parent)
+{
+	aura_plugin_t* plugin = pluginLoader.getPluginFor(AURA_PLUGIN_TYPE_LAYOUT, objectType);
+	if (plugin == NULL || plugin->create == NULL || ((aura_layout_plugin_t*)plugin)->arrange == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::createLayout: No plugin provides layout '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	aura_object_instance_t* object = plugin->create(objectType.c_str());
+	if (object == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::createLayout: Plugin failed to create layout '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	SceneNode* node = new SceneNode();
+	(parent != NULL ? parent : &scene)->addChild(node);
+	LayoutEngine* layout = new LayoutEngine(*this, (aura_layout_plugin_t*)plugin, object, node);
+	layouts.push_back(layout);
+	return layout;
+}
+
+/// Gets a transition object, creating it the first time it is asked for, so
+/// that its properties can be set before it is used
+/// @param objectType The name of the transition object type, e.g. "fade"
+/// @returns The transition object, or NULL if it could not be created
+aura_object_instance_t* AuraLive::getTransition(const string& objectType)
+{
+	auto transitionIter = transitionObjects.find(objectType);
+	if (transitionIter != transitionObjects.end())
+	{
+		return transitionIter->second;
+	}
+
+	aura_plugin_t* plugin = pluginLoader.getPluginFor(AURA_PLUGIN_TYPE_TRANSITION, objectType);
+	if (plugin == NULL || plugin->create == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::getTransition: No plugin provides transition '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	aura_object_instance_t* object = plugin->create(objectType.c_str());
+	if (object == NULL)
+	{
+		LOG(LOG_ERROR, "AuraLive::getTransition: Plugin failed to create transition '%s'", objectType.c_str());
+		return NULL;
+	}
+
+	transitionObjects[objectType] = object;
+	return object;
+}
+
+/// Replaces one node with another using a transition plugin. Both nodes are
+/// shown until the transition ends, after which the outgoing node is hidden
+/// @param objectType The name of the transition object type, e.g. "fade"
+/// @param from The outgoing node
+/// @param to The incoming node
+/// @returns true if the transition started, false if the nodes were swapped
+/// immediately instead
+bool AuraLive::startTransition(const string& objectType, SceneNode* from, SceneNode* to)
+{
+	if (transitionCompositor->isActive())
+	{
+		endTransition();
+	}
+
+	// If the transition can't be run then just cut to the new item
+	aura_object_instance_t* object = getTransition(objectType);
+	aura_plugin_t* plugin = pluginLoader.getPluginFor(AURA_PLUGIN_TYPE_TRANSITION, objectType);
+	if (object == NULL || !transitionCompositor->start((aura_transition_plugin_t*)plugin, object))
+	{
+		from->setVisible(false);
+		to->setVisible(true);
+		return false;
+	}
+
+	transitionFrom = from;
+	transitionTo = to;
+	from->setVisible(true);
+	to->setVisible(true);
+	scene.markDirty();
+	return true;
+}
+
+/// Ends the transition in progress, hiding the outgoing node
+void AuraLive::endTransition()
+{
+	transitionCompositor->finish();
+	transitionFrom->setVisible(false);
+	transitionTo->markDirty();
+	transitionFrom = NULL;
+	transitionTo = NULL;
+}
+
+/// Gets the transition compositor
+TransitionCompositor& AuraLive::getTransitionCompositor()
+{
+	return *transitionCompositor;
+}
+
+AuraLive& AuraLive::initInstance(string pluginPath, bool headless, bool windowed, int width, int height, int outputCount)
 {
 	// If we already have an instance, throw an exception
 	if (globalInstance)
@@ -77,7 +1353,7 @@ AuraLive& AuraLive::initInstance(string pluginPath)
 	}
 
 	// Initialise the global instance (this may throw an AuraException)
-	globalInstance = new AuraLive(pluginPath);
+	globalInstance = new AuraLive(pluginPath, headless, windowed, width, height, outputCount);
 
 	// Return the new instance
 	return *globalInstance;
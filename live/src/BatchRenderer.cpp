@@ -0,0 +1,229 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "BatchRenderer.h"
+#include "Log.h"
+
+// Definitions:
+#define BATCH_TEXELS_PER_QUAD      3
+#define BATCH_INITIAL_CAPACITY     1024
+
+/// Vertex shader: builds each quad from four vertices of a triangle strip and
+/// the instance data fetched from the buffer texture
+static const char* g_batchVertexShader =
+	"#version 150\n"
+	"uniform samplerBuffer instances;\n"
+	"uniform int instanceBase;\n"
+	"uniform vec2 viewport;\n"
+	"out vec2 texCoord;\n"
+	"out vec4 colour;\n"
+	"void main()\n"
+	"{\n"
+	"	int base = (instanceBase + gl_InstanceID) * 3;\n"
+	"	vec4 rect = texelFetch(instances, base);\n"
+	"	vec4 uvs = texelFetch(instances, base + 1);\n"
+	"	colour = texelFetch(instances, base + 2);\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	vec2 position = rect.xy + corner * rect.zw;\n"
+	"	texCoord = mix(uvs.xy, uvs.zw, corner);\n"
+	"	gl_Position = vec4(position.x / viewport.x * 2.0 - 1.0, 1.0 - position.y / viewport.y * 2.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Fragment shader: texture multiplied by colour
+static const char* g_batchFragmentShader =
+	"#version 150\n"
+	"uniform sampler2D quadTexture;\n"
+	"in vec2 texCoord;\n"
+	"in vec4 colour;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColour = texture(quadTexture, texCoord) * colour;\n"
+	"}\n";
+
+/// Constructs a new BatchRenderer object. A GL context must be current
+BatchRenderer::BatchRenderer() :
+	program(g_batchVertexShader, g_batchFragmentShader),
+	vertexArray(0),
+	instanceBuffer(0),
+	instanceTexture(0),
+	whiteTexture(0),
+	bufferCapacity(BATCH_INITIAL_CAPACITY),
+	maxQuads(0),
+	viewportWidth(1),
+	viewportHeight(1),
+	drawCalls(0),
+	quadCount(0),
+	lastDrawCalls(0),
+	lastQuadCount(0)
+{
+	viewportUniform = program.getUniformLocation("viewport");
+	instanceBaseUniform = program.getUniformLocation("instanceBase");
+	instancesUniform = program.getUniformLocation("instances");
+	textureUniform = program.getUniformLocation("quadTexture");
+
+	// The buffer texture is limited in size, so find out how many quads
+	// we can address in one upload
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	maxQuads = maxTexels / BATCH_TEXELS_PER_QUAD;
+	if (bufferCapacity > maxQuads)
+	{
+		bufferCapacity = maxQuads;
+	}
+	LOG(LOG_DEBUG, "BatchRenderer::BatchRenderer: Up to %u quads per upload", (unsigned int)maxQuads);
+
+	// A core context needs a VAO bound to draw, even with no attributes
+	glGenVertexArrays(1, &vertexArray);
+
+	// Instance buffer and the buffer texture that reads it
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, bufferCapacity * sizeof(batch_quad_t), NULL, GL_STREAM_DRAW);
+	glGenTextures(1, &instanceTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// Plain colour quads sample a white texel so they can share the shader
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	glGenTextures(1, &whiteTexture);
+	glBindTexture(GL_TEXTURE_2D, whiteTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	quads.reserve(bufferCapacity);
+}
+
+/// Destroys a BatchRenderer object and its GL resources
+BatchRenderer::~BatchRenderer()
+{
+	glDeleteTextures(1, &whiteTexture);
+	glDeleteTextures(1, &instanceTexture);
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+/// Starts collecting quads for a frame
+/// @param _viewportWidth The width of the viewport in pixels
+/// @param _viewportHeight The height of the viewport in pixels
+void BatchRenderer::begin(int _viewportWidth, int _viewportHeight)
+{
+	viewportWidth = _viewportWidth;
+	viewportHeight = _viewportHeight;
+	quads.clear();
+	batches.clear();
+	drawCalls = 0;
+	quadCount = 0;
+}
+
+/// Adds a textured quad
+/// @param texture The texture to draw with, or 0 for a plain colour
+/// @param quad The quad to draw
+void BatchRenderer::addQuad(GLuint texture, const batch_quad_t& quad)
+{
+	if (texture == 0)
+	{
+		texture = whiteTexture;
+	}
+
+	// If we've filled what the buffer texture can address, draw what we
+	// have so far and start again
+	if (quads.size() >= maxQuads)
+	{
+		flush();
+	}
+
+	// Extend the current run if the material matches, otherwise start a new one
+	if (batches.empty() || batches.back().texture != texture)
+	{
+		batch_t batch;
+		batch.texture = texture;
+		batch.first = quads.size();
+		batch.count = 0;
+		batches.push_back(batch);
+	}
+	batches.back().count++;
+	quads.push_back(quad);
+}
+
+/// Adds a plain coloured quad
+void BatchRenderer::addColourQuad(float x, float y, float width, float height, float r, float g, float b, float a)
+{
+	batch_quad_t quad = { x, y, width, height, 0.0f, 0.0f, 1.0f, 1.0f, r, g, b, a };
+	addQuad(0, quad);
+}
+
+/// Draws everything collected since begin()
+void BatchRenderer::end()
+{
+	flush();
+	lastDrawCalls = drawCalls;
+	lastQuadCount = quadCount;
+}
+
+/// Gets the number of draw calls issued for the last frame
+unsigned int BatchRenderer::getDrawCalls() const
+{
+	return lastDrawCalls;
+}
+
+/// Gets the number of quads drawn for the last frame
+unsigned int BatchRenderer::getQuadCount() const
+{
+	return lastQuadCount;
+}
+
+/// Draws everything collected so far without ending the frame, so that
+/// something drawn by another renderer can go on top of it
+void BatchRenderer::flush()
+{
+	if (quads.empty())
+	{
+		return;
+	}
+
+	// Orphan the buffer and upload this frame's instances in one go. The
+	// driver hands us fresh storage if the GPU is still reading the old
+	glBindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+	if (quads.size() > bufferCapacity)
+	{
+		bufferCapacity = quads.size() * 2 < maxQuads ? quads.size() * 2 : maxQuads;
+	}
+	glBufferData(GL_TEXTURE_BUFFER, bufferCapacity * sizeof(batch_quad_t), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, quads.size() * sizeof(batch_quad_t), &quads[0]);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	program.use();
+	glUniform2f(viewportUniform, (float)viewportWidth, (float)viewportHeight);
+	glUniform1i(instancesUniform, 1);
+	glUniform1i(textureUniform, 0);
+	glBindVertexArray(vertexArray);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// One instanced draw per run
+	for (auto& batch : batches)
+	{
+		glBindTexture(GL_TEXTURE_2D, batch.texture);
+		glUniform1i(instanceBaseUniform, (GLint)batch.first);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)batch.count);
+		drawCalls++;
+	}
+	quadCount += quads.size();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+
+	quads.clear();
+	batches.clear();
+}
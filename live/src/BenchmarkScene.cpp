@@ -0,0 +1,551 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <math.h>
+#include <stdio.h>
+#include "BenchmarkScene.h"
+#include "AuraLive.h"
+#include "Log.h"
+
+// Definitions:
+#define BENCHMARK_QUAD_COUNT   10000
+#define BENCHMARK_TEXT_COLUMNS 4
+#define BENCHMARK_TEXT_ROWS    6
+#define BENCHMARK_TEXT_REPEAT  4
+#define BENCHMARK_TEXT_CHANGE  0.25
+#define BENCHMARK_GRADIENT_COLUMNS 6
+#define BENCHMARK_GRADIENT_ROWS    4
+#define BENCHMARK_TRANSITION_QUADS    400
+#define BENCHMARK_TRANSITION_INTERVAL 1.5
+#define BENCHMARK_WALL_ITEMS          5000
+#define BENCHMARK_WALL_ADD            0.1
+#define BENCHMARK_WALL_EDIT           1.0
+
+/// Benchmark scene: a grid of linear and radial gradient elements covering
+/// the display, with every stop colour and angle changing every update. Run it
+/// at different resolutions (e.g. headless at 1920x1080 and 3840x2160) to
+/// measure the fill cost
+class GradientBenchmarkScene : public BenchmarkScene
+{
+	public:
+		virtual bool setup(AuraLive& auraLive)
+		{
+			int width, height;
+			auraLive.getDrawableSize(width, height);
+			float cellWidth = (float)width / BENCHMARK_GRADIENT_COLUMNS;
+			float cellHeight = (float)height / BENCHMARK_GRADIENT_ROWS;
+
+			for (int i = 0; i < BENCHMARK_GRADIENT_COLUMNS * BENCHMARK_GRADIENT_ROWS; i++)
+			{
+				SceneNode* node = auraLive.createElement("gradient");
+				if (node == NULL)
+				{
+					return false;
+				}
+				node->setGeometry((i % BENCHMARK_GRADIENT_COLUMNS) * cellWidth, (i / BENCHMARK_GRADIENT_COLUMNS) * cellHeight, cellWidth, cellHeight);
+
+				// Alternate linear and radial, with four evenly spaced stops
+				aura_property_bool_t* radial = (aura_property_bool_t*)node->getProperty("radial");
+				aura_property_int_t* stops = (aura_property_int_t*)node->getProperty("stops");
+				aura_property_float_t* angle = (aura_property_float_t*)node->getProperty("angle");
+				if (radial == NULL || stops == NULL || angle == NULL)
+				{
+					LOG(LOG_ERROR, "GradientBenchmarkScene::setup: gradient element is missing properties");
+					return false;
+				}
+				radial->value = i % 2 == 1;
+				stops->value = 4;
+
+				gradient_node_t gradientNode;
+				gradientNode.node = node;
+				gradientNode.angle = angle;
+				for (int stop = 0; stop < 4; stop++)
+				{
+					char colourName[16], positionName[16];
+					snprintf(colourName, sizeof(colourName), "colour%d", stop + 1);
+					snprintf(positionName, sizeof(positionName), "position%d", stop + 1);
+					gradientNode.colours[stop] = (aura_property_color_t*)node->getProperty(colourName);
+					aura_property_float_t* position = (aura_property_float_t*)node->getProperty(positionName);
+					if (gradientNode.colours[stop] == NULL || position == NULL)
+					{
+						LOG(LOG_ERROR, "GradientBenchmarkScene::setup: gradient element has too few stops");
+						return false;
+					}
+					position->value = stop / 3.0;
+				}
+				nodes.push_back(gradientNode);
+			}
+
+			return true;
+		}
+
+		virtual void update(double time)
+		{
+			for (size_t i = 0; i < nodes.size(); i++)
+			{
+				gradient_node_t& gradientNode = nodes[i];
+				gradientNode.angle->value = fmod(time * 45.0 + i * 15.0, 360.0);
+				for (int stop = 0; stop < 4; stop++)
+				{
+					double phase = time * 1.5 + i * 0.2 + stop * 1.3;
+					gradientNode.colours[stop]->valueR = (float)(0.5 + 0.5 * sin(phase));
+					gradientNode.colours[stop]->valueG = (float)(0.5 + 0.5 * sin(phase + 2.094));
+					gradientNode.colours[stop]->valueB = (float)(0.5 + 0.5 * sin(phase + 4.189));
+				}
+				gradientNode.node->propertyChanged((aura_property_t*)gradientNode.angle);
+			}
+		}
+
+	private:
+		/// A node and the properties we animate
+		typedef struct gradient_node_t
+		{
+			SceneNode* node;
+			aura_property_float_t* angle;
+			aura_property_color_t* colours[4];
+		} gradient_node_t;
+
+		/// The nodes in the scene
+		vector<gradient_node_t> nodes;
+};
+
+/// Sample posts in a range of scripts for the text benchmark. Each is repeated
+/// to make a long post
+static const char* g_benchmarkPosts[] =
+{
+	"The quick brown fox jumps over the lazy dog, while the band plays on and the crowd sings along. ",
+	"Portez ce vieux whisky au juge blond qui fume, puis dansez jusqu'\xc3\xa0 l'aube sur la place. ",
+	"Falsches \xc3\x9c" "ben von Xylophonmusik qu\xc3\xa4lt jeden gr\xc3\xb6\xc3\x9f" "eren Zwerg auf der B\xc3\xbchne. ",
+	"\xce\x9e\xce\xb5\xcf\x83\xce\xba\xce\xb5\xcf\x80\xce\xac\xce\xb6\xcf\x89 \xcf\x84\xe1\xbd\xb4\xce\xbd \xcf\x88\xcf\x85\xcf\x87\xce\xbf\xcf\x86\xce\xb8\xcf\x8c\xcf\x81\xce\xb1 \xce\xb2\xce\xb4\xce\xb5\xce\xbb\xcf\x85\xce\xb3\xce\xbc\xce\xaf\xce\xb1. ",
+	"\xd0\xa1\xd1\x8a\xd0\xb5\xd1\x88\xd1\x8c \xd0\xb6\xd0\xb5 \xd0\xb5\xd1\x89\xd1\x91 \xd1\x8d\xd1\x82\xd0\xb8\xd1\x85 \xd0\xbc\xd1\x8f\xd0\xb3\xd0\xba\xd0\xb8\xd1\x85 \xd1\x84\xd1\x80\xd0\xb0\xd0\xbd\xd1\x86\xd1\x83\xd0\xb7\xd1\x81\xd0\xba\xd0\xb8\xd1\x85 \xd0\xb1\xd1\x83\xd0\xbb\xd0\xbe\xd0\xba, \xd0\xb4\xd0\xb0 \xd0\xb2\xd1\x8b\xd0\xbf\xd0\xb5\xd0\xb9 \xd1\x87\xd0\xb0\xd1\x8e. ",
+	"\xd8\xb5\xd9\x90\xd9\x81 \xd8\xae\xd9\x8e\xd9\x84\xd9\x82\xd9\x8e \xd8\xae\xd9\x8e\xd9\x88\xd9\x92\xd8\xaf\xd9\x8d \xd9\x83\xd9\x8e\xd9\x85\xd9\x90\xd8\xab\xd9\x92\xd9\x84\xd9\x90 \xd8\xa7\xd9\x84\xd8\xb4\xd9\x8e\xd9\x85\xd9\x92\xd8\xb3\xd9\x90 \xd8\xa5\xd9\x90\xd8\xb0\xd9\x92 \xd8\xa8\xd9\x8e\xd8\xb2\xd9\x8e\xd8\xba\xd9\x8e\xd8\xaa\xd9\x92. ",
+	"\xd7\x93\xd7\x92 \xd7\xa1\xd7\xa7\xd7\xa8\xd7\x9f \xd7\xa9\xd7\x98 \xd7\x91\xd7\x99\xd7\x9d \xd7\x9e\xd7\x90\xd7\x95\xd7\x9b\xd7\x96\xd7\x91 \xd7\x95\xd7\x9c\xd7\xa4\xd7\xaa\xd7\xa2 \xd7\x9e\xd7\xa6\xd7\x90 \xd7\x97\xd7\x91\xd7\xa8\xd7\x94. ",
+	"\xe0\xa4\x8b\xe0\xa4\xb7\xe0\xa4\xbf\xe0\xa4\xaf\xe0\xa5\x8b\xe0\xa4\x82 \xe0\xa4\x95\xe0\xa5\x8b \xe0\xa4\xb8\xe0\xa4\xa4\xe0\xa4\xbe\xe0\xa4\xa8\xe0\xa5\x87 \xe0\xa4\xb5\xe0\xa4\xbe\xe0\xa4\xb2\xe0\xa5\x87 \xe0\xa4\xa6\xe0\xa5\x81\xe0\xa4\xb7\xe0\xa5\x8d\xe0\xa4\x9f \xe0\xa4\xb0\xe0\xa4\xbe\xe0\xa4\x95\xe0\xa5\x8d\xe0\xa4\xb7\xe0\xa4\xb8\xe0\xa5\x8b\xe0\xa4\x82 \xe0\xa4\x95\xe0\xa5\x87 \xe0\xa4\xb0\xe0\xa4\xbe\xe0\xa4\x9c\xe0\xa4\xbe. ",
+	"\xe5\xa4\xa9\xe5\x9c\xb0\xe7\x8e\x84\xe9\xbb\x84\xef\xbc\x8c\xe5\xae\x87\xe5\xae\x99\xe6\xb4\xaa\xe8\x8d\x92\xe3\x80\x82\xe6\x97\xa5\xe6\x9c\x88\xe7\x9b\x88\xe6\x98\x83\xef\xbc\x8c\xe8\xbe\xb0\xe5\xae\xbf\xe5\x88\x97\xe5\xbc\xa0\xe3\x80\x82 ",
+	"\xe3\x81\x84\xe3\x82\x8d\xe3\x81\xaf\xe3\x81\xab\xe3\x81\xbb\xe3\x81\xb8\xe3\x81\xa8 \xe3\x81\xa1\xe3\x82\x8a\xe3\x81\xac\xe3\x82\x8b\xe3\x82\x92 \xe3\x82\x8f\xe3\x81\x8b\xe3\x82\x88\xe3\x81\x9f\xe3\x82\x8c\xe3\x81\x9d \xe3\x81\xa4\xe3\x81\xad\xe3\x81\xaa\xe3\x82\x89\xe3\x82\x80. ",
+	"\xed\x82\xa4\xec\x8a\xa4\xec\x9d\x98 \xea\xb3\xa0\xec\x9c\xa0\xec\xa1\xb0\xea\xb1\xb4\xec\x9d\x80 \xec\x9e\x85\xec\x88\xa0\xeb\x81\xbc\xeb\xa6\xac \xeb\xa7\x8c\xeb\x82\x98\xec\x95\xbc \xed\x95\x98\xea\xb3\xa0 \xed\x8a\xb9\xeb\xb3\x84\xed\x95\x9c \xea\xb8\xb0\xec\x88\xa0\xec\x9d\x80 \xed\x95\x84\xec\x9a\x94\xec\xb9\x98 \xec\x95\x8a\xeb\x8b\xa4. ",
+	"\xe0\xb9\x80\xe0\xb8\x9b\xe0\xb9\x87\xe0\xb8\x99\xe0\xb8\xa1\xe0\xb8\x99\xe0\xb8\xb8\xe0\xb8\xa9\xe0\xb8\xa2\xe0\xb9\x8c\xe0\xb8\xaa\xe0\xb8\xb8\xe0\xb8\x94\xe0\xb8\x9b\xe0\xb8\xa3\xe0\xb8\xb0\xe0\xb9\x80\xe0\xb8\xaa\xe0\xb8\xa3\xe0\xb8\xb4\xe0\xb8\x90\xe0\xb9\x80\xe0\xb8\xa5\xe0\xb8\xb4\xe0\xb8\xa8\xe0\xb8\x84\xe0\xb8\xb8\xe0\xb8\x93\xe0\xb8\x84\xe0\xb9\x88\xe0\xb8\xb2. ",
+	"Emoji and symbols: \xe2\x98\x85 \xe2\x99\xab \xe2\x9c\x93 \xe2\x86\x92 \xe2\x82\xac" "100 \xc2\xa3 \xc2\xa5 \xe2\x88\x9e \xe2\x89\xa0 \xf0\x9f\x8e\xb5 \xf0\x9f\x8e\x89 \xf0\x9f\x91\x8d. "
+};
+
+/// Benchmark scene: a grid of text elements showing long posts in many
+/// scripts. The colours change every update so that every frame is drawn from
+/// the run cache, and one post changes every BENCHMARK_TEXT_CHANGE seconds to
+/// measure the cost of laying out new text
+class TextBenchmarkScene : public BenchmarkScene
+{
+	public:
+		TextBenchmarkScene() : changes(0) {}
+
+		virtual bool setup(AuraLive& auraLive)
+		{
+			int width, height;
+			auraLive.getDrawableSize(width, height);
+			float cellWidth = (float)width / BENCHMARK_TEXT_COLUMNS;
+			float cellHeight = (float)height / BENCHMARK_TEXT_ROWS;
+
+			unsigned int count = BENCHMARK_TEXT_COLUMNS * BENCHMARK_TEXT_ROWS;
+			texts.resize(count);
+			for (unsigned int i = 0; i < count; i++)
+			{
+				SceneNode* node = auraLive.createElement("text");
+				if (node == NULL)
+				{
+					return false;
+				}
+
+				node->setGeometry((i % BENCHMARK_TEXT_COLUMNS) * cellWidth, (i / BENCHMARK_TEXT_COLUMNS) * cellHeight, cellWidth - 8.0f, cellHeight - 8.0f);
+				aura_property_string_t* text = (aura_property_string_t*)node->getProperty("text");
+				aura_property_int_t* size = (aura_property_int_t*)node->getProperty("size");
+				aura_property_color_t* colour = (aura_property_color_t*)node->getProperty("colour");
+				if (text == NULL || size == NULL || colour == NULL)
+				{
+					LOG(LOG_ERROR, "TextBenchmarkScene::setup: text element is missing properties");
+					return false;
+				}
+				size->value = 14;
+				nodes.push_back(node);
+				textProperties.push_back(text);
+				colours.push_back(colour);
+				setPost(i, i);
+			}
+
+			return true;
+		}
+
+		virtual void update(double time)
+		{
+			// Swap one post for a new one now and again
+			unsigned int due = (unsigned int)(time / BENCHMARK_TEXT_CHANGE);
+			while (changes < due)
+			{
+				changes++;
+				setPost(changes % nodes.size(), changes + nodes.size());
+			}
+
+			for (size_t i = 0; i < nodes.size(); i++)
+			{
+				double phase = time + i * 0.1;
+				colours[i]->valueR = (float)(0.75 + 0.25 * sin(phase));
+				colours[i]->valueG = (float)(0.75 + 0.25 * sin(phase + 2.094));
+				colours[i]->valueB = (float)(0.75 + 0.25 * sin(phase + 4.189));
+				nodes[i]->propertyChanged((aura_property_t*)colours[i]);
+			}
+		}
+
+	private:
+		/// Sets the text of a node to a long post
+		/// @param index The index of the node
+		/// @param serial A number that makes the post unique
+		void setPost(size_t index, unsigned int serial)
+		{
+			const size_t postCount = sizeof(g_benchmarkPosts) / sizeof(g_benchmarkPosts[0]);
+			char header[32];
+			snprintf(header, sizeof(header), "#%u ", serial);
+
+			string& text = texts[index];
+			text = header;
+			for (int i = 0; i < BENCHMARK_TEXT_REPEAT; i++)
+			{
+				text += g_benchmarkPosts[serial % postCount];
+			}
+			textProperties[index]->value = &text[0];
+			nodes[index]->propertyChanged((aura_property_t*)textProperties[index]);
+		}
+
+		/// The nodes in the scene
+		vector<SceneNode*> nodes;
+
+		/// The text property of each node
+		vector<aura_property_string_t*> textProperties;
+
+		/// The colour property of each node
+		vector<aura_property_color_t*> colours;
+
+		/// The text of each node, which the text properties point in to
+		vector<string> texts;
+
+		/// The number of posts changed so far
+		unsigned int changes;
+};
+
+/// Benchmark scene: a grid of 10,000 colour elements that all change colour
+/// every update, to measure draw call batching
+class QuadBenchmarkScene : public BenchmarkScene
+{
+	public:
+		virtual bool setup(AuraLive& auraLive)
+		{
+			int width, height;
+			auraLive.getDrawableSize(width, height);
+
+			// Lay the quads out in a square-ish grid covering the display
+			int columns = (int)ceil(sqrt((double)BENCHMARK_QUAD_COUNT));
+			int rows = (BENCHMARK_QUAD_COUNT + columns - 1) / columns;
+			float cellWidth = (float)width / columns;
+			float cellHeight = (float)height / rows;
+
+			for (int i = 0; i < BENCHMARK_QUAD_COUNT; i++)
+			{
+				SceneNode* node = auraLive.createElement("colour");
+				if (node == NULL)
+				{
+					return false;
+				}
+
+				node->setGeometry((i % columns) * cellWidth, (i / columns) * cellHeight, cellWidth - 1.0f, cellHeight - 1.0f);
+				aura_property_color_t* colour = (aura_property_color_t*)node->getProperty("colour");
+				if (colour == NULL)
+				{
+					LOG(LOG_ERROR, "QuadBenchmarkScene::setup: colour element has no colour property");
+					return false;
+				}
+				nodes.push_back(node);
+				colours.push_back(colour);
+			}
+
+			return true;
+		}
+
+		virtual void update(double time)
+		{
+			for (size_t i = 0; i < nodes.size(); i++)
+			{
+				double phase = time * 2.0 + i * 0.01;
+				colours[i]->valueR = (float)(0.5 + 0.5 * sin(phase));
+				colours[i]->valueG = (float)(0.5 + 0.5 * sin(phase + 2.094));
+				colours[i]->valueB = (float)(0.5 + 0.5 * sin(phase + 4.189));
+				nodes[i]->propertyChanged((aura_property_t*)colours[i]);
+			}
+		}
+
+	private:
+		/// The nodes in the scene
+		vector<SceneNode*> nodes;
+
+		/// The colour property of each node
+		vector<aura_property_color_t*> colours;
+};
+
+/// Benchmark scene: two full-display items, each a gradient behind a grid of
+/// colour elements and some text, swapped back and forth with a different
+/// transition every BENCHMARK_TRANSITION_INTERVAL seconds. The items don't
+/// change, so each transition should render them once and then cost a single
+/// fullscreen pass per frame
+class TransitionBenchmarkScene : public BenchmarkScene
+{
+	public:
+		TransitionBenchmarkScene() : auraLive(NULL), transitions(0) {}
+
+		virtual bool setup(AuraLive& _auraLive)
+		{
+			auraLive = &_auraLive;
+			for (int i = 0; i < 2; i++)
+			{
+				items[i] = new SceneNode();
+				auraLive->getScene().addChild(items[i]);
+				if (!buildItem(items[i], i))
+				{
+					return false;
+				}
+			}
+			items[1]->setVisible(false);
+
+			return true;
+		}
+
+		virtual void update(double time)
+		{
+			static const char* transitionTypes[] = { "fade", "slide", "wipe" };
+
+			unsigned int due = (unsigned int)(time / BENCHMARK_TRANSITION_INTERVAL);
+			while (transitions < due)
+			{
+				// Vary the direction of each kind of transition as we go
+				const char* objectType = transitionTypes[transitions % 3];
+				aura_object_instance_t* transition = auraLive->getTransition(objectType);
+				if (transition != NULL)
+				{
+					aura_property_int_t* direction = (aura_property_int_t*)aura_get_property(transition->properties, "direction");
+					aura_property_float_t* angle = (aura_property_float_t*)aura_get_property(transition->properties, "angle");
+					if (direction != NULL)
+					{
+						direction->value = (transitions / 3) % 4;
+					}
+					if (angle != NULL)
+					{
+						angle->value = fmod(transitions / 3 * 135.0, 360.0);
+					}
+				}
+
+				SceneNode* from = items[transitions % 2];
+				SceneNode* to = items[(transitions + 1) % 2];
+				auraLive->startTransition(objectType, from, to);
+				transitions++;
+			}
+		}
+
+	private:
+		/// Fills an item with elements
+		/// @param item The group node to add the elements to
+		/// @param index Which item this is, to make them look different
+		bool buildItem(SceneNode* item, int index)
+		{
+			int width, height;
+			auraLive->getDrawableSize(width, height);
+
+			SceneNode* gradient = auraLive->createElement("gradient", item);
+			if (gradient == NULL)
+			{
+				return false;
+			}
+			gradient->setGeometry(0.0f, 0.0f, (float)width, (float)height);
+			aura_property_bool_t* radial = (aura_property_bool_t*)gradient->getProperty("radial");
+			aura_property_color_t* colour1 = (aura_property_color_t*)gradient->getProperty("colour1");
+			aura_property_color_t* colour2 = (aura_property_color_t*)gradient->getProperty("colour2");
+			if (radial == NULL || colour1 == NULL || colour2 == NULL)
+			{
+				LOG(LOG_ERROR, "TransitionBenchmarkScene::buildItem: gradient element is missing properties");
+				return false;
+			}
+			radial->value = index == 1;
+			colour1->valueR = index == 0 ? 0.1f : 0.9f;
+			colour1->valueG = 0.3f;
+			colour1->valueB = index == 0 ? 0.9f : 0.2f;
+			colour2->valueR = colour2->valueG = colour2->valueB = 0.05f;
+
+			// A grid of quads over the middle of the display
+			int columns = (int)ceil(sqrt((double)BENCHMARK_TRANSITION_QUADS));
+			int rows = (BENCHMARK_TRANSITION_QUADS + columns - 1) / columns;
+			float cellWidth = width * 0.5f / columns;
+			float cellHeight = height * 0.5f / rows;
+			for (int i = 0; i < BENCHMARK_TRANSITION_QUADS; i++)
+			{
+				SceneNode* quad = auraLive->createElement("colour", item);
+				if (quad == NULL)
+				{
+					return false;
+				}
+				quad->setGeometry(width * 0.25f + (i % columns) * cellWidth, height * 0.25f + (i / columns) * cellHeight, cellWidth - 1.0f, cellHeight - 1.0f);
+				aura_property_color_t* colour = (aura_property_color_t*)quad->getProperty("colour");
+				if (colour == NULL)
+				{
+					LOG(LOG_ERROR, "TransitionBenchmarkScene::buildItem: colour element has no colour property");
+					return false;
+				}
+				double phase = i * 0.05 + index * 3.0;
+				colour->valueR = (float)(0.5 + 0.5 * sin(phase));
+				colour->valueG = (float)(0.5 + 0.5 * sin(phase + 2.094));
+				colour->valueB = (float)(0.5 + 0.5 * sin(phase + 4.189));
+			}
+
+			SceneNode* text = auraLive->createElement("text", item);
+			if (text == NULL)
+			{
+				return false;
+			}
+			text->setGeometry(16.0f, 16.0f, width - 32.0f, height * 0.25f - 16.0f);
+			aura_property_string_t* textProperty = (aura_property_string_t*)text->getProperty("text");
+			if (textProperty == NULL)
+			{
+				LOG(LOG_ERROR, "TransitionBenchmarkScene::buildItem: text element has no text property");
+				return false;
+			}
+			textProperty->value = (char*)g_benchmarkPosts[index];
+
+			return true;
+		}
+
+		/// The application, for starting transitions
+		AuraLive* auraLive;
+
+		/// The two items
+		SceneNode* items[2];
+
+		/// The number of transitions started so far
+		unsigned int transitions;
+};
+
+/// Benchmark scene: a scrolling list of thousands of posts, with a new post
+/// added every BENCHMARK_WALL_ADD seconds and one changed every
+/// BENCHMARK_WALL_EDIT seconds, to measure the cost of incremental layout and
+/// of virtualising the list
+class WallBenchmarkScene : public BenchmarkScene
+{
+	public:
+		WallBenchmarkScene() : layout(NULL), added(0), edits(0) {}
+
+		virtual bool setup(AuraLive& auraLive)
+		{
+			int width, height;
+			auraLive.getDrawableSize(width, height);
+			layout = auraLive.createLayout("list");
+			if (layout == NULL)
+			{
+				return false;
+			}
+
+			// A column down the middle of the display
+			layout->setGeometry(width * 0.2f, 0.0f, width * 0.6f, (float)height);
+			while (added < BENCHMARK_WALL_ITEMS)
+			{
+				addPost();
+			}
+
+			return true;
+		}
+
+		virtual void update(double time)
+		{
+			unsigned int due = BENCHMARK_WALL_ITEMS + (unsigned int)(time / BENCHMARK_WALL_ADD);
+			while (added < due)
+			{
+				addPost();
+			}
+
+			// Edit posts near the top, which moves everything after them
+			unsigned int editsDue = (unsigned int)(time / BENCHMARK_WALL_EDIT);
+			while (edits < editsDue)
+			{
+				edits++;
+				char id[32];
+				snprintf(id, sizeof(id), "%u", (edits * 7) % 50);
+				layout->updateItem(id, makePost(edits + added), "");
+			}
+		}
+
+	private:
+		/// Makes the text of a post
+		/// @param serial A number that makes the post unique
+		static string makePost(unsigned int serial)
+		{
+			const size_t postCount = sizeof(g_benchmarkPosts) / sizeof(g_benchmarkPosts[0]);
+			char header[32];
+			snprintf(header, sizeof(header), "#%u ", serial);
+
+			string text = header;
+			for (unsigned int i = 0; i <= serial % 3; i++)
+			{
+				text += g_benchmarkPosts[(serial + i) % postCount];
+			}
+			return text;
+		}
+
+		/// Adds a new post to the end of the list
+		void addPost()
+		{
+			char id[32];
+			snprintf(id, sizeof(id), "%u", added);
+			layout->addItem(id, makePost(added), "");
+			added++;
+		}
+
+		/// The list layout
+		LayoutEngine* layout;
+
+		/// The number of posts added and edited so far
+		unsigned int added, edits;
+};
+
+/// Creates a benchmark scene by name
+/// @param name The name of the scene, e.g. "quads"
+/// @returns The new scene, or NULL if there is no such scene
+BenchmarkScene* BenchmarkScene::create(const string& name)
+{
+	if (name == "quads")
+	{
+		return new QuadBenchmarkScene();
+	}
+	else if (name == "gradients")
+	{
+		return new GradientBenchmarkScene();
+	}
+	else if (name == "text")
+	{
+		return new TextBenchmarkScene();
+	}
+	else if (name == "transitions")
+	{
+		return new TransitionBenchmarkScene();
+	}
+	else if (name == "wall")
+	{
+		return new WallBenchmarkScene();
+	}
+
+	return NULL;
+}
+
+/// Gets the names of all the benchmark scenes
+vector<string> BenchmarkScene::getNames()
+{
+	vector<string> names;
+	names.push_back("quads");
+	names.push_back("gradients");
+	names.push_back("text");
+	names.push_back("transitions");
+	names.push_back("wall");
+	return names;
+}
@@ -0,0 +1,535 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <string.h>
+#include "FrameCapture.h"
+#include "AuraException.h"
+#include "Log.h"
+
+/// Vertex shader: covers the viewport with a triangle strip of four vertices
+static const char* g_captureVertexShader =
+	"#version 150\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Fragment shader: the luma plane. Rows are read back bottom first, so the
+/// frame is drawn upside down to end up with its top row first. Colours are
+/// converted as JPEG expects (BT.601, full range)
+static const char* g_lumaFragmentShader =
+	"#version 150\n"
+	"uniform sampler2D frame;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 size = vec2(textureSize(frame, 0));\n"
+	"	vec3 rgb = texture(frame, vec2(gl_FragCoord.x / size.x, 1.0 - gl_FragCoord.y / size.y)).rgb;\n"
+	"	fragColour = vec4(dot(rgb, vec3(0.299, 0.587, 0.114)), 0.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Fragment shader: the chroma planes, half as wide as the frame and as tall,
+/// with U in the first half of the rows and V in the second. Each pixel is
+/// sampled where four meet, so linear filtering averages them
+static const char* g_chromaFragmentShader =
+	"#version 150\n"
+	"uniform sampler2D frame;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 size = vec2(textureSize(frame, 0));\n"
+	"	float row = gl_FragCoord.y;\n"
+	"	bool isV = row >= size.y * 0.5;\n"
+	"	if (isV)\n"
+	"	{\n"
+	"		row -= size.y * 0.5;\n"
+	"	}\n"
+	"	vec3 rgb = texture(frame, vec2(2.0 * gl_FragCoord.x / size.x, 1.0 - 2.0 * row / size.y)).rgb;\n"
+	"	float value = isV ? dot(rgb, vec3(0.5, -0.418688, -0.081312)) : dot(rgb, vec3(-0.168736, -0.331264, 0.5));\n"
+	"	fragColour = vec4(value + 128.0 / 255.0, 0.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Creates a texture and a framebuffer to draw in to it
+static void create_target(GLuint& texture, GLuint& framebuffer, GLint internalFormat, GLenum format, int width, int height)
+{
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG(LOG_ERROR, "FrameCapture::FrameCapture: Framebuffer is incomplete at %dx%d", width, height);
+	}
+}
+
+/// Constructs a new FrameCapture object. A GL context must be current
+/// @param _width The width of the stream, a multiple of 16
+/// @param _height The height of the stream, a multiple of 16
+/// @param frameRate The most frames to capture per second
+/// @param _encoder The encoder to hand captured frames to
+FrameCapture::FrameCapture(int _width, int _height, double frameRate, FrameEncoder* _encoder) :
+	width(_width),
+	height(_height),
+	minInterval(frameRate > 0.0 ? 1.0 / frameRate : 0.0),
+	encoder(_encoder),
+	canvasWidth(0),
+	canvasHeight(0),
+	nextSlot(0),
+	frameTexture(0),
+	frameFramebuffer(0),
+	lumaTexture(0),
+	chromaTexture(0),
+	lumaFramebuffer(0),
+	chromaFramebuffer(0),
+	lumaProgram(NULL),
+	chromaProgram(NULL),
+	lumaFrameUniform(-1),
+	chromaFrameUniform(-1),
+	vertexArray(0),
+	capturing(false),
+	lastCaptureTime(0.0),
+	timingSupported(false),
+	frameCpuMs(0.0),
+	sequence(0),
+	capturedCount(0),
+	droppedCount(0),
+	cpuFrames(0),
+	gpuFrames(0),
+	totalCpuMs(0.0),
+	maxCpuMs(0.0),
+	totalGpuMs(0.0),
+	maxGpuMs(0.0)
+{
+	// Throws if the shaders won't build, before anything needs tidying up
+	lumaProgram = new ShaderProgram(g_captureVertexShader, g_lumaFragmentShader);
+	try
+	{
+		chromaProgram = new ShaderProgram(g_captureVertexShader, g_chromaFragmentShader);
+	}
+	catch (AuraException&)
+	{
+		delete lumaProgram;
+		throw;
+	}
+	lumaFrameUniform = lumaProgram->getUniformLocation("frame");
+	chromaFrameUniform = chromaProgram->getUniformLocation("frame");
+	glGenVertexArrays(1, &vertexArray);
+
+	GLint previousBinding = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousBinding);
+	create_target(frameTexture, frameFramebuffer, GL_RGBA8, GL_RGBA, width, height);
+	create_target(lumaTexture, lumaFramebuffer, GL_R8, GL_RED, width, height);
+	create_target(chromaTexture, chromaFramebuffer, GL_R8, GL_RED, width / 2, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousBinding);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Each buffer holds a whole I420 frame
+	for (size_t i = 0; i < FRAME_CAPTURE_RING; i++)
+	{
+		slots[i].state = SLOT_FREE;
+		slots[i].fence = 0;
+		slots[i].released = false;
+		slots[i].sequence = 0;
+		slots[i].captureTime = 0.0;
+		glGenBuffers(1, &slots[i].buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 3 / 2, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// Timer queries are core from GL 3.3, and an extension before that
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	timingSupported = major > 3 || (major == 3 && minor >= 3);
+	if (!timingSupported)
+	{
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (GLint i = 0; i < extensionCount && !timingSupported; i++)
+		{
+			timingSupported = strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_timer_query") == 0;
+		}
+	}
+
+	LOG(LOG_DEBUG, "FrameCapture::FrameCapture: Capturing %dx%d frames through %d pixel buffers", width, height, FRAME_CAPTURE_RING);
+}
+
+/// Destroys a FrameCapture object and its GL resources. The encoder must have
+/// been stopped first
+FrameCapture::~FrameCapture()
+{
+	for (size_t i = 0; i < FRAME_CAPTURE_RING; i++)
+	{
+		if (slots[i].state == SLOT_READING)
+		{
+			glDeleteSync(slots[i].fence);
+		}
+		else if (slots[i].state == SLOT_ENCODING)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glDeleteBuffers(1, &slots[i].buffer);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	for (auto query : pendingQueries)
+	{
+		freeQueries.push_back(query);
+	}
+	if (!freeQueries.empty())
+	{
+		glDeleteQueries((GLsizei)freeQueries.size(), &freeQueries[0]);
+	}
+
+	GLuint framebuffers[3] = { frameFramebuffer, lumaFramebuffer, chromaFramebuffer };
+	GLuint textures[3] = { frameTexture, lumaTexture, chromaTexture };
+	glDeleteFramebuffers(3, framebuffers);
+	glDeleteTextures(3, textures);
+	glDeleteVertexArrays(1, &vertexArray);
+	delete lumaProgram;
+	delete chromaProgram;
+}
+
+/// Passes on any frames that have finished reading back and takes back buffers
+/// the encoder is done with. This should be called every time round the frame
+/// loop, whether or not a frame is drawn
+void FrameCapture::update()
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	collect();
+	addCpuTime(start);
+}
+
+/// Decides whether to capture the frame about to be drawn
+/// @param _canvasWidth The width of the canvas the outputs show
+/// @param _canvasHeight The height of the canvas
+/// @returns true if the frame is being captured, in which case each output
+/// should be grabbed once it has been drawn
+bool FrameCapture::beginFrame(int _canvasWidth, int _canvasHeight)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	// Allow a little slack on the interval, or rounding would have us
+	// capture every other frame when we mean every one
+	double now = nowSeconds();
+	capturing = false;
+	if (now - lastCaptureTime >= minInterval * 0.9)
+	{
+		for (size_t i = 0; i < FRAME_CAPTURE_RING && !capturing; i++)
+		{
+			size_t slot = (nextSlot + i) % FRAME_CAPTURE_RING;
+			if (slots[slot].state == SLOT_FREE)
+			{
+				nextSlot = slot;
+				capturing = true;
+			}
+		}
+		if (!capturing)
+		{
+			droppedCount++;
+		}
+		lastCaptureTime = now;
+	}
+
+	// Anywhere the outputs don't cover is black
+	if (capturing)
+	{
+		canvasWidth = _canvasWidth;
+		canvasHeight = _canvasHeight;
+
+		GLint previousBinding = 0;
+		GLfloat previousClearColour[4];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousBinding);
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColour);
+		glBindFramebuffer(GL_FRAMEBUFFER, frameFramebuffer);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glClearColor(previousClearColour[0], previousClearColour[1], previousClearColour[2], previousClearColour[3]);
+		glBindFramebuffer(GL_FRAMEBUFFER, previousBinding);
+	}
+
+	addCpuTime(start);
+	return capturing;
+}
+
+/// Scales an output that has just been drawn, in the framebuffer that is bound,
+/// in to its place in the captured frame
+/// @param x Where the output is on the canvas
+/// @param y Where the output is on the canvas
+/// @param viewWidth The width of the output in pixels
+/// @param viewHeight The height of the output in pixels
+void FrameCapture::grabView(int x, int y, int viewWidth, int viewHeight)
+{
+	if (!capturing || canvasWidth <= 0 || canvasHeight <= 0)
+	{
+		return;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	// The canvas runs top to bottom and GL bottom to top
+	double scaleX = (double)width / canvasWidth;
+	double scaleY = (double)height / canvasHeight;
+	GLint previousBinding = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousBinding);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousBinding);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameFramebuffer);
+	glBlitFramebuffer(0, 0, viewWidth, viewHeight,
+		(GLint)(x * scaleX + 0.5), (GLint)((canvasHeight - y - viewHeight) * scaleY + 0.5),
+		(GLint)((x + viewWidth) * scaleX + 0.5), (GLint)((canvasHeight - y) * scaleY + 0.5),
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousBinding);
+
+	addCpuTime(start);
+}
+
+/// Converts the captured frame and starts reading it back
+void FrameCapture::endFrame()
+{
+	if (!capturing)
+	{
+		return;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	collectTimings();
+
+	// Time the GPU's side if there is a query free. If there isn't then the
+	// GPU is a long way behind and this frame goes untimed
+	GLuint query = 0;
+	if (timingSupported)
+	{
+		if (!freeQueries.empty())
+		{
+			query = freeQueries.back();
+			freeQueries.pop_back();
+		}
+		else if (pendingQueries.size() < FRAME_CAPTURE_MAX_QUERIES)
+		{
+			glGenQueries(1, &query);
+		}
+	}
+	if (query != 0)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+
+	GLint previousBinding = 0, previousViewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousBinding);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	// Convert to the luma and chroma planes
+	glDisable(GL_BLEND);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, frameTexture);
+	glBindVertexArray(vertexArray);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, lumaFramebuffer);
+	glViewport(0, 0, width, height);
+	lumaProgram->use();
+	glUniform1i(lumaFrameUniform, 0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, chromaFramebuffer);
+	glViewport(0, 0, width / 2, height);
+	chromaProgram->use();
+	glUniform1i(chromaFrameUniform, 0);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+
+	// Start reading the planes back in to the buffer one after the other,
+	// which is laid out as I420. This returns straight away
+	slot_t& slot = slots[nextSlot];
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, lumaFramebuffer);
+	glReadPixels(0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, (void*)0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, chromaFramebuffer);
+	glReadPixels(0, 0, width / 2, height, GL_RED, GL_UNSIGNED_BYTE, (void*)((size_t)width * height));
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.state = SLOT_READING;
+	slot.sequence = ++sequence;
+	slot.captureTime = nowSeconds();
+	readingSlots.push_back(nextSlot);
+	nextSlot = (nextSlot + 1) % FRAME_CAPTURE_RING;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousBinding);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+	if (query != 0)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pendingQueries.push_back(query);
+	}
+
+	// That's the end of this frame's capture, so count its time
+	addCpuTime(start);
+	cpuFrames++;
+	totalCpuMs += frameCpuMs;
+	if (frameCpuMs > maxCpuMs)
+	{
+		maxCpuMs = frameCpuMs;
+	}
+	frameCpuMs = 0.0;
+	capturing = false;
+}
+
+/// Gets the size of the stream
+void FrameCapture::getSize(int& _width, int& _height) const
+{
+	_width = width;
+	_height = height;
+}
+
+/// Gets the number of frames read back and handed to the encoder
+unsigned long long FrameCapture::getCapturedCount() const
+{
+	return capturedCount;
+}
+
+/// Gets the number of frames that weren't captured because every buffer was in
+/// use
+unsigned long long FrameCapture::getDroppedCount() const
+{
+	return droppedCount;
+}
+
+/// Gets the mean time the render thread spent capturing a frame, in
+/// milliseconds
+double FrameCapture::getAverageCpuMs() const
+{
+	return cpuFrames > 0 ? totalCpuMs / cpuFrames : 0.0;
+}
+
+/// Gets the longest time the render thread spent capturing a frame, in
+/// milliseconds
+double FrameCapture::getMaxCpuMs() const
+{
+	return maxCpuMs;
+}
+
+/// Gets the mean GPU time of converting and reading back a frame, in
+/// milliseconds, or zero if it can't be measured
+double FrameCapture::getAverageGpuMs() const
+{
+	return gpuFrames > 0 ? totalGpuMs / gpuFrames : 0.0;
+}
+
+/// Gets the longest GPU time of converting and reading back a frame, in
+/// milliseconds, or zero if it can't be measured
+double FrameCapture::getMaxGpuMs() const
+{
+	return maxGpuMs;
+}
+
+/// Unmaps buffers the encoder has finished with, and hands over the frames that
+/// have finished reading back, oldest first
+void FrameCapture::collect()
+{
+	for (size_t i = 0; i < FRAME_CAPTURE_RING; i++)
+	{
+		if (slots[i].state == SLOT_ENCODING && slots[i].released)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slots[i].state = SLOT_FREE;
+		}
+	}
+
+	// Fences signal in order, so stop at the first that hasn't
+	while (!readingSlots.empty())
+	{
+		slot_t& slot = slots[readingSlots.front()];
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		readingSlots.pop_front();
+
+		// The GPU is done with the buffer, so mapping it doesn't wait
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		const unsigned char* data = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 3 / 2, GL_MAP_READ_BIT);
+		if (result == GL_WAIT_FAILED || data == NULL)
+		{
+			LOG(LOG_ERROR, "FrameCapture::collect: Failed to read back frame %llu", slot.sequence);
+			if (data != NULL)
+			{
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			slot.state = SLOT_FREE;
+			continue;
+		}
+
+		captured_frame_t frame;
+		frame.data = data;
+		frame.width = width;
+		frame.height = height;
+		frame.sequence = slot.sequence;
+		frame.captureTime = slot.captureTime;
+		frame.released = &slot.released;
+		slot.released = false;
+		slot.state = SLOT_ENCODING;
+		capturedCount++;
+		encoder->submit(frame);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/// Collects the results of any finished timer queries
+void FrameCapture::collectTimings()
+{
+	// Queries finish in order, so stop at the first that isn't ready
+	while (!pendingQueries.empty())
+	{
+		GLuint query = pendingQueries.front();
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != GL_TRUE)
+		{
+			break;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+		double elapsedMs = elapsed / 1000000.0;
+		gpuFrames++;
+		totalGpuMs += elapsedMs;
+		if (elapsedMs > maxGpuMs)
+		{
+			maxGpuMs = elapsedMs;
+		}
+
+		freeQueries.push_back(query);
+		pendingQueries.pop_front();
+	}
+}
+
+/// Adds the time spent on the render thread since a point to the current
+/// frame's total
+void FrameCapture::addCpuTime(chrono::steady_clock::time_point since)
+{
+	frameCpuMs += chrono::duration_cast<chrono::duration<double, milli> >(chrono::steady_clock::now() - since).count();
+}
+
+/// Gets the current time in seconds
+double FrameCapture::nowSeconds()
+{
+	return chrono::duration_cast<chrono::duration<double> >(chrono::steady_clock::now().time_since_epoch()).count();
+}
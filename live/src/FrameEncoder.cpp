@@ -0,0 +1,252 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <chrono>
+#include <jpeglib.h>
+#include "FrameEncoder.h"
+#include "Log.h"
+
+/// libjpeg error manager that jumps back out of the encoder instead of exiting
+typedef struct encoder_error_t
+{
+	struct jpeg_error_mgr super;
+	jmp_buf jump;
+} encoder_error_t;
+
+/// Called by libjpeg on a fatal error
+static void encoder_error_exit(j_common_ptr info)
+{
+	encoder_error_t* error = (encoder_error_t*)info->err;
+	char message[JMSG_LENGTH_MAX];
+	(*info->err->format_message)(info, message);
+	LOG(LOG_ERROR, "FrameEncoder::encode: %s", message);
+	longjmp(error->jump, 1);
+}
+
+/// Gets the current time in seconds on the steady clock
+static double encoder_now()
+{
+	return chrono::duration_cast<chrono::duration<double> >(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Constructs a new FrameEncoder object and starts its threads
+/// @param _server The server to give encoded frames to
+/// @param threadCount The number of frames to encode at once
+/// @param _quality The JPEG quality, from 1 to 100
+FrameEncoder::FrameEncoder(StreamServer* _server, unsigned int threadCount, int _quality) :
+	server(_server),
+	quality(_quality),
+	stopping(false),
+	encodedCount(0),
+	totalEncodeMs(0.0),
+	maxEncodeMs(0.0),
+	totalLatencyMs(0.0),
+	totalBytes(0.0)
+{
+	if (threadCount < 1)
+	{
+		threadCount = 1;
+	}
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(thread(&FrameEncoder::workerMain, this));
+	}
+	LOG(LOG_DEBUG, "FrameEncoder::FrameEncoder: Encoding on %u threads at quality %d", threadCount, quality);
+}
+
+/// Destroys a FrameEncoder object, stopping its threads
+FrameEncoder::~FrameEncoder()
+{
+	stop();
+}
+
+/// Queues a frame to be encoded. This never blocks, and the frame's released
+/// flag is set once the data is no longer needed
+void FrameEncoder::submit(const captured_frame_t& frame)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		if (stopping)
+		{
+			*frame.released = true;
+			return;
+		}
+		queue.push_back(frame);
+	}
+	wake.notify_one();
+}
+
+/// Stops the threads, waiting for the frames being encoded and releasing any
+/// that are still queued
+void FrameEncoder::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+
+	for (auto& frame : queue)
+	{
+		*frame.released = true;
+	}
+	queue.clear();
+}
+
+/// Gets the number of frames encoded
+unsigned long long FrameEncoder::getEncodedCount() const
+{
+	lock_guard<mutex> guard(lock);
+	return encodedCount;
+}
+
+/// Gets the mean time to encode a frame, in milliseconds
+double FrameEncoder::getAverageEncodeMs() const
+{
+	lock_guard<mutex> guard(lock);
+	return encodedCount > 0 ? totalEncodeMs / encodedCount : 0.0;
+}
+
+/// Gets the longest time to encode a frame, in milliseconds
+double FrameEncoder::getMaxEncodeMs() const
+{
+	lock_guard<mutex> guard(lock);
+	return maxEncodeMs;
+}
+
+/// Gets the mean time from capturing a frame to it being encoded, in
+/// milliseconds
+double FrameEncoder::getAverageLatencyMs() const
+{
+	lock_guard<mutex> guard(lock);
+	return encodedCount > 0 ? totalLatencyMs / encodedCount : 0.0;
+}
+
+/// Gets the mean size of an encoded frame in bytes
+double FrameEncoder::getAverageFrameBytes() const
+{
+	lock_guard<mutex> guard(lock);
+	return encodedCount > 0 ? totalBytes / encodedCount : 0.0;
+}
+
+/// Entry point for the encoding threads
+void FrameEncoder::workerMain()
+{
+	unique_lock<mutex> guard(lock);
+	while (true)
+	{
+		wake.wait(guard, [this]() { return stopping || !queue.empty(); });
+		if (stopping)
+		{
+			break;
+		}
+
+		captured_frame_t frame = queue.front();
+		queue.pop_front();
+		guard.unlock();
+
+		// The pixel buffer goes back to the ring as soon as the frame is
+		// compressed, before it is sent anywhere
+		double start = encoder_now();
+		unsigned char* output = NULL;
+		unsigned long outputLength = 0;
+		bool encoded = encode(frame, &output, &outputLength);
+		*frame.released = true;
+		double end = encoder_now();
+
+		if (encoded)
+		{
+			server->publish(output, outputLength, frame.sequence);
+		}
+		else
+		{
+			free(output);
+		}
+
+		guard.lock();
+		if (encoded)
+		{
+			double encodeMs = (end - start) * 1000.0;
+			encodedCount++;
+			totalEncodeMs += encodeMs;
+			if (encodeMs > maxEncodeMs)
+			{
+				maxEncodeMs = encodeMs;
+			}
+			totalLatencyMs += (end - frame.captureTime) * 1000.0;
+			totalBytes += outputLength;
+		}
+	}
+}
+
+/// Encodes a frame as JPEG
+/// @param frame The frame to encode
+/// @param output Set to the encoded frame, allocated with malloc()
+/// @param outputLength Set to the length of the encoded frame
+/// @returns true on success, false otherwise
+bool FrameEncoder::encode(const captured_frame_t& frame, unsigned char** output, unsigned long* outputLength)
+{
+	struct jpeg_compress_struct info;
+	encoder_error_t error;
+	info.err = jpeg_std_error(&error.super);
+	error.super.error_exit = encoder_error_exit;
+	if (setjmp(error.jump))
+	{
+		jpeg_destroy_compress(&info);
+		return false;
+	}
+
+	jpeg_create_compress(&info);
+	jpeg_mem_dest(&info, output, outputLength);
+	info.image_width = frame.width;
+	info.image_height = frame.height;
+	info.input_components = 3;
+	info.in_color_space = JCS_YCbCr;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, quality, TRUE);
+	info.dct_method = JDCT_IFAST;
+
+	// The planes go in as they are: full size luma and quarter size
+	// chroma, which is what a 4:2:0 JPEG holds
+	info.raw_data_in = TRUE;
+	info.comp_info[0].h_samp_factor = info.comp_info[0].v_samp_factor = 2;
+	info.comp_info[1].h_samp_factor = info.comp_info[1].v_samp_factor = 1;
+	info.comp_info[2].h_samp_factor = info.comp_info[2].v_samp_factor = 1;
+	jpeg_start_compress(&info, TRUE);
+
+	// Rows are passed sixteen luma rows and eight of each chroma at a time,
+	// pointing straight in to the frame
+	const unsigned char* planes[3];
+	planes[0] = frame.data;
+	planes[1] = planes[0] + frame.width * frame.height;
+	planes[2] = planes[1] + frame.width * frame.height / 4;
+	JSAMPROW lumaRows[16], uRows[8], vRows[8];
+	JSAMPARRAY rows[3] = { lumaRows, uRows, vRows };
+	while (info.next_scanline < info.image_height)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			lumaRows[i] = (JSAMPROW)(planes[0] + (info.next_scanline + i) * frame.width);
+		}
+		for (int i = 0; i < 8; i++)
+		{
+			uRows[i] = (JSAMPROW)(planes[1] + (info.next_scanline / 2 + i) * (frame.width / 2));
+			vRows[i] = (JSAMPROW)(planes[2] + (info.next_scanline / 2 + i) * (frame.width / 2));
+		}
+		jpeg_write_raw_data(&info, rows, 16);
+	}
+
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+	return true;
+}
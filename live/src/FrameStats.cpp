@@ -0,0 +1,187 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <algorithm>
+#include "FrameStats.h"
+#include "Log.h"
+
+/// Constructs a new FrameStats object
+/// @param _historySize The number of recent frames to keep
+FrameStats::FrameStats(size_t _historySize) :
+	history(_historySize > 0 ? _historySize : 1),
+	historyNext(0),
+	historyCount(0),
+	vsyncInterval(1.0 / 60.0),
+	totalFrames(0),
+	idleFrames(0),
+	missedVsyncs(0),
+	totalQualityChanges(0),
+	qualityLevel(0)
+{
+}
+
+/// Sets the expected time between vsyncs, used to spot missed vsyncs
+/// @param _vsyncInterval The vsync interval in seconds
+void FrameStats::setVsyncInterval(double _vsyncInterval)
+{
+	vsyncInterval = _vsyncInterval;
+}
+
+/// Gets the expected time between vsyncs in seconds
+double FrameStats::getVsyncInterval() const
+{
+	return vsyncInterval;
+}
+
+/// Records a presented frame
+/// @param frameTime The time since the previous frame was presented, in seconds
+/// @param timed false if there was no previously presented frame to time this
+/// one against, in which case only the total is updated
+void FrameStats::addFrame(double frameTime, bool timed)
+{
+	totalFrames++;
+	if (!timed)
+	{
+		return;
+	}
+
+	history[historyNext] = frameTime;
+	historyNext = (historyNext + 1) % history.size();
+	if (historyCount < history.size())
+	{
+		historyCount++;
+	}
+
+	// A frame that took more than one and a half intervals must have
+	// missed at least one vsync
+	if (frameTime > vsyncInterval * 1.5)
+	{
+		missedVsyncs++;
+	}
+}
+
+/// Records a frame interval in which nothing had changed, so nothing was drawn
+/// or presented
+void FrameStats::addIdleFrame()
+{
+	idleFrames++;
+}
+
+/// Records a change of rendering quality level
+/// @param fromLevel The level before the change
+/// @param toLevel The level after the change
+void FrameStats::addQualityChange(int fromLevel, int toLevel)
+{
+	quality_change_t change;
+	change.frame = totalFrames;
+	change.fromLevel = fromLevel;
+	change.toLevel = toLevel;
+	change.meanFrameTime = getMean();
+	change.p99FrameTime = getPercentile(99.0);
+	qualityChanges.push_back(change);
+	if (qualityChanges.size() > FRAMESTATS_QUALITY_HISTORY)
+	{
+		qualityChanges.pop_front();
+	}
+	totalQualityChanges++;
+	qualityLevel = toLevel;
+}
+
+/// Gets the recent quality level changes, oldest first
+const deque<quality_change_t>& FrameStats::getQualityChanges() const
+{
+	return qualityChanges;
+}
+
+/// Gets the total number of quality level changes
+unsigned long long FrameStats::getTotalQualityChanges() const
+{
+	return totalQualityChanges;
+}
+
+/// Gets the current quality level
+int FrameStats::getQualityLevel() const
+{
+	return qualityLevel;
+}
+
+/// Clears the rolling record (but not the running totals)
+void FrameStats::reset()
+{
+	historyNext = 0;
+	historyCount = 0;
+}
+
+/// Gets a percentile of the recent frame times
+/// @param percentile The percentile to get, from 0 to 100
+/// @returns The frame time in seconds, or zero if there are no frames
+double FrameStats::getPercentile(double percentile) const
+{
+	if (historyCount == 0)
+	{
+		return 0.0;
+	}
+
+	// Take a copy of the valid part of the history and find the nth element
+	vector<double> sorted(history.begin(), history.begin() + historyCount);
+	size_t index = (size_t)((percentile / 100.0) * (historyCount - 1) + 0.5);
+	if (index >= historyCount)
+	{
+		index = historyCount - 1;
+	}
+	nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+
+	return sorted[index];
+}
+
+/// Gets the mean of the recent frame times in seconds
+double FrameStats::getMean() const
+{
+	if (historyCount == 0)
+	{
+		return 0.0;
+	}
+
+	double total = 0.0;
+	for (size_t i = 0; i < historyCount; i++)
+	{
+		total += history[i];
+	}
+
+	return total / historyCount;
+}
+
+/// Gets the number of frames in the rolling record
+size_t FrameStats::getHistoryCount() const
+{
+	return historyCount;
+}
+
+/// Gets the total number of frames presented
+unsigned long long FrameStats::getTotalFrames() const
+{
+	return totalFrames;
+}
+
+/// Gets the total number of frame intervals that were skipped because nothing
+/// had changed
+unsigned long long FrameStats::getIdleFrames() const
+{
+	return idleFrames;
+}
+
+/// Gets the total number of frames that missed at least one vsync
+unsigned long long FrameStats::getMissedVsyncs() const
+{
+	return missedVsyncs;
+}
+
+/// Writes a one-line summary of the statistics to the log
+/// @param logLevel The level to log at
+void FrameStats::log(int logLevel) const
+{
+	double mean = getMean();
+	LOG(logLevel, "FrameStats: %llu frames rendered, %llu idle, %.1f fps, p50 %.2fms, p99 %.2fms, %llu missed vsyncs, quality level %d after %llu changes", totalFrames, idleFrames, mean > 0.0 ? 1.0 / mean : 0.0, getPercentile(50.0) * 1000.0, getPercentile(99.0) * 1000.0, missedVsyncs, qualityLevel, totalQualityChanges);
+}
@@ -0,0 +1,235 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "GlyphAtlas.h"
+#include "Log.h"
+
+// Definitions:
+#define GLYPHATLAS_PADDING   1
+
+/// Constructs a new GlyphAtlas object. A GL context must be current
+/// @param _size The width and height of the atlas texture
+GlyphAtlas::GlyphAtlas(int _size) :
+	size(_size),
+	texture(0),
+	frame(0),
+	rasterisedCount(0),
+	evictionCount(0)
+{
+	// Start with a cleared single-channel texture
+	vector<unsigned char> blank(size * size, 0);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, &blank[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/// Destroys a GlyphAtlas object and its texture
+GlyphAtlas::~GlyphAtlas()
+{
+	glDeleteTextures(1, &texture);
+}
+
+/// Starts a new frame. Glyphs used in this frame will not be evicted until a
+/// later frame
+void GlyphAtlas::beginFrame()
+{
+	frame++;
+}
+
+/// Gets a glyph, rasterising it in to the atlas if necessary
+/// @param face The face to rasterise with, already set to pixelSize
+/// @param faceId A unique identifier for the face
+/// @param pixelSize The pixel size the face is set to
+/// @param glyphIndex The index of the glyph within the face
+/// @returns The glyph, or NULL if it couldn't be rasterised or fitted in
+const atlas_glyph_t* GlyphAtlas::getGlyph(FT_Face face, unsigned int faceId, unsigned int pixelSize, FT_UInt glyphIndex)
+{
+	unsigned long long key = ((unsigned long long)faceId << 48) | ((unsigned long long)pixelSize << 32) | glyphIndex;
+
+	// Already in the atlas?
+	auto glyphIter = glyphs.find(key);
+	if (glyphIter != glyphs.end())
+	{
+		shelves[glyphIter->second.shelf].lastUsedFrame = frame;
+		return &glyphIter->second;
+	}
+
+	// Rasterise it
+	if (FT_Load_Glyph(face, glyphIndex, FT_LOAD_RENDER) != 0)
+	{
+		return NULL;
+	}
+	FT_Bitmap& bitmap = face->glyph->bitmap;
+	int x = 0, y = 0;
+	int shelfIndex = allocate(bitmap.width + GLYPHATLAS_PADDING, bitmap.rows + GLYPHATLAS_PADDING, x, y);
+	if (shelfIndex < 0)
+	{
+		LOG(LOG_WARN, "GlyphAtlas::getGlyph: Atlas is full, dropping glyph %u", glyphIndex);
+		return NULL;
+	}
+
+	// Upload it (whitespace has no bitmap at all)
+	if (bitmap.width > 0 && bitmap.rows > 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap.pitch);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, bitmap.width, bitmap.rows, GL_RED, GL_UNSIGNED_BYTE, bitmap.buffer);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	rasterisedCount++;
+
+	atlas_glyph_t& glyph = glyphs[key];
+	glyph.u0 = (float)x / size;
+	glyph.v0 = (float)y / size;
+	glyph.u1 = (float)(x + bitmap.width) / size;
+	glyph.v1 = (float)(y + bitmap.rows) / size;
+	glyph.width = bitmap.width;
+	glyph.height = bitmap.rows;
+	glyph.bearingX = face->glyph->bitmap_left;
+	glyph.bearingY = face->glyph->bitmap_top;
+	glyph.shelf = shelfIndex;
+	shelves[shelfIndex].glyphs.push_back(key);
+	shelves[shelfIndex].lastUsedFrame = frame;
+
+	return &glyph;
+}
+
+/// Marks a shelf as used in this frame, for when a glyph on it is drawn without
+/// being looked up again
+/// @param shelf The shelf, from atlas_glyph_t::shelf
+void GlyphAtlas::touch(int shelf)
+{
+	shelves[shelf].lastUsedFrame = frame;
+}
+
+/// Gets the atlas texture
+GLuint GlyphAtlas::getTexture() const
+{
+	return texture;
+}
+
+/// Gets the generation of a shelf, which changes whenever its glyphs are
+/// evicted
+/// @param shelf The shelf, from atlas_glyph_t::shelf
+unsigned int GlyphAtlas::getShelfGeneration(int shelf) const
+{
+	return shelves[shelf].generation;
+}
+
+/// Gets the number of glyphs rasterised since the atlas was created
+unsigned long long GlyphAtlas::getRasterisedCount() const
+{
+	return rasterisedCount;
+}
+
+/// Gets the number of shelves evicted since the atlas was created
+unsigned long long GlyphAtlas::getEvictionCount() const
+{
+	return evictionCount;
+}
+
+/// Finds space for a bitmap of the given size, evicting if needed
+/// @param width The width needed, including padding
+/// @param height The height needed, including padding
+/// @param x Set to the left of the space
+/// @param y Set to the top of the space
+/// @returns The index of the shelf, or -1 if there is no space
+int GlyphAtlas::allocate(int width, int height, int& x, int& y)
+{
+	if (width > size || height > size)
+	{
+		return -1;
+	}
+
+	// Best fit: the shortest existing shelf that is tall enough and has room,
+	// as long as it isn't wastefully tall
+	int bestShelf = -1;
+	for (size_t i = 0; i < shelves.size(); i++)
+	{
+		shelf_t& shelf = shelves[i];
+		if (shelf.height >= height && shelf.height <= height + height / 2 + 2 && shelf.x + width <= size)
+		{
+			if (bestShelf < 0 || shelf.height < shelves[bestShelf].height)
+			{
+				bestShelf = (int)i;
+			}
+		}
+	}
+
+	// Otherwise open a new shelf underneath the last one
+	if (bestShelf < 0)
+	{
+		int top = shelves.empty() ? 0 : shelves.back().y + shelves.back().height;
+		if (top + height <= size)
+		{
+			shelf_t shelf;
+			shelf.y = top;
+			shelf.height = height;
+			shelf.x = 0;
+			shelf.lastUsedFrame = frame;
+			shelf.generation = 0;
+			shelves.push_back(shelf);
+			bestShelf = (int)shelves.size() - 1;
+		}
+	}
+
+	// Otherwise evict the least-recently-used shelf that is tall enough
+	if (bestShelf < 0)
+	{
+		for (size_t i = 0; i < shelves.size(); i++)
+		{
+			shelf_t& shelf = shelves[i];
+			if (shelf.height >= height && shelf.lastUsedFrame < frame)
+			{
+				if (bestShelf < 0 || shelf.lastUsedFrame < shelves[bestShelf].lastUsedFrame)
+				{
+					bestShelf = (int)i;
+				}
+			}
+		}
+
+		if (bestShelf < 0)
+		{
+			return -1;
+		}
+		evictShelf(bestShelf);
+	}
+
+	shelf_t& shelf = shelves[bestShelf];
+	x = shelf.x;
+	y = shelf.y;
+	shelf.x += width;
+	return bestShelf;
+}
+
+/// Evicts every glyph on a shelf and clears it
+void GlyphAtlas::evictShelf(size_t shelfIndex)
+{
+	shelf_t& shelf = shelves[shelfIndex];
+	for (auto key : shelf.glyphs)
+	{
+		glyphs.erase(key);
+	}
+	shelf.glyphs.clear();
+	shelf.x = 0;
+
+	// Clear the old pixels so they can't bleed in to new neighbours
+	vector<unsigned char> blank(size * shelf.height, 0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, shelf.y, size, shelf.height, GL_RED, GL_UNSIGNED_BYTE, &blank[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	shelf.generation++;
+	evictionCount++;
+}
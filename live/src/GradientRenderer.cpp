@@ -0,0 +1,121 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <math.h>
+#include "GradientRenderer.h"
+
+/// Vertex shader: builds the quad from four vertices of a triangle strip and
+/// passes on the position within the rectangle, centred on its middle
+static const char* g_gradientVertexShader =
+	"#version 150\n"
+	"uniform vec2 viewport;\n"
+	"uniform vec4 rect;\n"
+	"out vec2 local;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	vec2 position = rect.xy + corner * rect.zw;\n"
+	"	local = (corner - 0.5) * rect.zw;\n"
+	"	gl_Position = vec4(position.x / viewport.x * 2.0 - 1.0, 1.0 - position.y / viewport.y * 2.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Fragment shader: works out how far along the gradient the pixel is, then
+/// blends between the two stops either side of it
+static const char* g_gradientFragmentShader =
+	"#version 150\n"
+	"#define MAX_STOPS 8\n"
+	"uniform vec4 rect;\n"
+	"uniform bool radial;\n"
+	"uniform vec2 direction;\n"
+	"uniform int stopCount;\n"
+	"uniform vec4 colours[MAX_STOPS];\n"
+	"uniform float positions[MAX_STOPS];\n"
+	"in vec2 local;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	float t;\n"
+	"	if (radial)\n"
+	"	{\n"
+	"		t = length(local / (rect.zw * 0.5));\n"
+	"	}\n"
+	"	else\n"
+	"	{\n"
+	"		float extent = abs(direction.x) * rect.z + abs(direction.y) * rect.w;\n"
+	"		t = dot(local, direction) / extent + 0.5;\n"
+	"	}\n"
+	"	fragColour = colours[0];\n"
+	"	for (int i = 1; i < stopCount; i++)\n"
+	"	{\n"
+	"		float span = max(positions[i] - positions[i - 1], 0.00001);\n"
+	"		fragColour = mix(fragColour, colours[i], clamp((t - positions[i - 1]) / span, 0.0, 1.0));\n"
+	"	}\n"
+	"}\n";
+
+/// Constructs a new GradientRenderer object. A GL context must be current
+GradientRenderer::GradientRenderer() :
+	program(g_gradientVertexShader, g_gradientFragmentShader),
+	vertexArray(0),
+	viewportWidth(1),
+	viewportHeight(1)
+{
+	viewportUniform = program.getUniformLocation("viewport");
+	rectUniform = program.getUniformLocation("rect");
+	radialUniform = program.getUniformLocation("radial");
+	directionUniform = program.getUniformLocation("direction");
+	stopCountUniform = program.getUniformLocation("stopCount");
+	coloursUniform = program.getUniformLocation("colours");
+	positionsUniform = program.getUniformLocation("positions");
+
+	// A core context needs a VAO bound to draw, even with no attributes
+	glGenVertexArrays(1, &vertexArray);
+}
+
+/// Destroys a GradientRenderer object and its GL resources
+GradientRenderer::~GradientRenderer()
+{
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+/// Starts a new frame
+/// @param _viewportWidth The width of the viewport in pixels
+/// @param _viewportHeight The height of the viewport in pixels
+void GradientRenderer::beginFrame(int _viewportWidth, int _viewportHeight)
+{
+	viewportWidth = _viewportWidth;
+	viewportHeight = _viewportHeight;
+}
+
+/// Draws a gradient
+void GradientRenderer::draw(const gradient_t& gradient)
+{
+	int stopCount = gradient.stopCount;
+	if (stopCount < 1)
+	{
+		return;
+	}
+	if (stopCount > GRADIENT_MAX_STOPS)
+	{
+		stopCount = GRADIENT_MAX_STOPS;
+	}
+
+	// Angles run clockwise, and y runs down the screen
+	double radians = gradient.angle * M_PI / 180.0;
+
+	program.use();
+	glUniform2f(viewportUniform, (float)viewportWidth, (float)viewportHeight);
+	glUniform4f(rectUniform, gradient.x, gradient.y, gradient.width, gradient.height);
+	glUniform1i(radialUniform, gradient.radial ? 1 : 0);
+	glUniform2f(directionUniform, (float)cos(radians), (float)sin(radians));
+	glUniform1i(stopCountUniform, stopCount);
+	glUniform4fv(coloursUniform, stopCount, &gradient.colours[0][0]);
+	glUniform1fv(positionsUniform, stopCount, gradient.positions);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindVertexArray(vertexArray);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+}
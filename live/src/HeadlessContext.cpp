@@ -0,0 +1,145 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "HeadlessContext.h"
+#include <EGL/eglext.h>
+#include <png.h>
+#include <string.h>
+#include <vector>
+#include "AuraException.h"
+#include "Log.h"
+
+/// Constructs a new HeadlessContext object, makes the context current and binds
+/// the framebuffer. Throws an AuraException on failure
+/// @param _width The width of the framebuffer in pixels
+/// @param _height The height of the framebuffer in pixels
+HeadlessContext::HeadlessContext(int _width, int _height) :
+	width(_width),
+	height(_height),
+	display(EGL_NO_DISPLAY),
+	context(EGL_NO_CONTEXT),
+	framebuffer(0),
+	colourBuffer(0)
+{
+	// Ask for the surfaceless platform explicitly if we can, so that we don't
+	// go looking for an X server or a DRM device
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (clientExtensions != NULL && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL && getPlatformDisplay != NULL)
+	{
+		LOG(LOG_DEBUG, "HeadlessContext::HeadlessContext: Using the EGL surfaceless platform");
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	else
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		throw AuraException(AURA_ERR_HEADLESSFAILED, "Failed to initialise EGL");
+	}
+	LOG(LOG_DEBUG, "HeadlessContext::HeadlessContext: EGL %d.%d (%s)", major, minor, eglQueryString(display, EGL_VENDOR));
+
+	// We never create a surface, so don't ask for any
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, 0,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount < 1)
+	{
+		eglTerminate(display);
+		throw AuraException(AURA_ERR_HEADLESSFAILED, "No suitable EGL config for OpenGL");
+	}
+
+	// Set OpenGL 3.2 core, the same as the windowed context
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 2,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		if (context != EGL_NO_CONTEXT)
+		{
+			eglDestroyContext(display, context);
+		}
+		eglTerminate(display);
+		throw AuraException(AURA_ERR_HEADLESSFAILED, "Failed to create a surfaceless OpenGL 3.2 context");
+	}
+	LOG(LOG_DEBUG, "HeadlessContext::HeadlessContext: OpenGL %s on %s", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+	// Everything is drawn in to this instead of a window
+	glGenRenderbuffers(1, &colourBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colourBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		throw AuraException(AURA_ERR_HEADLESSFAILED, "Offscreen framebuffer is incomplete");
+	}
+}
+
+/// Destroys a HeadlessContext object, its framebuffer and context
+HeadlessContext::~HeadlessContext()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &colourBuffer);
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+/// Gets the size of the framebuffer in pixels
+void HeadlessContext::getSize(int& _width, int& _height) const
+{
+	_width = width;
+	_height = height;
+}
+
+/// Waits for rendering to finish, in place of swapping buffers
+void HeadlessContext::finish()
+{
+	glFinish();
+}
+
+/// Saves the contents of the framebuffer as a PNG
+/// @param filename The file to write
+/// @returns true on success, false otherwise
+bool HeadlessContext::saveFrame(const string& filename)
+{
+	vector<unsigned char> pixels((size_t)width * height * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	// GL rows go bottom to top, so write them out with a negative stride
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	png.width = width;
+	png.height = height;
+	png.format = PNG_FORMAT_RGBA;
+	if (!png_image_write_to_file(&png, filename.c_str(), 0, &pixels[0], -width * 4, NULL))
+	{
+		LOG(LOG_ERROR, "HeadlessContext::saveFrame: Failed to write '%s': %s", filename.c_str(), png.message);
+		return false;
+	}
+
+	return true;
+}
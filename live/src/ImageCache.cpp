@@ -0,0 +1,510 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdio.h>
+#include <string.h>
+#include "ImageCache.h"
+#include "Log.h"
+
+// Definitions:
+#define IMAGECACHE_PADDING   1
+
+/// A run of rows copied in to the current upload buffer
+typedef struct upload_chunk_t
+{
+	GLuint texture;
+	int x, y, width, rows;
+	size_t offset;
+} upload_chunk_t;
+
+/// Constructs a new ImageCache object. A GL context must be current
+ImageCache::ImageCache() :
+	nextUploadBuffer(0),
+	frame(0),
+	decodedCount(0),
+	uploadedBytes(0),
+	evictionCount(0),
+	prefetchCount(0),
+	cancelCount(0)
+{
+	glGenBuffers(IMAGECACHE_UPLOAD_BUFFERS, uploadBuffers);
+	for (int i = 0; i < IMAGECACHE_UPLOAD_BUFFERS; i++)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, IMAGECACHE_UPLOAD_BUDGET, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/// Destroys an ImageCache object and its textures
+ImageCache::~ImageCache()
+{
+	for (auto& entry : entries)
+	{
+		if (entry.second.decoded != NULL)
+		{
+			delete entry.second.decoded;
+		}
+	}
+
+	for (auto& page : pages)
+	{
+		glDeleteTextures(1, &page.texture);
+	}
+	glDeleteBuffers(IMAGECACHE_UPLOAD_BUFFERS, uploadBuffers);
+}
+
+/// Starts a new frame. Images used in this frame will not be evicted until a
+/// later frame
+void ImageCache::beginFrame()
+{
+	frame++;
+}
+
+/// Gets an image, starting to load it if necessary
+/// @param source The URL or file name of the image
+/// @param width The width the image will be displayed at
+/// @param height The height the image will be displayed at
+/// @returns The image, or NULL if it isn't loaded (yet)
+const cached_image_t* ImageCache::get(const string& source, int width, int height)
+{
+	image_entry_t* entry = find(source, width, height, 0);
+	return entry != NULL && entry->state == IMAGE_STATE_READY ? &entry->image : NULL;
+}
+
+/// Starts loading an image that will be displayed soon, without waiting for it
+/// to be drawn. Images that are drawn are always loaded first, and prefetched
+/// ones are kept as if they were drawn
+/// @param source The URL or file name of the image
+/// @param width The width the image will be displayed at
+/// @param height The height the image will be displayed at
+/// @param priority How soon the image is needed, from one upwards; lower
+/// values are loaded first
+/// @returns true if the image is ready to draw
+bool ImageCache::prefetch(const string& source, int width, int height, int priority)
+{
+	if (priority < 1)
+	{
+		priority = 1;
+	}
+
+	size_t entryCount = entries.size();
+	image_entry_t* entry = find(source, width, height, priority);
+	if (entries.size() > entryCount)
+	{
+		prefetchCount++;
+	}
+
+	return entry != NULL && entry->state == IMAGE_STATE_READY;
+}
+
+/// Stops loading an image that is no longer needed. Images that have already
+/// been decoded are kept
+/// @param source The URL or file name of the image
+/// @param width The width the image was to be displayed at
+/// @param height The height the image was to be displayed at
+void ImageCache::cancel(const string& source, int width, int height)
+{
+	string key;
+	if (!makeKey(source, width, height, key))
+	{
+		return;
+	}
+
+	auto entryIter = entries.find(key);
+	if (entryIter == entries.end() || entryIter->second.state != IMAGE_STATE_DECODING)
+	{
+		return;
+	}
+
+	// Anything the decoder has already started on is dropped when it's
+	// collected, as the entry will have gone
+	decoder.cancel(key);
+	entries.erase(entryIter);
+	cancelCount++;
+}
+
+/// Collects decoded images and uploads some of them. Call this once per loop
+/// whether or not a frame is drawn
+/// @returns true if an image has finished loading since the last call
+bool ImageCache::update()
+{
+	decoded_image_t* decoded;
+	while ((decoded = decoder.collect()) != NULL)
+	{
+		// The entry may have been evicted whilst it was being decoded
+		auto entryIter = entries.find(decoded->key);
+		if (entryIter == entries.end() || entryIter->second.state != IMAGE_STATE_DECODING)
+		{
+			delete decoded;
+			continue;
+		}
+
+		image_entry_t& entry = entryIter->second;
+		if (decoded->failed)
+		{
+			entry.state = IMAGE_STATE_FAILED;
+			delete decoded;
+			continue;
+		}
+
+		decodedCount++;
+		entry.state = IMAGE_STATE_WAITING;
+		entry.decoded = decoded;
+		uploadQueue.push_back(decoded->key);
+	}
+
+	return upload();
+}
+
+/// Gets the number of images decoded since the cache was created
+unsigned long long ImageCache::getDecodedCount() const
+{
+	return decodedCount;
+}
+
+/// Gets the number of bytes uploaded since the cache was created
+unsigned long long ImageCache::getUploadedBytes() const
+{
+	return uploadedBytes;
+}
+
+/// Gets the number of pages evicted since the cache was created
+unsigned long long ImageCache::getEvictionCount() const
+{
+	return evictionCount;
+}
+
+/// Gets the number of images prefetched since the cache was created
+unsigned long long ImageCache::getPrefetchCount() const
+{
+	return prefetchCount;
+}
+
+/// Gets the number of prefetched images cancelled before they were decoded
+unsigned long long ImageCache::getCancelCount() const
+{
+	return cancelCount;
+}
+
+/// Gets the average time taken to fetch and decode an image, in seconds, or
+/// zero if none have been loaded yet
+double ImageCache::getAverageLatency() const
+{
+	return decoder.getAverageLatency();
+}
+
+/// Gets the number of images waiting to be fetched or decoded
+size_t ImageCache::getDecodeQueueLength() const
+{
+	return decoder.getQueuedCount();
+}
+
+/// Gets the number of atlas pages allocated
+size_t ImageCache::getPageCount() const
+{
+	return pages.size();
+}
+
+/// Gets the key of an image, rounding its size up to a step so that an element
+/// that changes size slightly doesn't cause the image to be decoded again
+/// @returns false if the image can't be loaded
+bool ImageCache::makeKey(const string& source, int& width, int& height, string& key)
+{
+	if (source.empty() || width <= 0 || height <= 0)
+	{
+		return false;
+	}
+
+	width = (width + IMAGECACHE_SIZE_STEP - 1) / IMAGECACHE_SIZE_STEP * IMAGECACHE_SIZE_STEP;
+	height = (height + IMAGECACHE_SIZE_STEP - 1) / IMAGECACHE_SIZE_STEP * IMAGECACHE_SIZE_STEP;
+	if (width > IMAGECACHE_PAGE_SIZE - IMAGECACHE_PADDING)
+	{
+		width = IMAGECACHE_PAGE_SIZE - IMAGECACHE_PADDING;
+	}
+	if (height > IMAGECACHE_PAGE_SIZE - IMAGECACHE_PADDING)
+	{
+		height = IMAGECACHE_PAGE_SIZE - IMAGECACHE_PADDING;
+	}
+
+	char size[32];
+	snprintf(size, sizeof(size), "@%dx%d", width, height);
+	key = source + size;
+	return true;
+}
+
+/// Finds an image or starts loading it
+/// @returns The entry, or NULL if the image can't be loaded
+ImageCache::image_entry_t* ImageCache::find(const string& source, int width, int height, int priority)
+{
+	string key;
+	if (!makeKey(source, width, height, key))
+	{
+		return NULL;
+	}
+
+	auto entryIter = entries.find(key);
+	if (entryIter == entries.end())
+	{
+		image_entry_t& entry = entries[key];
+		entry.state = IMAGE_STATE_DECODING;
+		entry.priority = priority;
+		entry.decoded = NULL;
+		entry.page = -1;
+		entry.x = 0;
+		entry.y = 0;
+		entry.uploadedRows = 0;
+		decoder.request(key, source, width, height, priority);
+		return &entry;
+	}
+
+	// An image that is needed sooner than it was asked for jumps the queue
+	image_entry_t& entry = entryIter->second;
+	if (entry.state == IMAGE_STATE_DECODING && priority < entry.priority)
+	{
+		entry.priority = priority;
+		decoder.setPriority(key, priority);
+	}
+
+	// Keep the page from being evicted whilst the image is on screen (or on
+	// its way there)
+	if (entry.page >= 0)
+	{
+		pages[entry.page].lastUsedFrame = frame;
+	}
+
+	return &entry;
+}
+
+/// Finds space for an image, evicting a page if needed
+/// @returns false if there is no space
+bool ImageCache::allocate(int width, int height, int& page, int& x, int& y)
+{
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		if (allocateInPage(pages[i], width, height, x, y))
+		{
+			page = (int)i;
+			return true;
+		}
+	}
+
+	// Start a new page if we're allowed
+	if (pages.size() < IMAGECACHE_MAX_PAGES)
+	{
+		page_t newPage;
+		newPage.lastUsedFrame = frame;
+		glGenTextures(1, &newPage.texture);
+		glBindTexture(GL_TEXTURE_2D, newPage.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMAGECACHE_PAGE_SIZE, IMAGECACHE_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		pages.push_back(newPage);
+		LOG(LOG_DEBUG, "ImageCache::allocate: Created page %u", (unsigned int)pages.size() - 1);
+
+		page = (int)pages.size() - 1;
+		return allocateInPage(pages.back(), width, height, x, y);
+	}
+
+	// Otherwise empty the least-recently-used page that isn't on screen
+	int oldest = -1;
+	for (size_t i = 0; i < pages.size(); i++)
+	{
+		if (pages[i].lastUsedFrame < frame && (oldest < 0 || pages[i].lastUsedFrame < pages[oldest].lastUsedFrame))
+		{
+			oldest = (int)i;
+		}
+	}
+	if (oldest < 0)
+	{
+		return false;
+	}
+
+	evictPage(oldest);
+	page = oldest;
+	return allocateInPage(pages[oldest], width, height, x, y);
+}
+
+/// Finds space for an image in a page
+/// @returns false if there is no space
+bool ImageCache::allocateInPage(page_t& page, int width, int height, int& x, int& y)
+{
+	width += IMAGECACHE_PADDING;
+	height += IMAGECACHE_PADDING;
+
+	// Best fit: the shortest shelf that is tall enough and has room, as long
+	// as it isn't wastefully tall
+	shelf_t* best = NULL;
+	for (auto& shelf : page.shelves)
+	{
+		if (shelf.height >= height && shelf.height <= height + height / 2 && shelf.x + width <= IMAGECACHE_PAGE_SIZE)
+		{
+			if (best == NULL || shelf.height < best->height)
+			{
+				best = &shelf;
+			}
+		}
+	}
+
+	// Otherwise open a new shelf underneath the last one
+	if (best == NULL)
+	{
+		int top = page.shelves.empty() ? 0 : page.shelves.back().y + page.shelves.back().height;
+		if (top + height > IMAGECACHE_PAGE_SIZE || width > IMAGECACHE_PAGE_SIZE)
+		{
+			return false;
+		}
+
+		shelf_t shelf;
+		shelf.y = top;
+		shelf.height = height;
+		shelf.x = 0;
+		page.shelves.push_back(shelf);
+		best = &page.shelves.back();
+	}
+
+	x = best->x;
+	y = best->y;
+	best->x += width;
+	page.lastUsedFrame = frame;
+	return true;
+}
+
+/// Removes every image on a page and empties it
+void ImageCache::evictPage(size_t pageIndex)
+{
+	page_t& page = pages[pageIndex];
+	for (auto& key : page.keys)
+	{
+		auto entryIter = entries.find(key);
+		if (entryIter != entries.end())
+		{
+			if (entryIter->second.decoded != NULL)
+			{
+				delete entryIter->second.decoded;
+			}
+			entries.erase(entryIter);
+		}
+	}
+	page.keys.clear();
+	page.shelves.clear();
+
+	evictionCount++;
+	LOG(LOG_DEBUG, "ImageCache::evictPage: Evicted page %u", (unsigned int)pageIndex);
+}
+
+/// Uploads up to the per-call budget of waiting rows
+/// @returns true if an image finished uploading
+bool ImageCache::upload()
+{
+	bool finished = false;
+	unsigned char* mapped = NULL;
+	size_t used = 0;
+	vector<upload_chunk_t> chunks;
+
+	while (!uploadQueue.empty())
+	{
+		// Skip anything evicted since it was queued
+		auto entryIter = entries.find(uploadQueue.front());
+		if (entryIter == entries.end())
+		{
+			uploadQueue.pop_front();
+			continue;
+		}
+
+		image_entry_t& entry = entryIter->second;
+		decoded_image_t* decoded = entry.decoded;
+		if (entry.state == IMAGE_STATE_WAITING)
+		{
+			// Try again next time if everything is on screen
+			if (!allocate(decoded->width, decoded->height, entry.page, entry.x, entry.y))
+			{
+				break;
+			}
+			pages[entry.page].keys.push_back(entryIter->first);
+			entry.state = IMAGE_STATE_UPLOADING;
+		}
+
+		// Copy as many rows as fit in what's left of the budget
+		size_t rowBytes = (size_t)decoded->width * 4;
+		int rows = (int)((IMAGECACHE_UPLOAD_BUDGET - used) / rowBytes);
+		if (rows > decoded->height - entry.uploadedRows)
+		{
+			rows = decoded->height - entry.uploadedRows;
+		}
+		if (rows <= 0)
+		{
+			break;
+		}
+
+		if (mapped == NULL)
+		{
+			// Invalidating means we never wait for the GPU to finish reading
+			// what was last uploaded from this buffer
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffers[nextUploadBuffer]);
+			mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, IMAGECACHE_UPLOAD_BUDGET, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (mapped == NULL)
+			{
+				LOG(LOG_ERROR, "ImageCache::upload: Failed to map upload buffer");
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				return finished;
+			}
+		}
+
+		memcpy(mapped + used, &decoded->pixels[entry.uploadedRows * rowBytes], rows * rowBytes);
+		upload_chunk_t chunk;
+		chunk.texture = pages[entry.page].texture;
+		chunk.x = entry.x;
+		chunk.y = entry.y + entry.uploadedRows;
+		chunk.width = decoded->width;
+		chunk.rows = rows;
+		chunk.offset = used;
+		chunks.push_back(chunk);
+		used += rows * rowBytes;
+		entry.uploadedRows += rows;
+
+		if (entry.uploadedRows == decoded->height)
+		{
+			// Inset the coordinates by half a texel so that filtering never
+			// picks up a neighbour
+			entry.image.texture = pages[entry.page].texture;
+			entry.image.u0 = (entry.x + 0.5f) / IMAGECACHE_PAGE_SIZE;
+			entry.image.v0 = (entry.y + 0.5f) / IMAGECACHE_PAGE_SIZE;
+			entry.image.u1 = (entry.x + decoded->width - 0.5f) / IMAGECACHE_PAGE_SIZE;
+			entry.image.v1 = (entry.y + decoded->height - 0.5f) / IMAGECACHE_PAGE_SIZE;
+			entry.image.width = decoded->width;
+			entry.image.height = decoded->height;
+			entry.state = IMAGE_STATE_READY;
+			entry.decoded = NULL;
+			delete decoded;
+			uploadQueue.pop_front();
+			finished = true;
+		}
+	}
+
+	if (mapped == NULL)
+	{
+		return finished;
+	}
+
+	// The copies into the textures come from the buffer, so they return
+	// straight away and happen asynchronously
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (auto& chunk : chunks)
+	{
+		glBindTexture(GL_TEXTURE_2D, chunk.texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, chunk.x, chunk.y, chunk.width, chunk.rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)chunk.offset);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	nextUploadBuffer = (nextUploadBuffer + 1) % IMAGECACHE_UPLOAD_BUFFERS;
+	uploadedBytes += used;
+
+	return finished;
+}
@@ -0,0 +1,643 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <new>
+#include <jpeglib.h>
+#include <png.h>
+#include "ImageDecoder.h"
+#include "Log.h"
+#include "TraceSpan.h"
+
+/// libjpeg error manager that jumps back out of the decoder instead of exiting
+typedef struct jpeg_error_t
+{
+	struct jpeg_error_mgr super;
+	jmp_buf jump;
+} jpeg_error_t;
+
+/// Called by libjpeg on a fatal error
+static void jpeg_error_exit(j_common_ptr info)
+{
+	jpeg_error_t* error = (jpeg_error_t*)info->err;
+	char message[JMSG_LENGTH_MAX];
+	(*info->err->format_message)(info, message);
+	LOG(LOG_WARN, "ImageDecoder::decodeJpeg: %s", message);
+	longjmp(error->jump, 1);
+}
+
+/// Tells whether an image source is a URL rather than a file name
+static bool is_url(const string& source)
+{
+	return source.compare(0, 7, "http://") == 0 || source.compare(0, 8, "https://") == 0;
+}
+
+/// Constructs a new ImageDecoder object and starts the workers
+/// @param threadCount The number of worker threads, or zero to pick one from
+/// the number of CPUs
+ImageDecoder::ImageDecoder(unsigned int threadCount) :
+	averageLatency(0.0),
+	stopping(false)
+{
+	// Leave a core for the render thread
+	if (threadCount == 0)
+	{
+		unsigned int cpus = thread::hardware_concurrency();
+		threadCount = cpus > 1 ? cpus - 1 : 1;
+		if (threadCount > IMAGE_DECODER_MAX_THREADS)
+		{
+			threadCount = IMAGE_DECODER_MAX_THREADS;
+		}
+	}
+
+	LOG(LOG_DEBUG, "ImageDecoder::ImageDecoder: Starting %u decode threads", threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(thread(&ImageDecoder::workerMain, this));
+	}
+}
+
+/// Destroys an ImageDecoder object, waiting for the workers to finish their
+/// current images. Images still queued are discarded
+ImageDecoder::~ImageDecoder()
+{
+	vector<aura_download_id_t> pending;
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+		for (auto& download : downloads)
+		{
+			pending.push_back(download.first);
+		}
+		downloads.clear();
+		requests.clear();
+	}
+	wake.notify_all();
+
+	// Cancelling waits for any callback in progress, so none can arrive
+	// once we've gone. It mustn't be done with the lock held, as the
+	// callback takes it
+	for (auto download : pending)
+	{
+		aura_download_cancel(download);
+	}
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	for (auto image : results)
+	{
+		delete image;
+	}
+}
+
+/// Queues an image to be fetched and decoded. Requesting a key that is already
+/// queued only raises its priority
+/// @param key The key to return the image with
+/// @param source The URL or file name of the image
+/// @param maxWidth The largest width the image will be displayed at
+/// @param maxHeight The largest height the image will be displayed at
+/// @param priority Lower values are fetched and decoded sooner
+void ImageDecoder::request(const string& key, const string& source, int maxWidth, int maxHeight, int priority)
+{
+	lock_guard<mutex> guard(lock);
+	auto requestIter = requests.find(key);
+	if (requestIter != requests.end())
+	{
+		request_t& existing = requestIter->second;
+		if (priority < existing.priority)
+		{
+			existing.priority = priority;
+			if (existing.download != 0)
+			{
+				aura_download_set_priority(existing.download, priority);
+			}
+		}
+		return;
+	}
+
+	request_t& newRequest = requests[key];
+	newRequest.source = source;
+	newRequest.maxWidth = maxWidth;
+	newRequest.maxHeight = maxHeight;
+	newRequest.priority = priority;
+	newRequest.download = 0;
+	newRequest.requested = chrono::steady_clock::now();
+
+	// Files are read by the workers, but downloads happen on libaura's
+	// threads so that a slow server doesn't hold up decoding
+	if (!is_url(source))
+	{
+		wake.notify_one();
+		return;
+	}
+
+	newRequest.download = aura_download_async(source.c_str(), priority, &ImageDecoder::downloadCallback, this);
+	if (newRequest.download == 0)
+	{
+		LOG(LOG_WARN, "ImageDecoder::request: Failed to start downloading '%s'", source.c_str());
+		requests.erase(key);
+		fail(key);
+		return;
+	}
+	downloads[newRequest.download] = key;
+}
+
+/// Changes the priority of a queued image
+void ImageDecoder::setPriority(const string& key, int priority)
+{
+	lock_guard<mutex> guard(lock);
+	auto requestIter = requests.find(key);
+	if (requestIter == requests.end())
+	{
+		return;
+	}
+
+	requestIter->second.priority = priority;
+	if (requestIter->second.download != 0)
+	{
+		aura_download_set_priority(requestIter->second.download, priority);
+	}
+}
+
+/// Drops a queued image, aborting its download. An image that is already being
+/// decoded is still returned
+void ImageDecoder::cancel(const string& key)
+{
+	aura_download_id_t download = 0;
+	{
+		lock_guard<mutex> guard(lock);
+		auto requestIter = requests.find(key);
+		if (requestIter == requests.end())
+		{
+			return;
+		}
+
+		download = requestIter->second.download;
+		if (download != 0)
+		{
+			downloads.erase(download);
+		}
+		requests.erase(requestIter);
+	}
+
+	// The callback takes the lock, so this has to be done without it
+	if (download != 0)
+	{
+		aura_download_cancel(download);
+	}
+}
+
+/// Takes a decoded image, if there is one
+/// @returns The image, which the caller must delete, or NULL if none are ready
+decoded_image_t* ImageDecoder::collect()
+{
+	lock_guard<mutex> guard(lock);
+	if (results.empty())
+	{
+		return NULL;
+	}
+
+	decoded_image_t* image = results.front();
+	results.pop_front();
+	return image;
+}
+
+/// Gets the average time from requesting an image to it being decoded, in
+/// seconds, or zero if none have been decoded yet
+double ImageDecoder::getAverageLatency() const
+{
+	lock_guard<mutex> guard(lock);
+	return averageLatency;
+}
+
+/// Gets the number of images waiting to be fetched or decoded
+size_t ImageDecoder::getQueuedCount() const
+{
+	lock_guard<mutex> guard(lock);
+	return requests.size();
+}
+
+/// Called by libaura when a download finishes
+void ImageDecoder::downloadCallback(aura_download_id_t id, aura_download_data_t* data, void* userData)
+{
+	ImageDecoder* decoder = (ImageDecoder*)userData;
+	lock_guard<mutex> guard(decoder->lock);
+
+	// Anything cancelled after the download finished is no longer wanted
+	auto downloadIter = decoder->downloads.find(id);
+	if (downloadIter == decoder->downloads.end())
+	{
+		if (data != NULL)
+		{
+			aura_free_download_data(data);
+		}
+		return;
+	}
+	string key = downloadIter->second;
+	decoder->downloads.erase(downloadIter);
+
+	auto requestIter = decoder->requests.find(key);
+	if (requestIter == decoder->requests.end())
+	{
+		if (data != NULL)
+		{
+			aura_free_download_data(data);
+		}
+		return;
+	}
+	request_t& request = requestIter->second;
+	if (data != NULL && data->responseCode == 200 && data->dataLength > 0)
+	{
+		request.data.assign(data->data, data->data + data->dataLength);
+		request.download = 0;
+		decoder->wake.notify_one();
+	}
+	else
+	{
+		if (data == NULL)
+		{
+			LOG(LOG_WARN, "ImageDecoder::downloadCallback: Failed to download '%s'", request.source.c_str());
+		}
+		else
+		{
+			LOG(LOG_WARN, "ImageDecoder::downloadCallback: Download of '%s' failed with HTTP status %ld", request.source.c_str(), data->responseCode);
+		}
+		decoder->requests.erase(requestIter);
+		decoder->fail(key);
+	}
+
+	if (data != NULL)
+	{
+		aura_free_download_data(data);
+	}
+}
+
+/// Entry point for the worker threads
+void ImageDecoder::workerMain()
+{
+	aura_trace_set_thread_name("image decoder");
+	unique_lock<mutex> guard(lock);
+	while (true)
+	{
+		map<string, request_t>::iterator ready;
+		wake.wait(guard, [this, &ready] { return stopping || (ready = findReady()) != requests.end(); });
+		if (stopping)
+		{
+			return;
+		}
+
+		string key = ready->first;
+		request_t current;
+		swap(current, ready->second);
+		requests.erase(ready);
+
+		// Do the slow part without the lock
+		guard.unlock();
+		decoded_image_t* image = new decoded_image_t;
+		image->key = key;
+		image->width = 0;
+		image->height = 0;
+		try
+		{
+			TraceSpan span("image", "decode", current.source.c_str());
+			if (current.data.empty())
+			{
+				image->failed = !decode(current.source, current.maxWidth, current.maxHeight, *image);
+			}
+			else
+			{
+				image->failed = !decodeData(current.source, current.data, current.maxWidth, current.maxHeight, *image);
+			}
+		}
+		catch (bad_alloc&)
+		{
+			// An exception escaping the thread would end the process
+			LOG(LOG_WARN, "ImageDecoder::workerMain: Out of memory decoding '%s'", current.source.c_str());
+			image->width = 0;
+			image->height = 0;
+			vector<unsigned char>().swap(image->pixels);
+			image->failed = true;
+		}
+		double latency = chrono::duration<double>(chrono::steady_clock::now() - current.requested).count();
+		guard.lock();
+
+		if (!image->failed)
+		{
+			averageLatency = averageLatency > 0.0 ? averageLatency + (latency - averageLatency) * IMAGE_DECODER_LATENCY_BLEND : latency;
+		}
+		results.push_back(image);
+	}
+}
+
+/// Finds the most urgent request that is ready to decode. The lock must be
+/// held
+map<string, ImageDecoder::request_t>::iterator ImageDecoder::findReady()
+{
+	auto best = requests.end();
+	for (auto requestIter = requests.begin(); requestIter != requests.end(); ++requestIter)
+	{
+		if (requestIter->second.download == 0 && (best == requests.end() || requestIter->second.priority < best->second.priority))
+		{
+			best = requestIter;
+		}
+	}
+
+	return best;
+}
+
+/// Queues an image that couldn't be fetched. The lock must be held
+void ImageDecoder::fail(const string& key)
+{
+	decoded_image_t* image = new decoded_image_t;
+	image->key = key;
+	image->width = 0;
+	image->height = 0;
+	image->failed = true;
+	results.push_back(image);
+}
+
+/// Fetches and decodes an image on the calling thread
+/// @param source The URL or file name of the image
+/// @param maxWidth The largest width the image will be displayed at
+/// @param maxHeight The largest height the image will be displayed at
+/// @param image The image to fill in
+/// @returns true on success, false otherwise
+bool ImageDecoder::decode(const string& source, int maxWidth, int maxHeight, decoded_image_t& image)
+{
+	image.width = 0;
+	image.height = 0;
+	image.pixels.clear();
+
+	vector<unsigned char> data;
+	if (!fetch(source, data))
+	{
+		return false;
+	}
+
+	return decodeData(source, data, maxWidth, maxHeight, image);
+}
+
+/// Decodes the encoded bytes of an image
+bool ImageDecoder::decodeData(const string& source, const vector<unsigned char>& data, int maxWidth, int maxHeight, decoded_image_t& image)
+{
+	// Pick the decoder from the signature rather than the name, as URLs
+	// often don't have an extension
+	bool decoded = false;
+	if (data.size() >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+	{
+		decoded = decodeJpeg(data, maxWidth, maxHeight, image);
+	}
+	else if (data.size() >= 8 && png_sig_cmp(&data[0], 0, 8) == 0)
+	{
+		decoded = decodePng(data, image);
+	}
+	else
+	{
+		LOG(LOG_WARN, "ImageDecoder::decodeData: '%s' is not a JPEG or PNG image", source.c_str());
+	}
+
+	if (!decoded)
+	{
+		return false;
+	}
+
+	fitWithin(image, maxWidth, maxHeight);
+	return true;
+}
+
+/// Reads the encoded bytes of an image from a URL or file
+bool ImageDecoder::fetch(const string& source, vector<unsigned char>& data)
+{
+	if (is_url(source))
+	{
+		aura_download_data_t* download = aura_download_sync(source.c_str());
+		if (download == NULL)
+		{
+			LOG(LOG_WARN, "ImageDecoder::fetch: Failed to download '%s'", source.c_str());
+			return false;
+		}
+
+		bool success = download->responseCode == 200 && download->dataLength > 0;
+		if (success)
+		{
+			data.assign(download->data, download->data + download->dataLength);
+		}
+		else
+		{
+			LOG(LOG_WARN, "ImageDecoder::fetch: Download of '%s' failed with HTTP status %ld", source.c_str(), download->responseCode);
+		}
+		aura_free_download_data(download);
+		return success;
+	}
+
+	FILE* file = fopen(source.c_str(), "rb");
+	if (file == NULL)
+	{
+		LOG(LOG_WARN, "ImageDecoder::fetch: Failed to open '%s'", source.c_str());
+		return false;
+	}
+
+	unsigned char buffer[65536];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + length);
+	}
+	fclose(file);
+
+	return !data.empty();
+}
+
+/// Decodes a JPEG, scaling by a power of two on the way if that still leaves
+/// at least maxWidth x maxHeight pixels
+bool ImageDecoder::decodeJpeg(const vector<unsigned char>& data, int maxWidth, int maxHeight, decoded_image_t& image)
+{
+	// Anything with a destructor must exist before setjmp, as longjmp won't
+	// run destructors
+	vector<unsigned char> row;
+	struct jpeg_decompress_struct info;
+	jpeg_error_t error;
+	info.err = jpeg_std_error(&error.super);
+	error.super.error_exit = jpeg_error_exit;
+	if (setjmp(error.jump))
+	{
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, (unsigned char*)&data[0], data.size());
+	jpeg_read_header(&info, TRUE);
+
+	// Let the IDCT do most of the downscaling: it is far cheaper than
+	// decoding every pixel and throwing most of them away
+	double scale = 1.0;
+	if ((int)info.image_width > maxWidth || (int)info.image_height > maxHeight)
+	{
+		double scaleX = (double)maxWidth / info.image_width;
+		double scaleY = (double)maxHeight / info.image_height;
+		scale = scaleX < scaleY ? scaleX : scaleY;
+	}
+	info.scale_num = 1;
+	info.scale_denom = 1;
+	for (unsigned int denom = 8; denom > 1; denom /= 2)
+	{
+		if (scale * denom <= 1.0)
+		{
+			info.scale_denom = denom;
+			break;
+		}
+	}
+	info.out_color_space = JCS_RGB;
+	jpeg_start_decompress(&info);
+	if (info.output_width > IMAGE_DECODER_MAX_DIMENSION || info.output_height > IMAGE_DECODER_MAX_DIMENSION)
+	{
+		LOG(LOG_WARN, "ImageDecoder::decodeJpeg: Image is too large (%ux%u)", info.output_width, info.output_height);
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	image.width = info.output_width;
+	image.height = info.output_height;
+	image.pixels.resize((size_t)image.width * image.height * 4);
+	row.resize(info.output_width * info.output_components);
+	while (info.output_scanline < info.output_height)
+	{
+		unsigned char* rowPointer = &row[0];
+		unsigned char* out = &image.pixels[(size_t)info.output_scanline * image.width * 4];
+		jpeg_read_scanlines(&info, &rowPointer, 1);
+		for (int x = 0; x < image.width; x++)
+		{
+			out[x * 4 + 0] = row[x * 3 + 0];
+			out[x * 4 + 1] = row[x * 3 + 1];
+			out[x * 4 + 2] = row[x * 3 + 2];
+			out[x * 4 + 3] = 255;
+		}
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return true;
+}
+
+/// Decodes a PNG, unless it is larger than IMAGE_DECODER_MAX_DIMENSION in either
+/// direction
+bool ImageDecoder::decodePng(const vector<unsigned char>& data, decoded_image_t& image)
+{
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_memory(&png, &data[0], data.size()))
+	{
+		LOG(LOG_WARN, "ImageDecoder::decodePng: %s", png.message);
+		return false;
+	}
+
+	// PNGs can't be scaled as they're decoded, so refuse any that would take
+	// more memory than is sensible before allocating it
+	if (png.width > IMAGE_DECODER_MAX_DIMENSION || png.height > IMAGE_DECODER_MAX_DIMENSION)
+	{
+		LOG(LOG_WARN, "ImageDecoder::decodePng: Image is too large (%ux%u)", png.width, png.height);
+		png_image_free(&png);
+		return false;
+	}
+
+	png.format = PNG_FORMAT_RGBA;
+	image.width = png.width;
+	image.height = png.height;
+	try
+	{
+		image.pixels.resize(PNG_IMAGE_SIZE(png));
+	}
+	catch (bad_alloc&)
+	{
+		png_image_free(&png);
+		throw;
+	}
+	if (!png_image_finish_read(&png, NULL, &image.pixels[0], 0, NULL))
+	{
+		LOG(LOG_WARN, "ImageDecoder::decodePng: %s", png.message);
+		png_image_free(&png);
+		return false;
+	}
+
+	return true;
+}
+
+/// Scales an image down with a box filter so that it fits within
+/// maxWidth x maxHeight, keeping its aspect ratio
+void ImageDecoder::fitWithin(decoded_image_t& image, int maxWidth, int maxHeight)
+{
+	if (image.width <= maxWidth && image.height <= maxHeight)
+	{
+		return;
+	}
+
+	double scaleX = (double)maxWidth / image.width;
+	double scaleY = (double)maxHeight / image.height;
+	double scale = scaleX < scaleY ? scaleX : scaleY;
+	int width = (int)(image.width * scale + 0.5);
+	int height = (int)(image.height * scale + 0.5);
+	if (width < 1)
+	{
+		width = 1;
+	}
+	if (height < 1)
+	{
+		height = 1;
+	}
+
+	// Each output pixel is the average of the block of input pixels it covers
+	vector<unsigned char> pixels((size_t)width * height * 4);
+	for (int y = 0; y < height; y++)
+	{
+		int y0 = (int)((long long)y * image.height / height);
+		int y1 = (int)((long long)(y + 1) * image.height / height);
+		if (y1 <= y0)
+		{
+			y1 = y0 + 1;
+		}
+
+		for (int x = 0; x < width; x++)
+		{
+			int x0 = (int)((long long)x * image.width / width);
+			int x1 = (int)((long long)(x + 1) * image.width / width);
+			if (x1 <= x0)
+			{
+				x1 = x0 + 1;
+			}
+
+			unsigned int sum[4] = { 0, 0, 0, 0 };
+			for (int sy = y0; sy < y1; sy++)
+			{
+				const unsigned char* in = &image.pixels[((size_t)sy * image.width + x0) * 4];
+				for (int sx = x0; sx < x1; sx++, in += 4)
+				{
+					sum[0] += in[0];
+					sum[1] += in[1];
+					sum[2] += in[2];
+					sum[3] += in[3];
+				}
+			}
+
+			unsigned int count = (x1 - x0) * (y1 - y0);
+			unsigned char* out = &pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				out[c] = (unsigned char)((sum[c] + count / 2) / count);
+			}
+		}
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.swap(pixels);
+}
@@ -0,0 +1,588 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <math.h>
+#include <algorithm>
+#include "LayoutEngine.h"
+#include "AuraLive.h"
+#include "Log.h"
+
+/// Constructs a new LayoutEngine object
+/// @param _auraLive The application, for creating elements and measuring text
+/// @param _plugin The plugin that created the layout object
+/// @param _layout The layout object, which the engine takes ownership of
+/// @param _root The group node to add the items' elements to
+LayoutEngine::LayoutEngine(AuraLive& _auraLive, aura_layout_plugin_t* _plugin, aura_object_instance_t* _layout, SceneNode* _root) :
+	auraLive(_auraLive),
+	plugin(_plugin),
+	layout(_layout),
+	root(_root),
+	x(0.0f),
+	y(0.0f),
+	width(0.0f),
+	height(0.0f),
+	firstChanged(LAYOUT_NONE_CHANGED),
+	itemWidth(0.0f),
+	horizontal(false),
+	extent(0.0f),
+	page(0.0f),
+	scrollPosition(0.0),
+	pageTime(0.0),
+	viewsDirty(false),
+	firstLive(0),
+	lastLive(0),
+	prefetcher(_auraLive.getImageCache()),
+	shownCount(0),
+	prefetchDepth(0),
+	prefetchDirty(false),
+	measureCount(0),
+	arrangeCount(0),
+	arrangedItemCount(0)
+{
+}
+
+/// Destroys a LayoutEngine object and its layout object. The elements belong to
+/// the scene graph and are left there
+LayoutEngine::~LayoutEngine()
+{
+	for (auto entry : entries)
+	{
+		delete entry;
+	}
+	for (auto view : views)
+	{
+		delete view;
+	}
+
+	if (plugin->super.destroy != NULL)
+	{
+		plugin->super.destroy(layout);
+	}
+}
+
+/// Sets the area of the display to lay items out in
+void LayoutEngine::setGeometry(float _x, float _y, float _width, float _height)
+{
+	// Moving the area only moves the elements, but resizing it can change
+	// the width items are measured at and where the plugin puts them
+	if (_width != width || _height != height)
+	{
+		firstChanged = 0;
+	}
+	x = _x;
+	y = _y;
+	width = _width;
+	height = _height;
+	viewsDirty = true;
+}
+
+/// Adds an item
+/// @param id A unique identifier for the item
+/// @param text The UTF-8 encoded text of the item
+/// @param imageSource The URL or file name of an image, or empty
+/// @param atStart Add the item before the others instead of after
+/// @returns true on success, false if the identifier is in use
+bool LayoutEngine::addItem(const string& id, const string& text, const string& imageSource, bool atStart)
+{
+	if (entriesById.find(id) != entriesById.end())
+	{
+		LOG(LOG_WARN, "LayoutEngine::addItem: There is already an item '%s'", id.c_str());
+		return false;
+	}
+
+	entry_t* entry = new entry_t;
+	entry->id = id;
+	entry->text = text;
+	entry->imageSource = imageSource;
+	entry->measuredWidth = -1.0f;
+	entry->textHeight = 0.0f;
+	entry->view = NULL;
+
+	aura_layout_item_t item;
+	item.width = item.height = 0.0f;
+	item.x = item.y = 0.0f;
+
+	size_t index = atStart ? 0 : entries.size();
+	entries.insert(entries.begin() + index, entry);
+	items.insert(items.begin() + index, item);
+	entriesById[id] = entry;
+	unmeasured.push_back(entry);
+	renumber(index);
+	return true;
+}
+
+/// Changes the content of an item
+/// @returns true on success, false if there is no such item
+bool LayoutEngine::updateItem(const string& id, const string& text, const string& imageSource)
+{
+	auto entryIter = entriesById.find(id);
+	if (entryIter == entriesById.end())
+	{
+		return false;
+	}
+
+	entry_t* entry = entryIter->second;
+	entry->text = text;
+	entry->imageSource = imageSource;
+	if (entry->measuredWidth >= 0.0f)
+	{
+		entry->measuredWidth = -1.0f;
+		unmeasured.push_back(entry);
+	}
+
+	// The text has moved, so the elements need pointing at it again
+	if (entry->view != NULL)
+	{
+		bindView(entry->view);
+	}
+	viewsDirty = true;
+	return true;
+}
+
+/// Removes an item
+/// @returns true on success, false if there is no such item
+bool LayoutEngine::removeItem(const string& id)
+{
+	auto entryIter = entriesById.find(id);
+	if (entryIter == entriesById.end())
+	{
+		return false;
+	}
+
+	entry_t* entry = entryIter->second;
+	if (entry->view != NULL)
+	{
+		releaseView(entry->view);
+	}
+	auto unmeasuredIter = find(unmeasured.begin(), unmeasured.end(), entry);
+	if (unmeasuredIter != unmeasured.end())
+	{
+		unmeasured.erase(unmeasuredIter);
+	}
+
+	size_t index = entry->index;
+	entries.erase(entries.begin() + index);
+	items.erase(items.begin() + index);
+	entriesById.erase(entryIter);
+	delete entry;
+	renumber(index);
+	return true;
+}
+
+/// Gets the number of items
+size_t LayoutEngine::getItemCount() const
+{
+	return entries.size();
+}
+
+/// Measures and places anything that has changed, scrolls, and updates the
+/// elements of the items that can be seen
+/// @param timestep The time to advance by, in seconds
+void LayoutEngine::update(double timestep)
+{
+	if (width <= 0.0f || height <= 0.0f)
+	{
+		return;
+	}
+
+	// If the item width has changed then every cached size is out of date
+	float newItemWidth = plugin->getItemWidth != NULL ? plugin->getItemWidth(layout, width, height) : width;
+	if (newItemWidth != itemWidth)
+	{
+		itemWidth = newItemWidth;
+		unmeasured.clear();
+		for (auto entry : entries)
+		{
+			entry->measuredWidth = -1.0f;
+			unmeasured.push_back(entry);
+		}
+	}
+
+	// Otherwise only new and changed items are measured, and only a change
+	// in size moves anything
+	for (auto entry : unmeasured)
+	{
+		float previousHeight = items[entry->index].height;
+		measure(entry);
+		if (items[entry->index].height != previousHeight && entry->index < firstChanged)
+		{
+			firstChanged = entry->index;
+		}
+	}
+	unmeasured.clear();
+
+	if (firstChanged != LAYOUT_NONE_CHANGED)
+	{
+		arrange();
+	}
+
+	scroll(timestep);
+	if (viewsDirty)
+	{
+		updateViews();
+	}
+
+	prefetcher.update(timestep, shownCount);
+	shownCount = 0;
+	if (prefetchDirty || prefetcher.getDepth() != prefetchDepth)
+	{
+		updatePrefetch();
+	}
+}
+
+/// Gets the number of times an item has been measured
+unsigned long long LayoutEngine::getMeasureCount() const
+{
+	return measureCount;
+}
+
+/// Gets the number of times the plugin has arranged the items
+unsigned long long LayoutEngine::getArrangeCount() const
+{
+	return arrangeCount;
+}
+
+/// Gets the total number of items the plugin has been asked to place
+unsigned long long LayoutEngine::getArrangedItemCount() const
+{
+	return arrangedItemCount;
+}
+
+/// Gets the number of items that have elements at the moment
+size_t LayoutEngine::getLiveViewCount() const
+{
+	return views.size() - freeViews.size();
+}
+
+/// Gets the number of sets of elements that have been created
+size_t LayoutEngine::getViewCount() const
+{
+	return views.size();
+}
+
+/// Gets the prefetcher for the items' images
+const Prefetcher& LayoutEngine::getPrefetcher() const
+{
+	return prefetcher;
+}
+
+/// Measures an item at the current item width
+void LayoutEngine::measure(entry_t* entry)
+{
+	float contentWidth = itemWidth - LAYOUT_PADDING * 2.0f;
+	entry->textHeight = auraLive.getTextRenderer().measure(entry->text.c_str(), "", LAYOUT_TEXT_SIZE, contentWidth);
+	entry->measuredWidth = itemWidth;
+	measureCount++;
+
+	aura_layout_item_t& item = items[entry->index];
+	item.width = itemWidth;
+	item.height = LAYOUT_PADDING * 2.0f + entry->textHeight;
+	if (!entry->imageSource.empty())
+	{
+		item.height += contentWidth * LAYOUT_IMAGE_ASPECT + LAYOUT_PADDING;
+	}
+}
+
+/// Renumbers items from the given position, after an insertion or removal, and
+/// notes that they need placing again
+void LayoutEngine::renumber(size_t first)
+{
+	for (size_t i = first; i < entries.size(); i++)
+	{
+		entries[i]->index = i;
+	}
+
+	if (first < firstChanged)
+	{
+		firstChanged = first;
+	}
+	viewsDirty = true;
+}
+
+/// Asks the plugin to place the items that have moved
+void LayoutEngine::arrange()
+{
+	if (firstChanged > items.size())
+	{
+		firstChanged = items.size();
+	}
+
+	aura_layout_t state;
+	state.width = width;
+	state.height = height;
+	state.items = items.empty() ? NULL : &items[0];
+	state.itemCount = items.size();
+	state.firstChanged = firstChanged;
+	state.horizontal = horizontal;
+	state.extent = extent;
+	state.page = page;
+	plugin->arrange(layout, &state);
+
+	arrangeCount++;
+	arrangedItemCount += items.size() - firstChanged;
+	horizontal = state.horizontal;
+	extent = state.extent;
+	page = state.page;
+	firstChanged = LAYOUT_NONE_CHANGED;
+	viewsDirty = true;
+
+	// Keep a paged layout on a page boundary
+	if (page > 0.0f)
+	{
+		scrollPosition = floor(scrollPosition / page + 0.5) * page;
+	}
+}
+
+/// Moves the scroll position on
+void LayoutEngine::scroll(double timestep)
+{
+	if (extent <= 0.0f)
+	{
+		return;
+	}
+
+	if (page > 0.0f)
+	{
+		// Step a page at a time, back to the start after the last
+		pageTime += timestep;
+		if (pageTime >= getLayoutProperty("interval", 8.0))
+		{
+			pageTime = 0.0;
+			scrollPosition += page;
+			if (scrollPosition > extent - page / 2.0f)
+			{
+				scrollPosition = 0.0;
+			}
+			viewsDirty = true;
+		}
+	}
+	else
+	{
+		// Once everything has scrolled past, bring it back round from the
+		// far edge
+		double speed = getLayoutProperty("speed", 0.0);
+		if (speed > 0.0)
+		{
+			scrollPosition += speed * timestep;
+			if (scrollPosition > extent)
+			{
+				scrollPosition = -(horizontal ? width : height);
+			}
+			viewsDirty = true;
+		}
+	}
+}
+
+/// Gives elements to the items that can be seen and takes them from those that
+/// can't, then positions them
+void LayoutEngine::updateViews()
+{
+	viewsDirty = false;
+
+	// Items are in order along the direction of scrolling, so find the
+	// first that reaches the window with a binary search
+	float viewLength = horizontal ? width : height;
+	double windowStart = scrollPosition - viewLength * LAYOUT_NEAR_VISIBLE;
+	double windowEnd = scrollPosition + viewLength * (1.0f + LAYOUT_NEAR_VISIBLE);
+	size_t low = 0, high = items.size();
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		const aura_layout_item_t& item = items[middle];
+		double itemEnd = horizontal ? item.x + item.width : item.y + item.height;
+		if (itemEnd < windowStart)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	size_t first = low;
+	size_t last = first;
+	while (last < items.size() && (horizontal ? items[last].x : items[last].y) <= windowEnd)
+	{
+		last++;
+	}
+	firstLive = first;
+	lastLive = last;
+	prefetchDirty = true;
+
+	// Take the elements from items that have gone out of range first, so
+	// they can be reused straight away
+	for (auto view : views)
+	{
+		if (view->entry != NULL && (view->entry->index < first || view->entry->index >= last))
+		{
+			releaseView(view);
+		}
+	}
+
+	for (size_t i = first; i < last; i++)
+	{
+		entry_t* entry = entries[i];
+		if (entry->view == NULL)
+		{
+			view_t* view = acquireView();
+			if (view == NULL)
+			{
+				break;
+			}
+			view->entry = entry;
+			entry->view = view;
+			bindView(view);
+			shownCount++;
+		}
+
+		const aura_layout_item_t& item = items[i];
+		float itemX = x + item.x - (horizontal ? (float)scrollPosition : 0.0f);
+		float itemY = y + item.y - (horizontal ? 0.0f : (float)scrollPosition);
+		float contentWidth = item.width - LAYOUT_PADDING * 2.0f;
+		view_t* view = entry->view;
+		view->group->setGeometry(itemX, itemY, item.width, item.height);
+		view->background->setGeometry(itemX, itemY, item.width, item.height);
+		view->text->setGeometry(itemX + LAYOUT_PADDING, itemY + LAYOUT_PADDING, contentWidth, entry->textHeight);
+		view->image->setGeometry(itemX + LAYOUT_PADDING, itemY + LAYOUT_PADDING * 2.0f + entry->textHeight, contentWidth, contentWidth * LAYOUT_IMAGE_ASPECT);
+	}
+}
+
+/// Tells the prefetcher which images are shown now and which come next
+void LayoutEngine::updatePrefetch()
+{
+	prefetchDirty = false;
+	prefetchDepth = prefetcher.getDepth();
+	if (lastLive > items.size())
+	{
+		lastLive = items.size();
+	}
+
+	// Images are drawn at the content width, less padding, so this has to
+	// match the size updateViews() gives them
+	vector<prefetch_item_t> images;
+	auto addImage = [this, &images](size_t i)
+	{
+		if (!entries[i]->imageSource.empty())
+		{
+			float contentWidth = items[i].width - LAYOUT_PADDING * 2.0f;
+			prefetch_item_t image;
+			image.source = entries[i]->imageSource;
+			image.width = (int)(contentWidth + 0.5f);
+			image.height = (int)(contentWidth * LAYOUT_IMAGE_ASPECT + 0.5f);
+			images.push_back(image);
+		}
+	};
+
+	for (size_t i = firstLive; i < lastLive; i++)
+	{
+		addImage(i);
+	}
+	size_t currentCount = images.size();
+
+	// Then the items after them, wrapping round to the start as the
+	// scrolling does
+	size_t liveCount = lastLive - firstLive;
+	for (size_t n = 0; n < prefetchDepth && n + liveCount < entries.size(); n++)
+	{
+		addImage((lastLive + n) % entries.size());
+	}
+
+	prefetcher.setItems(images, currentCount);
+}
+
+/// Gets a free set of elements, creating one if there are none
+/// @returns The view, or NULL if its elements couldn't be created
+LayoutEngine::view_t* LayoutEngine::acquireView()
+{
+	if (!freeViews.empty())
+	{
+		view_t* view = freeViews.back();
+		freeViews.pop_back();
+		view->group->setVisible(true);
+		return view;
+	}
+
+	SceneNode* group = new SceneNode();
+	root->addChild(group);
+	SceneNode* background = auraLive.createElement("colour", group);
+	SceneNode* text = auraLive.createElement("text", group);
+	SceneNode* image = auraLive.createElement("image", group);
+	aura_property_color_t* colour = background != NULL ? (aura_property_color_t*)background->getProperty("colour") : NULL;
+	aura_property_int_t* size = text != NULL ? (aura_property_int_t*)text->getProperty("size") : NULL;
+	if (colour == NULL || size == NULL || image == NULL)
+	{
+		LOG(LOG_ERROR, "LayoutEngine::acquireView: Failed to create the elements for an item");
+		root->removeChild(group);
+		delete group;
+		return NULL;
+	}
+
+	colour->valueR = 0.1f;
+	colour->valueG = 0.1f;
+	colour->valueB = 0.12f;
+	colour->valueA = 0.85f;
+	size->value = LAYOUT_TEXT_SIZE;
+
+	view_t* view = new view_t;
+	view->group = group;
+	view->background = background;
+	view->text = text;
+	view->image = image;
+	view->entry = NULL;
+	views.push_back(view);
+	return view;
+}
+
+/// Sets the content of a view from its item
+void LayoutEngine::bindView(view_t* view)
+{
+	entry_t* entry = view->entry;
+	aura_property_string_t* text = (aura_property_string_t*)view->text->getProperty("text");
+	aura_property_string_t* source = (aura_property_string_t*)view->image->getProperty("source");
+	if (text != NULL)
+	{
+		text->value = entry->text.empty() ? NULL : &entry->text[0];
+		view->text->propertyChanged((aura_property_t*)text);
+	}
+	if (source != NULL)
+	{
+		source->value = entry->imageSource.empty() ? NULL : &entry->imageSource[0];
+		view->image->propertyChanged((aura_property_t*)source);
+	}
+	view->image->setVisible(!entry->imageSource.empty());
+}
+
+/// Hides a view and returns it to the free list
+void LayoutEngine::releaseView(view_t* view)
+{
+	// Don't leave the elements pointing in to an item that may go away
+	aura_property_string_t* text = (aura_property_string_t*)view->text->getProperty("text");
+	aura_property_string_t* source = (aura_property_string_t*)view->image->getProperty("source");
+	if (text != NULL)
+	{
+		text->value = NULL;
+	}
+	if (source != NULL)
+	{
+		source->value = NULL;
+	}
+
+	view->entry->view = NULL;
+	view->entry = NULL;
+	view->group->setVisible(false);
+	freeViews.push_back(view);
+}
+
+/// Gets a floating point property of the layout object
+double LayoutEngine::getLayoutProperty(const char* name, double defaultValue) const
+{
+	aura_property_t* property = aura_get_property(layout->properties, name);
+	if (property == NULL || property->type != AURA_VARTYPE_FLOAT)
+	{
+		return defaultValue;
+	}
+
+	return ((aura_property_float_t*)property)->value;
+}
@@ -3,18 +3,363 @@
 // License (LGPL). A copy of the license is included in the file COPYING.LESSER
 
 // Includes:
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include "Log.h"
 
+// Namespaces:
+using namespace std;
+
+/// The header of a message in a thread's ring. The text follows it, and the
+/// whole record is padded to a multiple of the header's size so that a header
+/// always fits in the space left at the end of the ring
+typedef struct log_record_t
+{
+	/// When the message was logged, in nanoseconds since the epoch
+	unsigned long long timestamp;
+
+	/// The level it was logged at, or -1 for the filler at the end of the
+	/// ring when a record didn't fit there
+	int level;
+
+	/// The length of the text
+	unsigned int length;
+} log_record_t;
+
+/// A ring of messages, written to by one thread and read by whichever thread
+/// is writing messages out. Positions only ever increase, and are wrapped
+/// when they're used
+typedef struct log_ring_t
+{
+	/// The ring itself
+	char buffer[LOG_RING_SIZE];
+
+	/// Where the next record goes, only moved by the thread logging
+	atomic<size_t> head;
+
+	/// Where the next record to write out is, only moved by the writer
+	atomic<size_t> tail;
+
+	/// Messages that were dropped because the ring was full
+	atomic<unsigned long long> dropped;
+
+	/// Set once the thread has exited
+	atomic<bool> closed;
+
+	/// The ID of the thread logging
+	long threadId;
+} log_ring_t;
+
+/// A message read out of a ring, waiting to be written
+typedef struct log_pending_t
+{
+	unsigned long long timestamp;
+	long threadId;
+	int level;
+
+	/// Where the text is in the writer's scratch buffer
+	size_t offset;
+	unsigned int length;
+} log_pending_t;
+
 /// Log level, defaults to LOG_WARN
-static int g_logLevel = LOG_WARN;
+static atomic<int> g_logLevel(LOG_WARN);
 
 // Default to logging to stderr
 static FILE* g_logFP = stderr;
 
+/// Protects the file being logged to, and reading from the rings
+static mutex g_logFileLock;
+
+/// Set once the writer has finished, after which messages are written out
+/// straight away
+static atomic<bool> g_logStopped(false);
+
+/// Gets the current time in nanoseconds since the epoch
+static unsigned long long log_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/// Gets the name of a level as it appears in the log
+static const char* log_level_name(int logLevel)
+{
+	if (logLevel <= LOG_FATAL)
+	{
+		return "FATAL";
+	}
+	else if (logLevel <= LOG_ERROR)
+	{
+		return "ERROR";
+	}
+	else if (logLevel <= LOG_WARN)
+	{
+		return "WARN ";
+	}
+	else if (logLevel <= LOG_DEBUG)
+	{
+		return "DEBUG";
+	}
+	return "INFO ";
+}
+
+/// Appends a message to a line of output, with the time, thread and level
+static void log_format_line(string& output, unsigned long long timestamp, long threadId, int logLevel, const char* text, size_t length)
+{
+	time_t seconds = (time_t)(timestamp / 1000000000ULL);
+	struct tm local;
+	localtime_r(&seconds, &local);
+
+	char prefix[64];
+	size_t prefixLength = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+	prefixLength += snprintf(prefix + prefixLength, sizeof(prefix) - prefixLength, ".%06llu [%ld] %s ", (timestamp % 1000000000ULL) / 1000ULL, threadId, log_level_name(logLevel));
+	output.append(prefix, prefixLength);
+	output.append(text, length);
+	output.push_back('\n');
+}
+
+/// The LogWriter class owns every thread's ring and writes the messages in
+/// them out on a thread of its own, merged in to the order they were logged
+class LogWriter
+{
+	public:
+		LogWriter() :
+			stopping(false)
+		{
+			writerThread = thread(&LogWriter::writerMain, this);
+		}
+
+		/// Stops the writer thread once everything has been written out.
+		/// Rings belonging to threads that are still running are left
+		/// alone, as they might still be logged to
+		~LogWriter()
+		{
+			{
+				lock_guard<mutex> guard(wakeLock);
+				stopping = true;
+			}
+			wake.notify_one();
+			writerThread.join();
+
+			lock_guard<mutex> guard(g_logFileLock);
+			drain();
+			g_logStopped = true;
+		}
+
+		/// Creates a ring for the calling thread
+		log_ring_t* addRing()
+		{
+			log_ring_t* ring = new log_ring_t;
+			ring->head = 0;
+			ring->tail = 0;
+			ring->dropped = 0;
+			ring->closed = false;
+			ring->threadId = syscall(SYS_gettid);
+
+			lock_guard<mutex> guard(ringsLock);
+			rings.push_back(ring);
+			return ring;
+		}
+
+		/// Writes out everything logged so far
+		void flush()
+		{
+			lock_guard<mutex> guard(g_logFileLock);
+			drain();
+		}
+
+	private:
+		/// Entry point for the writer thread
+		void writerMain()
+		{
+			unique_lock<mutex> guard(wakeLock);
+			while (!stopping)
+			{
+				wake.wait_for(guard, chrono::milliseconds(LOG_WRITER_INTERVAL_MS));
+				guard.unlock();
+				flush();
+				guard.lock();
+			}
+		}
+
+		/// Reads every complete record out of the rings, and writes them
+		/// out in the order they were logged. The file lock must be held
+		void drain()
+		{
+			vector<log_ring_t*> current;
+			{
+				lock_guard<mutex> guard(ringsLock);
+				current = rings;
+			}
+
+			pending.clear();
+			scratch.clear();
+			output.clear();
+			for (auto ring : current)
+			{
+				// Read the closed flag first, so that anything logged
+				// before the thread exited is seen below
+				bool closed = ring->closed.load(memory_order_acquire);
+				size_t tail = ring->tail.load(memory_order_relaxed);
+				size_t head = ring->head.load(memory_order_acquire);
+				while (tail != head)
+				{
+					const log_record_t* record = (const log_record_t*)(ring->buffer + tail % LOG_RING_SIZE);
+					if (record->level < 0)
+					{
+						// Filler up to the end of the ring
+						tail += LOG_RING_SIZE - tail % LOG_RING_SIZE;
+						continue;
+					}
+
+					log_pending_t message;
+					message.timestamp = record->timestamp;
+					message.threadId = ring->threadId;
+					message.level = record->level;
+					message.offset = scratch.size();
+					message.length = record->length;
+					scratch.append((const char*)(record + 1), record->length);
+					pending.push_back(message);
+					tail += sizeof(log_record_t) + (record->length + sizeof(log_record_t) - 1) / sizeof(log_record_t) * sizeof(log_record_t);
+				}
+				ring->tail.store(tail, memory_order_release);
+
+				unsigned long long dropped = ring->dropped.exchange(0);
+				if (dropped > 0)
+				{
+					char text[128];
+					int length = snprintf(text, sizeof(text), "Log: %llu messages dropped, logged faster than they could be written", dropped);
+					log_pending_t message;
+					message.timestamp = log_now();
+					message.threadId = ring->threadId;
+					message.level = LOG_WARN;
+					message.offset = scratch.size();
+					message.length = length;
+					scratch.append(text, length);
+					pending.push_back(message);
+				}
+
+				if (closed)
+				{
+					lock_guard<mutex> guard(ringsLock);
+					rings.erase(find(rings.begin(), rings.end(), ring));
+					delete ring;
+				}
+			}
+
+			if (pending.empty())
+			{
+				return;
+			}
+
+			// Each ring is already in order, so a stable sort keeps a
+			// thread's messages in the order they were logged even when
+			// they share a timestamp
+			stable_sort(pending.begin(), pending.end(), [](const log_pending_t& a, const log_pending_t& b) { return a.timestamp < b.timestamp; });
+			for (auto& message : pending)
+			{
+				log_format_line(output, message.timestamp, message.threadId, message.level, scratch.data() + message.offset, message.length);
+			}
+			fwrite(output.data(), 1, output.size(), g_logFP);
+			fflush(g_logFP);
+		}
+
+		/// The rings, and the lock that protects the list of them
+		vector<log_ring_t*> rings;
+		mutex ringsLock;
+
+		/// The writer thread, and how it is woken to stop
+		thread writerThread;
+		mutex wakeLock;
+		condition_variable wake;
+		bool stopping;
+
+		/// Reused between drains, protected by the file lock
+		vector<log_pending_t> pending;
+		string scratch;
+		string output;
+};
+
+/// Gets the writer, starting it the first time. It is stopped, and everything
+/// written out, when the program exits
+static LogWriter& log_writer()
+{
+	static LogWriter writer;
+	return writer;
+}
+
+/// Owns the calling thread's ring, and marks it closed when the thread exits
+/// so the writer can delete it once it is empty
+class LogRingHolder
+{
+	public:
+		LogRingHolder() :
+			ring(NULL)
+		{
+		}
+
+		~LogRingHolder()
+		{
+			if (ring != NULL)
+			{
+				ring->closed.store(true, memory_order_release);
+				ring = NULL;
+			}
+		}
+
+		log_ring_t* ring;
+};
+static thread_local LogRingHolder t_logRing;
+
+/// Puts a message in a ring
+/// @returns false if there wasn't room
+static bool log_push(log_ring_t* ring, int logLevel, const char* text, size_t length)
+{
+	size_t recordSize = sizeof(log_record_t) + (length + sizeof(log_record_t) - 1) / sizeof(log_record_t) * sizeof(log_record_t);
+	size_t head = ring->head.load(memory_order_relaxed);
+	size_t tail = ring->tail.load(memory_order_acquire);
+
+	// A record that would run off the end of the ring goes at the start,
+	// with filler in the space left
+	size_t offset = head % LOG_RING_SIZE;
+	size_t filler = (offset + recordSize > LOG_RING_SIZE) ? LOG_RING_SIZE - offset : 0;
+	if (LOG_RING_SIZE - (head - tail) < filler + recordSize)
+	{
+		return false;
+	}
+	if (filler > 0)
+	{
+		((log_record_t*)(ring->buffer + offset))->level = -1;
+		head += filler;
+		offset = 0;
+	}
+
+	log_record_t* record = (log_record_t*)(ring->buffer + offset);
+	record->timestamp = log_now();
+	record->level = logLevel;
+	record->length = length;
+	memcpy(record + 1, text, length);
+	ring->head.store(head + recordSize, memory_order_release);
+	return true;
+}
+
 /// Set up logging to log to another file handle
 /// @param fp The file pointer of the file/stream to log to
 void log_set_handle(FILE* fp)
 {
+	lock_guard<mutex> guard(g_logFileLock);
 	g_logFP = fp;
 }
 
@@ -22,13 +367,22 @@ void log_set_handle(FILE* fp)
 /// @param logLevel The new log level
 void log_set_level(int logLevel)
 {
-	g_logLevel = logLevel;
+	g_logLevel.store(logLevel, memory_order_relaxed);
 }
 
 /// Gets the current log level
 int log_get_level()
 {
-	return g_logLevel;
+	return g_logLevel.load(memory_order_relaxed);
+}
+
+/// Waits until every message logged so far has been written out
+void log_flush()
+{
+	if (!g_logStopped)
+	{
+		log_writer().flush();
+	}
 }
 
 /// Logging function
@@ -36,13 +390,58 @@ int log_get_level()
 /// @param format The format string, followed by arguments
 void log(int logLevel, const char* format, ...)
 {
-	if (logLevel <= g_logLevel)
+	if (logLevel > g_logLevel.load(memory_order_relaxed))
+	{
+		return;
+	}
+
+	char text[LOG_MAX_LINE];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (length < 0)
+	{
+		return;
+	}
+	if ((size_t)length >= sizeof(text))
+	{
+		length = sizeof(text) - 1;
+		memcpy(text + length - 3, "...", 3);
+	}
+
+	// Every message is a line of its own
+	while (length > 0 && text[length - 1] == '\n')
+	{
+		length--;
+	}
+
+	// Once the writer has gone at exit, messages are written out directly
+	if (g_logStopped)
+	{
+		string output;
+		log_format_line(output, log_now(), syscall(SYS_gettid), logLevel, text, length);
+		lock_guard<mutex> guard(g_logFileLock);
+		fwrite(output.data(), 1, output.size(), g_logFP);
+		fflush(g_logFP);
+		return;
+	}
+
+	LogWriter& writer = log_writer();
+	if (t_logRing.ring == NULL)
+	{
+		t_logRing.ring = writer.addRing();
+	}
+	if (!log_push(t_logRing.ring, logLevel, text, length))
+	{
+		t_logRing.ring->dropped++;
+	}
+
+	// Whatever caused a fatal error is likely to end the program, so make
+	// sure the message gets out first
+	if (logLevel <= LOG_FATAL)
 	{
-		va_list args;
-		va_start(args, format);
-		vfprintf(g_logFP, format, args);
-		fprintf(g_logFP, "\n");
-		va_end(args);
+		writer.flush();
 	}
 }
 
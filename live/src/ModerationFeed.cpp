@@ -0,0 +1,160 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "ModerationFeed.h"
+#include "Log.h"
+
+/// Constructs a new ModerationFeed object
+/// @param _queueName The name of the moderation queue
+/// @param _layout The layout to add the approved items to
+/// @param journalPath The file to keep the items in, or empty not to
+ModerationFeed::ModerationFeed(const string& _queueName, LayoutEngine* _layout, const string& journalPath) :
+	queueName(_queueName),
+	layout(_layout),
+	queue(NULL),
+	journal(NULL),
+	retryTime(0.0),
+	receivedCount(0),
+	replayedCount(0)
+{
+	if (journalPath.empty())
+	{
+		return;
+	}
+
+	journal = aura_journal_open(journalPath.c_str(), MODERATION_JOURNAL_ITEMS, MODERATION_JOURNAL_BYTES);
+	if (journal == NULL)
+	{
+		LOG(LOG_ERROR, "ModerationFeed::ModerationFeed: Failed to open journal '%s'", journalPath.c_str());
+		return;
+	}
+
+	replayedCount = aura_journal_replay(journal, replayCallback, this);
+	LOG(LOG_INFO, "ModerationFeed::ModerationFeed: Replayed %zu items from journal '%s'", replayedCount, journalPath.c_str());
+}
+
+/// Destroys a ModerationFeed object, closing the queue and journal
+ModerationFeed::~ModerationFeed()
+{
+	if (queue != NULL)
+	{
+		aura_mod_queue_close(queue);
+	}
+	if (journal != NULL)
+	{
+		aura_journal_close(journal);
+	}
+}
+
+/// Adds any items that have arrived to the layout, and opens the queue if it
+/// isn't yet
+/// @param timestep The time since the last update, in seconds
+void ModerationFeed::update(double timestep)
+{
+	if (queue == NULL)
+	{
+		retryTime -= timestep;
+		if (retryTime > 0.0)
+		{
+			return;
+		}
+
+		retryTime = MODERATION_RETRY_INTERVAL;
+		queue = aura_mod_queue_open(queueName.c_str());
+		if (queue == NULL)
+		{
+			return;
+		}
+		LOG(LOG_INFO, "ModerationFeed::update: Opened moderation queue '%s'", queueName.c_str());
+	}
+
+	// Take a bounded number per update, so a backlog can't stall a frame
+	aura_item_t item;
+	for (int i = 0; i < MODERATION_MAX_PER_UPDATE; i++)
+	{
+		int result = aura_mod_queue_peek(queue, &item, 0);
+		if (result == AURA_MOD_QUEUE_CLOSED)
+		{
+			LOG(LOG_INFO, "ModerationFeed::update: Moderation queue '%s' was closed, waiting for it to return", queueName.c_str());
+			aura_mod_queue_close(queue);
+			queue = NULL;
+			retryTime = MODERATION_RETRY_INTERVAL;
+			return;
+		}
+		if (result != AURA_MOD_QUEUE_OK)
+		{
+			return;
+		}
+
+		// The layout takes copies, so the slot can go straight back
+		if (item.id[0] == '\0')
+		{
+			LOG(LOG_WARN, "ModerationFeed::update: Ignoring malformed item %llu", item.sequence);
+		}
+		else
+		{
+			showItem(&item);
+			if (journal != NULL && !aura_journal_append(journal, item.id, item.fields, item.fieldCount))
+			{
+				LOG(LOG_WARN, "ModerationFeed::update: Failed to add item '%s' to the journal", item.id);
+			}
+			receivedCount++;
+		}
+		aura_mod_queue_release(queue);
+	}
+}
+
+/// Shows an item, adding it or replacing the one with its identifier. Once
+/// there are more than MODERATION_JOURNAL_ITEMS the oldest is removed, so the
+/// layout doesn't grow for ever and new items don't queue behind the history.
+/// Replaying the journal never gives more than that, so nothing is removed
+/// from the journal whilst it's being replayed
+void ModerationFeed::showItem(const aura_item_t* item)
+{
+	const char* text = aura_item_get_field(item, "text");
+	const char* image = aura_item_get_field(item, "image");
+	string textValue = text != NULL ? text : "";
+	string imageValue = image != NULL ? image : "";
+	if (layout->updateItem(item->id, textValue, imageValue) || !layout->addItem(item->id, textValue, imageValue))
+	{
+		return;
+	}
+
+	shownIds.push_back(item->id);
+	while (shownIds.size() > MODERATION_JOURNAL_ITEMS)
+	{
+		const string& oldest = shownIds.front();
+		layout->removeItem(oldest);
+		if (journal != NULL && !aura_journal_remove(journal, oldest.c_str()))
+		{
+			LOG(LOG_WARN, "ModerationFeed::showItem: Failed to remove item '%s' from the journal", oldest.c_str());
+		}
+		shownIds.pop_front();
+	}
+}
+
+/// Called for each item when the journal is replayed
+void ModerationFeed::replayCallback(void* userData, const aura_item_t* item)
+{
+	((ModerationFeed*)userData)->showItem(item);
+}
+
+/// Determines whether the queue is open
+bool ModerationFeed::isConnected() const
+{
+	return queue != NULL;
+}
+
+/// Gets the number of items received from the queue
+unsigned long long ModerationFeed::getReceivedCount() const
+{
+	return receivedCount;
+}
+
+/// Gets the number of items replayed from the journal
+size_t ModerationFeed::getReplayedCount() const
+{
+	return replayedCount;
+}
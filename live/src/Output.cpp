@@ -0,0 +1,98 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <stdio.h>
+#include "Output.h"
+#include "AuraException.h"
+#include "Log.h"
+
+/// Creates the window for an output. Throws an AuraException on failure. The GL
+/// attributes must already have been set
+/// @param _index The number of the output, from zero
+/// @param windowed Whether to open a window rather than filling the screen
+/// @param width The width of the window, or of the display mode to use when
+/// filling the screen (zero for the desktop mode)
+/// @param height The height of the window or display mode
+Output::Output(int _index, bool windowed, int width, int height) :
+	index(_index),
+	window(NULL),
+	canvasX(0),
+	canvasY(0)
+{
+	char title[32];
+	snprintf(title, sizeof(title), "Aura Live! (%d)", index + 1);
+
+	// Each output gets a display of its own when filling the screen, but
+	// windows can share one (which is handy for testing)
+	int displayCount = SDL_GetNumVideoDisplays();
+	int display = displayCount > 0 ? index % displayCount : 0;
+	Uint32 flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
+	if (!windowed)
+	{
+		if (width > 0 && height > 0)
+		{
+			flags |= SDL_WINDOW_FULLSCREEN;
+		}
+		else
+		{
+			flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+			width = height = 1;
+		}
+	}
+
+	LOG(LOG_DEBUG, "Output::Output: Creating %s output %d on display %d", windowed ? "windowed" : "fullscreen", index, display);
+	window = SDL_CreateWindow(index == 0 ? "Aura Live!" : title, SDL_WINDOWPOS_CENTERED_DISPLAY(display), SDL_WINDOWPOS_CENTERED_DISPLAY(display), width, height, flags);
+	if (window == NULL)
+	{
+		throw AuraException(AURA_ERR_SDLWINDOWFAILED, SDL_GetError());
+	}
+}
+
+/// Destroys an Output object and its window
+Output::~Output()
+{
+	if (window != NULL)
+	{
+		SDL_DestroyWindow(window);
+	}
+}
+
+/// Gets the number of the output
+int Output::getIndex() const
+{
+	return index;
+}
+
+/// Gets the window
+SDL_Window* Output::getWindow() const
+{
+	return window;
+}
+
+/// Gets the SDL identifier of the window, as given in window events
+Uint32 Output::getWindowId() const
+{
+	return SDL_GetWindowID(window);
+}
+
+/// Gets the size of the drawable area of the window in pixels
+void Output::getDrawableSize(int& width, int& height) const
+{
+	SDL_GL_GetDrawableSize(window, &width, &height);
+}
+
+/// Sets where the output is on the canvas
+void Output::setCanvasPosition(int _canvasX, int _canvasY)
+{
+	canvasX = _canvasX;
+	canvasY = _canvasY;
+}
+
+/// Gets where the output is on the canvas
+void Output::getCanvasPosition(int& _canvasX, int& _canvasY) const
+{
+	_canvasX = canvasX;
+	_canvasY = canvasY;
+}
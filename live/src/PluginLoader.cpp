@@ -11,21 +11,57 @@
 #include "PluginLoader.h"
 #include "AuraException.h"
 #include "Log.h"
+#include "TraceSpan.h"
 
 /// Constructs a new PluginLoader object
 /// @param _rootDir The path to start searching for plugins from
 PluginLoader::PluginLoader(const string& _rootDir) :
 	rootDir(_rootDir)
 {
-	// Scan the plugin root directory for plugins
-	log(LOG_INFO, "PluginLoader::PluginLoader: Starting search for plugins");
-	scanPluginDir(rootDir);
-	log(LOG_INFO, "PluginLoader::PluginLoader: Plugin search complete");
+	TraceSpan span("plugin", "load all", NULL);
+
+	// Register any plugins that were linked directly in to the application
+	for (aura_static_plugin_t* staticPlugin = aura_get_static_plugins(); staticPlugin != NULL; staticPlugin = staticPlugin->next)
+	{
+		LOG(LOG_DEBUG, "PluginLoader::PluginLoader: Loading static plugin %s", staticPlugin->name);
+		TraceSpan loadSpan("plugin", "load", staticPlugin->name);
+		aura_plugin_t* plugin = staticPlugin->load();
+		if (plugin == NULL)
+		{
+			LOG(LOG_ERROR, "PluginLoader::PluginLoader: NULL returned from static plugin '%s'", staticPlugin->name);
+			continue;
+		}
+
+		string pluginName = string("static:") + staticPlugin->name;
+		if (registerPlugin(pluginName, plugin))
+		{
+			addPlugin(pluginName, plugin, NULL);
+		}
+	}
+
+	// Scan the plugin root directory for plugins. When we have static
+	// plugins the directory is optional
+	LOG(LOG_INFO, "PluginLoader::PluginLoader: Starting search for plugins");
+	try
+	{
+		TraceSpan scanSpan("plugin", "scan", rootDir.c_str());
+		scanPluginDir(rootDir);
+	}
+	catch (AuraException& e)
+	{
+		if (plugins.empty())
+		{
+			throw;
+		}
+		LOG(LOG_WARN, "PluginLoader::PluginLoader: %s, using static plugins only", e.what());
+	}
+	LOG(LOG_INFO, "PluginLoader::PluginLoader: Plugin search complete");
 
 	// Print out the plugins
 	for (auto pluginPair : pluginHandles)
 	{
-		log(LOG_DEBUG, "PluginLoader::PluginLoader: Loading %s", pluginPair.first.c_str());
+		LOG(LOG_DEBUG, "PluginLoader::PluginLoader: Loading %s", pluginPair.first.c_str());
+		TraceSpan loadSpan("plugin", "load", pluginPair.first.c_str());
 #ifdef WIN32
 #	error Not implemented
 #else
@@ -33,18 +69,28 @@ PluginLoader::PluginLoader(const string& _rootDir) :
 		void* handle = dlopen(pluginPair.first.c_str(), RTLD_LAZY);
 		if (handle == NULL)
 		{
-			log(LOG_ERROR, "PluginLoader::PluginLoader: Failed to open plugin '%s', error %s", pluginPair.first.c_str(), dlerror());
+			LOG(LOG_ERROR, "PluginLoader::PluginLoader: Failed to open plugin '%s', error %s", pluginPair.first.c_str(), dlerror());
 			continue;
 		}
 
 		// Clear any outstanding errors
 		dlerror();
 
+		// Refuse plugins built against different plugin structures, as
+		// they'd fill them in wrongly
+		const int* abiVersion = (const int*)dlsym(handle, "aura_plugin_abi_version");
+		if (abiVersion == NULL || *abiVersion != AURA_PLUGIN_ABI_VERSION)
+		{
+			LOG(LOG_ERROR, "PluginLoader::PluginLoader: Plugin '%s' was built for plugin ABI version %d, not %d", pluginPair.first.c_str(), abiVersion != NULL ? *abiVersion : 1, AURA_PLUGIN_ABI_VERSION);
+			dlclose(handle);
+			continue;
+		}
+
 		// Get the entry point function for the plugin
 		aura_plugin_func_load_t loadPlugin = (aura_plugin_func_load_t)dlsym(handle, "aura_plugin_load");
 		if (loadPlugin == NULL)
 		{
-			log(LOG_ERROR, "PluginLoader::PluginLoader: Failed to find entry point aura_plugin_load, error %s", dlerror());
+			LOG(LOG_ERROR, "PluginLoader::PluginLoader: Failed to find entry point aura_plugin_load, error %s", dlerror());
 			dlclose(handle);
 			continue;
 		}
@@ -53,71 +99,38 @@ PluginLoader::PluginLoader(const string& _rootDir) :
 		aura_plugin_t* plugin = loadPlugin();
 		if (plugin == NULL)
 		{
-			log(LOG_ERROR, "PluginLoader::PluginLoader: NULL returned from aura_plugin_load");
+			LOG(LOG_ERROR, "PluginLoader::PluginLoader: NULL returned from aura_plugin_load");
 			dlclose(handle);
 			continue;
 		}
 
-		// Attempt to get the description
-		if (plugin->getDescription)
-		{
-			aura_plugin_desc_t* description = plugin->getDescription();
-			if (description == NULL)
-			{
-				log(LOG_ERROR, "PluginLoader::PluginLoader: NULL returned from getDescription");
-				dlclose(handle);
-				continue;
-			}
-
-			log(LOG_DEBUG, "PluginLoader::PluginLoader: Successfully loaded plugin '%s' version '%s', by '%s'", description->name, description->version, description->author);
-			if (description->objectTypes != NULL)
-			{
-				auto iter = &description->objectTypes[0];
-				while (*iter != NULL)
-				{
-					log(LOG_INFO, "PluginLoader::PluginLoader: - PROVIDES %s", *iter);
-					objectPlugins[aura_object_class_t(description->pluginType, *iter)] = plugin;
-					objectTypes[description->pluginType].push_back(*iter);
-					iter++;
-				}
-			}
-		}
-		else
+		// Register the object types it provides
+		if (!registerPlugin(pluginPair.first, plugin))
 		{
-			log(LOG_ERROR, "PluginLoader::PluginLoader: No getDescription function specified");
 			dlclose(handle);
 			continue;
 		}
 
 		// Store the plugin handle for closing later
 		pluginHandles[pluginPair.first] = handle;
-		plugins[pluginPair.first] = plugin;
+		addPlugin(pluginPair.first, plugin, handle);
 #endif
 	}
 }
 
-/// Destroys a PluginLoader object, unloading all loaded plugins
+/// Destroys a PluginLoader object, unloading all loaded plugins that aren't
+/// still referenced. Those are unloaded when the last reference to them is
+/// released
 PluginLoader::~PluginLoader()
 {
-	for (auto pluginPair : pluginHandles)
+	for (auto& refPair : pluginRefs)
 	{
-#ifdef WIN32
-#	error Not implemented
-#else
-		if (pluginPair.second != NULL)
+		if (refPair.second.use_count() > 1)
 		{
-			// If the plugin has an unload function
-			if (plugins[pluginPair.first]->unload)
-			{
-				log(LOG_DEBUG, "PluginLoader::~PluginLoader: Unloading plugin '%s'", plugins[pluginPair.first]->getDescription()->name);
-				plugins[pluginPair.first]->unload();
-			}
-
-			log(LOG_DEBUG, "PluginLoader::~PluginLoader: Closing plugin '%s'", pluginPair.first.c_str());
-			dlclose(pluginPair.second);
+			LOG(LOG_WARN, "PluginLoader::~PluginLoader: Plugin '%s' is still in use, it will be unloaded once released", refPair.first->getDescription()->name);
 		}
-#endif
 	}
+	pluginRefs.clear();
 }
 
 /// Gets the plugin responsible creating for objects of the given class
@@ -135,6 +148,14 @@ aura_plugin_t* PluginLoader::getPluginFor(aura_plugin_type_t pluginType, string
 	return getPluginFor(aura_object_class_t(pluginType, name));
 }
 
+/// Gets a reference to a plugin, which keeps it loaded whilst held
+/// @param plugin A plugin returned by getPluginFor
+aura_plugin_ref_t PluginLoader::getPluginRef(aura_plugin_t* plugin)
+{
+	auto refIter = pluginRefs.find(plugin);
+	return refIter == pluginRefs.end() ? aura_plugin_ref_t() : refIter->second;
+}
+
 /// Get the names of the object types available for a plugin type
 /// @param pluginType The type of the plugin, e.g. AURA_PLUGIN_TYPE_ELEMENT
 const vector<string>& PluginLoader::getObjectTypes(aura_plugin_type_t pluginType)
@@ -142,11 +163,92 @@ const vector<string>& PluginLoader::getObjectTypes(aura_plugin_type_t pluginType
 	return objectTypes[pluginType]; 
 }
 
+/// Reads the description of a loaded plugin and registers the object types it
+/// provides
+/// @param name The name to refer to the plugin by in log messages
+/// @param plugin The loaded plugin structure
+/// @returns true if the plugin was registered, false if it was invalid
+bool PluginLoader::registerPlugin(const string& name, aura_plugin_t* plugin)
+{
+	// Attempt to get the description
+	if (plugin->getDescription == NULL)
+	{
+		LOG(LOG_ERROR, "PluginLoader::registerPlugin: No getDescription function specified by '%s'", name.c_str());
+		return false;
+	}
+
+	aura_plugin_desc_t* description = plugin->getDescription();
+	if (description == NULL)
+	{
+		LOG(LOG_ERROR, "PluginLoader::registerPlugin: NULL returned from getDescription by '%s'", name.c_str());
+		return false;
+	}
+
+	LOG(LOG_DEBUG, "PluginLoader::registerPlugin: Successfully loaded plugin '%s' version '%s', by '%s'", description->name, description->version, description->author);
+	if (description->objectTypes != NULL)
+	{
+		auto iter = &description->objectTypes[0];
+		while (*iter != NULL)
+		{
+			aura_object_class_t objectClass(description->pluginType, *iter);
+			if (objectPlugins.find(objectClass) != objectPlugins.end())
+			{
+				LOG(LOG_WARN, "PluginLoader::registerPlugin: - IGNORING %s, already provided by another plugin", *iter);
+			}
+			else
+			{
+				LOG(LOG_INFO, "PluginLoader::registerPlugin: - PROVIDES %s", *iter);
+				objectPlugins[objectClass] = plugin;
+				objectTypes[description->pluginType].push_back(*iter);
+			}
+			iter++;
+		}
+	}
+
+	return true;
+}
+
+/// Makes the first reference to a loaded plugin, which unloads it when the last
+/// reference is released
+/// @param name The name the plugin was loaded by
+/// @param plugin The loaded plugin structure
+/// @param handle The shared object handle, or NULL for static plugins
+void PluginLoader::addPlugin(const string& name, aura_plugin_t* plugin, void* handle)
+{
+	plugins[name] = plugin;
+	pluginRefs[plugin] = aura_plugin_ref_t(plugin, [name, handle](aura_plugin_t* released)
+	{
+		unloadPlugin(name, released, handle);
+	});
+}
+
+/// Unloads a plugin once nothing references it any more
+void PluginLoader::unloadPlugin(const string& name, aura_plugin_t* plugin, void* handle)
+{
+	// If the plugin has an unload function
+	if (plugin->unload)
+	{
+		LOG(LOG_DEBUG, "PluginLoader::unloadPlugin: Unloading plugin '%s'", plugin->getDescription()->name);
+		plugin->unload();
+	}
+
+#ifdef WIN32
+#	error Not implemented
+#else
+	// Static plugins have no handle to close
+	if (handle != NULL)
+	{
+		LOG(LOG_DEBUG, "PluginLoader::unloadPlugin: Closing plugin '%s'", name.c_str());
+		dlclose(handle);
+	}
+#endif
+}
+
 /// Scan the given directory for plugins, recursing down as necessary and adding
 /// them to the map
 void PluginLoader::scanPluginDir(const string& path)
 {
-	log(LOG_INFO, "PluginLoader::scanPluginDir: Scanning: %s", path.c_str());
+	LOG(LOG_INFO, "PluginLoader::scanPluginDir: Scanning: %s", path.c_str());
 #ifdef WIN32
 #	error Not implemented.
 #else
@@ -181,14 +283,14 @@ void PluginLoader::scanPluginDir(const string& path)
 			// If the filename ends in ".so"
 			if (nameLen > 3 && ent->d_name[nameLen - 3] == '.' && ent->d_name[nameLen - 2] == 's' && ent->d_name[nameLen - 1] == 'o')
 			{
-				log(LOG_DEBUG, "PluginLoader::scanPluginDir: Found: %s", entName.c_str());
+				LOG(LOG_DEBUG, "PluginLoader::scanPluginDir: Found: %s", entName.c_str());
 				pluginHandles[entName] = NULL;
 			}
 		}
 		// If we have a symbolic link...
 		else if (ent->d_type == DT_LNK)
 		{
-			log(LOG_WARN, "Found symbolic link whilst searching for plugins, ignoring");
+			LOG(LOG_WARN, "Found symbolic link whilst searching for plugins, ignoring");
 		}
 	}
 
@@ -0,0 +1,151 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <math.h>
+#include <stdio.h>
+#include "Prefetcher.h"
+
+/// Makes the key of an image from its source and size
+static string make_key(const prefetch_item_t& item)
+{
+	char size[32];
+	snprintf(size, sizeof(size), "@%dx%d", item.width, item.height);
+	return item.source + size;
+}
+
+/// Constructs a new Prefetcher object
+/// @param _imageCache The cache to load images in to
+Prefetcher::Prefetcher(ImageCache& _imageCache) :
+	imageCache(_imageCache),
+	depth(PREFETCH_MIN_DEPTH),
+	rate(0.0),
+	burst(0),
+	windowShown(0),
+	windowBurst(0),
+	windowTime(0.0),
+	hitCount(0),
+	missCount(0)
+{
+}
+
+/// Destroys a Prefetcher object, cancelling anything still loading
+Prefetcher::~Prefetcher()
+{
+	for (auto& entry : outstanding)
+	{
+		imageCache.cancel(entry.second.item.source, entry.second.item.width, entry.second.item.height);
+	}
+}
+
+/// Measures how quickly items are appearing
+/// @param timestep The time since the last call, in seconds
+/// @param shown The number of items that have appeared since the last call
+void Prefetcher::update(double timestep, size_t shown)
+{
+	windowTime += timestep;
+	windowShown += shown;
+	if (shown > windowBurst)
+	{
+		windowBurst = shown;
+	}
+
+	// Measure over a window rather than per update, as items arrive in
+	// steps even when the content scrolls smoothly
+	if (windowTime >= PREFETCH_RATE_WINDOW)
+	{
+		double measured = windowShown / windowTime;
+		rate = rate > 0.0 ? rate + (measured - rate) * PREFETCH_RATE_BLEND : measured;
+		burst = windowBurst;
+		windowShown = 0;
+		windowBurst = 0;
+		windowTime = 0.0;
+	}
+
+	// Enough to cover what appears whilst an image loads, plus the biggest
+	// jump, so that a paged layout has its next page ready
+	double ahead = ceil(rate * imageCache.getAverageLatency() * PREFETCH_MARGIN) + (burst > windowBurst ? burst : windowBurst);
+	if (ahead < PREFETCH_MIN_DEPTH)
+	{
+		ahead = PREFETCH_MIN_DEPTH;
+	}
+	if (ahead > PREFETCH_MAX_DEPTH)
+	{
+		ahead = PREFETCH_MAX_DEPTH;
+	}
+	depth = (size_t)ahead;
+}
+
+/// Prefetches the images for the current and upcoming items and cancels any
+/// that are no longer wanted
+/// @param items The images of the current items, then the upcoming ones in the
+/// order they will appear
+/// @param currentCount The number of current items at the start of the list
+void Prefetcher::setItems(const vector<prefetch_item_t>& items, size_t currentCount)
+{
+	map<string, outstanding_t> wanted;
+	size_t count = currentCount + depth < items.size() ? currentCount + depth : items.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		string key = make_key(items[i]);
+		if (wanted.find(key) != wanted.end())
+		{
+			continue;
+		}
+
+		// Current items come first, then the upcoming ones nearest first.
+		// The cache loads anything that is actually drawn ahead of all of
+		// them
+		bool upcoming = i >= currentCount;
+		bool ready = imageCache.prefetch(items[i].source, items[i].width, items[i].height, upcoming ? (int)(i - currentCount) + 2 : 1);
+
+		auto previousIter = outstanding.find(key);
+		if (!upcoming && previousIter != outstanding.end() && previousIter->second.upcoming)
+		{
+			if (ready)
+			{
+				hitCount++;
+			}
+			else
+			{
+				missCount++;
+			}
+		}
+
+		outstanding_t& entry = wanted[key];
+		entry.item = items[i];
+		entry.upcoming = upcoming;
+	}
+
+	// Whatever is left has been skipped or is too far ahead now
+	for (auto& entry : outstanding)
+	{
+		if (wanted.find(entry.first) == wanted.end())
+		{
+			imageCache.cancel(entry.second.item.source, entry.second.item.width, entry.second.item.height);
+		}
+	}
+	outstanding.swap(wanted);
+}
+
+/// Gets the number of upcoming items to prefetch, from the measured load
+/// latency and rate the items are appearing at
+size_t Prefetcher::getDepth() const
+{
+	return depth;
+}
+
+/// Gets the number of prefetched images that were ready by the time they
+/// appeared
+unsigned long long Prefetcher::getHitCount() const
+{
+	return hitCount;
+}
+
+/// Gets the number of prefetched images that weren't ready by the time they
+/// appeared
+unsigned long long Prefetcher::getMissCount() const
+{
+	return missCount;
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "QualityController.h"
+
+/// The quality levels, from best to cheapest
+static const quality_level_t g_qualityLevels[QUALITY_LEVEL_COUNT] = {
+	{ "full quality", 1.0f, false },
+	{ "simple transitions", 1.0f, true },
+	{ "75% resolution", 0.75f, true },
+	{ "50% resolution", 0.5f, true },
+};
+
+/// Constructs a new QualityController object at full quality
+QualityController::QualityController() :
+	budget(1.0 / 60.0),
+	adaptive(false),
+	level(0),
+	overrunNext(0),
+	overrunCount(0),
+	framesAtLevel(0),
+	headroomFrames(0),
+	recoverFrames(QUALITY_RECOVER_FRAMES),
+	steppedUp(false)
+{
+	for (size_t i = 0; i < QUALITY_WINDOW; i++)
+	{
+		overruns[i] = false;
+	}
+}
+
+/// Sets the time available for each frame
+/// @param _budget The vsync interval in seconds
+void QualityController::setBudget(double _budget)
+{
+	budget = _budget;
+}
+
+/// Turns the controller on or off. When off, the level stays where it is put
+void QualityController::setAdaptive(bool _adaptive)
+{
+	adaptive = _adaptive;
+}
+
+/// Determines whether the controller picks the level itself
+bool QualityController::isAdaptive() const
+{
+	return adaptive;
+}
+
+/// Sets the quality level
+/// @param _level The level, from 0 (full quality) to QUALITY_LEVEL_COUNT - 1
+void QualityController::setLevel(int _level)
+{
+	if (_level < 0)
+	{
+		_level = 0;
+	}
+	if (_level >= QUALITY_LEVEL_COUNT)
+	{
+		_level = QUALITY_LEVEL_COUNT - 1;
+	}
+
+	changeLevel(_level);
+	recoverFrames = QUALITY_RECOVER_FRAMES;
+	steppedUp = false;
+}
+
+/// Gets the current quality level
+int QualityController::getLevel() const
+{
+	return level;
+}
+
+/// Gets the settings of the current quality level
+const quality_level_t& QualityController::getSettings() const
+{
+	return g_qualityLevels[level];
+}
+
+/// Gets the settings of a quality level
+const quality_level_t& QualityController::getSettings(int _level)
+{
+	return g_qualityLevels[_level];
+}
+
+/// Records a presented frame and changes the quality level if it's called for
+/// @param frameTime The time since the previous frame, in seconds
+/// @param workTime The time spent producing the frame, in seconds
+/// @returns true if the quality level changed
+bool QualityController::addFrame(double frameTime, double workTime)
+{
+	if (!adaptive)
+	{
+		return false;
+	}
+
+	// A frame overran if it missed a vsync or took longer than the budget to
+	// produce, and had headroom if it was produced well within it
+	bool overran = frameTime > budget * QUALITY_MISSED_VSYNC || workTime > budget;
+	if (overruns[overrunNext])
+	{
+		overrunCount--;
+	}
+	overruns[overrunNext] = overran;
+	if (overran)
+	{
+		overrunCount++;
+	}
+	overrunNext = (overrunNext + 1) % QUALITY_WINDOW;
+	framesAtLevel++;
+	headroomFrames = (!overran && workTime < budget * QUALITY_HEADROOM) ? headroomFrames + 1 : 0;
+
+	// Give a new level a full window before judging it
+	if (overrunCount >= QUALITY_OVERRUN_LIMIT && framesAtLevel >= QUALITY_WINDOW && level < QUALITY_LEVEL_COUNT - 1)
+	{
+		// Stepping up didn't work out, so be slower to try again
+		if (steppedUp && framesAtLevel < QUALITY_UNSTABLE_FRAMES)
+		{
+			recoverFrames *= 2;
+			if (recoverFrames > QUALITY_MAX_RECOVER_FRAMES)
+			{
+				recoverFrames = QUALITY_MAX_RECOVER_FRAMES;
+			}
+		}
+		changeLevel(level + 1);
+		steppedUp = false;
+		return true;
+	}
+
+	if (headroomFrames >= recoverFrames && level > 0)
+	{
+		changeLevel(level - 1);
+		steppedUp = true;
+		return true;
+	}
+
+	// A level that has held for a long time has proven itself
+	if (steppedUp && framesAtLevel == QUALITY_UNSTABLE_FRAMES)
+	{
+		recoverFrames = QUALITY_RECOVER_FRAMES;
+	}
+
+	return false;
+}
+
+/// Moves to a new level and starts watching afresh
+void QualityController::changeLevel(int _level)
+{
+	level = _level;
+	for (size_t i = 0; i < QUALITY_WINDOW; i++)
+	{
+		overruns[i] = false;
+	}
+	overrunNext = 0;
+	overrunCount = 0;
+	framesAtLevel = 0;
+	headroomFrames = 0;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include "ScaledRenderTarget.h"
+#include "Log.h"
+
+/// Constructs a new ScaledRenderTarget object. A GL context must be current
+ScaledRenderTarget::ScaledRenderTarget() :
+	framebuffer(0),
+	colourBuffer(0),
+	width(0),
+	height(0),
+	scaledWidth(0),
+	scaledHeight(0),
+	previousFramebuffer(0)
+{
+}
+
+/// Destroys a ScaledRenderTarget object and its GL resources
+ScaledRenderTarget::~ScaledRenderTarget()
+{
+	if (framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colourBuffer);
+	}
+}
+
+/// Binds a framebuffer that is a scaled-down copy of the current viewport,
+/// ready to draw in to. The viewport is left for the caller to set, in the
+/// scaled framebuffer's pixels
+/// @param _width The width of the output in pixels
+/// @param _height The height of the output in pixels
+/// @param scale The resolution to draw at, as a fraction of the output's
+void ScaledRenderTarget::begin(int _width, int _height, float scale)
+{
+	width = _width;
+	height = _height;
+	int newWidth = (int)(width * scale + 0.5f);
+	int newHeight = (int)(height * scale + 0.5f);
+	if (newWidth < 1)
+	{
+		newWidth = 1;
+	}
+	if (newHeight < 1)
+	{
+		newHeight = 1;
+	}
+	if (newWidth != scaledWidth || newHeight != scaledHeight)
+	{
+		resize(newWidth, newHeight);
+	}
+
+	// Offscreen there is already a framebuffer bound that we have to go
+	// back to
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+/// Stretches what was drawn over the framebuffer that was bound before
+/// begin(), and binds that framebuffer again
+void ScaledRenderTarget::end()
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+	glBlitFramebuffer(0, 0, scaledWidth, scaledHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(0, 0, width, height);
+}
+
+/// (Re)creates the framebuffer at the given size
+void ScaledRenderTarget::resize(int _scaledWidth, int _scaledHeight)
+{
+	scaledWidth = _scaledWidth;
+	scaledHeight = _scaledHeight;
+
+	if (framebuffer == 0)
+	{
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &colourBuffer);
+	}
+
+	GLint previousBinding = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousBinding);
+	glBindRenderbuffer(GL_RENDERBUFFER, colourBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, scaledWidth, scaledHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG(LOG_ERROR, "ScaledRenderTarget::resize: Framebuffer is incomplete at %dx%d", scaledWidth, scaledHeight);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, previousBinding);
+	LOG(LOG_DEBUG, "ScaledRenderTarget::resize: Framebuffer is now %dx%d", scaledWidth, scaledHeight);
+}
@@ -0,0 +1,228 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <algorithm>
+#include "SceneNode.h"
+
+/// Constructs a new SceneNode object. The node takes ownership of the element
+/// instance
+/// @param _plugin The plugin that created the object, or NULL for a group
+/// @param _object The element instance, or NULL for a group
+SceneNode::SceneNode(aura_plugin_t* _plugin, aura_object_instance_t* _object) :
+	plugin(_plugin),
+	object(_object),
+	parent(NULL),
+	x(0.0f),
+	y(0.0f),
+	width(0.0f),
+	height(0.0f),
+	visible(true),
+	dirty(true),
+	childDirty(false)
+{
+}
+
+/// Destroys a SceneNode object, its element instance and all of its children
+SceneNode::~SceneNode()
+{
+	for (auto child : children)
+	{
+		delete child;
+	}
+
+	if (object != NULL && plugin != NULL && plugin->destroy != NULL)
+	{
+		plugin->destroy(object);
+	}
+}
+
+/// Adds a child node. The node takes ownership of the child
+/// @param child The node to add
+void SceneNode::addChild(SceneNode* child)
+{
+	child->parent = this;
+	children.push_back(child);
+	child->markDirty();
+}
+
+/// Removes a child node without deleting it. Ownership passes back to the caller
+/// @param child The node to remove
+void SceneNode::removeChild(SceneNode* child)
+{
+	auto childIter = find(children.begin(), children.end(), child);
+	if (childIter != children.end())
+	{
+		// Whatever was underneath the child is now exposed
+		if (child->isVisibleInTree())
+		{
+			markDirty();
+		}
+		children.erase(childIter);
+		child->parent = NULL;
+	}
+}
+
+/// Gets the children of this node, in drawing order
+const vector<SceneNode*>& SceneNode::getChildren() const
+{
+	return children;
+}
+
+/// Gets the parent of this node, or NULL if it is the root
+SceneNode* SceneNode::getParent() const
+{
+	return parent;
+}
+
+/// Gets the plugin that created the element instance
+aura_plugin_t* SceneNode::getPlugin() const
+{
+	return plugin;
+}
+
+/// Gets the element instance, or NULL for a group
+aura_object_instance_t* SceneNode::getObject() const
+{
+	return object;
+}
+
+/// Gets a property of the element instance
+/// @param name The name of the property
+/// @returns The property, or NULL if there is no such property
+aura_property_t* SceneNode::getProperty(const char* name) const
+{
+	if (object == NULL || object->properties == NULL)
+	{
+		return NULL;
+	}
+
+	return aura_get_property(object->properties, name);
+}
+
+/// Notifies the node that one of its properties has been changed, passing the
+/// notification on to the plugin and marking the node dirty
+/// @param property The property that changed
+void SceneNode::propertyChanged(aura_property_t* property)
+{
+	if (plugin != NULL && plugin->propertyChanged != NULL)
+	{
+		plugin->propertyChanged(property);
+	}
+
+	markDirty();
+}
+
+/// Sets the position and size of the node on the display
+void SceneNode::setGeometry(float _x, float _y, float _width, float _height)
+{
+	if (_x != x || _y != y || _width != width || _height != height)
+	{
+		x = _x;
+		y = _y;
+		width = _width;
+		height = _height;
+		markDirty();
+	}
+}
+
+/// Gets the position and size of the node on the display
+void SceneNode::getGeometry(float& _x, float& _y, float& _width, float& _height) const
+{
+	_x = x;
+	_y = y;
+	_width = width;
+	_height = height;
+}
+
+/// Shows or hides the node (and its children)
+void SceneNode::setVisible(bool _visible)
+{
+	if (_visible == visible)
+	{
+		return;
+	}
+
+	// Mark dirty whilst visible so that hiding is drawn too
+	if (visible)
+	{
+		markDirty();
+		visible = false;
+	}
+	else
+	{
+		visible = true;
+		markDirty();
+	}
+}
+
+/// Determines whether the node itself is visible
+bool SceneNode::isVisible() const
+{
+	return visible;
+}
+
+/// Determines whether the node and all of its ancestors are visible
+bool SceneNode::isVisibleInTree() const
+{
+	for (const SceneNode* node = this; node != NULL; node = node->parent)
+	{
+		if (!node->visible)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Marks the node as needing to be redrawn. If the node can't be seen it is
+/// still marked, but the display doesn't need redrawing for it
+void SceneNode::markDirty()
+{
+	dirty = true;
+	if (visible && parent != NULL)
+	{
+		parent->markChildDirty();
+	}
+}
+
+/// Marks this node and its ancestors as having a dirty descendant, up to the
+/// first one that is hidden
+void SceneNode::markChildDirty()
+{
+	// Stop as soon as we find an ancestor that already knows, or one that
+	// hides the change from everything above it
+	for (SceneNode* node = this; node != NULL && !node->childDirty; node = node->parent)
+	{
+		node->childDirty = true;
+		if (!node->visible)
+		{
+			break;
+		}
+	}
+}
+
+/// Determines whether this node or any of its descendants need to be redrawn
+bool SceneNode::needsRedraw() const
+{
+	return dirty || childDirty;
+}
+
+/// Clears the dirty state of this node and its descendants
+void SceneNode::clearDirty()
+{
+	bool descendantsDirty = childDirty;
+	dirty = false;
+	childDirty = false;
+
+	// Only the children on a dirty path need visiting
+	if (descendantsDirty)
+	{
+		for (auto child : children)
+		{
+			child->clearDirty();
+		}
+	}
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <string>
+#include <vector>
+#include "ShaderProgram.h"
+#include "AuraException.h"
+#include "Log.h"
+
+/// Compiles and links a new shader program
+/// @param vertexSource The source of the vertex shader
+/// @param fragmentSource The source of the fragment shader
+ShaderProgram::ShaderProgram(const char* vertexSource, const char* fragmentSource) :
+	program(0)
+{
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = 0;
+	try
+	{
+		fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	}
+	catch (AuraException&)
+	{
+		glDeleteShader(vertexShader);
+		throw;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glBindFragDataLocation(program, 0, "fragColour");
+	glLinkProgram(program);
+
+	// The shaders aren't needed once they have been linked
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		GLint logLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		vector<char> infoLog(logLength + 1, '\0');
+		glGetProgramInfoLog(program, logLength, NULL, &infoLog[0]);
+		glDeleteProgram(program);
+
+		LOG(LOG_ERROR, "ShaderProgram::ShaderProgram: Link failed: %s", &infoLog[0]);
+		throw AuraException(AURA_ERR_SHADERCOMPILE, string("Failed to link shader program: ") + &infoLog[0]);
+	}
+}
+
+/// Destroys a ShaderProgram object, deleting the program
+ShaderProgram::~ShaderProgram()
+{
+	glDeleteProgram(program);
+}
+
+/// Makes this the current program
+void ShaderProgram::use()
+{
+	glUseProgram(program);
+}
+
+/// Gets the location of a uniform
+/// @param name The name of the uniform
+GLint ShaderProgram::getUniformLocation(const char* name)
+{
+	return glGetUniformLocation(program, name);
+}
+
+/// Gets the GL program name
+GLuint ShaderProgram::getProgram() const
+{
+	return program;
+}
+
+/// Compiles a single shader, throwing an AuraException on failure
+/// @param type The shader type, e.g. GL_VERTEX_SHADER
+/// @param source The source of the shader
+GLuint ShaderProgram::compileShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled != GL_TRUE)
+	{
+		GLint logLength = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+		vector<char> infoLog(logLength + 1, '\0');
+		glGetShaderInfoLog(shader, logLength, NULL, &infoLog[0]);
+		glDeleteShader(shader);
+
+		LOG(LOG_ERROR, "ShaderProgram::compileShader: Compilation failed: %s", &infoLog[0]);
+		throw AuraException(AURA_ERR_SHADERCOMPILE, string("Failed to compile shader: ") + &infoLog[0]);
+	}
+
+	return shader;
+}
@@ -0,0 +1,358 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <chrono>
+#include "SourceRunner.h"
+#include "Log.h"
+#include "TraceSpan.h"
+
+/// Constructs a new SourceRunner object and starts the watchdog
+/// @param _budgetMs The time budget for a single plugin call
+/// @param _quarantineCount The number of consecutive overruns before a source
+/// is quarantined
+SourceRunner::SourceRunner(unsigned int _budgetMs, unsigned int _quarantineCount) :
+	budgetMs(_budgetMs),
+	quarantineCount(_quarantineCount),
+	watchdogStopping(false)
+{
+	watchdogThread = thread(&SourceRunner::watchdogMain, this);
+}
+
+/// Destroys a SourceRunner object, stopping all the worker threads and
+/// destroying their source objects
+SourceRunner::~SourceRunner()
+{
+	// Stop the watchdog first so that it isn't looking at workers as we go
+	{
+		unique_lock<mutex> guard(lock);
+		watchdogStopping = true;
+	}
+	watchdogWake.notify_all();
+	watchdogThread.join();
+
+	// Stop all the workers
+	map<aura_object_instance_t*, worker_t*> stopping;
+	{
+		unique_lock<mutex> guard(lock);
+		stopping.swap(workers);
+	}
+	for (auto workerPair : stopping)
+	{
+		stopWorker(workerPair.second);
+	}
+}
+
+/// Starts polling a source object on a new worker thread. The source object
+/// belongs to the SourceRunner from then on
+/// @param plugin A reference to the source plugin that created the object,
+/// which is held until the worker has exited
+/// @param object The source object instance to poll
+/// @param intervalMs The usual time to wait between polls
+void SourceRunner::addSource(const aura_plugin_ref_t& plugin, aura_object_instance_t* object, unsigned int intervalMs)
+{
+	worker_t* worker = new worker_t;
+	worker->plugin = (aura_source_plugin_t*)plugin.get();
+	worker->pluginRef = plugin;
+	worker->object = object;
+	worker->intervalMs = intervalMs;
+	worker->budgetMs = budgetMs;
+	worker->quarantineCount = quarantineCount;
+	worker->stopping = false;
+	worker->finished = false;
+	worker->abandoned = false;
+	worker->callStartNs = 0;
+	worker->overrunCounted = false;
+	worker->stats.objectType = object->objectType;
+	worker->stats.calls = 0;
+	worker->stats.overruns = 0;
+	worker->stats.consecutiveOverruns = 0;
+	worker->stats.lastCallMs = 0.0;
+	worker->stats.maxCallMs = 0.0;
+	worker->stats.quarantined = false;
+	worker->stats.pollIntervalMs = intervalMs;
+	worker->stats.itemRate = 0.0;
+
+	static const double pollBounds[] = { SOURCE_POLL_BUCKETS };
+	string labels = string("source=\"") + object->objectType + "\"";
+	worker->pollSeconds = aura_metric_histogram("aura_source_poll_seconds", labels.c_str(), "Time taken by source plugins' polls", pollBounds, sizeof(pollBounds) / sizeof(pollBounds[0]));
+	worker->pollFailures = aura_metric_counter("aura_source_poll_failures_total", labels.c_str(), "Source plugin polls that failed");
+
+	LOG(LOG_DEBUG, "SourceRunner::addSource: Starting worker for source '%s', polling around every %ums", object->objectType, intervalMs);
+
+	aura_source_schedule_add(object, intervalMs / 1000.0, intervalMs / (SOURCE_SCHEDULE_SPEEDUP * 1000.0), intervalMs * SOURCE_SCHEDULE_SLOWDOWN / 1000.0);
+
+	unique_lock<mutex> guard(lock);
+	workers[object] = worker;
+	worker->workerThread = thread(&SourceRunner::workerMain, worker);
+}
+
+/// Stops polling a source object, waiting for its worker to finish, and
+/// destroys the object. If the worker is stuck then the object is destroyed
+/// when it returns
+/// @param object The source object instance to stop
+void SourceRunner::removeSource(aura_object_instance_t* object)
+{
+	worker_t* worker = NULL;
+	{
+		unique_lock<mutex> guard(lock);
+		auto workerIter = workers.find(object);
+		if (workerIter == workers.end())
+		{
+			return;
+		}
+		worker = workerIter->second;
+		workers.erase(workerIter);
+	}
+
+	stopWorker(worker);
+}
+
+/// Gets a snapshot of the statistics for a source object
+/// @param object The source object instance
+/// @param stats The structure to fill in
+/// @returns true if the object is known, false otherwise
+bool SourceRunner::getStats(aura_object_instance_t* object, source_stats_t& stats)
+{
+	unique_lock<mutex> guard(lock);
+	auto workerIter = workers.find(object);
+	if (workerIter == workers.end())
+	{
+		return false;
+	}
+
+	unique_lock<mutex> workerGuard(workerIter->second->lock);
+	stats = workerIter->second->stats;
+	getScheduleStats(object, stats);
+	return true;
+}
+
+/// Gets a snapshot of the statistics of every source object
+vector<source_stats_t> SourceRunner::getAllStats()
+{
+	vector<source_stats_t> allStats;
+
+	unique_lock<mutex> guard(lock);
+	for (auto workerPair : workers)
+	{
+		unique_lock<mutex> workerGuard(workerPair.second->lock);
+		allStats.push_back(workerPair.second->stats);
+		getScheduleStats(workerPair.first, allStats.back());
+	}
+
+	return allStats;
+}
+
+/// Determines whether a source has been quarantined
+/// @param object The source object instance
+bool SourceRunner::isQuarantined(aura_object_instance_t* object)
+{
+	source_stats_t stats;
+	return getStats(object, stats) && stats.quarantined;
+}
+
+/// Entry point for worker threads
+void SourceRunner::workerMain(worker_t* worker)
+{
+	aura_trace_set_thread_name((string("source ") + worker->object->objectType).c_str());
+	unique_lock<mutex> guard(worker->lock);
+	while (!worker->stopping && !worker->stats.quarantined)
+	{
+		// Call in to the plugin without holding the lock so that the
+		// watchdog can inspect us whilst we're in there
+		worker->overrunCounted = false;
+		worker->callStartNs = nowNs();
+		guard.unlock();
+		bool success = true;
+		if (worker->plugin->poll != NULL)
+		{
+			TraceSpan span("plugin", "poll", worker->object->objectType);
+			success = worker->plugin->poll(worker->object);
+		}
+		long long callEndNs = nowNs();
+		aura_source_report_poll(worker->object, success);
+		aura_metric_observe(worker->pollSeconds, (callEndNs - worker->callStartNs) / 1000000000.0);
+		if (!success)
+		{
+			aura_metric_add(worker->pollFailures, 1.0);
+		}
+		guard.lock();
+
+		// Update the statistics
+		double callMs = (callEndNs - worker->callStartNs) / 1000000.0;
+		worker->callStartNs = 0;
+		worker->stats.calls++;
+		worker->stats.lastCallMs = callMs;
+		if (callMs > worker->stats.maxCallMs)
+		{
+			worker->stats.maxCallMs = callMs;
+		}
+
+		if (callMs > worker->budgetMs)
+		{
+			// The watchdog may not have spotted this one in time
+			if (!worker->overrunCounted)
+			{
+				recordOverrun(worker);
+			}
+		}
+		else
+		{
+			worker->stats.consecutiveOverruns = 0;
+		}
+
+		// Wait until the next poll is due (or we're told to stop)
+		if (!worker->stats.quarantined)
+		{
+			waitForPoll(worker, guard);
+		}
+	}
+
+	worker->finished = true;
+	worker->finishedSignal.notify_all();
+
+	// Nothing will join an abandoned worker, so it tidies up after itself
+	if (worker->abandoned)
+	{
+		guard.unlock();
+		destroyWorker(worker);
+	}
+}
+
+/// Entry point for the watchdog thread
+void SourceRunner::watchdogMain()
+{
+	// Check a few times per budget period so we spot overruns promptly
+	unsigned int checkIntervalMs = budgetMs / 4 > 0 ? budgetMs / 4 : 1;
+
+	unique_lock<mutex> guard(lock);
+	while (!watchdogStopping)
+	{
+		watchdogWake.wait_for(guard, chrono::milliseconds(checkIntervalMs));
+
+		long long now = nowNs();
+		for (auto workerPair : workers)
+		{
+			worker_t* worker = workerPair.second;
+			unique_lock<mutex> workerGuard(worker->lock);
+
+			long long callStart = worker->callStartNs;
+			if (callStart != 0 && !worker->overrunCounted && (now - callStart) / 1000000 > budgetMs)
+			{
+				LOG(LOG_WARN, "SourceRunner::watchdogMain: Source '%s' has exceeded its %ums budget", worker->stats.objectType.c_str(), budgetMs);
+				worker->overrunCounted = true;
+				recordOverrun(worker);
+			}
+		}
+	}
+}
+
+/// Records an overrun against a worker, quarantining it if necessary. Must be
+/// called with the worker mutex held
+void SourceRunner::recordOverrun(worker_t* worker)
+{
+	worker->stats.overruns++;
+	worker->stats.consecutiveOverruns++;
+
+	if (!worker->stats.quarantined && worker->stats.consecutiveOverruns >= worker->quarantineCount)
+	{
+		LOG(LOG_ERROR, "SourceRunner::recordOverrun: Source '%s' overran %u times in a row, quarantining", worker->stats.objectType.c_str(), worker->stats.consecutiveOverruns);
+		worker->stats.quarantined = true;
+	}
+}
+
+/// Stops and joins (or abandons, if stuck) a worker. Must be called without any
+/// mutex held
+void SourceRunner::stopWorker(worker_t* worker)
+{
+	// A stuck worker that returns later reports to a schedule that's gone,
+	// which is ignored
+	aura_source_schedule_remove(worker->object);
+
+	unique_lock<mutex> guard(worker->lock);
+	worker->stopping = true;
+	worker->wake.notify_all();
+
+	// Give the worker the rest of its budget to get out of the plugin
+	long long callStart = worker->callStartNs;
+	long long remainingMs = worker->budgetMs;
+	if (callStart != 0)
+	{
+		remainingMs -= (nowNs() - callStart) / 1000000;
+	}
+	if (remainingMs < 0)
+	{
+		remainingMs = 0;
+	}
+
+	if (worker->finishedSignal.wait_for(guard, chrono::milliseconds(remainingMs), [worker]() { return worker->finished; }))
+	{
+		guard.unlock();
+		worker->workerThread.join();
+		destroyWorker(worker);
+	}
+	else
+	{
+		// The worker is stuck inside the plugin. We can't safely kill it,
+		// so detach it and leave it to destroy itself (and release the
+		// plugin) if it ever returns. Its state is the only thing it will
+		// touch until then
+		LOG(LOG_ERROR, "SourceRunner::stopWorker: Source '%s' is stuck, abandoning its worker thread", worker->stats.objectType.c_str());
+		worker->abandoned = true;
+		worker->workerThread.detach();
+	}
+}
+
+/// Destroys a worker whose thread has exited, along with the source object it
+/// polled, releasing its reference to the plugin
+void SourceRunner::destroyWorker(worker_t* worker)
+{
+	if (worker->plugin->super.destroy != NULL)
+	{
+		worker->plugin->super.destroy(worker->object);
+	}
+	delete worker;
+}
+
+/// Waits until the next poll of a worker's source is due, or the worker is told
+/// to stop. Must be called with the worker mutex held
+void SourceRunner::waitForPoll(worker_t* worker, unique_lock<mutex>& guard)
+{
+	double delay = aura_source_get_poll_delay(worker->object);
+	if (delay < 0.0)
+	{
+		worker->wake.wait_for(guard, chrono::milliseconds(worker->intervalMs), [worker]() { return worker->stopping; });
+		return;
+	}
+
+	// Ask the scheduler again every so often, as a stream dropping brings
+	// the next poll forward
+	while (delay > 0.0 && !worker->stopping)
+	{
+		long long delayMs = (long long)(delay * 1000.0) + 1;
+		if (delayMs > SOURCE_SCHEDULE_RECHECK_MS)
+		{
+			delayMs = SOURCE_SCHEDULE_RECHECK_MS;
+		}
+		worker->wake.wait_for(guard, chrono::milliseconds(delayMs), [worker]() { return worker->stopping; });
+		delay = aura_source_get_poll_delay(worker->object);
+	}
+}
+
+/// Fills in the scheduling statistics of a source
+void SourceRunner::getScheduleStats(aura_object_instance_t* object, source_stats_t& stats)
+{
+	aura_source_schedule_t schedule;
+	if (aura_source_get_schedule(object, &schedule))
+	{
+		stats.pollIntervalMs = schedule.interval * 1000.0;
+		stats.itemRate = schedule.itemRate;
+	}
+}
+
+/// Gets the current steady clock time in nanoseconds
+long long SourceRunner::nowNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
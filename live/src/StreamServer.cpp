@@ -0,0 +1,369 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "StreamServer.h"
+#include "AuraException.h"
+#include "Log.h"
+
+/// The response to a request for the stream
+static const char* g_streamResponse =
+	"HTTP/1.0 200 OK\r\n"
+	"Content-Type: multipart/x-mixed-replace; boundary=" STREAM_SERVER_BOUNDARY "\r\n"
+	"Cache-Control: no-cache\r\n"
+	"Connection: close\r\n"
+	"\r\n";
+
+/// The response to anything else
+static const char* g_badRequestResponse =
+	"HTTP/1.0 405 Method Not Allowed\r\n"
+	"Allow: GET\r\n"
+	"Connection: close\r\n"
+	"\r\n";
+
+/// Frees an encoded frame's data
+StreamServer::stream_frame_t::~stream_frame_t()
+{
+	free(data);
+}
+
+/// Constructs a new StreamServer object, listening on every address
+/// @param _port The port to listen on
+StreamServer::StreamServer(unsigned short _port) :
+	port(_port),
+	listenSocket(-1),
+	stopping(false),
+	publishedCount(0),
+	clientCount(0),
+	sentCount(0),
+	skippedCount(0)
+{
+	wakePipe[0] = wakePipe[1] = -1;
+
+	listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (listenSocket < 0 ||
+		setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+		bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(listenSocket, STREAM_SERVER_MAX_CLIENTS) != 0 ||
+		fcntl(listenSocket, F_SETFL, O_NONBLOCK) != 0 ||
+		pipe(wakePipe) != 0)
+	{
+		string reason = strerror(errno);
+		if (listenSocket >= 0)
+		{
+			close(listenSocket);
+		}
+		throw AuraException(AURA_ERR_STREAMFAILED, "Failed to listen for stream clients on port " + to_string(port) + ": " + reason);
+	}
+	fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+
+	serverThread = thread(&StreamServer::serverMain, this);
+	LOG(LOG_INFO, "StreamServer::StreamServer: Streaming on port %u", port);
+}
+
+/// Destroys a StreamServer object, disconnecting every client
+StreamServer::~StreamServer()
+{
+	stopping = true;
+	if (write(wakePipe[1], "", 1) < 0)
+	{
+		// The pipe is only full if the thread is already awake
+	}
+	serverThread.join();
+
+	for (auto& client : clients)
+	{
+		close(client.socket);
+	}
+	close(listenSocket);
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+}
+
+/// Makes a frame the newest, to be sent to every client. Frames can finish
+/// encoding out of order, so one older than the newest is dropped
+/// @param data The JPEG data, allocated with malloc(), which the server takes
+/// ownership of
+/// @param length The length of the data in bytes
+/// @param sequence The number of the captured frame it came from
+void StreamServer::publish(unsigned char* data, size_t length, unsigned long long sequence)
+{
+	shared_ptr<stream_frame_t> frame(new stream_frame_t);
+	frame->data = data;
+	frame->length = length;
+	frame->sequence = sequence;
+	{
+		lock_guard<mutex> guard(lock);
+		if (latest && latest->sequence >= sequence)
+		{
+			return;
+		}
+		frame->serial = ++publishedCount;
+		latest = frame;
+	}
+
+	if (write(wakePipe[1], "", 1) < 0)
+	{
+		// The pipe is only full if the thread is already awake
+	}
+}
+
+/// Gets the port being listened on
+unsigned short StreamServer::getPort() const
+{
+	return port;
+}
+
+/// Gets the number of clients being streamed to
+size_t StreamServer::getClientCount() const
+{
+	return clientCount;
+}
+
+/// Gets the number of frames sent, to every client
+unsigned long long StreamServer::getSentCount() const
+{
+	return sentCount;
+}
+
+/// Gets the number of frames clients skipped because they were busy
+unsigned long long StreamServer::getSkippedCount() const
+{
+	return skippedCount;
+}
+
+/// Entry point for the server thread
+void StreamServer::serverMain()
+{
+	vector<struct pollfd> pollFds;
+	while (!stopping)
+	{
+		// Wait for a new client, a new frame, or a client to be ready
+		pollFds.resize(2 + clients.size());
+		pollFds[0].fd = listenSocket;
+		pollFds[0].events = POLLIN;
+		pollFds[1].fd = wakePipe[0];
+		pollFds[1].events = POLLIN;
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			client_t& client = clients[i];
+			pollFds[i + 2].fd = client.socket;
+			pollFds[i + 2].events = POLLIN;
+			if (client.pendingSent < client.pending.size() || client.frame)
+			{
+				pollFds[i + 2].events |= POLLOUT;
+			}
+		}
+		if (poll(&pollFds[0], pollFds.size(), -1) < 0 && errno != EINTR)
+		{
+			LOG(LOG_ERROR, "StreamServer::serverMain: poll() failed: %s", strerror(errno));
+			break;
+		}
+
+		char drain[64];
+		while (read(wakePipe[0], drain, sizeof(drain)) > 0)
+		{
+		}
+
+		// Look after the clients we had before accepting any more, as the
+		// poll results are in the same order
+		for (size_t i = clients.size(); i-- > 0;)
+		{
+			client_t& client = clients[i];
+			short events = pollFds[i + 2].revents;
+			bool keep = true;
+			if (events & (POLLERR | POLLHUP | POLLNVAL))
+			{
+				keep = false;
+			}
+			if (keep && (events & POLLIN))
+			{
+				keep = readClient(client);
+			}
+			if (keep && client.streaming)
+			{
+				nextFrame(client);
+			}
+			if (keep)
+			{
+				keep = writeClient(client);
+			}
+
+			// A client that was refused goes once it has been told
+			if (keep && !client.streaming && !client.pending.empty() && client.pendingSent == client.pending.size())
+			{
+				keep = false;
+			}
+			if (!keep)
+			{
+				close(client.socket);
+				clients.erase(clients.begin() + i);
+				LOG(LOG_DEBUG, "StreamServer::serverMain: Client disconnected, %zu left", clients.size());
+			}
+		}
+
+		if (pollFds[0].revents & POLLIN)
+		{
+			int clientSocket;
+			while ((clientSocket = accept(listenSocket, NULL, NULL)) >= 0)
+			{
+				if (clients.size() >= STREAM_SERVER_MAX_CLIENTS)
+				{
+					LOG(LOG_WARN, "StreamServer::serverMain: Already streaming to %d clients, refusing another", STREAM_SERVER_MAX_CLIENTS);
+					close(clientSocket);
+					continue;
+				}
+
+				fcntl(clientSocket, F_SETFL, O_NONBLOCK);
+				client_t client;
+				client.socket = clientSocket;
+				client.streaming = false;
+				client.pendingSent = 0;
+				client.frameSent = 0;
+				client.lastSerial = 0;
+				clients.push_back(client);
+				LOG(LOG_DEBUG, "StreamServer::serverMain: Client connected, %zu in total", clients.size());
+			}
+		}
+
+		clientCount = clients.size();
+	}
+}
+
+/// Reads from a client
+/// @returns false if the client should be disconnected
+bool StreamServer::readClient(client_t& client)
+{
+	char buffer[1024];
+	ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+	if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+	{
+		return false;
+	}
+	if (received < 0 || client.streaming || !client.pending.empty())
+	{
+		// Anything sent after the request is ignored
+		return true;
+	}
+
+	client.request.append(buffer, received);
+	if (client.request.find("\r\n\r\n") == string::npos)
+	{
+		return client.request.size() < STREAM_SERVER_MAX_REQUEST;
+	}
+
+	// Every path is the stream, as there's only the one thing to serve
+	if (client.request.compare(0, 4, "GET ") == 0)
+	{
+		client.streaming = true;
+		client.pending = g_streamResponse;
+	}
+	else
+	{
+		client.pending = g_badRequestResponse;
+	}
+	client.request.clear();
+	client.pendingSent = 0;
+	return true;
+}
+
+/// Sends what's waiting to a client
+/// @returns false if the client should be disconnected
+bool StreamServer::writeClient(client_t& client)
+{
+	while (client.pendingSent < client.pending.size() || (client.frame && client.frameSent < client.frame->length))
+	{
+		const char* data;
+		size_t length;
+		if (client.pendingSent < client.pending.size())
+		{
+			data = client.pending.data() + client.pendingSent;
+			length = client.pending.size() - client.pendingSent;
+		}
+		else
+		{
+			data = (const char*)client.frame->data + client.frameSent;
+			length = client.frame->length - client.frameSent;
+		}
+
+		ssize_t sent = send(client.socket, data, length, MSG_NOSIGNAL);
+		if (sent < 0)
+		{
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+		if (client.pendingSent < client.pending.size())
+		{
+			client.pendingSent += sent;
+		}
+		else
+		{
+			client.frameSent += sent;
+		}
+	}
+
+	// The frame has gone, so the client is ready for the next
+	if (client.frame)
+	{
+		client.frame.reset();
+		sentCount++;
+		nextFrame(client);
+		if (client.frame)
+		{
+			return writeClient(client);
+		}
+	}
+
+	return true;
+}
+
+/// Starts sending the newest frame to a client, if it has finished the last and
+/// there is a newer one
+void StreamServer::nextFrame(client_t& client)
+{
+	if (client.frame || client.pendingSent < client.pending.size())
+	{
+		return;
+	}
+
+	shared_ptr<stream_frame_t> frame;
+	{
+		lock_guard<mutex> guard(lock);
+		frame = latest;
+	}
+	if (!frame || frame->serial == client.lastSerial)
+	{
+		return;
+	}
+
+	if (client.lastSerial != 0)
+	{
+		skippedCount += frame->serial - client.lastSerial - 1;
+	}
+	client.lastSerial = frame->serial;
+	client.frame = frame;
+	client.frameSent = 0;
+
+	// Each part is preceded by a line break, which before the first part is
+	// just ignored
+	char header[128];
+	snprintf(header, sizeof(header), "\r\n--" STREAM_SERVER_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", frame->length);
+	client.pending = header;
+	client.pendingSent = 0;
+}
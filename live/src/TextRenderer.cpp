@@ -0,0 +1,500 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <libaura/aura.h>
+#include <algorithm>
+#include <string.h>
+#include "TextRenderer.h"
+#include FT_ADVANCES_H
+#include "AuraException.h"
+#include "Log.h"
+
+// Definitions:
+#define TEXT_FLOATS_PER_VERTEX   4
+#define TEXT_VERTICES_PER_GLYPH  6
+
+/// Vertex shader: glyph quads are built relative to the top-left of the run
+static const char* g_textVertexShader =
+	"#version 150\n"
+	"uniform vec2 viewport;\n"
+	"uniform vec2 offset;\n"
+	"in vec2 position;\n"
+	"in vec2 texCoordIn;\n"
+	"out vec2 texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 pixel = position + offset;\n"
+	"	texCoord = texCoordIn;\n"
+	"	gl_Position = vec4(pixel.x / viewport.x * 2.0 - 1.0, 1.0 - pixel.y / viewport.y * 2.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Fragment shader: the atlas holds coverage, which becomes alpha
+static const char* g_textFragmentShader =
+	"#version 150\n"
+	"uniform sampler2D atlas;\n"
+	"uniform vec4 colour;\n"
+	"in vec2 texCoord;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColour = vec4(colour.rgb, colour.a * texture(atlas, texCoord).r);\n"
+	"}\n";
+
+/// A glyph positioned by the layout
+typedef struct positioned_glyph_t
+{
+	/// The index of the glyph in the face
+	FT_UInt index;
+
+	/// The pen position of the glyph
+	float x, baseline;
+} positioned_glyph_t;
+
+/// Positions the glyphs of a block of text, wrapping at spaces where it can
+/// @param face The face to lay out with, already set to the right size
+/// @param text The UTF-8 encoded text
+/// @param wrapWidth The width to wrap lines at, or zero not to wrap
+/// @param glyphs Filled with the positioned glyphs
+/// @returns The height of the block in pixels
+static float layout_glyphs(FT_Face face, const char* text, float wrapWidth, vector<positioned_glyph_t>& glyphs)
+{
+	float lineHeight = face->size->metrics.height / 64.0f;
+	bool hasKerning = FT_HAS_KERNING(face);
+
+	float penX = 0.0f;
+	float baseline = face->size->metrics.ascender / 64.0f;
+	size_t lineStart = 0, wordStart = 0;
+	float wordStartX = 0.0f;
+	FT_UInt previous = 0;
+
+	const char* next = text;
+	unsigned int codepoint;
+	while ((codepoint = utf8decode(next, &next)) != 0)
+	{
+		if (codepoint == '\n')
+		{
+			penX = 0.0f;
+			baseline += lineHeight;
+			lineStart = wordStart = glyphs.size();
+			wordStartX = 0.0f;
+			previous = 0;
+			continue;
+		}
+
+		FT_UInt index = FT_Get_Char_Index(face, codepoint);
+		if (hasKerning && previous != 0 && index != 0)
+		{
+			FT_Vector kerning;
+			FT_Get_Kerning(face, previous, index, FT_KERNING_DEFAULT, &kerning);
+			penX += kerning.x / 64.0f;
+		}
+
+		FT_Fixed advance = 0;
+		FT_Get_Advance(face, index, FT_LOAD_DEFAULT, &advance);
+		float advanceX = advance / 65536.0f;
+
+		// Wrap if this glyph would go past the edge (spaces can hang off)
+		if (wrapWidth > 0.0f && codepoint != ' ' && penX + advanceX > wrapWidth && glyphs.size() > lineStart)
+		{
+			if (wordStart > lineStart)
+			{
+				// Move the current word down on to a new line
+				for (size_t i = wordStart; i < glyphs.size(); i++)
+				{
+					glyphs[i].x -= wordStartX;
+					glyphs[i].baseline += lineHeight;
+				}
+				penX -= wordStartX;
+				lineStart = wordStart;
+			}
+			else
+			{
+				// The word is longer than a line, so break it here
+				penX = 0.0f;
+				lineStart = wordStart = glyphs.size();
+			}
+			wordStartX = 0.0f;
+			baseline += lineHeight;
+		}
+
+		positioned_glyph_t glyph = { index, penX, baseline };
+		glyphs.push_back(glyph);
+		penX += advanceX;
+		previous = index;
+
+		if (codepoint == ' ')
+		{
+			wordStart = glyphs.size();
+			wordStartX = penX;
+		}
+	}
+
+	return baseline - face->size->metrics.ascender / 64.0f + lineHeight;
+}
+
+/// Mixes bytes in to an FNV-1a hash
+static unsigned long long hash_bytes(unsigned long long hash, const void* data, size_t length)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+/// Hashes everything that affects how a run is laid out, for the run cache
+static unsigned long long hash_run(const char* text, const string& fontPath, unsigned int pixelSize, int wrapWidth)
+{
+	unsigned long long hash = hash_bytes(14695981039346656037ULL, text, strlen(text) + 1);
+	hash = hash_bytes(hash, fontPath.c_str(), fontPath.length() + 1);
+	hash = hash_bytes(hash, &pixelSize, sizeof(pixelSize));
+	return hash_bytes(hash, &wrapWidth, sizeof(wrapWidth));
+}
+
+/// Constructs a new TextRenderer object. A GL context must be current
+/// @param _runCacheSize The maximum number of runs to keep
+TextRenderer::TextRenderer(size_t _runCacheSize) :
+	library(NULL),
+	program(g_textVertexShader, g_textFragmentShader),
+	runCacheSize(_runCacheSize > 0 ? _runCacheSize : 1),
+	viewportWidth(1),
+	viewportHeight(1),
+	runHits(0),
+	runMisses(0)
+{
+	if (FT_Init_FreeType(&library) != 0)
+	{
+		LOG(LOG_ERROR, "TextRenderer::TextRenderer: Failed to initialise FreeType, text will not be drawn");
+		library = NULL;
+	}
+
+	positionAttribute = glGetAttribLocation(program.getProgram(), "position");
+	texCoordAttribute = glGetAttribLocation(program.getProgram(), "texCoordIn");
+	viewportUniform = program.getUniformLocation("viewport");
+	offsetUniform = program.getUniformLocation("offset");
+	colourUniform = program.getUniformLocation("colour");
+	atlasUniform = program.getUniformLocation("atlas");
+}
+
+/// Destroys a TextRenderer object, its runs and its fonts
+TextRenderer::~TextRenderer()
+{
+	while (!runLru.empty())
+	{
+		evictRun();
+	}
+
+	for (auto fontPair : fonts)
+	{
+		if (fontPair.second.face != NULL)
+		{
+			FT_Done_Face(fontPair.second.face);
+		}
+	}
+
+	if (library != NULL)
+	{
+		FT_Done_FreeType(library);
+	}
+}
+
+/// Starts a new frame
+/// @param _viewportWidth The width of the viewport in pixels
+/// @param _viewportHeight The height of the viewport in pixels
+void TextRenderer::beginFrame(int _viewportWidth, int _viewportHeight)
+{
+	viewportWidth = _viewportWidth;
+	viewportHeight = _viewportHeight;
+	atlas.beginFrame();
+}
+
+/// Draws a block of text
+/// @param text The UTF-8 encoded text
+/// @param fontPath The font file to use, or empty for the default
+/// @param pixelSize The size of the font in pixels
+/// @param x The left of the text block
+/// @param y The top of the text block
+/// @param wrapWidth The width to wrap lines at, or zero not to wrap
+void TextRenderer::draw(const char* text, const string& fontPath, unsigned int pixelSize, float x, float y, float wrapWidth, float r, float g, float b, float a)
+{
+	if (text == NULL || *text == '\0' || pixelSize == 0)
+	{
+		return;
+	}
+
+	// Hash everything that affects the layout. The run found is checked
+	// against it, and on the rare collision the old run makes way
+	unsigned long long key = hash_run(text, fontPath, pixelSize, (int)wrapWidth);
+	text_run_t* run = NULL;
+	auto runIter = runs.find(key);
+	if (runIter != runs.end())
+	{
+		run = runIter->second;
+		if (run->pixelSize == pixelSize && run->wrapWidth == (int)wrapWidth && run->fontPath == fontPath && strcmp(run->text.c_str(), text) == 0)
+		{
+			runLru.erase(run->lruPosition);
+		}
+		else
+		{
+			deleteRun(run);
+			run = NULL;
+		}
+	}
+	if (run == NULL)
+	{
+		while (runs.size() >= runCacheSize)
+		{
+			evictRun();
+		}
+
+		run = new text_run_t;
+		run->key = key;
+		run->text = text;
+		run->fontPath = fontPath;
+		run->pixelSize = pixelSize;
+		run->wrapWidth = (int)wrapWidth;
+		run->vertexCount = 0;
+		glGenVertexArrays(1, &run->vertexArray);
+		glGenBuffers(1, &run->vertexBuffer);
+		glBindVertexArray(run->vertexArray);
+		glBindBuffer(GL_ARRAY_BUFFER, run->vertexBuffer);
+		glEnableVertexAttribArray(positionAttribute);
+		glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, TEXT_FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(texCoordAttribute);
+		glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE, TEXT_FLOATS_PER_VERTEX * sizeof(float), (void*)(2 * sizeof(float)));
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// Force a build below
+		run->built = false;
+		runs[key] = run;
+	}
+	runLru.push_front(run);
+	run->lruPosition = runLru.begin();
+
+	// (Re)build the run if it's new or the atlas has evicted its glyphs
+	if (!isRunCurrent(run))
+	{
+		runMisses++;
+		font_t* font = getFont(fontPath, pixelSize);
+		if (font == NULL || !buildRun(run, text, font, pixelSize, wrapWidth))
+		{
+			return;
+		}
+	}
+	else
+	{
+		runHits++;
+
+		// Keep the glyphs we're about to draw in the atlas
+		for (auto shelf : run->shelves)
+		{
+			atlas.touch(shelf);
+		}
+	}
+
+	if (run->vertexCount == 0)
+	{
+		return;
+	}
+
+	program.use();
+	glUniform2f(viewportUniform, (float)viewportWidth, (float)viewportHeight);
+	glUniform2f(offsetUniform, x, y);
+	glUniform4f(colourUniform, r, g, b, a);
+	glUniform1i(atlasUniform, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlas.getTexture());
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glBindVertexArray(run->vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, run->vertexCount);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/// Gets the glyph atlas
+const GlyphAtlas& TextRenderer::getAtlas() const
+{
+	return atlas;
+}
+
+/// Gets the number of draws that found their run in the cache
+unsigned long long TextRenderer::getRunHits() const
+{
+	return runHits;
+}
+
+/// Gets the number of draws that had to lay out their text
+unsigned long long TextRenderer::getRunMisses() const
+{
+	return runMisses;
+}
+
+/// Measures the height of a block of text, without drawing it
+/// @param text The UTF-8 encoded text
+/// @param fontPath The font file to use, or empty for the default
+/// @param pixelSize The size of the font in pixels
+/// @param wrapWidth The width to wrap lines at, or zero not to wrap
+/// @returns The height of the block in pixels
+float TextRenderer::measure(const char* text, const string& fontPath, unsigned int pixelSize, float wrapWidth)
+{
+	if (text == NULL || *text == '\0' || pixelSize == 0)
+	{
+		return 0.0f;
+	}
+
+	font_t* font = getFont(fontPath, pixelSize);
+	if (font == NULL)
+	{
+		return 0.0f;
+	}
+
+	vector<positioned_glyph_t> glyphs;
+	return layout_glyphs(font->face, text, wrapWidth, glyphs);
+}
+
+/// Gets a font, loading it if necessary, and sets its pixel size
+/// @returns The font, or NULL if it couldn't be loaded
+TextRenderer::font_t* TextRenderer::getFont(const string& fontPath, unsigned int pixelSize)
+{
+	if (library == NULL)
+	{
+		return NULL;
+	}
+
+	string path = fontPath.empty() ? TEXT_DEFAULT_FONT : fontPath;
+	auto fontIter = fonts.find(path);
+	if (fontIter == fonts.end())
+	{
+		// Remember failures too, so we don't keep trying to load them
+		font_t& font = fonts[path];
+		font.id = fonts.size();
+		font.pixelSize = 0;
+		if (FT_New_Face(library, path.c_str(), 0, &font.face) != 0)
+		{
+			LOG(LOG_ERROR, "TextRenderer::getFont: Failed to load font '%s'", path.c_str());
+			font.face = NULL;
+		}
+		fontIter = fonts.find(path);
+	}
+
+	font_t* font = &fontIter->second;
+	if (font->face == NULL)
+	{
+		return NULL;
+	}
+
+	if (font->pixelSize != pixelSize)
+	{
+		FT_Set_Pixel_Sizes(font->face, 0, pixelSize);
+		font->pixelSize = pixelSize;
+	}
+
+	return font;
+}
+
+/// Lays out text and (re)builds the vertices of a run
+/// @returns false if the run has no glyphs
+bool TextRenderer::buildRun(text_run_t* run, const char* text, font_t* font, unsigned int pixelSize, float wrapWidth)
+{
+	FT_Face face = font->face;
+	vector<positioned_glyph_t> glyphs;
+	layout_glyphs(face, text, wrapWidth, glyphs);
+
+	// Build two triangles per visible glyph
+	vector<float> vertices;
+	vertices.reserve(glyphs.size() * TEXT_VERTICES_PER_GLYPH * TEXT_FLOATS_PER_VERTEX);
+	run->shelves.clear();
+	for (auto& positioned : glyphs)
+	{
+		const atlas_glyph_t* glyph = atlas.getGlyph(face, font->id, pixelSize, positioned.index);
+		if (glyph == NULL)
+		{
+			continue;
+		}
+		if (find(run->shelves.begin(), run->shelves.end(), glyph->shelf) == run->shelves.end())
+		{
+			run->shelves.push_back(glyph->shelf);
+		}
+		if (glyph->width == 0 || glyph->height == 0)
+		{
+			continue;
+		}
+
+		float x0 = positioned.x + glyph->bearingX;
+		float y0 = positioned.baseline - glyph->bearingY;
+		float x1 = x0 + glyph->width;
+		float y1 = y0 + glyph->height;
+		float quad[TEXT_VERTICES_PER_GLYPH * TEXT_FLOATS_PER_VERTEX] = {
+			x0, y0, glyph->u0, glyph->v0,
+			x1, y0, glyph->u1, glyph->v0,
+			x0, y1, glyph->u0, glyph->v1,
+			x1, y0, glyph->u1, glyph->v0,
+			x1, y1, glyph->u1, glyph->v1,
+			x0, y1, glyph->u0, glyph->v1,
+		};
+		vertices.insert(vertices.end(), quad, quad + TEXT_VERTICES_PER_GLYPH * TEXT_FLOATS_PER_VERTEX);
+	}
+
+	// Note the generations last, as laying out never evicts a shelf used in
+	// this frame
+	run->shelfGenerations.clear();
+	for (auto shelf : run->shelves)
+	{
+		run->shelfGenerations.push_back(atlas.getShelfGeneration(shelf));
+	}
+	run->built = true;
+
+	// Upload once; the buffer is then reused every frame the run is drawn
+	run->vertexCount = vertices.size() / TEXT_FLOATS_PER_VERTEX;
+	if (run->vertexCount > 0)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, run->vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	return run->vertexCount > 0;
+}
+
+/// Determines whether a run's texture coordinates are still valid, i.e. none of
+/// the shelves its glyphs are on have been evicted
+bool TextRenderer::isRunCurrent(const text_run_t* run) const
+{
+	if (!run->built)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < run->shelves.size(); i++)
+	{
+		if (atlas.getShelfGeneration(run->shelves[i]) != run->shelfGenerations[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Deletes the least-recently-used run
+void TextRenderer::evictRun()
+{
+	deleteRun(runLru.back());
+}
+
+/// Deletes a run
+void TextRenderer::deleteRun(text_run_t* run)
+{
+	runLru.erase(run->lruPosition);
+	runs.erase(run->key);
+
+	glDeleteBuffers(1, &run->vertexBuffer);
+	glDeleteVertexArrays(1, &run->vertexArray);
+	delete run;
+}
@@ -0,0 +1,536 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+// Includes:
+#include <string.h>
+#include "TransitionCompositor.h"
+#include "AuraException.h"
+#include "Log.h"
+
+/// Vertex shader: covers the viewport with a triangle strip of four vertices
+/// and passes on where in the framebuffers each pixel comes from
+static const char* g_transitionVertexShader =
+	"#version 150\n"
+	"out vec2 texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	texCoord = corner;\n"
+	"	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+/// Fragment shader: the cross-fade drawn in place of a plugin's shader when
+/// transitions are simplified
+static const char* g_simpleFragmentShader =
+	"#version 150\n"
+	"uniform sampler2D from;\n"
+	"uniform sampler2D to;\n"
+	"uniform float progress;\n"
+	"in vec2 texCoord;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColour = mix(texture(from, texCoord), texture(to, texCoord), progress);\n"
+	"}\n";
+
+/// Constructs a new TransitionCompositor object. A GL context must be current
+TransitionCompositor::TransitionCompositor() :
+	vertexArray(0),
+	width(0),
+	height(0),
+	previousFramebuffer(0),
+	simpleShader(NULL),
+	simplified(false),
+	transition(NULL),
+	shader(NULL),
+	active(false),
+	progress(0.0),
+	duration(1.0),
+	serial(0),
+	timingSupported(false),
+	historySerial(0)
+{
+	framebuffers[0] = framebuffers[1] = 0;
+	textures[0] = textures[1] = 0;
+	captured[0] = captured[1] = false;
+	memset(previousViewport, 0, sizeof(previousViewport));
+	memset(previousClearColour, 0, sizeof(previousClearColour));
+
+	// A core context needs a VAO bound to draw, even with no attributes
+	glGenVertexArrays(1, &vertexArray);
+
+	// Timer queries are core from GL 3.3, and an extension before that
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	timingSupported = major > 3 || (major == 3 && minor >= 3);
+	if (!timingSupported)
+	{
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (GLint i = 0; i < extensionCount && !timingSupported; i++)
+		{
+			timingSupported = strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_ARB_timer_query") == 0;
+		}
+	}
+	if (!timingSupported)
+	{
+		LOG(LOG_INFO, "TransitionCompositor::TransitionCompositor: Timer queries are not supported, transitions will not be timed");
+	}
+}
+
+/// Destroys a TransitionCompositor object and its GL resources
+TransitionCompositor::~TransitionCompositor()
+{
+	for (auto& entry : shaders)
+	{
+		if (entry.second != NULL)
+		{
+			delete entry.second->program;
+			delete entry.second;
+		}
+	}
+	if (simpleShader != NULL)
+	{
+		delete simpleShader->program;
+		delete simpleShader;
+	}
+
+	for (auto& pending : pendingQueries)
+	{
+		freeQueries.push_back(pending.query);
+	}
+	if (!freeQueries.empty())
+	{
+		glDeleteQueries((GLsizei)freeQueries.size(), &freeQueries[0]);
+	}
+
+	if (framebuffers[0] != 0)
+	{
+		glDeleteFramebuffers(2, framebuffers);
+		glDeleteTextures(2, textures);
+	}
+	glDeleteVertexArrays(1, &vertexArray);
+}
+
+/// Starts a transition, ending any that is in progress
+/// @param plugin The plugin that created the transition object
+/// @param _transition The transition object
+/// @returns true on success, false if the plugin's shader couldn't be built
+bool TransitionCompositor::start(aura_transition_plugin_t* plugin, aura_object_instance_t* _transition)
+{
+	if (active)
+	{
+		finish();
+	}
+
+	shader = getShader(plugin, _transition);
+	if (shader == NULL)
+	{
+		return false;
+	}
+	transition = _transition;
+
+	// Work out which of the object's properties the shader wants
+	propertyUniforms.clear();
+	size_t propertyCount = aura_get_property_count(transition->properties);
+	for (size_t i = 0; i < propertyCount; i++)
+	{
+		aura_property_t* property = aura_get_property_at(transition->properties, i);
+		if (property->type == AURA_VARTYPE_TEXT || property->type == AURA_VARTYPE_FILENAME)
+		{
+			continue;
+		}
+
+		property_uniform_t propertyUniform;
+		propertyUniform.property = property;
+		propertyUniform.location = shader->program->getUniformLocation(property->name);
+		if (propertyUniform.location != -1)
+		{
+			propertyUniforms.push_back(propertyUniform);
+		}
+	}
+
+	aura_property_float_t* durationProperty = (aura_property_float_t*)aura_get_property(transition->properties, "duration");
+	duration = (durationProperty != NULL && durationProperty->super.type == AURA_VARTYPE_FLOAT && durationProperty->value > 0.0) ? durationProperty->value : 1.0;
+	progress = 0.0;
+	active = true;
+	captured[TRANSITION_FROM] = captured[TRANSITION_TO] = false;
+
+	// Start a new set of statistics
+	transition_stats_t stats;
+	stats.objectType = transition->objectType;
+	stats.frames = 0;
+	stats.captures = 0;
+	stats.timedFrames = 0;
+	stats.totalGpuMs = 0.0;
+	stats.maxGpuMs = 0.0;
+	history.push_back(stats);
+	if (history.size() > TRANSITION_HISTORY)
+	{
+		history.pop_front();
+		historySerial++;
+	}
+	serial = historySerial + history.size() - 1;
+
+	LOG(LOG_DEBUG, "TransitionCompositor::start: Starting '%s' transition over %.2fs", transition->objectType, duration);
+	return true;
+}
+
+/// Determines whether a transition is in progress
+bool TransitionCompositor::isActive() const
+{
+	return active;
+}
+
+/// Gets how far through the transition we are (0 to 1)
+double TransitionCompositor::getProgress() const
+{
+	return progress;
+}
+
+/// Advances the transition
+/// @param timestep The time to advance by, in seconds
+/// @returns true if the transition has finished
+bool TransitionCompositor::advance(double timestep)
+{
+	if (!active)
+	{
+		return false;
+	}
+
+	progress += timestep / duration;
+	if (progress >= 1.0)
+	{
+		progress = 1.0;
+		return true;
+	}
+
+	return false;
+}
+
+/// Ends the transition in progress
+void TransitionCompositor::finish()
+{
+	if (!active)
+	{
+		return;
+	}
+
+	active = false;
+	transition = NULL;
+	shader = NULL;
+	propertyUniforms.clear();
+
+	collectTimings();
+	transition_stats_t* stats = findStats(serial);
+	if (stats != NULL)
+	{
+		LOG(LOG_DEBUG, "TransitionCompositor::finish: '%s' transition composited %u frames with %u captures, GPU time %.3fms average, %.3fms max", stats->objectType.c_str(), stats->frames, stats->captures, stats->timedFrames > 0 ? stats->totalGpuMs / stats->timedFrames : 0.0, stats->maxGpuMs);
+	}
+}
+
+/// Determines whether an item needs to be rendered in to its framebuffer,
+/// regardless of whether it has changed
+/// @param item TRANSITION_FROM or TRANSITION_TO
+bool TransitionCompositor::needsCapture(int item) const
+{
+	return !captured[item];
+}
+
+/// Forgets what is in both framebuffers, so that both items are rendered again
+void TransitionCompositor::invalidate()
+{
+	captured[TRANSITION_FROM] = captured[TRANSITION_TO] = false;
+}
+
+/// Binds an item's framebuffer and clears it, ready to render the item in to it
+/// @param item TRANSITION_FROM or TRANSITION_TO
+/// @param _width The width of the display in pixels
+/// @param _height The height of the display in pixels
+void TransitionCompositor::beginCapture(int item, int _width, int _height)
+{
+	if (_width != width || _height != height)
+	{
+		resize(_width, _height);
+	}
+
+	// Offscreen there is already a framebuffer bound that we have to go
+	// back to
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColour);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[item]);
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	captured[item] = true;
+	transition_stats_t* stats = findStats(serial);
+	if (stats != NULL)
+	{
+		stats->captures++;
+	}
+}
+
+/// Goes back to the framebuffer that was bound before beginCapture()
+void TransitionCompositor::endCapture()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(previousClearColour[0], previousClearColour[1], previousClearColour[2], previousClearColour[3]);
+}
+
+/// Draws the current frame of the transition over the whole viewport
+void TransitionCompositor::draw()
+{
+	if (!active || framebuffers[0] == 0)
+	{
+		return;
+	}
+
+	collectTimings();
+
+	// Time the pass if there is a query free. If there isn't then the GPU
+	// is a long way behind and this frame goes untimed
+	GLuint query = 0;
+	if (timingSupported)
+	{
+		if (!freeQueries.empty())
+		{
+			query = freeQueries.back();
+			freeQueries.pop_back();
+		}
+		else if (pendingQueries.size() < TRANSITION_MAX_QUERIES)
+		{
+			glGenQueries(1, &query);
+		}
+	}
+	if (query != 0)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+
+	// The plugin's properties only mean anything to its own shader
+	shader_t* drawShader = (simplified && simpleShader != NULL) ? simpleShader : shader;
+	drawShader->program->use();
+	glUniform1i(drawShader->fromUniform, 0);
+	glUniform1i(drawShader->toUniform, 1);
+	glUniform1f(drawShader->progressUniform, (float)progress);
+	glUniform2f(drawShader->resolutionUniform, (float)width, (float)height);
+	if (drawShader == shader)
+	{
+		for (auto& propertyUniform : propertyUniforms)
+		{
+			aura_property_t* property = propertyUniform.property;
+			switch (property->type)
+			{
+				case AURA_VARTYPE_INT:
+					glUniform1i(propertyUniform.location, (GLint)((aura_property_int_t*)property)->value);
+					break;
+				case AURA_VARTYPE_BOOLEAN:
+					glUniform1i(propertyUniform.location, ((aura_property_bool_t*)property)->value ? 1 : 0);
+					break;
+				case AURA_VARTYPE_FLOAT:
+					glUniform1f(propertyUniform.location, (GLfloat)((aura_property_float_t*)property)->value);
+					break;
+				case AURA_VARTYPE_COLOR:
+				{
+					aura_property_color_t* colour = (aura_property_color_t*)property;
+					glUniform4f(propertyUniform.location, colour->valueR, colour->valueG, colour->valueB, colour->hasAlpha ? colour->valueA : 1.0f);
+					break;
+				}
+				default:
+					break;
+			}
+		}
+	}
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, textures[TRANSITION_TO]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, textures[TRANSITION_FROM]);
+
+	// The framebuffers hold the items as blended over transparent black, so
+	// their colours are already multiplied by alpha
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glBindVertexArray(vertexArray);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+
+	if (query != 0)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pending_query_t pending;
+		pending.query = query;
+		pending.serial = serial;
+		pendingQueries.push_back(pending);
+	}
+
+	transition_stats_t* stats = findStats(serial);
+	if (stats != NULL)
+	{
+		stats->frames++;
+	}
+}
+
+/// Draws transitions as a plain cross-fade instead of with their plugins'
+/// shaders, which is cheaper on slow hardware
+void TransitionCompositor::setSimplified(bool _simplified)
+{
+	simplified = _simplified;
+	if (!simplified || simpleShader != NULL)
+	{
+		return;
+	}
+
+	try
+	{
+		ShaderProgram* program = new ShaderProgram(g_transitionVertexShader, g_simpleFragmentShader);
+		simpleShader = new shader_t;
+		simpleShader->program = program;
+		simpleShader->fromUniform = program->getUniformLocation("from");
+		simpleShader->toUniform = program->getUniformLocation("to");
+		simpleShader->progressUniform = program->getUniformLocation("progress");
+		simpleShader->resolutionUniform = program->getUniformLocation("resolution");
+	}
+	catch (AuraException&)
+	{
+		LOG(LOG_ERROR, "TransitionCompositor::setSimplified: Failed to build cross-fade shader, transitions will not be simplified");
+	}
+}
+
+/// Collects the results of any finished timer queries
+void TransitionCompositor::collectTimings()
+{
+	// Queries finish in order, so stop at the first that isn't ready
+	while (!pendingQueries.empty())
+	{
+		pending_query_t& pending = pendingQueries.front();
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != GL_TRUE)
+		{
+			break;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+		transition_stats_t* stats = findStats(pending.serial);
+		if (stats != NULL)
+		{
+			double elapsedMs = elapsed / 1000000.0;
+			stats->timedFrames++;
+			stats->totalGpuMs += elapsedMs;
+			if (elapsedMs > stats->maxGpuMs)
+			{
+				stats->maxGpuMs = elapsedMs;
+			}
+		}
+
+		freeQueries.push_back(pending.query);
+		pendingQueries.pop_front();
+	}
+}
+
+/// Determines whether the driver can measure GPU times
+bool TransitionCompositor::isTimingSupported() const
+{
+	return timingSupported;
+}
+
+/// Gets the statistics of recent transitions, oldest first
+const deque<transition_stats_t>& TransitionCompositor::getHistory() const
+{
+	return history;
+}
+
+/// Gets the shader for a transition object, building it if necessary
+/// @returns The shader, or NULL if it can't be built
+TransitionCompositor::shader_t* TransitionCompositor::getShader(aura_transition_plugin_t* plugin, aura_object_instance_t* _transition)
+{
+	auto shaderIter = shaders.find(_transition->objectType);
+	if (shaderIter != shaders.end())
+	{
+		return shaderIter->second;
+	}
+
+	const char* fragmentSource = plugin->getShader != NULL ? plugin->getShader(_transition) : NULL;
+	if (fragmentSource == NULL)
+	{
+		LOG(LOG_ERROR, "TransitionCompositor::getShader: Plugin has no shader for '%s' transition", _transition->objectType);
+		shaders[_transition->objectType] = NULL;
+		return NULL;
+	}
+
+	shader_t* newShader = NULL;
+	try
+	{
+		ShaderProgram* program = new ShaderProgram(g_transitionVertexShader, fragmentSource);
+		newShader = new shader_t;
+		newShader->program = program;
+		newShader->fromUniform = program->getUniformLocation("from");
+		newShader->toUniform = program->getUniformLocation("to");
+		newShader->progressUniform = program->getUniformLocation("progress");
+		newShader->resolutionUniform = program->getUniformLocation("resolution");
+	}
+	catch (AuraException&)
+	{
+		LOG(LOG_ERROR, "TransitionCompositor::getShader: Failed to build shader for '%s' transition", _transition->objectType);
+	}
+
+	shaders[_transition->objectType] = newShader;
+	return newShader;
+}
+
+/// (Re)creates the framebuffers at the given size
+void TransitionCompositor::resize(int _width, int _height)
+{
+	width = _width;
+	height = _height;
+
+	if (framebuffers[0] == 0)
+	{
+		glGenFramebuffers(2, framebuffers);
+		glGenTextures(2, textures);
+	}
+
+	GLint previousBinding = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousBinding);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			LOG(LOG_ERROR, "TransitionCompositor::resize: Framebuffer %d is incomplete at %dx%d", i, width, height);
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, previousBinding);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	captured[TRANSITION_FROM] = captured[TRANSITION_TO] = false;
+	LOG(LOG_DEBUG, "TransitionCompositor::resize: Framebuffers are now %dx%d", width, height);
+}
+
+/// Finds the statistics of a transition by serial number
+/// @returns The statistics, or NULL if they have left the history
+transition_stats_t* TransitionCompositor::findStats(unsigned long long _serial)
+{
+	if (history.empty() || _serial < historySerial || _serial - historySerial >= history.size())
+	{
+		return NULL;
+	}
+
+	return &history[_serial - historySerial];
+}
@@ -5,12 +5,16 @@
 // Includes:
 #include <libaura/aura.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <getopt.h>
 #include <stdarg.h>
 #include "AuraLive.h"
 #include "Log.h"
 #include "AuraException.h"
 
+// Definitions:
+#define HEADLESS_DEFAULT_FRAMES   600
+
 /// Defines the entry point for the application. Parses the command line arguments and passes them
 /// to a new global instance of an AuraLive application object.
 /// @param argc The number of arguments passed to the application
@@ -20,6 +24,18 @@ int main(int argc, char** argv)
 	bool windowed = false;
 	string resolution;
 	string pluginsPath = "./plugins";
+	string benchmarkScene;
+	unsigned long long maxFrames = 0;
+	bool headless = false;
+	string frameDumpPath;
+	int outputCount = 1;
+	string quality;
+	string moderationQueue;
+	string journalPath;
+	int streamPort = 0;
+	string streamSize;
+	string tracePath;
+	string metricsPath;
 
 	// Enable debug log level in DEBUG builds (or rather in not NDEBUG builds)
 #ifndef NDEBUG
@@ -31,11 +47,24 @@ int main(int argc, char** argv)
 		{ "windowed", no_argument, 0, 'w' },
 		{ "resolution", required_argument, 0, 'r' },
 		{ "plugins-path", required_argument, 0, 'p' },
+		{ "benchmark", required_argument, 0, 'b' },
+		{ "frames", required_argument, 0, 'f' },
+		{ "headless", no_argument, 0, 'H' },
+		{ "dump-frames", required_argument, 0, 'd' },
+		{ "outputs", required_argument, 0, 'o' },
+		{ "quality", required_argument, 0, 'q' },
+		{ "moderation-queue", required_argument, 0, 'm' },
+		{ "journal", required_argument, 0, 'j' },
+		{ "stream", required_argument, 0, 's' },
+		{ "stream-size", required_argument, 0, 'S' },
+		{ "trace", required_argument, 0, 't' },
+		{ "metrics", required_argument, 0, 'M' },
+		{ 0, 0, 0, 0 },
 	};
 
 	// Iterate over our command line arguments
 	int option, optionIndex = 0;
-	while ((option = getopt_long(argc, argv, "wr:p:", cmdOptions, &optionIndex)) != -1)
+	while ((option = getopt_long(argc, argv, "wr:p:b:f:Hd:o:q:m:j:s:S:t:M:", cmdOptions, &optionIndex)) != -1)
 	{
 		switch (option)
 		{
@@ -48,13 +77,49 @@ int main(int argc, char** argv)
 			case 'p':
 				pluginsPath = optarg;
 				break;
+			case 'b':
+				benchmarkScene = optarg;
+				break;
+			case 'f':
+				maxFrames = strtoull(optarg, NULL, 10);
+				break;
+			case 'H':
+				headless = true;
+				break;
+			case 'd':
+				frameDumpPath = optarg;
+				break;
+			case 'o':
+				outputCount = atoi(optarg);
+				break;
+			case 'q':
+				quality = optarg;
+				break;
+			case 'm':
+				moderationQueue = optarg;
+				break;
+			case 'j':
+				journalPath = optarg;
+				break;
+			case 's':
+				streamPort = atoi(optarg);
+				break;
+			case 'S':
+				streamSize = optarg;
+				break;
+			case 't':
+				tracePath = optarg;
+				break;
+			case 'M':
+				metricsPath = optarg;
+				break;
 			default:
 				return 1;
 				break;
 		}
 	}
 
-	log(LOG_DEBUG, "main: Running with libaura version: %d.%d.%d\n", aura_get_version() / 1000000, aura_get_version() % 1000000 / 1000, aura_get_version() % 1000);
+	LOG(LOG_DEBUG, "main: Running with libaura version: %d.%d.%d\n", aura_get_version() / 1000000, aura_get_version() % 1000000 / 1000, aura_get_version() % 1000);
 
 	try
 	{
@@ -64,17 +129,123 @@ int main(int argc, char** argv)
 			throw AuraException(AURA_ERR_LIBAURAINIT, "libaura initialisation failed");
 		}
 
-		AuraLive& auraLive = AuraLive::initInstance(pluginsPath);
-		SDL_Delay(5000);
+		// Start tracing before anything is loaded, so that it's covered too
+		if (!tracePath.empty())
+		{
+			aura_trace_set_enabled(true);
+		}
+
+		// Windows and offscreen rendering need a size, but filling the
+		// screen without one uses the desktop resolution
+		int width = 0, height = 0;
+		if (windowed || headless)
+		{
+			width = AURA_DEFAULT_WIDTH;
+			height = AURA_DEFAULT_HEIGHT;
+		}
+		if (!resolution.empty() && (sscanf(resolution.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0))
+		{
+			LOG(LOG_FATAL, "Invalid resolution '%s', expected WIDTHxHEIGHT\n", resolution.c_str());
+			return 1;
+		}
+		int streamWidth = 0, streamHeight = 0;
+		if (!streamSize.empty() && (sscanf(streamSize.c_str(), "%dx%d", &streamWidth, &streamHeight) != 2 || streamWidth < 16 || streamHeight < 16))
+		{
+			LOG(LOG_FATAL, "Invalid stream size '%s', expected WIDTHxHEIGHT of at least 16x16\n", streamSize.c_str());
+			return 1;
+		}
+		if (streamPort < 0 || streamPort > 65535)
+		{
+			LOG(LOG_FATAL, "Invalid stream port %d\n", streamPort);
+			return 1;
+		}
+		if (outputCount < 1 || outputCount > AURA_MAX_OUTPUTS)
+		{
+			LOG(LOG_FATAL, "Invalid number of outputs %d, expected 1 to %d\n", outputCount, AURA_MAX_OUTPUTS);
+			return 1;
+		}
+		if (headless && outputCount > 1)
+		{
+			LOG(LOG_WARN, "Only one output is rendered when headless\n");
+		}
+
+		// Quality follows the frame rate on a display, but benchmarks are
+		// there to measure one level, so they stay at full quality unless
+		// told otherwise
+		if (quality.empty())
+		{
+			quality = headless ? "0" : "auto";
+		}
+		int qualityLevel = atoi(quality.c_str());
+		if (quality != "auto" && (quality.find_first_not_of("0123456789") != string::npos || qualityLevel >= QUALITY_LEVEL_COUNT))
+		{
+			LOG(LOG_FATAL, "Invalid quality '%s', expected auto or 0 to %d\n", quality.c_str(), QUALITY_LEVEL_COUNT - 1);
+			return 1;
+		}
+
+		// Offscreen there's no window to close, so always stop eventually
+		if (headless && maxFrames == 0)
+		{
+			maxFrames = HEADLESS_DEFAULT_FRAMES;
+		}
+
+		AuraLive& auraLive = AuraLive::initInstance(pluginsPath, headless, windowed, width, height, outputCount);
+		auraLive.setFrameDump(frameDumpPath);
+		if (quality == "auto")
+		{
+			auraLive.setAdaptiveQuality(true);
+		}
+		else
+		{
+			auraLive.setQualityLevel(qualityLevel);
+		}
+		if (!benchmarkScene.empty())
+		{
+			// Make sure the results are printed
+			if (log_get_level() < LOG_INFO)
+			{
+				log_set_level(LOG_INFO);
+			}
+
+			if (!auraLive.setBenchmark(benchmarkScene))
+			{
+				return 1;
+			}
+		}
+		if (!moderationQueue.empty() && !auraLive.setModerationQueue(moderationQueue, journalPath))
+		{
+			return 1;
+		}
+		if (streamPort > 0 && !auraLive.setStream((unsigned short)streamPort, streamWidth, streamHeight))
+		{
+			return 1;
+		}
+		if (!metricsPath.empty() && !auraLive.setMetrics(metricsPath))
+		{
+			return 1;
+		}
+		auraLive.run(maxFrames);
+
+		if (!tracePath.empty())
+		{
+			if (aura_trace_export(tracePath.c_str()))
+			{
+				LOG(LOG_INFO, "main: Wrote trace to %s, %llu events recorded, %llu overwritten", tracePath.c_str(), aura_trace_get_event_count(), aura_trace_get_overwritten_count());
+			}
+			else
+			{
+				LOG(LOG_ERROR, "main: Failed to write trace to %s", tracePath.c_str());
+			}
+		}
 	}
 	catch (AuraException e1)
 	{
-		log(LOG_FATAL, "Error: Code %d: %s\n", e1.getCode(), e1.what());
+		LOG(LOG_FATAL, "Error: Code %d: %s\n", e1.getCode(), e1.what());
 		return 1;
 	}
 	catch (exception e2)
 	{
-		log(LOG_FATAL, "Unhandled exception: %s\n", e2.what());
+		LOG(LOG_FATAL, "Unhandled exception: %s\n", e2.what());
 		return 1;
 	}
 
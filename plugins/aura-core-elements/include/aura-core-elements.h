@@ -8,5 +8,8 @@
 // Includes:
 #include "libaura/aura.h"
 
+// Definitions:
+#define ACE_GRADIENT_STOPS   4
+
 #endif
 
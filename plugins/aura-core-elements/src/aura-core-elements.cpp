@@ -5,60 +5,196 @@
 // This program is distributed under the terms of the GNU Lesser General Public
 // License (LGPL). A copy of the license is included in the file COPYING.LESSER
 
-aura_plugin_t plugin;
-aura_plugin_desc_t description;
+static aura_plugin_t plugin;
+static aura_plugin_desc_t description;
 
 typedef struct ace_colour_object_t
 {
 	// Superclass details (must come first)
 	aura_object_instance_t parent;
 
-	// Colour
-	float r;
-	float g;
-	float b;
+	// Colour (also in the property list as "colour")
+	aura_property_color_t* colour;
 } ace_colour_object_t;
 
-aura_plugin_desc_t* getDescription()
+typedef struct ace_gradient_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_bool_t* radial;
+	aura_property_float_t* angle;
+	aura_property_int_t* stops;
+	aura_property_color_t* colours[ACE_GRADIENT_STOPS];
+	aura_property_float_t* positions[ACE_GRADIENT_STOPS];
+} ace_gradient_object_t;
+
+typedef struct ace_text_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_string_t* text;
+	aura_property_file_t* font;
+	aura_property_int_t* size;
+	aura_property_color_t* colour;
+} ace_text_object_t;
+
+typedef struct ace_image_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Source (also in the property list as "source")
+	aura_property_string_t* source;
+} ace_image_object_t;
+
+static aura_plugin_desc_t* getDescription()
 {
 	return &description;
 }
 
-void unload()
+static void unload()
 {
 	delete [] description.objectTypes;
 }
 
-aura_object_instance_t* create_object(aura_plugin_type_t pluginType, const char* name)
+/// Adds a colour property to a property list, defaulting to opaque white
+static aura_property_color_t* add_colour_property(aura_properties_t properties, const char* name, const char* description)
 {
-	if (pluginType != AURA_PLUGIN_TYPE_ELEMENT)
-	{
-		return NULL;
-	}
+	aura_property_color_t* colour = (aura_property_color_t*)aura_allocate_property(AURA_VARTYPE_COLOR);
+	colour->super.name = name;
+	colour->super.description = description;
+	colour->hasAlpha = true;
+	colour->valueR = 1.0f;
+	colour->valueG = 1.0f;
+	colour->valueB = 1.0f;
+	colour->valueA = 1.0f;
+	aura_add_property(properties, (aura_property_t*)colour);
+
+	return colour;
+}
 
+static aura_object_instance_t* create_object(const char* name)
+{
 	if (strcmp(name, "colour") == 0)
 	{
 		// Initial object creation
 		ace_colour_object_t* object = new ace_colour_object_t;
 		object->parent.pluginType = AURA_PLUGIN_TYPE_ELEMENT;
 		object->parent.objectType = "colour";
+		object->parent.properties = aura_create_property_list();
+
+		object->colour = add_colour_property(object->parent.properties, "colour", "The colour to fill the element with");
 
 		return (aura_object_instance_t*)object;
 	}
 	else if (strcmp(name, "gradient") == 0)
 	{
-		// TODO
-		return NULL;
+		static const char* colourNames[ACE_GRADIENT_STOPS] = { "colour1", "colour2", "colour3", "colour4" };
+		static const char* positionNames[ACE_GRADIENT_STOPS] = { "position1", "position2", "position3", "position4" };
+
+		// Initial object creation
+		ace_gradient_object_t* object = new ace_gradient_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_ELEMENT;
+		object->parent.objectType = "gradient";
+		object->parent.properties = aura_create_property_list();
+
+		// Linear or radial
+		object->radial = (aura_property_bool_t*)aura_allocate_property(AURA_VARTYPE_BOOLEAN);
+		object->radial->super.name = "radial";
+		object->radial->super.description = "Whether the gradient radiates from the centre of the element";
+		object->radial->value = false;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->radial);
+
+		// Direction of a linear gradient
+		object->angle = (aura_property_float_t*)aura_allocate_property(AURA_VARTYPE_FLOAT);
+		object->angle->super.name = "angle";
+		object->angle->super.description = "The direction of a linear gradient, in degrees clockwise from left-to-right";
+		object->angle->minimum = 0.0;
+		object->angle->maximum = 360.0;
+		object->angle->value = 90.0;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->angle);
+
+		// Number of stops in use
+		object->stops = (aura_property_int_t*)aura_allocate_property(AURA_VARTYPE_INT);
+		object->stops->super.name = "stops";
+		object->stops->super.description = "The number of colour stops to use";
+		object->stops->minimum = 2;
+		object->stops->maximum = ACE_GRADIENT_STOPS;
+		object->stops->value = 2;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->stops);
+
+		// The stops themselves: black to white across the element by default
+		for (int i = 0; i < ACE_GRADIENT_STOPS; i++)
+		{
+			object->colours[i] = add_colour_property(object->parent.properties, colourNames[i], "The colour of a gradient stop");
+			object->colours[i]->valueR = object->colours[i]->valueG = object->colours[i]->valueB = i == 0 ? 0.0f : 1.0f;
+
+			object->positions[i] = (aura_property_float_t*)aura_allocate_property(AURA_VARTYPE_FLOAT);
+			object->positions[i]->super.name = positionNames[i];
+			object->positions[i]->super.description = "The position of a gradient stop, from 0 to 1";
+			object->positions[i]->minimum = 0.0;
+			object->positions[i]->maximum = 1.0;
+			object->positions[i]->value = i == 0 ? 0.0 : 1.0;
+			aura_add_property(object->parent.properties, (aura_property_t*)object->positions[i]);
+		}
+
+		return (aura_object_instance_t*)object;
 	}
 	else if (strcmp(name, "text") == 0)
 	{
-		// TODO
-		return NULL;
+		// Initial object creation
+		ace_text_object_t* object = new ace_text_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_ELEMENT;
+		object->parent.objectType = "text";
+		object->parent.properties = aura_create_property_list();
+
+		// The text itself, which is wrapped to the width of the element
+		object->text = (aura_property_string_t*)aura_allocate_property(AURA_VARTYPE_TEXT);
+		object->text->super.name = "text";
+		object->text->super.description = "The text to display";
+		object->text->value = NULL;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->text);
+
+		// Font file, or NULL to use the default
+		object->font = (aura_property_file_t*)aura_allocate_property(AURA_VARTYPE_FILENAME);
+		object->font->super.name = "font";
+		object->font->super.description = "The font file to draw the text with";
+		object->font->value = NULL;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->font);
+
+		// Font size in pixels
+		object->size = (aura_property_int_t*)aura_allocate_property(AURA_VARTYPE_INT);
+		object->size->super.name = "size";
+		object->size->super.description = "The size of the text in pixels";
+		object->size->minimum = 1;
+		object->size->maximum = 512;
+		object->size->value = 32;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->size);
+
+		object->colour = add_colour_property(object->parent.properties, "colour", "The colour of the text");
+
+		return (aura_object_instance_t*)object;
 	}
 	else if (strcmp(name, "image") == 0)
 	{
-		// TODO
-		return NULL;
+		// Initial object creation
+		ace_image_object_t* object = new ace_image_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_ELEMENT;
+		object->parent.objectType = "image";
+		object->parent.properties = aura_create_property_list();
+
+		// The image is scaled to fit the element, keeping its aspect ratio
+		object->source = (aura_property_string_t*)aura_allocate_property(AURA_VARTYPE_TEXT);
+		object->source->super.name = "source";
+		object->source->super.description = "The URL or file name of the image to display";
+		object->source->value = NULL;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->source);
+
+		return (aura_object_instance_t*)object;
 	}
 	else
 	{
@@ -66,11 +202,35 @@ aura_object_instance_t* create_object(aura_plugin_type_t pluginType, const char*
 	}
 }
 
-extern "C" aura_plugin_t* aura_plugin_load()
+/// Frees an object that create_object returned, along with its properties
+static void destroy_object(aura_object_instance_t* object)
+{
+	aura_delete_object(object);
+
+	if (strcmp(object->objectType, "colour") == 0)
+	{
+		delete (ace_colour_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "gradient") == 0)
+	{
+		delete (ace_gradient_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "text") == 0)
+	{
+		delete (ace_text_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "image") == 0)
+	{
+		delete (ace_image_object_t*)object;
+	}
+}
+
+AURA_PLUGIN_ENTRY_POINT(aura_core_elements)
 {
 	plugin.getDescription = getDescription;
 	plugin.unload = unload;
 	plugin.create = create_object;
+	plugin.destroy = destroy_object;
 	plugin.propertyChanged = NULL;
 
 	description.name = "Aura Core Elements";
@@ -83,7 +243,7 @@ extern "C" aura_plugin_t* aura_plugin_load()
 	description.objectTypes[1] = "gradient";
 	description.objectTypes[2] = "text";
 	description.objectTypes[3] = "image";
-	description.objectTypes[3] = NULL;
+	description.objectTypes[4] = NULL;
 
 	return &plugin;
 }
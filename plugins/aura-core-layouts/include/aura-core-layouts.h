@@ -0,0 +1,11 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef AURA_CORE_LAYOUTS_H_INCLUDED
+#define AURA_CORE_LAYOUTS_H_INCLUDED
+
+// Includes:
+#include "libaura/aura.h"
+
+#endif
@@ -0,0 +1,224 @@
+// Includes:
+#include "aura-core-layouts.h"
+
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+static aura_layout_plugin_t plugin;
+static aura_plugin_desc_t description;
+
+typedef struct acl_list_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_float_t* spacing;
+	aura_property_float_t* speed;
+} acl_list_object_t;
+
+typedef struct acl_ticker_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_float_t* itemWidth;
+	aura_property_float_t* spacing;
+	aura_property_float_t* speed;
+} acl_ticker_object_t;
+
+typedef struct acl_single_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_float_t* interval;
+} acl_single_object_t;
+
+static aura_plugin_desc_t* getDescription()
+{
+	return &description;
+}
+
+static void unload()
+{
+	delete [] description.objectTypes;
+}
+
+/// Adds a floating point property to a property list
+static aura_property_float_t* add_float_property(aura_properties_t properties, const char* name, const char* description, double minimum, double maximum, double value)
+{
+	aura_property_float_t* property = (aura_property_float_t*)aura_allocate_property(AURA_VARTYPE_FLOAT);
+	property->super.name = name;
+	property->super.description = description;
+	property->minimum = minimum;
+	property->maximum = maximum;
+	property->value = value;
+	aura_add_property(properties, (aura_property_t*)property);
+
+	return property;
+}
+
+static aura_object_instance_t* create_object(const char* name)
+{
+	if (strcmp(name, "list") == 0)
+	{
+		// Initial object creation
+		acl_list_object_t* object = new acl_list_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_LAYOUT;
+		object->parent.objectType = "list";
+		object->parent.properties = aura_create_property_list();
+
+		object->spacing = add_float_property(object->parent.properties, "spacing", "The gap between items in pixels", 0.0, 1000.0, 16.0);
+		object->speed = add_float_property(object->parent.properties, "speed", "The speed the list scrolls up at, in pixels per second", 0.0, 10000.0, 40.0);
+
+		return (aura_object_instance_t*)object;
+	}
+	else if (strcmp(name, "ticker") == 0)
+	{
+		// Initial object creation
+		acl_ticker_object_t* object = new acl_ticker_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_LAYOUT;
+		object->parent.objectType = "ticker";
+		object->parent.properties = aura_create_property_list();
+
+		object->itemWidth = add_float_property(object->parent.properties, "itemWidth", "The width of each item in pixels", 16.0, 10000.0, 480.0);
+		object->spacing = add_float_property(object->parent.properties, "spacing", "The gap between items in pixels", 0.0, 1000.0, 48.0);
+		object->speed = add_float_property(object->parent.properties, "speed", "The speed the ticker scrolls left at, in pixels per second", 0.0, 10000.0, 120.0);
+
+		return (aura_object_instance_t*)object;
+	}
+	else if (strcmp(name, "single") == 0)
+	{
+		// Initial object creation
+		acl_single_object_t* object = new acl_single_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_LAYOUT;
+		object->parent.objectType = "single";
+		object->parent.properties = aura_create_property_list();
+
+		object->interval = add_float_property(object->parent.properties, "interval", "The time each item is shown for, in seconds", 0.5, 3600.0, 8.0);
+
+		return (aura_object_instance_t*)object;
+	}
+	else
+	{
+		return NULL;
+	}
+}
+
+/// Frees an object that create_object returned, along with its properties
+static void destroy_object(aura_object_instance_t* object)
+{
+	aura_delete_object(object);
+
+	if (strcmp(object->objectType, "list") == 0)
+	{
+		delete (acl_list_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "ticker") == 0)
+	{
+		delete (acl_ticker_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "single") == 0)
+	{
+		delete (acl_single_object_t*)object;
+	}
+}
+
+static float get_item_width(aura_object_instance_t* object, float width, float /*height*/)
+{
+	if (strcmp(object->objectType, "ticker") == 0)
+	{
+		return (float)((acl_ticker_object_t*)object)->itemWidth->value;
+	}
+
+	return width;
+}
+
+static void arrange(aura_object_instance_t* object, aura_layout_t* layout)
+{
+	if (strcmp(object->objectType, "list") == 0)
+	{
+		// A column of items, one under the other
+		float spacing = (float)((acl_list_object_t*)object)->spacing->value;
+		float y = 0.0f;
+		if (layout->firstChanged > 0)
+		{
+			aura_layout_item_t& previous = layout->items[layout->firstChanged - 1];
+			y = previous.y + previous.height + spacing;
+		}
+		for (size_t i = layout->firstChanged; i < layout->itemCount; i++)
+		{
+			layout->items[i].x = 0.0f;
+			layout->items[i].y = y;
+			y += layout->items[i].height + spacing;
+		}
+
+		layout->horizontal = false;
+		layout->extent = layout->itemCount > 0 ? y - spacing : 0.0f;
+		layout->page = 0.0f;
+	}
+	else if (strcmp(object->objectType, "ticker") == 0)
+	{
+		// A row of items, centred vertically
+		float spacing = (float)((acl_ticker_object_t*)object)->spacing->value;
+		float x = 0.0f;
+		if (layout->firstChanged > 0)
+		{
+			aura_layout_item_t& previous = layout->items[layout->firstChanged - 1];
+			x = previous.x + previous.width + spacing;
+		}
+		for (size_t i = layout->firstChanged; i < layout->itemCount; i++)
+		{
+			float y = (layout->height - layout->items[i].height) / 2.0f;
+			layout->items[i].x = x;
+			layout->items[i].y = y > 0.0f ? y : 0.0f;
+			x += layout->items[i].width + spacing;
+		}
+
+		layout->horizontal = true;
+		layout->extent = layout->itemCount > 0 ? x - spacing : 0.0f;
+		layout->page = 0.0f;
+	}
+	else
+	{
+		// One item per page, centred vertically
+		for (size_t i = layout->firstChanged; i < layout->itemCount; i++)
+		{
+			float y = (layout->height - layout->items[i].height) / 2.0f;
+			layout->items[i].x = 0.0f;
+			layout->items[i].y = i * layout->height + (y > 0.0f ? y : 0.0f);
+		}
+
+		layout->horizontal = false;
+		layout->extent = layout->itemCount * layout->height;
+		layout->page = layout->height;
+	}
+}
+
+AURA_PLUGIN_ENTRY_POINT(aura_core_layouts)
+{
+	plugin.super.getDescription = getDescription;
+	plugin.super.unload = unload;
+	plugin.super.create = create_object;
+	plugin.super.destroy = destroy_object;
+	plugin.super.propertyChanged = NULL;
+	plugin.getItemWidth = get_item_width;
+	plugin.arrange = arrange;
+
+	description.name = "Aura Core Layouts";
+	description.author = "Clayton Peters";
+	description.description = "Provide core layouts of items to aura, such as a scrolling list, a ticker and a single item at a time";
+	description.version = "0.1.0";
+	description.pluginType = AURA_PLUGIN_TYPE_LAYOUT;
+	description.objectTypes = new const char*[4];
+	description.objectTypes[0] = "list";
+	description.objectTypes[1] = "ticker";
+	description.objectTypes[2] = "single";
+	description.objectTypes[3] = NULL;
+
+	return (aura_plugin_t*)&plugin;
+}
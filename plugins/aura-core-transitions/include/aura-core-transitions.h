@@ -0,0 +1,14 @@
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+#ifndef AURA_CORE_TRANSITIONS_H_INCLUDED
+#define AURA_CORE_TRANSITIONS_H_INCLUDED
+
+// Includes:
+#include "libaura/aura.h"
+
+// Definitions:
+#define ACT_DEFAULT_DURATION   1.0
+
+#endif
@@ -0,0 +1,247 @@
+// Includes:
+#include "aura-core-transitions.h"
+
+// Copyright (c) 2014 Clayton Peters
+// This program is distributed under the terms of the GNU Lesser General Public
+// License (LGPL). A copy of the license is included in the file COPYING.LESSER
+
+static aura_transition_plugin_t plugin;
+static aura_plugin_desc_t description;
+
+/// Fragment shader for "fade": a cross-fade between the two items
+static const char* g_fadeShader =
+	"#version 150\n"
+	"uniform sampler2D from;\n"
+	"uniform sampler2D to;\n"
+	"uniform float progress;\n"
+	"in vec2 texCoord;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColour = mix(texture(from, texCoord), texture(to, texCoord), progress);\n"
+	"}\n";
+
+/// Fragment shader for "slide": the outgoing item slides off the display in
+/// the given direction, pushed by the incoming item
+static const char* g_slideShader =
+	"#version 150\n"
+	"uniform sampler2D from;\n"
+	"uniform sampler2D to;\n"
+	"uniform float progress;\n"
+	"uniform int direction;\n"
+	"in vec2 texCoord;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 offset = direction == 0 ? vec2(-1.0, 0.0) : direction == 1 ? vec2(1.0, 0.0) : direction == 2 ? vec2(0.0, 1.0) : vec2(0.0, -1.0);\n"
+	"	vec2 fromCoord = texCoord - offset * progress;\n"
+	"	if (all(greaterThanEqual(fromCoord, vec2(0.0))) && all(lessThanEqual(fromCoord, vec2(1.0))))\n"
+	"	{\n"
+	"		fragColour = texture(from, fromCoord);\n"
+	"	}\n"
+	"	else\n"
+	"	{\n"
+	"		fragColour = texture(to, fromCoord + offset);\n"
+	"	}\n"
+	"}\n";
+
+/// Fragment shader for "wipe": a straight edge sweeps across the display at
+/// the given angle, revealing the incoming item behind it
+static const char* g_wipeShader =
+	"#version 150\n"
+	"uniform sampler2D from;\n"
+	"uniform sampler2D to;\n"
+	"uniform float progress;\n"
+	"uniform vec2 resolution;\n"
+	"uniform float angle;\n"
+	"uniform float softness;\n"
+	"in vec2 texCoord;\n"
+	"out vec4 fragColour;\n"
+	"void main()\n"
+	"{\n"
+	"	float radians = angle * 3.14159265 / 180.0;\n"
+	"	vec2 direction = vec2(cos(radians), -sin(radians));\n"
+	"	vec2 local = (texCoord - 0.5) * resolution;\n"
+	"	float extent = abs(direction.x) * resolution.x + abs(direction.y) * resolution.y;\n"
+	"	float t = dot(local, direction) / extent + 0.5;\n"
+	"	float edge = progress * (1.0 + softness);\n"
+	"	float mask = clamp((edge - t) / max(softness, 0.00001), 0.0, 1.0);\n"
+	"	fragColour = mix(texture(from, texCoord), texture(to, texCoord), mask);\n"
+	"}\n";
+
+typedef struct act_fade_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_float_t* duration;
+} act_fade_object_t;
+
+typedef struct act_slide_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_float_t* duration;
+	aura_property_int_t* direction;
+} act_slide_object_t;
+
+typedef struct act_wipe_object_t
+{
+	// Superclass details (must come first)
+	aura_object_instance_t parent;
+
+	// Properties (also in the property list)
+	aura_property_float_t* duration;
+	aura_property_float_t* angle;
+	aura_property_float_t* softness;
+} act_wipe_object_t;
+
+static aura_plugin_desc_t* getDescription()
+{
+	return &description;
+}
+
+static void unload()
+{
+	delete [] description.objectTypes;
+}
+
+/// Adds a floating point property to a property list
+static aura_property_float_t* add_float_property(aura_properties_t properties, const char* name, const char* description, double minimum, double maximum, double value)
+{
+	aura_property_float_t* property = (aura_property_float_t*)aura_allocate_property(AURA_VARTYPE_FLOAT);
+	property->super.name = name;
+	property->super.description = description;
+	property->minimum = minimum;
+	property->maximum = maximum;
+	property->value = value;
+	aura_add_property(properties, (aura_property_t*)property);
+
+	return property;
+}
+
+/// Adds the duration property that every transition has
+static aura_property_float_t* add_duration_property(aura_properties_t properties)
+{
+	return add_float_property(properties, "duration", "The length of the transition in seconds", 0.1, 10.0, ACT_DEFAULT_DURATION);
+}
+
+static aura_object_instance_t* create_object(const char* name)
+{
+	if (strcmp(name, "fade") == 0)
+	{
+		// Initial object creation
+		act_fade_object_t* object = new act_fade_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_TRANSITION;
+		object->parent.objectType = "fade";
+		object->parent.properties = aura_create_property_list();
+
+		object->duration = add_duration_property(object->parent.properties);
+
+		return (aura_object_instance_t*)object;
+	}
+	else if (strcmp(name, "slide") == 0)
+	{
+		// Initial object creation
+		act_slide_object_t* object = new act_slide_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_TRANSITION;
+		object->parent.objectType = "slide";
+		object->parent.properties = aura_create_property_list();
+
+		object->duration = add_duration_property(object->parent.properties);
+
+		// Which way the items move
+		object->direction = (aura_property_int_t*)aura_allocate_property(AURA_VARTYPE_INT);
+		object->direction->super.name = "direction";
+		object->direction->super.description = "The direction the items move in: 0 left, 1 right, 2 up, 3 down";
+		object->direction->minimum = 0;
+		object->direction->maximum = 3;
+		object->direction->value = 0;
+		aura_add_property(object->parent.properties, (aura_property_t*)object->direction);
+
+		return (aura_object_instance_t*)object;
+	}
+	else if (strcmp(name, "wipe") == 0)
+	{
+		// Initial object creation
+		act_wipe_object_t* object = new act_wipe_object_t;
+		object->parent.pluginType = AURA_PLUGIN_TYPE_TRANSITION;
+		object->parent.objectType = "wipe";
+		object->parent.properties = aura_create_property_list();
+
+		object->duration = add_duration_property(object->parent.properties);
+		object->angle = add_float_property(object->parent.properties, "angle", "The direction the edge moves in, in degrees clockwise from left-to-right", 0.0, 360.0, 0.0);
+		object->softness = add_float_property(object->parent.properties, "softness", "The width of the edge, as a fraction of the display", 0.0, 1.0, 0.05);
+
+		return (aura_object_instance_t*)object;
+	}
+	else
+	{
+		return NULL;
+	}
+}
+
+/// Frees an object that create_object returned, along with its properties
+static void destroy_object(aura_object_instance_t* object)
+{
+	aura_delete_object(object);
+
+	if (strcmp(object->objectType, "fade") == 0)
+	{
+		delete (act_fade_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "slide") == 0)
+	{
+		delete (act_slide_object_t*)object;
+	}
+	else if (strcmp(object->objectType, "wipe") == 0)
+	{
+		delete (act_wipe_object_t*)object;
+	}
+}
+
+static const char* get_shader(aura_object_instance_t* object)
+{
+	if (strcmp(object->objectType, "fade") == 0)
+	{
+		return g_fadeShader;
+	}
+	else if (strcmp(object->objectType, "slide") == 0)
+	{
+		return g_slideShader;
+	}
+	else if (strcmp(object->objectType, "wipe") == 0)
+	{
+		return g_wipeShader;
+	}
+	else
+	{
+		return NULL;
+	}
+}
+
+AURA_PLUGIN_ENTRY_POINT(aura_core_transitions)
+{
+	plugin.super.getDescription = getDescription;
+	plugin.super.unload = unload;
+	plugin.super.create = create_object;
+	plugin.super.destroy = destroy_object;
+	plugin.super.propertyChanged = NULL;
+	plugin.getShader = get_shader;
+
+	description.name = "Aura Core Transitions";
+	description.author = "Clayton Peters";
+	description.description = "Provide core transitions between items to aura, such as fading, sliding and wiping";
+	description.version = "0.1.0";
+	description.pluginType = AURA_PLUGIN_TYPE_TRANSITION;
+	description.objectTypes = new const char*[4];
+	description.objectTypes[0] = "fade";
+	description.objectTypes[1] = "slide";
+	description.objectTypes[2] = "wipe";
+	description.objectTypes[3] = NULL;
+
+	return (aura_plugin_t*)&plugin;
+}